@@ -189,6 +189,7 @@ LOCAL_SRC_FILES := \
     arp_packet.cc \
     async_connection.cc \
     certificate_file.cc \
+    connect_tracer.cc \
     connection.cc \
     connection_diagnostics.cc \
     connection_health_checker.cc \
@@ -203,6 +204,7 @@ LOCAL_SRC_FILES := \
     dbus/chromeos_dhcpcd_listener.cc \
     dbus/chromeos_dhcpcd_proxy.cc \
     dbus/chromeos_firewalld_proxy.cc \
+    decryption_cache.cc \
     default_profile.cc \
     device.cc \
     device_claimer.cc \
@@ -211,6 +213,7 @@ LOCAL_SRC_FILES := \
     dhcp/dhcp_config.cc \
     dhcp/dhcp_provider.cc \
     dhcp/dhcpv4_config.cc \
+    dns_cache.cc \
     dns_client.cc \
     dns_client_factory.cc \
     dns_server_proxy.cc \
@@ -229,6 +232,7 @@ LOCAL_SRC_FILES := \
     geolocation_info.cc \
     hook_table.cc \
     http_proxy.cc \
+    http_proxy_session.cc \
     http_request.cc \
     http_url.cc \
     icmp.cc \
@@ -268,6 +272,7 @@ LOCAL_SRC_FILES := \
     socket_info.cc \
     socket_info_reader.cc \
     static_ip_parameters.cc \
+    storage_worker.cc \
     store_factory.cc \
     technology.cc \
     tethering.cc \
@@ -322,6 +327,7 @@ ifeq ($(SHILL_USE_WIFI), true)
 LOCAL_SRC_FILES += \
     wifi/callback80211_metrics.cc \
     wifi/mac80211_monitor.cc \
+    wifi/roam_scorer.cc \
     wifi/scan_session.cc \
     wifi/tdls_manager.cc \
     wifi/wake_on_wifi.cc \
@@ -419,6 +425,7 @@ LOCAL_SRC_FILES := \
     arp_packet_unittest.cc \
     async_connection_unittest.cc \
     certificate_file_unittest.cc \
+    connect_tracer_unittest.cc \
     connection_diagnostics_unittest.cc \
     connection_health_checker_unittest.cc \
     connection_info_reader_unittest.cc \
@@ -429,6 +436,7 @@ LOCAL_SRC_FILES := \
     crypto_rot47_unittest.cc \
     crypto_util_proxy_unittest.cc \
     daemon_task_unittest.cc \
+    decryption_cache_unittest.cc \
     default_profile_unittest.cc \
     device_claimer_unittest.cc \
     device_info_unittest.cc \
@@ -440,6 +448,7 @@ LOCAL_SRC_FILES := \
     dhcp/mock_dhcp_provider.cc \
     dhcp/mock_dhcp_proxy.cc \
     dhcp_properties_unittest.cc \
+    dns_cache_unittest.cc \
     dns_client_unittest.cc \
     dns_server_tester_unittest.cc \
     error_unittest.cc \
@@ -452,6 +461,7 @@ LOCAL_SRC_FILES := \
     file_reader_unittest.cc \
     hook_table_unittest.cc \
     http_proxy_unittest.cc \
+    http_proxy_session_unittest.cc \
     http_request_unittest.cc \
     http_url_unittest.cc \
     icmp_unittest.cc \
@@ -540,12 +550,14 @@ LOCAL_SRC_FILES := \
     routing_table_unittest.cc \
     rpc_task_unittest.cc \
     scope_logger_unittest.cc \
+    service_property_change_notifier_unittest.cc \
     service_property_change_test.cc \
     service_under_test.cc \
     service_unittest.cc \
     socket_info_reader_unittest.cc \
     socket_info_unittest.cc \
     static_ip_parameters_unittest.cc \
+    storage_worker_unittest.cc \
     technology_unittest.cc \
     testrunner.cc \
     traffic_monitor_unittest.cc \
@@ -574,12 +586,14 @@ LOCAL_SRC_FILES += \
     wifi/callback80211_metrics_unittest.cc \
     wifi/mac80211_monitor_unittest.cc \
     wifi/mock_mac80211_monitor.cc \
+    wifi/mock_roam_scorer.cc \
     wifi/mock_scan_session.cc \
     wifi/mock_tdls_manager.cc \
     wifi/mock_wake_on_wifi.cc \
     wifi/mock_wifi.cc \
     wifi/mock_wifi_provider.cc \
     wifi/mock_wifi_service.cc \
+    wifi/roam_scorer_unittest.cc \
     wifi/scan_session_unittest.cc \
     wifi/tdls_manager_unittest.cc \
     wifi/wake_on_wifi_unittest.cc \
@@ -18,6 +18,8 @@
 
 #include <string>
 
+#include <base/bind.h>
+#include <base/message_loop/message_loop.h>
 #include <utils/String16.h>
 
 #include "android/system/connectivity/shill/IPropertyChangedCallback.h"
@@ -26,6 +28,7 @@
 using android::sp;
 using android::String16;
 using android::system::connectivity::shill::IPropertyChangedCallback;
+using base::Bind;
 using std::string;
 
 namespace shill {
@@ -37,7 +40,8 @@ static string ObjectID(BinderAdaptor* b) {
 }
 }  // namespace Logging
 
-BinderAdaptor::BinderAdaptor(const string& id) : id_(id) {
+BinderAdaptor::BinderAdaptor(const string& id)
+    : id_(id), weak_factory_(this) {
   SLOG(this, 2) << "BinderAdaptor: " << id;
 }
 
@@ -47,8 +51,26 @@ void BinderAdaptor::AddPropertyChangedSignalHandler(
 }
 
 void BinderAdaptor::SendPropertyChangedSignal(const string& name) {
-  for (const auto& callback : property_changed_callbacks_) {
-    callback->OnPropertyChanged(String16(name.c_str()));
+  if (!pending_property_name_set_.insert(name).second) {
+    SLOG(this, 3) << "Coalescing property changed signal for " << name;
+    return;
+  }
+  if (pending_property_names_.empty()) {
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE, Bind(&BinderAdaptor::FlushPropertyChangedSignals,
+                        weak_factory_.GetWeakPtr()));
+  }
+  pending_property_names_.push_back(name);
+}
+
+void BinderAdaptor::FlushPropertyChangedSignals() {
+  std::vector<string> names;
+  names.swap(pending_property_names_);
+  pending_property_name_set_.clear();
+  for (const auto& name : names) {
+    for (const auto& callback : property_changed_callbacks_) {
+      callback->OnPropertyChanged(String16(name.c_str()));
+    }
   }
 }
 
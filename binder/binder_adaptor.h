@@ -17,10 +17,12 @@
 #ifndef SHILL_BINDER_BINDER_ADAPTOR_H_
 #define SHILL_BINDER_BINDER_ADAPTOR_H_
 
+#include <set>
 #include <string>
 #include <vector>
 
 #include <base/macros.h>
+#include <base/memory/weak_ptr.h>
 #include <utils/StrongPointer.h>
 
 namespace android {
@@ -52,12 +54,17 @@ class BinderAdaptor {
 
   // Signals all registered listeners the shill property |name| has changed by
   // calling the OnPropertyChanged() method of all IPropertyChangedCallback
-  // binders in |property_changed_callbacks_|.
+  // binders in |property_changed_callbacks_|.  Signals are sent once control
+  // returns to the message loop, and a property that changes several times
+  // before then is only signalled once.
   void SendPropertyChangedSignal(const std::string& name);
 
   const std::string& id() { return id_; }
 
  private:
+  // Sends the signals queued by SendPropertyChangedSignal().
+  void FlushPropertyChangedSignals();
+
   // Used to uniquely identify this Binder adaptor.
   std::string id_;
 
@@ -65,6 +72,13 @@ class BinderAdaptor {
       android::system::connectivity::shill::IPropertyChangedCallback>>
       property_changed_callbacks_;
 
+  // Names of properties with a queued signal, in the order in which they
+  // were first queued, and the same names as a set for deduplication.
+  std::vector<std::string> pending_property_names_;
+  std::set<std::string> pending_property_name_set_;
+
+  base::WeakPtrFactory<BinderAdaptor> weak_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(BinderAdaptor);
 };
 
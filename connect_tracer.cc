@@ -0,0 +1,115 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/connect_tracer.h"
+
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
+
+#include "shill/logging.h"
+#include "shill/net/shill_time.h"
+
+using base::StringPrintf;
+using std::string;
+using std::vector;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kMetrics;
+static string ObjectID(const ConnectTracer* c) { return "(connect_tracer)"; }
+}
+
+const size_t ConnectTracer::kMaxTraces = 16;
+
+ConnectTracer::ConnectTracer() : time_(Time::GetInstance()) {}
+
+ConnectTracer::~ConnectTracer() {}
+
+void ConnectTracer::NotifyServiceStateChanged(
+    const string& service_name,
+    Technology::Identifier technology,
+    Service::ConnectState state) {
+  struct timeval now;
+  time_->GetTimeMonotonic(&now);
+
+  auto it = active_traces_.find(service_name);
+  if (state == Service::kStateAssociating) {
+    if (it != active_traces_.end()) {
+      // A new connect attempt supersedes the one in progress.
+      FinishTrace(service_name);
+    }
+    Trace& trace = active_traces_[service_name];
+    trace.service_name = service_name;
+    trace.technology = technology;
+    trace.start_time = now;
+    it = active_traces_.find(service_name);
+  } else if (it == active_traces_.end()) {
+    return;
+  }
+
+  Trace& trace = it->second;
+  struct timeval elapsed;
+  timersub(&now, &trace.start_time, &elapsed);
+  Event event;
+  event.state = state;
+  event.milliseconds =
+      static_cast<int64_t>(elapsed.tv_sec) * 1000 + elapsed.tv_usec / 1000;
+  trace.events.push_back(event);
+
+  if (state == Service::kStateOnline ||
+      state == Service::kStateFailure ||
+      state == Service::kStateIdle) {
+    FinishTrace(service_name);
+  }
+}
+
+void ConnectTracer::NotifyServiceRemoved(const string& service_name) {
+  if (active_traces_.find(service_name) != active_traces_.end()) {
+    FinishTrace(service_name);
+  }
+}
+
+vector<string> ConnectTracer::FormatTraces() const {
+  vector<string> lines;
+  for (const auto& trace : traces_) {
+    vector<string> fields;
+    fields.push_back(trace.service_name);
+    fields.push_back(Technology::NameFromIdentifier(trace.technology));
+    for (const auto& event : trace.events) {
+      fields.push_back(
+          StringPrintf("%s=%s",
+                       Service::ConnectStateToString(event.state),
+                       base::Int64ToString(event.milliseconds).c_str()));
+    }
+    lines.push_back(base::JoinString(fields, " "));
+  }
+  return lines;
+}
+
+void ConnectTracer::FinishTrace(const string& service_name) {
+  auto it = active_traces_.find(service_name);
+  SLOG(this, 3) << __func__ << ": " << service_name << " with "
+                << it->second.events.size() << " events";
+  if (traces_.size() >= kMaxTraces) {
+    traces_.pop_front();
+  }
+  traces_.push_back(it->second);
+  active_traces_.erase(it);
+}
+
+}  // namespace shill
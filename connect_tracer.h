@@ -0,0 +1,96 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SHILL_CONNECT_TRACER_H_
+#define SHILL_CONNECT_TRACER_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "shill/service.h"
+#include "shill/technology.h"
+
+namespace shill {
+
+class Time;
+
+// Records when a service passes through each connection state during a
+// connect, measured on the monotonic clock, so that the time from the
+// start of association to the service coming online can be broken down by
+// phase.  The traces of the most recent connects are kept in a ring buffer.
+class ConnectTracer {
+ public:
+  struct Event {
+    Service::ConnectState state;
+    // Time since the start of the trace.
+    int64_t milliseconds;
+  };
+
+  struct Trace {
+    Trace() : technology(Technology::kUnknown), start_time{} {}
+
+    std::string service_name;
+    Technology::Identifier technology;
+    struct timeval start_time;
+    std::vector<Event> events;
+  };
+
+  // Number of completed traces kept.
+  static const size_t kMaxTraces;
+
+  ConnectTracer();
+  virtual ~ConnectTracer();
+
+  // Records the transition of the service named |service_name| to |state|.
+  // A trace starts when a service begins associating and is complete once
+  // the service is online, fails or goes idle.
+  void NotifyServiceStateChanged(const std::string& service_name,
+                                 Technology::Identifier technology,
+                                 Service::ConnectState state);
+
+  // Completes any trace in progress for |service_name|.
+  void NotifyServiceRemoved(const std::string& service_name);
+
+  // Returns the completed traces, oldest first.
+  const std::deque<Trace>& traces() const { return traces_; }
+
+  // Returns one line per completed trace, oldest first, of the form
+  // "<service> <technology> Associating=0 Configuring=812 Connected=2034
+  // Online=2901", with times in milliseconds.
+  std::vector<std::string> FormatTraces() const;
+
+ private:
+  friend class ConnectTracerTest;
+
+  void FinishTrace(const std::string& service_name);
+
+  std::map<std::string, Trace> active_traces_;
+  std::deque<Trace> traces_;
+  Time* time_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConnectTracer);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_CONNECT_TRACER_H_
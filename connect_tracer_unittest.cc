@@ -0,0 +1,152 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/connect_tracer.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "shill/net/mock_time.h"
+
+using std::string;
+using std::vector;
+using testing::_;
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgumentPointee;
+using testing::Test;
+
+namespace shill {
+
+namespace {
+const char kServiceName[] = "wifi_0";
+const char kOtherServiceName[] = "ethernet_0";
+}  // namespace
+
+class ConnectTracerTest : public Test {
+ public:
+  ConnectTracerTest() {
+    tracer_.time_ = &time_;
+    now_.tv_sec = 1000;
+    now_.tv_usec = 0;
+  }
+
+  void SetUp() override {
+    AdvanceTime(0);
+  }
+
+ protected:
+  void AdvanceTime(int milliseconds) {
+    struct timeval delta = { milliseconds / 1000,
+                             (milliseconds % 1000) * 1000 };
+    timeradd(&now_, &delta, &now_);
+    EXPECT_CALL(time_, GetTimeMonotonic(_))
+        .WillRepeatedly(DoAll(SetArgumentPointee<0>(now_), Return(0)));
+  }
+
+  void SetState(const string& service_name, Service::ConnectState state) {
+    tracer_.NotifyServiceStateChanged(service_name, Technology::kWifi, state);
+  }
+
+  size_t GetActiveTraceCount() const { return tracer_.active_traces_.size(); }
+
+  ConnectTracer tracer_;
+  MockTime time_;
+  struct timeval now_;
+};
+
+TEST_F(ConnectTracerTest, ConnectToOnline) {
+  // Transitions before the start of a connect are not traced.
+  SetState(kServiceName, Service::kStateIdle);
+  EXPECT_EQ(0, GetActiveTraceCount());
+
+  SetState(kServiceName, Service::kStateAssociating);
+  AdvanceTime(812);
+  SetState(kServiceName, Service::kStateConfiguring);
+  AdvanceTime(1222);
+  SetState(kServiceName, Service::kStateConnected);
+  AdvanceTime(867);
+  SetState(kServiceName, Service::kStateOnline);
+  EXPECT_EQ(0, GetActiveTraceCount());
+
+  ASSERT_EQ(1, tracer_.traces().size());
+  const ConnectTracer::Trace& trace = tracer_.traces().front();
+  EXPECT_EQ(kServiceName, trace.service_name);
+  EXPECT_EQ(Technology::kWifi, trace.technology);
+  ASSERT_EQ(4, trace.events.size());
+  EXPECT_EQ(Service::kStateConfiguring, trace.events[1].state);
+  EXPECT_EQ(812, trace.events[1].milliseconds);
+  EXPECT_EQ(Service::kStateOnline, trace.events[3].state);
+  EXPECT_EQ(2901, trace.events[3].milliseconds);
+
+  EXPECT_EQ((vector<string>{
+                "wifi_0 wifi Associating=0 Configuring=812 Connected=2034 "
+                "Online=2901"}),
+            tracer_.FormatTraces());
+}
+
+TEST_F(ConnectTracerTest, PortalThenFailure) {
+  SetState(kServiceName, Service::kStateAssociating);
+  AdvanceTime(100);
+  SetState(kServiceName, Service::kStateConfiguring);
+  SetState(kServiceName, Service::kStateConnected);
+  SetState(kServiceName, Service::kStatePortal);
+  // A service in the portal state may still come online.
+  EXPECT_EQ(1, GetActiveTraceCount());
+  EXPECT_TRUE(tracer_.traces().empty());
+
+  AdvanceTime(100);
+  SetState(kServiceName, Service::kStateFailure);
+  ASSERT_EQ(1, tracer_.traces().size());
+  const ConnectTracer::Event& last_event =
+      tracer_.traces().back().events.back();
+  EXPECT_EQ(Service::kStateFailure, last_event.state);
+  EXPECT_EQ(200, last_event.milliseconds);
+}
+
+TEST_F(ConnectTracerTest, InterleavedServices) {
+  SetState(kServiceName, Service::kStateAssociating);
+  tracer_.NotifyServiceStateChanged(kOtherServiceName, Technology::kEthernet,
+                                    Service::kStateAssociating);
+  AdvanceTime(50);
+  tracer_.NotifyServiceStateChanged(kOtherServiceName, Technology::kEthernet,
+                                    Service::kStateOnline);
+  // Restarting a connect completes the trace of the earlier attempt.
+  SetState(kServiceName, Service::kStateAssociating);
+  tracer_.NotifyServiceRemoved(kServiceName);
+  EXPECT_EQ(0, GetActiveTraceCount());
+
+  ASSERT_EQ(3, tracer_.traces().size());
+  EXPECT_EQ(kOtherServiceName, tracer_.traces()[0].service_name);
+  EXPECT_EQ(kServiceName, tracer_.traces()[1].service_name);
+  EXPECT_EQ(1, tracer_.traces()[1].events.size());
+  EXPECT_EQ(kServiceName, tracer_.traces()[2].service_name);
+}
+
+TEST_F(ConnectTracerTest, RingBuffer) {
+  for (size_t i = 0; i < ConnectTracer::kMaxTraces + 2; ++i) {
+    SetState("service" + std::to_string(i), Service::kStateAssociating);
+    SetState("service" + std::to_string(i), Service::kStateFailure);
+  }
+  ASSERT_EQ(ConnectTracer::kMaxTraces, tracer_.traces().size());
+  EXPECT_EQ("service2", tracer_.traces().front().service_name);
+  EXPECT_EQ("service" + std::to_string(ConnectTracer::kMaxTraces + 1),
+            tracer_.traces().back().service_name);
+}
+
+}  // namespace shill
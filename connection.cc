@@ -25,9 +25,12 @@
 
 #include "shill/control_interface.h"
 #include "shill/device_info.h"
+#include "shill/dns_cache.h"
 #include "shill/firewall_proxy_interface.h"
 #include "shill/logging.h"
 #include "shill/net/rtnl_handler.h"
+#include "shill/net/rtnl_listener.h"
+#include "shill/net/rtnl_message.h"
 #include "shill/routing_table.h"
 
 #if !defined(__ANDROID__)
@@ -74,6 +77,39 @@ const uint32_t Connection::kMarkForUserTraffic = 0x1;
 // static
 const uint8_t Connection::kSecondaryTableId = 0x1;
 
+namespace {
+
+bool RoutesEqual(const vector<IPConfig::Route>& a,
+                 const vector<IPConfig::Route>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].host != b[i].host ||
+        a[i].netmask != b[i].netmask ||
+        a[i].gateway != b[i].gateway) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Connection::AppliedConfig::AppliedConfig()
+    : has_address(false),
+      local(IPAddress::kFamilyUnknown),
+      broadcast(IPAddress::kFamilyUnknown),
+      peer(IPAddress::kFamilyUnknown),
+      has_routes(false),
+      routes_table_id(RT_TABLE_MAIN),
+      has_mtu(false),
+      mtu(IPConfig::kUndefinedMTU),
+      has_blackhole_route(false),
+      blackhole_table_id(RT_TABLE_MAIN),
+      has_iptable_entries(false),
+      has_dns_config(false) {}
+
 Connection::Binder::Binder(const string& name,
                            const Closure& disconnect_callback)
     : name_(name),
@@ -124,6 +160,7 @@ Connection::Connection(int interface_index,
       table_id_(RT_TABLE_MAIN),
       local_(IPAddress::kFamilyUnknown),
       gateway_(IPAddress::kFamilyUnknown),
+      skipped_update_operations_(0),
       lower_binder_(
           interface_name_,
           // Connection owns a single instance of |lower_binder_| so it's safe
@@ -141,6 +178,12 @@ Connection::Connection(int interface_index,
   SLOG(this, 2) << __func__ << "(" << interface_index << ", "
                 << interface_name << ", "
                 << Technology::NameFromIdentifier(technology) << ")";
+  // Connection owns |address_route_listener_|, so it's safe to use an
+  // Unretained callback.
+  address_route_listener_.reset(
+      new RTNLListener(RTNLHandler::kRequestAddr | RTNLHandler::kRequestRoute,
+                       Bind(&Connection::AddressOrRouteMsgHandler,
+                            Unretained(this))));
 }
 
 Connection::~Connection() {
@@ -153,18 +196,21 @@ Connection::~Connection() {
   routing_table_->FlushRoutesWithTag(interface_index_);
   device_info_->FlushAddresses(interface_index_);
   TearDownIptableEntries();
+  // Answers obtained over this connection may not be valid on the next
+  // network brought up on the same interface.
+  DNSCache::GetInstance()->FlushInterface(interface_name_);
 }
 
 void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
   SLOG(this, 2) << __func__ << " " << interface_name_;
 
   const IPConfig::Properties& properties = config->properties();
+  const IPConfig::ParsedProperties& parsed = config->parsed_properties();
   user_traffic_only_ = properties.user_traffic_only;
   table_id_ = user_traffic_only_ ? kSecondaryTableId : (uint8_t)RT_TABLE_MAIN;
 
-  IPAddress gateway(properties.address_family);
-  if (!properties.gateway.empty() &&
-      !gateway.SetAddressFromString(properties.gateway)) {
+  IPAddress gateway(parsed.gateway);
+  if (!properties.gateway.empty() && !gateway.IsValid()) {
     LOG(ERROR) << "Gateway address " << properties.gateway << " is invalid";
     return;
   }
@@ -198,28 +244,26 @@ void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
     }
   }
 
-  IPAddress local(properties.address_family);
-  if (!local.SetAddressFromString(properties.address)) {
+  const IPAddress& local = parsed.local;
+  if (!local.IsValid()) {
     LOG(ERROR) << "Local address " << properties.address << " is invalid";
     return;
   }
-  local.set_prefix(properties.subnet_prefix);
 
-  IPAddress broadcast(properties.address_family);
+  IPAddress broadcast(parsed.broadcast);
   if (properties.broadcast_address.empty()) {
     if (properties.peer_address.empty()) {
       LOG(WARNING) << "Broadcast address is not set.  Using default.";
       broadcast = local.GetDefaultBroadcast();
     }
-  } else if (!broadcast.SetAddressFromString(properties.broadcast_address)) {
+  } else if (!broadcast.IsValid()) {
     LOG(ERROR) << "Broadcast address " << properties.broadcast_address
                << " is invalid";
     return;
   }
 
-  IPAddress peer(properties.address_family);
-  if (!properties.peer_address.empty() &&
-      !peer.SetAddressFromString(properties.peer_address)) {
+  IPAddress peer(parsed.peer);
+  if (!properties.peer_address.empty() && !peer.IsValid()) {
     LOG(ERROR) << "Peer address " << properties.peer_address
                << " is invalid";
     return;
@@ -235,14 +279,28 @@ void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
     LOG(INFO) << __func__ << ": Flushing old addresses and routes.";
     routing_table_->FlushRoutes(interface_index_);
     device_info_->FlushAddresses(interface_index_);
+    applied_config_ = AppliedConfig();
   }
 
-  LOG(INFO) << __func__ << ": Installing with parameters:"
-            << " local=" << local.ToString()
-            << " broadcast=" << broadcast.ToString()
-            << " peer=" << peer.ToString()
-            << " gateway=" << gateway.ToString();
-  rtnl_handler_->AddInterfaceAddress(interface_index_, local, broadcast, peer);
+  const uint64_t skipped_before = skipped_update_operations_;
+  if (applied_config_.has_address &&
+      applied_config_.local.Equals(local) &&
+      applied_config_.broadcast.Equals(broadcast) &&
+      applied_config_.peer.Equals(peer)) {
+    ++skipped_update_operations_;
+  } else {
+    LOG(INFO) << __func__ << ": Installing with parameters:"
+              << " local=" << local.ToString()
+              << " broadcast=" << broadcast.ToString()
+              << " peer=" << peer.ToString()
+              << " gateway=" << gateway.ToString();
+    rtnl_handler_->AddInterfaceAddress(interface_index_, local, broadcast,
+                                       peer);
+    applied_config_.has_address = true;
+    applied_config_.local = local;
+    applied_config_.broadcast = broadcast;
+    applied_config_.peer = peer;
+  }
 
   if (gateway.IsValid() && properties.default_route) {
     routing_table_->SetDefaultRoute(interface_index_, gateway,
@@ -251,22 +309,52 @@ void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
   }
 
   if (user_traffic_only_) {
-    SetupIptableEntries();
+    if (applied_config_.has_iptable_entries) {
+      ++skipped_update_operations_;
+    } else {
+      applied_config_.has_iptable_entries = SetupIptableEntries();
+    }
   }
 
   // Install any explicitly configured routes at the default metric.
-  routing_table_->ConfigureRoutes(interface_index_, config, kDefaultMetric,
-                                  table_id_);
+  if (applied_config_.has_routes &&
+      applied_config_.routes_table_id == table_id_ &&
+      RoutesEqual(applied_config_.routes, properties.routes)) {
+    ++skipped_update_operations_;
+  } else {
+    routing_table_->ConfigureRoutes(interface_index_, config, kDefaultMetric,
+                                    table_id_);
+    applied_config_.has_routes = true;
+    applied_config_.routes_table_id = table_id_;
+    applied_config_.routes = properties.routes;
+  }
 
-  SetMTU(properties.mtu);
+  if (applied_config_.has_mtu && applied_config_.mtu == properties.mtu) {
+    ++skipped_update_operations_;
+  } else {
+    SetMTU(properties.mtu);
+    applied_config_.has_mtu = true;
+    applied_config_.mtu = properties.mtu;
+  }
 
   if (properties.blackhole_ipv6) {
-    routing_table_->CreateBlackholeRoute(interface_index_,
-                                         IPAddress::kFamilyIPv6,
-                                         kDefaultMetric,
-                                         table_id_);
+    if (applied_config_.has_blackhole_route &&
+        applied_config_.blackhole_table_id == table_id_) {
+      ++skipped_update_operations_;
+    } else {
+      routing_table_->CreateBlackholeRoute(interface_index_,
+                                           IPAddress::kFamilyIPv6,
+                                           kDefaultMetric,
+                                           table_id_);
+      applied_config_.has_blackhole_route = true;
+      applied_config_.blackhole_table_id = table_id_;
+    }
   }
 
+  const vector<string> old_dns_servers = dns_servers_;
+  const vector<string> old_dns_domain_search = dns_domain_search_;
+  const string old_dns_domain_name = dns_domain_name_;
+
   // Save a copy of the last non-null DNS config.
   if (!config->properties().dns_servers.empty()) {
     dns_servers_ = config->properties().dns_servers;
@@ -292,7 +380,22 @@ void Connection::UpdateFromIPConfig(const IPConfigRefPtr& config) {
 
   ipconfig_rpc_identifier_ = config->GetRpcIdentifier();
 
-  PushDNSConfig();
+  if (applied_config_.has_dns_config &&
+      dns_servers_ == old_dns_servers &&
+      dns_domain_search_ == old_dns_domain_search &&
+      dns_domain_name_ == old_dns_domain_name) {
+    ++skipped_update_operations_;
+  } else {
+    PushDNSConfig();
+    applied_config_.has_dns_config = true;
+  }
+
+  if (skipped_update_operations_ != skipped_before) {
+    SLOG(this, 2) << __func__ << ": skipped "
+                  << skipped_update_operations_ - skipped_before
+                  << " unchanged operation(s), "
+                  << skipped_update_operations_ << " in total";
+  }
 
   local_ = local;
   gateway_ = gateway;
@@ -623,6 +726,64 @@ void Connection::OnRouteQueryResponse(int interface_index,
   PinPendingRoutes(interface_index, entry);
 }
 
+void Connection::AddressOrRouteMsgHandler(const RTNLMessage& msg) {
+  if (msg.mode() != RTNLMessage::kModeDelete) {
+    return;
+  }
+
+  if (msg.type() == RTNLMessage::kTypeAddress) {
+    if (static_cast<int>(msg.interface_index()) != interface_index_ ||
+        !applied_config_.has_address) {
+      return;
+    }
+    IPAddress address(msg.family(),
+                      msg.HasAttribute(IFA_LOCAL) ?
+                      msg.GetAttribute(IFA_LOCAL) :
+                      msg.GetAttribute(IFA_ADDRESS));
+    if (!address.HasSameAddressAs(applied_config_.local)) {
+      return;
+    }
+    SLOG(this, 2) << __func__ << ": Address " << address.ToString()
+                  << " was removed from " << interface_name_;
+    // The kernel drops the routes that depended on the address without
+    // reporting each of them, so they need to be installed again too.
+    applied_config_.has_address = false;
+    applied_config_.has_routes = false;
+    return;
+  }
+
+  if (msg.type() != RTNLMessage::kTypeRoute || !applied_config_.has_routes ||
+      msg.route_status().table != applied_config_.routes_table_id ||
+      !msg.HasAttribute(RTA_OIF)) {
+    return;
+  }
+  uint32_t interface_index = 0;
+  if (!msg.GetAttribute(RTA_OIF).ConvertToCPUUInt32(&interface_index) ||
+      static_cast<int>(interface_index) != interface_index_) {
+    return;
+  }
+  IPAddress destination(msg.family());
+  destination.SetAddressToDefault();
+  if (msg.HasAttribute(RTA_DST)) {
+    destination = IPAddress(msg.family(), msg.GetAttribute(RTA_DST));
+  }
+  destination.set_prefix(msg.route_status().dst_prefix);
+  for (const auto& route : applied_config_.routes) {
+    IPAddress route_destination(msg.family());
+    if (!route_destination.SetAddressFromString(route.host)) {
+      continue;
+    }
+    route_destination.set_prefix(
+        IPAddress::GetPrefixLengthFromMask(msg.family(), route.netmask));
+    if (route_destination.Equals(destination)) {
+      SLOG(this, 2) << __func__ << ": Route to " << destination.ToString()
+                    << " was removed from " << interface_name_;
+      applied_config_.has_routes = false;
+      return;
+    }
+  }
+}
+
 bool Connection::CreateGatewayRoute() {
   // Ensure that the gateway for the lower connection remains reachable,
   // since we may create routes that conflict with it.
@@ -36,6 +36,8 @@ class ControlInterface;
 class DeviceInfo;
 class FirewallProxyInterface;
 class RTNLHandler;
+class RTNLListener;
+class RTNLMessage;
 #if !defined(__ANDROID__)
 class Resolver;
 #else
@@ -168,6 +170,8 @@ class Connection : public base::RefCounted<Connection> {
   FRIEND_TEST(ConnectionTest, RequestHostRoute);
   FRIEND_TEST(ConnectionTest, SetMTU);
   FRIEND_TEST(ConnectionTest, UpdateDNSServers);
+  FRIEND_TEST(ConnectionTest, UpdateFromChangedIPConfig);
+  FRIEND_TEST(ConnectionTest, UpdateFromUnchangedIPConfig);
   FRIEND_TEST(VPNServiceTest, OnConnectionDisconnected);
 
   static const uint32_t kDefaultMetric;
@@ -175,6 +179,28 @@ class Connection : public base::RefCounted<Connection> {
   static const uint32_t kMarkForUserTraffic;
   static const uint8_t kSecondaryTableId;
 
+  // The state that UpdateFromIPConfig() has installed in the kernel and
+  // the resolver.  Updates compare against it and skip the operations
+  // whose result is already in place, so that a DHCP renewal that changes
+  // nothing does not churn addresses, routes and DNS configuration.
+  struct AppliedConfig {
+    AppliedConfig();
+
+    bool has_address;
+    IPAddress local;
+    IPAddress broadcast;
+    IPAddress peer;
+    bool has_routes;
+    uint8_t routes_table_id;
+    std::vector<IPConfig::Route> routes;
+    bool has_mtu;
+    int32_t mtu;
+    bool has_blackhole_route;
+    uint8_t blackhole_table_id;
+    bool has_iptable_entries;
+    bool has_dns_config;
+  };
+
   // Work around misconfigured servers which provide a gateway address that
   // is unreachable with the provided netmask.
   bool FixGatewayReachability(const IPAddress& local,
@@ -188,6 +214,11 @@ class Connection : public base::RefCounted<Connection> {
   void OnRouteQueryResponse(int interface_index,
                             const RoutingTableEntry& entry);
 
+  // Forgets the parts of |applied_config_| that an address or route removed
+  // from this interface, possibly outside of shill, has undone, so that the
+  // next UpdateFromIPConfig() installs them again.
+  void AddressOrRouteMsgHandler(const RTNLMessage& msg);
+
   void AttachBinder(Binder* binder);
   void DetachBinder(Binder* binder);
   void NotifyBindersOnDisconnect();
@@ -214,6 +245,10 @@ class Connection : public base::RefCounted<Connection> {
   uint8_t table_id_;
   IPAddress local_;
   IPAddress gateway_;
+  AppliedConfig applied_config_;
+  // Number of operations UpdateFromIPConfig() skipped because their result
+  // was already in place.
+  uint64_t skipped_update_operations_;
 
   // Track the tethering status of the Service associated with this connection.
   // This property is set by a service as it takes ownership of a connection,
@@ -237,6 +272,7 @@ class Connection : public base::RefCounted<Connection> {
 #endif  // __ANDROID__;
   RoutingTable* routing_table_;
   RTNLHandler* rtnl_handler_;
+  std::unique_ptr<RTNLListener> address_route_listener_;
 
   ControlInterface* control_interface_;
   std::unique_ptr<FirewallProxyInterface> firewall_proxy_;
@@ -40,6 +40,7 @@
 #endif  // __ANDROID__
 #include "shill/mock_routing_table.h"
 #include "shill/net/mock_rtnl_handler.h"
+#include "shill/net/rtnl_message.h"
 #include "shill/routing_table_entry.h"
 
 using std::string;
@@ -141,6 +142,40 @@ class ConnectionTest : public Test {
     ip6config_->UpdateProperties(ipv6_properties_, true);
   }
 
+  // Reports to |connection_| that |address| was removed from its interface.
+  void ReportAddressRemoved(const IPAddress& address) {
+    RTNLMessage message(RTNLMessage::kTypeAddress,
+                        RTNLMessage::kModeDelete,
+                        0,
+                        0,
+                        0,
+                        kTestDeviceInterfaceIndex0,
+                        address.family());
+    message.SetAttribute(IFA_ADDRESS, address.address());
+    message.set_address_status(
+        RTNLMessage::AddressStatus(address.prefix(), 0, RT_SCOPE_UNIVERSE));
+    connection_->AddressOrRouteMsgHandler(message);
+  }
+
+  // Reports to |connection_| that the route to |destination| through its
+  // interface was removed from the main table.
+  void ReportRouteRemoved(const IPAddress& destination) {
+    RTNLMessage message(RTNLMessage::kTypeRoute,
+                        RTNLMessage::kModeDelete,
+                        0,
+                        0,
+                        0,
+                        0,
+                        destination.family());
+    message.SetAttribute(RTA_DST, destination.address());
+    message.SetAttribute(
+        RTA_OIF, ByteString::CreateFromCPUUInt32(kTestDeviceInterfaceIndex0));
+    message.set_route_status(RTNLMessage::RouteStatus(
+        destination.prefix(), 0, RT_TABLE_MAIN, RTPROT_BOOT,
+        RT_SCOPE_UNIVERSE, RTN_UNICAST, 0));
+    connection_->AddressOrRouteMsgHandler(message);
+  }
+
   bool PinHostRoute(ConnectionRefPtr connection,
                     const IPAddress trusted_ip,
                     const IPAddress gateway) {
@@ -360,6 +395,121 @@ TEST_F(ConnectionTest, AddConfig) {
   EXPECT_FALSE(connection_->is_default());
 }
 
+TEST_F(ConnectionTest, UpdateFromUnchangedIPConfig) {
+  EXPECT_CALL(*device_info_, HasOtherAddress(_, _))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _));
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, _));
+  connection_->UpdateFromIPConfig(ipconfig_);
+  EXPECT_EQ(0, connection_->skipped_update_operations_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // A renewal with identical parameters does not touch the address, the
+  // explicit routes, the MTU or the DNS configuration.  The default route
+  // is left to RoutingTable, which only updates it when it differs.
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _)).Times(0);
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _)).Times(0);
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, _)).Times(0);
+  UpdateProperties();
+  connection_->UpdateFromIPConfig(ipconfig_);
+  EXPECT_EQ(4, connection_->skipped_update_operations_);
+}
+
+TEST_F(ConnectionTest, UpdateFromChangedIPConfig) {
+  EXPECT_CALL(*device_info_, HasOtherAddress(_, _))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _));
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, IPConfig::kDefaultMTU));
+  connection_->UpdateFromIPConfig(ipconfig_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // Only the MTU changed, so only the MTU is applied.
+  const int kMTU = 1400;
+  properties_.mtu = kMTU;
+  UpdateProperties();
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _)).Times(0);
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _)).Times(0);
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, kMTU));
+  connection_->UpdateFromIPConfig(ipconfig_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // Flushing a stale address reinstalls everything.
+  EXPECT_CALL(*device_info_, HasOtherAddress(_, _)).WillOnce(Return(true));
+  EXPECT_CALL(routing_table_, FlushRoutes(kTestDeviceInterfaceIndex0));
+  EXPECT_CALL(*device_info_, FlushAddresses(kTestDeviceInterfaceIndex0));
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _));
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillOnce(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, kMTU));
+  connection_->UpdateFromIPConfig(ipconfig_);
+}
+
+TEST_F(ConnectionTest, UpdateFromIPConfigAfterAddressOrRouteLoss) {
+  IPConfig::Route route;
+  route.host = "10.0.0.0";
+  route.netmask = "255.255.0.0";
+  route.gateway = kGatewayAddress0;
+  properties_.routes.push_back(route);
+  UpdateProperties();
+  EXPECT_CALL(*device_info_, HasOtherAddress(_, _))
+      .WillRepeatedly(Return(false));
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _));
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  EXPECT_CALL(rtnl_handler_, SetInterfaceMTU(_, _));
+  connection_->UpdateFromIPConfig(ipconfig_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // Losing a route that was not installed from the IPConfig changes nothing.
+  IPAddress other_destination(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(other_destination.SetAddressAndPrefixFromString("10.1.0.0/16"));
+  ReportRouteRemoved(other_destination);
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _)).Times(0);
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _)).Times(0);
+  connection_->UpdateFromIPConfig(ipconfig_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // Losing an installed route, for example to "ip route del" outside shill,
+  // installs the routes again.
+  IPAddress destination(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(destination.SetAddressAndPrefixFromString("10.0.0.0/16"));
+  ReportRouteRemoved(destination);
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _)).Times(0);
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  connection_->UpdateFromIPConfig(ipconfig_);
+  Mock::VerifyAndClearExpectations(&rtnl_handler_);
+  Mock::VerifyAndClearExpectations(&routing_table_);
+
+  // Losing the address installs the address and the routes again.
+  ReportAddressRemoved(local_address_);
+  EXPECT_CALL(rtnl_handler_, AddInterfaceAddress(_, _, _, _));
+  EXPECT_CALL(routing_table_, SetDefaultRoute(_, _, _, _))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(routing_table_, ConfigureRoutes(_, _, _, _));
+  connection_->UpdateFromIPConfig(ipconfig_);
+}
+
 TEST_F(ConnectionTest, AddConfigUserTrafficOnly) {
   ConnectionRefPtr connection = GetNewConnection();
   const std::string kExcludeAddress1 = "192.0.1.0/24";
@@ -38,6 +38,7 @@
 #include "shill/process_manager.h"
 #include "shill/routing_table.h"
 #include "shill/shill_config.h"
+#include "shill/store_factory.h"
 
 #if !defined(DISABLE_WIFI)
 #include "shill/net/netlink_manager.h"
@@ -168,6 +169,9 @@ void DaemonTask::Start() {
                        RTMGRP_IPV6_IFADDR | RTMGRP_IPV6_ROUTE |
                        RTMGRP_ND_USEROPT);
   routing_table_->Start();
+  if (!StoreFactory::GetInstance()->StartStorageWorker()) {
+    LOG(WARNING) << "Profile storage will be written synchronously.";
+  }
   dhcp_provider_->Init(control_.get(), dispatcher_.get(), metrics_.get());
   process_manager_->Init(dispatcher_.get());
 #if !defined(DISABLE_WIFI)
@@ -194,6 +198,10 @@ void DaemonTask::Start() {
 }
 
 void DaemonTask::Stop() {
+  // Complete the queued profile writes, so that the final profile saves made
+  // while stopping |manager_| are written synchronously and their results
+  // are seen by the caller.
+  StoreFactory::GetInstance()->StopStorageWorker();
   manager_->Stop();
   manager_ = nullptr;  // Release manager resources, including DBus adaptor.
 #if !defined(DISABLE_WIFI)
@@ -20,6 +20,7 @@
 
 #include <base/bind.h>
 #include <base/callback.h>
+#include <base/message_loop/message_loop.h>
 
 #include "shill/error.h"
 #include "shill/logging.h"
@@ -53,6 +54,37 @@ ChromeosDBusAdaptor::ChromeosDBusAdaptor(const scoped_refptr<dbus::Bus>& bus,
 
 ChromeosDBusAdaptor::~ChromeosDBusAdaptor() {}
 
+void ChromeosDBusAdaptor::QueuePropertyChangedSignal(
+    const string& name, const brillo::Any& value) {
+  if (pending_property_names_.empty()) {
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE,
+        Bind(&ChromeosDBusAdaptor::FlushPropertyChangedSignals, AsWeakPtr()));
+  }
+  auto it = pending_property_values_.find(name);
+  if (it != pending_property_values_.end()) {
+    SLOG(this, 3) << "Coalescing PropertyChanged signal for " << name;
+    it->second = value;
+    return;
+  }
+  pending_property_names_.push_back(name);
+  pending_property_values_[name] = value;
+}
+
+void ChromeosDBusAdaptor::FlushPropertyChangedSignals() {
+  std::vector<string> names;
+  names.swap(pending_property_names_);
+  std::map<string, brillo::Any> values;
+  values.swap(pending_property_values_);
+  SLOG(this, 2) << __func__ << ": " << names.size() << " signal(s)";
+  if (property_changed_signal_sender_.is_null()) {
+    return;
+  }
+  for (const auto& name : names) {
+    property_changed_signal_sender_.Run(name, values[name]);
+  }
+}
+
 // static
 bool ChromeosDBusAdaptor::SetProperty(PropertyStore* store,
                                       const std::string& name,
@@ -17,7 +17,9 @@
 #ifndef SHILL_DBUS_CHROMEOS_DBUS_ADAPTOR_H_
 #define SHILL_DBUS_CHROMEOS_DBUS_ADAPTOR_H_
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <base/callback.h>
 #include <base/macros.h>
@@ -49,8 +51,13 @@ class ChromeosDBusAdaptor : public base::SupportsWeakPtr<ChromeosDBusAdaptor> {
   const dbus::ObjectPath& dbus_path() const { return dbus_path_; }
 
  protected:
+  FRIEND_TEST(ChromeosDBusAdaptorTest, CoalescePropertyChangedSignals);
   FRIEND_TEST(ChromeosDBusAdaptorTest, SanitizePathElement);
 
+  typedef base::Callback<void(const std::string& name,
+                              const brillo::Any& value)>
+      PropertyChangedSignalSender;
+
   // Callback to wrap around DBus method response.
   ResultCallback GetMethodReplyCallback(DBusMethodResponsePtr<> response);
 
@@ -118,7 +125,24 @@ class ChromeosDBusAdaptor : public base::SupportsWeakPtr<ChromeosDBusAdaptor> {
   // Returns an object path fragment that conforms to D-Bus specifications.
   static std::string SanitizePathElement(const std::string& object_path);
 
+  // Sets the callback used to send the PropertyChanged signal of the
+  // interface implemented by the subclass.
+  void set_property_changed_signal_sender(
+      const PropertyChangedSignalSender& sender) {
+    property_changed_signal_sender_ = sender;
+  }
+
+  // Queues a PropertyChanged signal for property |name|.  Queued signals
+  // are sent together once control returns to the message loop, so a
+  // burst of changes results in one signal per property carrying its last
+  // value, in the order in which the properties first changed.
+  void QueuePropertyChangedSignal(const std::string& name,
+                                  const brillo::Any& value);
+
  private:
+  // Sends the PropertyChanged signals queued by QueuePropertyChangedSignal().
+  void FlushPropertyChangedSignals();
+
   void MethodReplyCallback(DBusMethodResponsePtr<> response,
                            const Error& error);
 
@@ -135,6 +159,11 @@ class ChromeosDBusAdaptor : public base::SupportsWeakPtr<ChromeosDBusAdaptor> {
 
   dbus::ObjectPath dbus_path_;
   std::unique_ptr<brillo::dbus_utils::DBusObject> dbus_object_;
+  PropertyChangedSignalSender property_changed_signal_sender_;
+  // Names of properties with a queued PropertyChanged signal, in the order
+  // in which they were first queued, and the last value queued for each.
+  std::vector<std::string> pending_property_names_;
+  std::map<std::string, brillo::Any> pending_property_values_;
 
   DISALLOW_COPY_AND_ASSIGN(ChromeosDBusAdaptor);
 };
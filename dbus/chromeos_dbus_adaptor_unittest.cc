@@ -16,11 +16,22 @@
 
 #include "shill/dbus/chromeos_dbus_adaptor.h"
 
+#include <string>
+
+#include <base/bind.h>
+#include <dbus/mock_bus.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "shill/property_store_unittest.h"
 
+using base::Bind;
+using base::Unretained;
+using std::string;
+using testing::_;
+using testing::InSequence;
+using testing::Property;
+
 namespace shill {
 
 class ChromeosDBusAdaptorTest : public PropertyStoreTest {
@@ -28,8 +39,45 @@ class ChromeosDBusAdaptorTest : public PropertyStoreTest {
   ChromeosDBusAdaptorTest() {}
 
   virtual ~ChromeosDBusAdaptorTest() {}
+
+  MOCK_METHOD2(SendPropertyChangedSignal,
+               void(const string& name, const brillo::Any& value));
 };
 
+TEST_F(ChromeosDBusAdaptorTest, CoalescePropertyChangedSignals) {
+  scoped_refptr<dbus::MockBus> bus(new dbus::MockBus(dbus::Bus::Options()));
+  ChromeosDBusAdaptor adaptor(bus, "/test");
+  adaptor.set_property_changed_signal_sender(
+      Bind(&ChromeosDBusAdaptorTest::SendPropertyChangedSignal,
+           Unretained(this)));
+
+  // Nothing is sent until control returns to the message loop.
+  EXPECT_CALL(*this, SendPropertyChangedSignal(_, _)).Times(0);
+  adaptor.QueuePropertyChangedSignal("State", brillo::Any(string("idle")));
+  adaptor.QueuePropertyChangedSignal("Strength", brillo::Any(10));
+  adaptor.QueuePropertyChangedSignal("State",
+                                     brillo::Any(string("online")));
+  adaptor.QueuePropertyChangedSignal("Strength", brillo::Any(20));
+  testing::Mock::VerifyAndClearExpectations(this);
+
+  // Each property is sent once with its last value, in the order in which
+  // the properties first changed.
+  {
+    InSequence s;
+    EXPECT_CALL(*this, SendPropertyChangedSignal(
+        "State", Property(&brillo::Any::Get<string>, "online")));
+    EXPECT_CALL(*this, SendPropertyChangedSignal(
+        "Strength", Property(&brillo::Any::Get<int>, 20)));
+  }
+  dispatcher()->DispatchPendingEvents();
+  testing::Mock::VerifyAndClearExpectations(this);
+
+  // A later change is sent in a new batch.
+  EXPECT_CALL(*this, SendPropertyChangedSignal("State", _));
+  adaptor.QueuePropertyChangedSignal("State", brillo::Any(string("idle")));
+  dispatcher()->DispatchPendingEvents();
+}
+
 TEST_F(ChromeosDBusAdaptorTest, SanitizePathElement) {
   EXPECT_EQ("0Ab_y_Z_9_",
             ChromeosDBusAdaptor::SanitizePathElement("0Ab/y:Z`9{"));
@@ -19,13 +19,16 @@
 #include <string>
 #include <vector>
 
+#include <base/bind.h>
 #include <base/strings/stringprintf.h>
 
 #include "shill/error.h"
 #include "shill/ipconfig.h"
 #include "shill/logging.h"
 
+using base::Bind;
 using base::StringPrintf;
+using base::Unretained;
 using brillo::dbus_utils::AsyncEventSequencer;
 using brillo::dbus_utils::ExportedObjectManager;
 using std::string;
@@ -55,6 +58,9 @@ ChromeosIPConfigDBusAdaptor::ChromeosIPConfigDBusAdaptor(
                                        config->serial(),
                                        config->type().c_str())),
       ipconfig_(config) {
+  set_property_changed_signal_sender(Bind(
+      &org::chromium::flimflam::IPConfigAdaptor::SendPropertyChangedSignal,
+      Unretained(this)));
   // Register DBus object.
   RegisterWithDBusObject(dbus_object());
   dbus_object()->RegisterAndBlock();
@@ -68,31 +74,31 @@ ChromeosIPConfigDBusAdaptor::~ChromeosIPConfigDBusAdaptor() {
 void ChromeosIPConfigDBusAdaptor::EmitBoolChanged(const string& name,
                                                   bool value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosIPConfigDBusAdaptor::EmitUintChanged(const string& name,
                                                   uint32_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosIPConfigDBusAdaptor::EmitIntChanged(const string& name,
                                                  int value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosIPConfigDBusAdaptor::EmitStringChanged(const string& name,
                                                     const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosIPConfigDBusAdaptor::EmitStringsChanged(
     const string& name, const vector<string>& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 bool ChromeosIPConfigDBusAdaptor::GetProperties(
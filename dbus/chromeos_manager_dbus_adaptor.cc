@@ -20,6 +20,8 @@
 #include <string>
 #include <vector>
 
+#include <base/bind.h>
+
 #include "shill/callbacks.h"
 #include "shill/dbus/dbus_service_watcher_factory.h"
 #include "shill/device.h"
@@ -30,6 +32,7 @@
 #include "shill/manager.h"
 #include "shill/property_store.h"
 
+using base::Bind;
 using base::Unretained;
 using std::map;
 using std::string;
@@ -55,7 +58,11 @@ ChromeosManagerDBusAdaptor::ChromeosManagerDBusAdaptor(
       ChromeosDBusAdaptor(adaptor_bus, kPath),
       manager_(manager),
       proxy_bus_(proxy_bus),
-      dbus_service_watcher_factory_(DBusServiceWatcherFactory::GetInstance()) {}
+      dbus_service_watcher_factory_(DBusServiceWatcherFactory::GetInstance()) {
+  set_property_changed_signal_sender(Bind(
+      &org::chromium::flimflam::ManagerAdaptor::SendPropertyChangedSignal,
+      Unretained(this)));
+}
 
 ChromeosManagerDBusAdaptor::~ChromeosManagerDBusAdaptor() {
   manager_ = nullptr;
@@ -70,37 +77,37 @@ void ChromeosManagerDBusAdaptor::RegisterAsync(
 void ChromeosManagerDBusAdaptor::EmitBoolChanged(const string& name,
                                                  bool value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosManagerDBusAdaptor::EmitUintChanged(const string& name,
                                          uint32_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosManagerDBusAdaptor::EmitIntChanged(const string& name, int value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosManagerDBusAdaptor::EmitStringChanged(const string& name,
                                            const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosManagerDBusAdaptor::EmitStringsChanged(const string& name,
                                             const vector<string>& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosManagerDBusAdaptor::EmitRpcIdentifierChanged(
     const string& name,
     const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(dbus::ObjectPath(value)));
+  QueuePropertyChangedSignal(name, brillo::Any(dbus::ObjectPath(value)));
 }
 
 void ChromeosManagerDBusAdaptor::EmitRpcIdentifierArrayChanged(
@@ -112,7 +119,7 @@ void ChromeosManagerDBusAdaptor::EmitRpcIdentifierArrayChanged(
     paths.push_back(dbus::ObjectPath(element));
   }
 
-  SendPropertyChangedSignal(name, brillo::Any(paths));
+  QueuePropertyChangedSignal(name, brillo::Any(paths));
 }
 
 bool ChromeosManagerDBusAdaptor::GetProperties(
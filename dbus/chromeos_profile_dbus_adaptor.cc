@@ -19,11 +19,15 @@
 #include <string>
 #include <vector>
 
+#include <base/bind.h>
+
 #include "shill/error.h"
 #include "shill/logging.h"
 #include "shill/profile.h"
 #include "shill/service.h"
 
+using base::Bind;
+using base::Unretained;
 using brillo::dbus_utils::AsyncEventSequencer;
 using brillo::dbus_utils::ExportedObjectManager;
 using std::string;
@@ -48,6 +52,9 @@ ChromeosProfileDBusAdaptor::ChromeosProfileDBusAdaptor(
     : org::chromium::flimflam::ProfileAdaptor(this),
       ChromeosDBusAdaptor(bus, kPath + profile->GetFriendlyName()),
       profile_(profile) {
+  set_property_changed_signal_sender(Bind(
+      &org::chromium::flimflam::ProfileAdaptor::SendPropertyChangedSignal,
+      Unretained(this)));
   // Register DBus object.
   RegisterWithDBusObject(dbus_object());
   dbus_object()->RegisterAndBlock();
@@ -61,24 +68,24 @@ ChromeosProfileDBusAdaptor::~ChromeosProfileDBusAdaptor() {
 void ChromeosProfileDBusAdaptor::EmitBoolChanged(const string& name,
                                                  bool value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosProfileDBusAdaptor::EmitUintChanged(const string& name,
                                                  uint32_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosProfileDBusAdaptor::EmitIntChanged(const string& name, int value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosProfileDBusAdaptor::EmitStringChanged(const string& name,
                                                    const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 bool ChromeosProfileDBusAdaptor::GetProperties(
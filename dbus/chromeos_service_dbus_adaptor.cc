@@ -19,10 +19,14 @@
 #include <map>
 #include <string>
 
+#include <base/bind.h>
+
 #include "shill/error.h"
 #include "shill/logging.h"
 #include "shill/service.h"
 
+using base::Bind;
+using base::Unretained;
 using brillo::dbus_utils::AsyncEventSequencer;
 using brillo::dbus_utils::ExportedObjectManager;
 using std::map;
@@ -47,6 +51,9 @@ ChromeosServiceDBusAdaptor::ChromeosServiceDBusAdaptor(
     : org::chromium::flimflam::ServiceAdaptor(this),
       ChromeosDBusAdaptor(bus, kPath + service->unique_name()),
       service_(service) {
+  set_property_changed_signal_sender(Bind(
+      &org::chromium::flimflam::ServiceAdaptor::SendPropertyChangedSignal,
+      Unretained(this)));
   // Register DBus object.
   RegisterWithDBusObject(dbus_object());
   dbus_object()->RegisterAndBlock();
@@ -60,54 +67,63 @@ ChromeosServiceDBusAdaptor::~ChromeosServiceDBusAdaptor() {
 void ChromeosServiceDBusAdaptor::EmitBoolChanged(const string& name,
                                                  bool value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitUint8Changed(const string& name,
                                                   uint8_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitUint16Changed(const string& name,
                                                    uint16_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitUint16sChanged(const string& name,
                                                     const Uint16s& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitUintChanged(const string& name,
                                                  uint32_t value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitIntChanged(const string& name, int value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitRpcIdentifierChanged(const string& name,
                                                           const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(dbus::ObjectPath(value)));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(dbus::ObjectPath(value)));
 }
 
 void ChromeosServiceDBusAdaptor::EmitStringChanged(const string& name,
                                                    const string& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 void ChromeosServiceDBusAdaptor::EmitStringmapChanged(const string& name,
                                                       const Stringmap& value) {
   SLOG(this, 2) << __func__ << ": " << name;
-  SendPropertyChangedSignal(name, brillo::Any(value));
+  service_->mutable_store()->MarkPropertyChanged(name);
+  QueuePropertyChangedSignal(name, brillo::Any(value));
 }
 
 bool ChromeosServiceDBusAdaptor::GetProperties(
@@ -118,6 +134,18 @@ bool ChromeosServiceDBusAdaptor::GetProperties(
                                             error);
 }
 
+bool ChromeosServiceDBusAdaptor::GetPropertiesChangedSince(
+    brillo::ErrorPtr* error,
+    uint64_t generation,
+    brillo::VariantDictionary* properties,
+    uint64_t* current_generation) {
+  SLOG(this, 2) << __func__ << ": " << generation;
+  Error e;
+  service_->mutable_store()->GetPropertiesChangedSince(
+      generation, properties, current_generation, &e);
+  return !e.ToChromeosError(error);
+}
+
 bool ChromeosServiceDBusAdaptor::SetProperty(
     brillo::ErrorPtr* error, const string& name, const brillo::Any& value) {
   SLOG(this, 2) << __func__ << ": " << name;
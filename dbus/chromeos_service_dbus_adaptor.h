@@ -67,6 +67,10 @@ class ChromeosServiceDBusAdaptor
   // Implementation of ServiceAdaptor
   bool GetProperties(brillo::ErrorPtr* error,
                      brillo::VariantDictionary* properties) override;
+  bool GetPropertiesChangedSince(brillo::ErrorPtr* error,
+                                 uint64_t generation,
+                                 brillo::VariantDictionary* properties,
+                                 uint64_t* current_generation) override;
   bool SetProperty(brillo::ErrorPtr* error,
                    const std::string& name,
                    const brillo::Any& value) override;
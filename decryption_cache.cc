@@ -0,0 +1,74 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "shill/decryption_cache.h"
+
+using std::string;
+
+namespace shill {
+
+DecryptionCache::DecryptionCache() : hit_count_(0), miss_count_(0) {}
+
+DecryptionCache::~DecryptionCache() {}
+
+bool DecryptionCache::Lookup(const string& group,
+                             const string& key,
+                             const string& ciphertext,
+                             string* plaintext) {
+  const auto group_it = groups_.find(group);
+  if (group_it != groups_.end()) {
+    const auto key_it = group_it->second.find(key);
+    if (key_it != group_it->second.end() &&
+        key_it->second.ciphertext == ciphertext) {
+      *plaintext = key_it->second.plaintext;
+      ++hit_count_;
+      return true;
+    }
+  }
+  ++miss_count_;
+  return false;
+}
+
+void DecryptionCache::Insert(const string& group,
+                             const string& key,
+                             const string& ciphertext,
+                             const string& plaintext) {
+  Entry& entry = groups_[group][key];
+  entry.ciphertext = ciphertext;
+  entry.plaintext = plaintext;
+}
+
+void DecryptionCache::InvalidateKey(const string& group, const string& key) {
+  auto group_it = groups_.find(group);
+  if (group_it == groups_.end()) {
+    return;
+  }
+  group_it->second.erase(key);
+  if (group_it->second.empty()) {
+    groups_.erase(group_it);
+  }
+}
+
+void DecryptionCache::InvalidateGroup(const string& group) {
+  groups_.erase(group);
+}
+
+void DecryptionCache::Clear() {
+  groups_.clear();
+}
+
+}  // namespace shill
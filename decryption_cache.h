@@ -0,0 +1,74 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef SHILL_DECRYPTION_CACHE_H_
+#define SHILL_DECRYPTION_CACHE_H_
+
+#include <map>
+#include <string>
+
+#include <base/macros.h>
+
+namespace shill {
+
+// Remembers the plaintext of crypted strings read from a store, so that
+// repeated reads of the same |group|:|key| do not run the crypto modules
+// again.  Each entry also records the ciphertext it was decrypted from, and
+// is only used if the ciphertext currently in the store still matches.  The
+// owning store invalidates entries when it modifies or removes them.
+class DecryptionCache {
+ public:
+  DecryptionCache();
+  ~DecryptionCache();
+
+  // Returns true and sets |plaintext| if |ciphertext| for |group|:|key| has
+  // been decrypted before.
+  bool Lookup(const std::string& group,
+              const std::string& key,
+              const std::string& ciphertext,
+              std::string* plaintext);
+
+  // Records that |ciphertext| for |group|:|key| decrypts to |plaintext|.
+  void Insert(const std::string& group,
+              const std::string& key,
+              const std::string& ciphertext,
+              const std::string& plaintext);
+
+  void InvalidateKey(const std::string& group, const std::string& key);
+  void InvalidateGroup(const std::string& group);
+  void Clear();
+
+  size_t hit_count() const { return hit_count_; }
+  size_t miss_count() const { return miss_count_; }
+
+ private:
+  struct Entry {
+    std::string ciphertext;
+    std::string plaintext;
+  };
+  typedef std::map<std::string, Entry> KeyToEntryMap;
+
+  std::map<std::string, KeyToEntryMap> groups_;
+  size_t hit_count_;
+  size_t miss_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecryptionCache);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_DECRYPTION_CACHE_H_
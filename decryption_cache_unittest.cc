@@ -0,0 +1,82 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "shill/decryption_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+using std::string;
+using testing::Test;
+
+namespace shill {
+
+namespace {
+const char kGroup[] = "group";
+const char kKey[] = "key";
+const char kCiphertext[] = "rot47:AG?J";
+const char kPlaintext[] = "pnyq";
+}  // namespace
+
+class DecryptionCacheTest : public Test {
+ protected:
+  DecryptionCache cache_;
+};
+
+TEST_F(DecryptionCacheTest, LookupMiss) {
+  string plaintext;
+  EXPECT_FALSE(cache_.Lookup(kGroup, kKey, kCiphertext, &plaintext));
+  EXPECT_EQ(0, cache_.hit_count());
+  EXPECT_EQ(1, cache_.miss_count());
+}
+
+TEST_F(DecryptionCacheTest, LookupHit) {
+  cache_.Insert(kGroup, kKey, kCiphertext, kPlaintext);
+  string plaintext;
+  EXPECT_TRUE(cache_.Lookup(kGroup, kKey, kCiphertext, &plaintext));
+  EXPECT_EQ(kPlaintext, plaintext);
+  EXPECT_EQ(1, cache_.hit_count());
+  EXPECT_EQ(0, cache_.miss_count());
+}
+
+TEST_F(DecryptionCacheTest, LookupWithChangedCiphertext) {
+  cache_.Insert(kGroup, kKey, kCiphertext, kPlaintext);
+  string plaintext;
+  EXPECT_FALSE(cache_.Lookup(kGroup, kKey, "rot47:other", &plaintext));
+  EXPECT_FALSE(cache_.Lookup(kGroup, "other-key", kCiphertext, &plaintext));
+  EXPECT_FALSE(cache_.Lookup("other-group", kKey, kCiphertext, &plaintext));
+}
+
+TEST_F(DecryptionCacheTest, Invalidate) {
+  static const char kOtherKey[] = "other-key";
+  string plaintext;
+  cache_.Insert(kGroup, kKey, kCiphertext, kPlaintext);
+  cache_.Insert(kGroup, kOtherKey, kCiphertext, kPlaintext);
+  cache_.InvalidateKey(kGroup, kKey);
+  EXPECT_FALSE(cache_.Lookup(kGroup, kKey, kCiphertext, &plaintext));
+  EXPECT_TRUE(cache_.Lookup(kGroup, kOtherKey, kCiphertext, &plaintext));
+
+  cache_.InvalidateGroup(kGroup);
+  EXPECT_FALSE(cache_.Lookup(kGroup, kOtherKey, kCiphertext, &plaintext));
+
+  cache_.Insert(kGroup, kKey, kCiphertext, kPlaintext);
+  cache_.Clear();
+  EXPECT_FALSE(cache_.Lookup(kGroup, kKey, kCiphertext, &plaintext));
+}
+
+}  // namespace shill
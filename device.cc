@@ -1319,6 +1319,7 @@ bool Device::StartPortalDetection() {
   portal_detector_.reset(new PortalDetector(connection_,
                                             dispatcher_,
                                             portal_detector_callback_));
+  portal_detector_->set_fallback_urls(manager_->GetPortalFallbackURLs());
   if (!portal_detector_->Start(manager_->GetPortalCheckURL())) {
     LOG(ERROR) << "Device " << FriendlyName()
                << ": Portal detection failed to start: likely bad URL: "
@@ -1667,6 +1668,8 @@ void Device::PortalDetectorCallback(const PortalDetector::Result& result) {
                     result.trial_result.status);
 
   portal_attempts_to_online_ += result.num_attempts;
+  metrics()->NotifyPortalDetectionTimeToVerdict(
+      technology(), result.time_to_verdict_milliseconds);
 
   int portal_status = Metrics::PortalDetectionResultToEnum(result);
   metrics()->SendEnumToUMA(
@@ -0,0 +1,185 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/dns_cache.h"
+
+#include <sys/time.h>
+
+#include <algorithm>
+
+#include <base/strings/string_util.h>
+
+#include "shill/logging.h"
+#include "shill/net/shill_time.h"
+
+using std::string;
+using std::vector;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kDNS;
+static string ObjectID(DNSCache* d) { return "(dns_cache)"; }
+}
+
+namespace {
+base::LazyInstance<DNSCache> g_dns_cache = LAZY_INSTANCE_INITIALIZER;
+}  // namespace
+
+// ares_gethostbyname() does not report record TTLs, so answers are kept
+// for a short, fixed period.  This is long enough to absorb back-to-back
+// portal and health checks, and short enough that an address handed out by
+// a captive portal is not remembered long after the user has signed in.
+const int DNSCache::kDefaultTTLSeconds = 30;
+const size_t DNSCache::kMaxEntries = 64;
+
+DNSCache::DNSCache()
+    : hits_(0),
+      misses_(0),
+      time_(Time::GetInstance()) {}
+
+DNSCache::~DNSCache() {}
+
+DNSCache* DNSCache::GetInstance() {
+  return g_dns_cache.Pointer();
+}
+
+bool DNSCache::Lookup(IPAddress::Family family,
+                      const string& hostname,
+                      const string& interface_name,
+                      const vector<string>& dns_servers,
+                      IPAddress* address) {
+  auto it = entries_.find(
+      MakeKey(family, hostname, interface_name, dns_servers));
+  if (it != entries_.end() && it->second.expiry > Now()) {
+    *address = it->second.address;
+    ++hits_;
+    SLOG(this, 3) << "Hit for " << hostname << " on " << interface_name
+                  << " (hits " << hits_ << ", misses " << misses_ << ")";
+    return true;
+  }
+  if (it != entries_.end()) {
+    entries_.erase(it);
+  }
+  ++misses_;
+  SLOG(this, 3) << "Miss for " << hostname << " on " << interface_name
+                << " (hits " << hits_ << ", misses " << misses_ << ")";
+  return false;
+}
+
+void DNSCache::Insert(IPAddress::Family family,
+                      const string& hostname,
+                      const string& interface_name,
+                      const vector<string>& dns_servers,
+                      const IPAddress& address,
+                      int ttl_seconds) {
+  if (ttl_seconds <= 0) {
+    return;
+  }
+  time_t now = Now();
+  Key key = MakeKey(family, hostname, interface_name, dns_servers);
+  if (entries_.find(key) == entries_.end() && entries_.size() >= kMaxEntries) {
+    MakeRoom(now);
+  }
+  Entry& entry = entries_[key];
+  entry.address = address;
+  entry.expiry = now + ttl_seconds;
+}
+
+void DNSCache::FlushInterface(const string& interface_name) {
+  SLOG(this, 2) << __func__ << ": " << interface_name;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (std::get<2>(it->first) == interface_name) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = server_latency_ms_.begin();
+       it != server_latency_ms_.end();) {
+    if (it->first.first == interface_name) {
+      it = server_latency_ms_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DNSCache::Flush() {
+  SLOG(this, 2) << __func__;
+  entries_.clear();
+  server_latency_ms_.clear();
+}
+
+void DNSCache::RecordServerLatency(const string& interface_name,
+                                   const string& server,
+                                   int latency_ms) {
+  // Keep a latency of 0 for "not measured".
+  latency_ms = std::max(latency_ms, 1);
+  ServerKey key(interface_name, server);
+  auto it = server_latency_ms_.find(key);
+  if (it == server_latency_ms_.end()) {
+    server_latency_ms_[key] = latency_ms;
+  } else {
+    // Exponentially weighted moving average, with weight 1/4 on the new
+    // sample.
+    it->second = (it->second * 3 + latency_ms) / 4;
+  }
+  SLOG(this, 3) << __func__ << ": " << server << " on " << interface_name
+                << ": " << server_latency_ms_[key] << " ms";
+}
+
+int DNSCache::GetServerLatency(const string& interface_name,
+                               const string& server) const {
+  auto it = server_latency_ms_.find(ServerKey(interface_name, server));
+  return it == server_latency_ms_.end() ? 0 : it->second;
+}
+
+// static
+DNSCache::Key DNSCache::MakeKey(IPAddress::Family family,
+                                const string& hostname,
+                                const string& interface_name,
+                                const vector<string>& dns_servers) {
+  // Host names are case-insensitive.
+  return Key(family, base::ToLowerASCII(hostname), interface_name,
+             dns_servers);
+}
+
+time_t DNSCache::Now() const {
+  struct timeval now;
+  time_->GetTimeMonotonic(&now);
+  return now.tv_sec;
+}
+
+void DNSCache::MakeRoom(time_t now) {
+  auto soonest = entries_.end();
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.expiry <= now) {
+      it = entries_.erase(it);
+      continue;
+    }
+    if (soonest == entries_.end() ||
+        it->second.expiry < soonest->second.expiry) {
+      soonest = it;
+    }
+    ++it;
+  }
+  if (entries_.size() >= kMaxEntries && soonest != entries_.end()) {
+    entries_.erase(soonest);
+  }
+}
+
+}  // namespace shill
@@ -0,0 +1,137 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SHILL_DNS_CACHE_H_
+#define SHILL_DNS_CACHE_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <base/lazy_instance.h>
+#include <base/macros.h>
+
+#include "shill/net/ip_address.h"
+
+namespace shill {
+
+class Time;
+
+// An in-process cache of successful DNS lookups shared by all DNSClient
+// instances.  Entries are keyed by the address family, hostname, interface
+// and DNS server list used for the lookup, so that a change of network
+// configuration never returns an answer obtained from a different server
+// set.  Entries expire after their time-to-live.  The cache also keeps a
+// smoothed response time for each DNS server, which DNSClient uses to
+// decide which servers to race.
+class DNSCache {
+ public:
+  // Lifetime of an entry when the resolver does not report a record TTL.
+  static const int kDefaultTTLSeconds;
+  // Upper bound on the number of entries kept in the cache.
+  static const size_t kMaxEntries;
+
+  virtual ~DNSCache();
+
+  // This is a singleton. Use DNSCache::GetInstance()->Foo().
+  static DNSCache* GetInstance();
+
+  // Returns true and sets |address| if an unexpired entry matching the
+  // arguments exists.  Updates the hit and miss counters.
+  virtual bool Lookup(IPAddress::Family family,
+                      const std::string& hostname,
+                      const std::string& interface_name,
+                      const std::vector<std::string>& dns_servers,
+                      IPAddress* address);
+
+  // Adds or replaces the entry matching the arguments with |address|, valid
+  // for |ttl_seconds|.
+  virtual void Insert(IPAddress::Family family,
+                      const std::string& hostname,
+                      const std::string& interface_name,
+                      const std::vector<std::string>& dns_servers,
+                      const IPAddress& address,
+                      int ttl_seconds);
+
+  // Removes all entries and server latencies for |interface_name|.
+  virtual void FlushInterface(const std::string& interface_name);
+
+  // Removes all entries and server latencies.
+  virtual void Flush();
+
+  // Folds a response time of |latency_ms| for |server| reached over
+  // |interface_name| into that server's smoothed latency.
+  virtual void RecordServerLatency(const std::string& interface_name,
+                                   const std::string& server,
+                                   int latency_ms);
+
+  // Returns the smoothed latency of |server| over |interface_name| in
+  // milliseconds, or 0 if the server has not been measured yet.
+  virtual int GetServerLatency(const std::string& interface_name,
+                               const std::string& server) const;
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  size_t size() const { return entries_.size(); }
+
+ protected:
+  DNSCache();
+
+ private:
+  friend class DNSCacheTest;
+  friend class DNSClientTest;
+  friend struct base::DefaultLazyInstanceTraits<DNSCache>;
+
+  typedef std::tuple<int, std::string, std::string, std::vector<std::string>>
+      Key;
+  typedef std::pair<std::string, std::string> ServerKey;
+
+  struct Entry {
+    Entry() : address(IPAddress::kFamilyUnknown), expiry(0) {}
+
+    IPAddress address;
+    time_t expiry;
+  };
+
+  static Key MakeKey(IPAddress::Family family,
+                     const std::string& hostname,
+                     const std::string& interface_name,
+                     const std::vector<std::string>& dns_servers);
+
+  // Returns the current monotonic time in seconds.
+  time_t Now() const;
+
+  // Removes expired entries and, if the cache is still full, the entry
+  // closest to expiry.
+  void MakeRoom(time_t now);
+
+  std::map<Key, Entry> entries_;
+  std::map<ServerKey, int> server_latency_ms_;
+  uint64_t hits_;
+  uint64_t misses_;
+  Time* time_;
+
+  DISALLOW_COPY_AND_ASSIGN(DNSCache);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_DNS_CACHE_H_
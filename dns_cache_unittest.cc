@@ -0,0 +1,164 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/dns_cache.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "shill/net/mock_time.h"
+
+using std::string;
+using std::vector;
+using testing::_;
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgumentPointee;
+using testing::Test;
+
+namespace shill {
+
+namespace {
+const char kHostname[] = "www.gstatic.com";
+const char kInterface[] = "wlan0";
+const char kOtherInterface[] = "eth0";
+const char kAddress[] = "10.0.0.1";
+const char kServer[] = "8.8.8.8";
+const char kOtherServer[] = "8.8.4.4";
+const int kTTLSeconds = 10;
+}  // namespace
+
+class DNSCacheTest : public Test {
+ public:
+  DNSCacheTest()
+      : servers_{kServer},
+        address_(IPAddress::kFamilyIPv4) {
+    cache_.time_ = &time_;
+    now_.tv_sec = 100;
+    now_.tv_usec = 0;
+    EXPECT_TRUE(address_.SetAddressFromString(kAddress));
+  }
+
+  void SetUp() override {
+    SetNow(now_.tv_sec);
+  }
+
+ protected:
+  void SetNow(time_t seconds) {
+    now_.tv_sec = seconds;
+    EXPECT_CALL(time_, GetTimeMonotonic(_))
+        .WillRepeatedly(DoAll(SetArgumentPointee<0>(now_), Return(0)));
+  }
+
+  void Insert(const string& hostname, int ttl_seconds) {
+    cache_.Insert(IPAddress::kFamilyIPv4, hostname, kInterface, servers_,
+                  address_, ttl_seconds);
+  }
+
+  bool Lookup(const string& hostname) {
+    return Lookup(hostname, kInterface, servers_);
+  }
+
+  bool Lookup(const string& hostname,
+              const string& interface_name,
+              const vector<string>& servers) {
+    IPAddress address(IPAddress::kFamilyIPv4);
+    if (!cache_.Lookup(IPAddress::kFamilyIPv4, hostname, interface_name,
+                       servers, &address)) {
+      return false;
+    }
+    EXPECT_TRUE(address_.Equals(address));
+    return true;
+  }
+
+  DNSCache cache_;
+  MockTime time_;
+  struct timeval now_;
+  vector<string> servers_;
+  IPAddress address_;
+};
+
+TEST_F(DNSCacheTest, LookupAfterInsert) {
+  EXPECT_FALSE(Lookup(kHostname));
+  Insert(kHostname, kTTLSeconds);
+  EXPECT_TRUE(Lookup(kHostname));
+  // Host names are compared case-insensitively.
+  EXPECT_TRUE(Lookup("WWW.GStatic.com"));
+  EXPECT_EQ(2, cache_.hits());
+  EXPECT_EQ(1, cache_.misses());
+}
+
+TEST_F(DNSCacheTest, EntryExpires) {
+  Insert(kHostname, kTTLSeconds);
+  SetNow(now_.tv_sec + kTTLSeconds - 1);
+  EXPECT_TRUE(Lookup(kHostname));
+  SetNow(now_.tv_sec + 1);
+  EXPECT_FALSE(Lookup(kHostname));
+  // The expired entry is dropped on lookup.
+  EXPECT_EQ(0, cache_.size());
+}
+
+TEST_F(DNSCacheTest, ZeroTTLNotCached) {
+  Insert(kHostname, 0);
+  EXPECT_FALSE(Lookup(kHostname));
+}
+
+TEST_F(DNSCacheTest, KeyIncludesInterfaceAndServers) {
+  Insert(kHostname, kTTLSeconds);
+  EXPECT_FALSE(Lookup(kHostname, kOtherInterface, servers_));
+  EXPECT_FALSE(Lookup(kHostname, kInterface, {kOtherServer}));
+  EXPECT_FALSE(Lookup(kHostname, kInterface, {kServer, kOtherServer}));
+  EXPECT_TRUE(Lookup(kHostname, kInterface, servers_));
+}
+
+TEST_F(DNSCacheTest, FlushInterface) {
+  Insert(kHostname, kTTLSeconds);
+  cache_.Insert(IPAddress::kFamilyIPv4, kHostname, kOtherInterface, servers_,
+                address_, kTTLSeconds);
+  cache_.FlushInterface(kInterface);
+  EXPECT_FALSE(Lookup(kHostname, kInterface, servers_));
+  EXPECT_TRUE(Lookup(kHostname, kOtherInterface, servers_));
+  cache_.Flush();
+  EXPECT_EQ(0, cache_.size());
+}
+
+TEST_F(DNSCacheTest, EvictSoonestExpiring) {
+  for (size_t i = 0; i < DNSCache::kMaxEntries; ++i) {
+    Insert("host" + std::to_string(i), kTTLSeconds + i);
+  }
+  EXPECT_EQ(DNSCache::kMaxEntries, cache_.size());
+
+  // Replacing an existing entry does not evict anything.
+  Insert("host0", kTTLSeconds);
+  EXPECT_EQ(DNSCache::kMaxEntries, cache_.size());
+
+  Insert(kHostname, kTTLSeconds);
+  EXPECT_EQ(DNSCache::kMaxEntries, cache_.size());
+  EXPECT_FALSE(Lookup("host0"));
+  EXPECT_TRUE(Lookup("host1"));
+  EXPECT_TRUE(Lookup(kHostname));
+
+  // Expired entries are removed before live ones.
+  SetNow(now_.tv_sec + kTTLSeconds + 1);
+  Insert("another", kTTLSeconds);
+  EXPECT_EQ(DNSCache::kMaxEntries - 1, cache_.size());
+  EXPECT_FALSE(Lookup("host1"));
+  EXPECT_TRUE(Lookup("host2"));
+}
+
+}  // namespace shill
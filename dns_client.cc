@@ -21,6 +21,7 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
@@ -32,6 +33,7 @@
 #include <base/stl_util.h>
 #include <base/strings/string_number_conversions.h>
 
+#include "shill/dns_cache.h"
 #include "shill/logging.h"
 #include "shill/net/shill_time.h"
 #include "shill/shill_ares.h"
@@ -62,6 +64,7 @@ const char DNSClient::kErrorTimedOut[] = "The network connection was timed out";
 const char DNSClient::kErrorUnknown[] = "DNS Resolver unknown internal error";
 
 const int DNSClient::kDefaultDNSPort = 53;
+const size_t DNSClient::kDefaultRaceServerCount = 3;
 
 // Private to the implementation of resolver so callers don't include ares.h
 struct DNSClientState {
@@ -86,8 +89,13 @@ DNSClient::DNSClient(IPAddress::Family family,
       callback_(callback),
       timeout_ms_(timeout_ms),
       running_(false),
+      use_cache_(false),
+      race_server_count_(0),
+      race_pending_(0),
+      race_start_time_{},
       weak_ptr_factory_(this),
       ares_(Ares::GetInstance()),
+      dns_cache_(DNSCache::GetInstance()),
       time_(Time::GetInstance()) {}
 
 DNSClient::~DNSClient() {
@@ -101,6 +109,21 @@ bool DNSClient::Start(const string& hostname, Error* error) {
     return false;
   }
 
+  hostname_ = hostname;
+  if (use_cache_ &&
+      dns_cache_->Lookup(address_.family(), hostname, interface_name_,
+                         dns_servers_, &address_)) {
+    SLOG(this, 3) << "Using cached address for " << hostname;
+    running_ = true;
+    dispatcher_->PostTask(Bind(&DNSClient::HandleCompletion,
+                               weak_ptr_factory_.GetWeakPtr()));
+    return true;
+  }
+
+  if (race_server_count_ > 1 && dns_servers_.size() > 1) {
+    return StartRace(hostname, error);
+  }
+
   if (!resolver_state_.get()) {
     struct ares_options options;
     memset(&options, 0, sizeof(options));
@@ -174,7 +197,16 @@ bool DNSClient::Start(const string& hostname, Error* error) {
 
 void DNSClient::Stop() {
   SLOG(this, 3) << "In " << __func__;
+  race_clients_.clear();
   if (!resolver_state_.get()) {
+    if (running_) {
+      // Cancel a race, or a pending completion for an answer served from
+      // the cache.
+      running_ = false;
+      weak_ptr_factory_.InvalidateWeakPtrs();
+      error_.Reset();
+      address_.SetAddressToDefault();
+    }
     return;
   }
 
@@ -190,12 +222,127 @@ bool DNSClient::IsActive() const {
   return running_;
 }
 
+vector<string> DNSClient::GetRaceServers() const {
+  // Servers that have not been measured yet report a latency of 0, so they
+  // are tried before servers that are known to be slow.
+  vector<string> servers(dns_servers_);
+  std::stable_sort(servers.begin(), servers.end(),
+                   [this](const string& a, const string& b) {
+                     return dns_cache_->GetServerLatency(interface_name_, a) <
+                            dns_cache_->GetServerLatency(interface_name_, b);
+                   });
+  if (servers.size() > race_server_count_) {
+    servers.resize(race_server_count_);
+  }
+  return servers;
+}
+
+bool DNSClient::StartRace(const string& hostname, Error* error) {
+  race_servers_ = GetRaceServers();
+  SLOG(this, 3) << "Racing " << race_servers_.size() << " servers for "
+                << hostname;
+  running_ = true;
+  race_pending_ = 0;
+  time_->GetTimeMonotonic(&race_start_time_);
+  for (size_t i = 0; i < race_servers_.size(); ++i) {
+    std::unique_ptr<DNSClient> client(
+        new DNSClient(address_.family(),
+                      interface_name_,
+                      vector<string>{race_servers_[i]},
+                      timeout_ms_,
+                      dispatcher_,
+                      Bind(&DNSClient::HandleRaceResult,
+                           weak_ptr_factory_.GetWeakPtr(), i)));
+    client->ares_ = ares_;
+    client->time_ = time_;
+    client->use_cache_ = false;
+    Error client_error;
+    if (client->Start(hostname, &client_error)) {
+      ++race_pending_;
+    } else {
+      SLOG(this, 2) << "Failed to query " << race_servers_[i] << ": "
+                    << client_error.message();
+      error_.CopyFrom(client_error);
+    }
+    race_clients_.push_back(std::move(client));
+  }
+
+  if (!race_pending_) {
+    error->CopyFrom(error_);
+    Stop();
+    return false;
+  }
+  error_.Reset();
+  return true;
+}
+
+// Called from the completion task of the single-server client at |index|.
+// That client must not be destroyed here; the race clients are released in
+// our own completion task.
+void DNSClient::HandleRaceResult(size_t index,
+                                 const Error& error,
+                                 const IPAddress& address) {
+  if (!race_pending_) {
+    // The race has already been decided.
+    return;
+  }
+  struct timeval now, elapsed_time;
+  time_->GetTimeMonotonic(&now);
+  timersub(&now, &race_start_time_, &elapsed_time);
+  int elapsed_ms = elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000;
+  const string& server = race_servers_[index];
+  dns_cache_->RecordServerLatency(
+      interface_name_, server,
+      error.type() == Error::kOperationTimeout ? timeout_ms_ : elapsed_ms);
+  --race_pending_;
+
+  if (error.IsSuccess()) {
+    SLOG(this, 3) << server << " answered first, after " << elapsed_ms
+                  << " ms";
+    // The servers still outstanding are at least this slow.  That is only
+    // a lower bound, so it may raise their estimate but never lower it;
+    // otherwise a dead server would drift toward the winner's latency.
+    for (size_t i = 0; i < race_clients_.size(); ++i) {
+      if (i == index) {
+        continue;
+      }
+      if (race_clients_[i]->IsActive()) {
+        const string& other_server = race_servers_[i];
+        dns_cache_->RecordServerLatency(
+            interface_name_, other_server,
+            std::max(dns_cache_->GetServerLatency(interface_name_,
+                                                  other_server),
+                     elapsed_ms));
+      }
+      race_clients_[i]->Stop();
+    }
+    race_pending_ = 0;
+    error_.Reset();
+    address_ = address;
+    if (use_cache_) {
+      dns_cache_->Insert(address_.family(), hostname_, interface_name_,
+                         dns_servers_, address_,
+                         DNSCache::kDefaultTTLSeconds);
+    }
+  } else {
+    SLOG(this, 3) << server << " failed: " << error.message();
+    error_.CopyFrom(error);
+    if (race_pending_) {
+      return;
+    }
+  }
+  dispatcher_->PostTask(Bind(&DNSClient::HandleCompletion,
+                             weak_ptr_factory_.GetWeakPtr()));
+}
+
 // We delay our call to completion so that we exit all IOHandlers, and
 // can clean up all of our local state before calling the callback, or
 // during the process of the execution of the callee (which is free to
 // call our destructor safely).
 void DNSClient::HandleCompletion() {
   SLOG(this, 3) << "In " << __func__;
+  running_ = false;
+  race_clients_.clear();
   Error error;
   error.CopyFrom(error_);
   IPAddress address(address_);
@@ -248,6 +395,11 @@ void DNSClient::ReceiveDNSReply(int status, struct hostent* hostent) {
     address_ = IPAddress(address_.family(),
                          ByteString(reinterpret_cast<unsigned char*>(
                              hostent->h_addr_list[0]), hostent->h_length));
+    if (use_cache_) {
+      dns_cache_->Insert(address_.family(), hostname_, interface_name_,
+                         dns_servers_, address_,
+                         DNSCache::kDefaultTTLSeconds);
+    }
   } else {
     switch (status) {
       case ARES_ENODATA:
@@ -36,6 +36,7 @@ struct hostent;
 namespace shill {
 
 class Ares;
+class DNSCache;
 class Time;
 struct DNSClientState;
 
@@ -55,6 +56,9 @@ class DNSClient {
   static const char kErrorTimedOut[];
   static const char kErrorUnknown[];
 
+  // Number of servers raced by clients that enable racing.
+  static const size_t kDefaultRaceServerCount;
+
   DNSClient(IPAddress::Family family,
             const std::string& interface_name,
             const std::vector<std::string>& dns_servers,
@@ -76,11 +80,33 @@ class DNSClient {
 
   virtual bool IsActive() const;
 
+  // When enabled, successful answers are shared with other DNSClient
+  // instances through DNSCache, and Start() completes from the cache when
+  // it can.  This is off by default: portal detection and connectivity
+  // probes must see the network's current answer, since a captive portal
+  // may fake answers until the user signs in.
+  void set_use_cache(bool use_cache) { use_cache_ = use_cache; }
+  bool use_cache() const { return use_cache_; }
+
+  // When |count| is greater than one and more than one DNS server is
+  // configured, Start() queries up to |count| servers concurrently instead
+  // of letting ARES try them one after another, and completes with the
+  // first successful answer.  Servers are picked in order of their measured
+  // response time, so a dead server stops delaying resolution once it has
+  // been observed.
+  void set_race_server_count(size_t count) { race_server_count_ = count; }
+
   std::string interface_name() { return interface_name_; }
 
  private:
   friend class DNSClientTest;
 
+  // Returns the servers to race, fastest first.
+  std::vector<std::string> GetRaceServers() const;
+  bool StartRace(const std::string& hostname, Error* error);
+  void HandleRaceResult(size_t index,
+                        const Error& error,
+                        const IPAddress& address);
   void HandleCompletion();
   void HandleDNSRead(int fd);
   void HandleDNSWrite(int fd);
@@ -94,16 +120,25 @@ class DNSClient {
 
   Error error_;
   IPAddress address_;
+  std::string hostname_;
   std::string interface_name_;
   std::vector<std::string> dns_servers_;
   EventDispatcher* dispatcher_;
   ClientCallback callback_;
   int timeout_ms_;
   bool running_;
+  bool use_cache_;
+  size_t race_server_count_;
+  // Servers and single-server clients of the race in progress, if any.
+  std::vector<std::string> race_servers_;
+  std::vector<std::unique_ptr<DNSClient>> race_clients_;
+  size_t race_pending_;
+  struct timeval race_start_time_;
   std::unique_ptr<DNSClientState> resolver_state_;
   base::CancelableClosure timeout_closure_;
   base::WeakPtrFactory<DNSClient> weak_ptr_factory_;
   Ares* ares_;
+  DNSCache* dns_cache_;
   Time* time_;
 
   DISALLOW_COPY_AND_ASSIGN(DNSClient);
@@ -24,6 +24,7 @@
 
 #include <base/bind.h>
 
+#include "shill/dns_cache.h"
 #include "shill/error.h"
 #include "shill/event_dispatcher.h"
 #include "shill/mock_ares.h"
@@ -54,6 +55,8 @@ namespace {
 const char kGoodName[] = "all-systems.mcast.net";
 const char kResult[] = "224.0.0.1";
 const char kGoodServer[] = "8.8.8.8";
+const char kSecondServer[] = "8.8.4.4";
+const char kThirdServer[] = "4.2.2.1";
 const char kBadServer[] = "10.9xx8.7";
 const char kNetworkInterface[] = "eth0";
 char kReturnAddressList0[] = { static_cast<char>(224), 0, 0, 1 };
@@ -69,7 +72,9 @@ const int kAresWaitMS = 1000;     // Time period ARES asks caller to wait
 class DNSClientTest : public Test {
  public:
   DNSClientTest()
-      : ares_result_(ARES_SUCCESS), address_result_(IPAddress::kFamilyUnknown) {
+      : ares_result_(ARES_SUCCESS),
+        address_result_(IPAddress::kFamilyUnknown),
+        use_cache_(false) {
     time_val_.tv_sec = 0;
     time_val_.tv_usec = 0;
     ares_timeout_.tv_sec = kAresWaitMS / 1000;
@@ -121,6 +126,48 @@ class DNSClientTest : public Test {
     dns_client_->HandleCompletion();
   }
 
+  void CallRaceReplyCB(size_t index, int status) {
+    DNSClient* client = dns_client_->race_clients_[index].get();
+    client->ReceiveDNSReplyCB(client, status, 0, &hostent_);
+  }
+
+  void CallRaceCompletion(size_t index) {
+    dns_client_->race_clients_[index]->HandleCompletion();
+  }
+
+  vector<string> GetRaceServers() {
+    return dns_client_->GetRaceServers();
+  }
+
+  // Starts a race between |kGoodServer| and |kSecondServer|.
+  void StartRace() {
+    vector<string> dns_servers{kGoodServer, kSecondServer};
+    CreateClient(dns_servers, kAresTimeoutMS);
+    dns_client_->set_race_server_count(2);
+    EXPECT_CALL(ares_, InitOptions(_, _, _))
+        .Times(2)
+        .WillRepeatedly(DoAll(SetArgumentPointee<0>(kAresChannel),
+                              Return(ARES_SUCCESS)));
+    EXPECT_CALL(ares_, SetServersCsv(_, StrEq(string(kGoodServer) + ":53")))
+        .WillOnce(Return(ARES_SUCCESS));
+    EXPECT_CALL(ares_, SetServersCsv(_, StrEq(string(kSecondServer) + ":53")))
+        .WillOnce(Return(ARES_SUCCESS));
+    EXPECT_CALL(ares_, SetLocalDev(kAresChannel, StrEq(kNetworkInterface)))
+        .Times(2);
+    EXPECT_CALL(ares_, GetHostByName(kAresChannel, StrEq(kGoodName), _, _, _))
+        .Times(2);
+    EXPECT_CALL(dispatcher_,
+                CreateReadyHandler(kAresFd, IOHandler::kModeInput, _))
+        .Times(2)
+        .WillRepeatedly(ReturnNew<IOHandler>());
+    SetActive();
+    EXPECT_CALL(dispatcher_, PostDelayedTask(_, kAresWaitMS)).Times(2);
+    Error error;
+    ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+    EXPECT_TRUE(error.IsSuccess());
+    EXPECT_TRUE(dns_client_->IsActive());
+  }
+
   void CreateClient(const vector<string>& dns_servers, int timeout_ms) {
     dns_client_.reset(new DNSClient(IPAddress::kFamilyIPv4,
                                     kNetworkInterface,
@@ -130,6 +177,9 @@ class DNSClientTest : public Test {
                                     callback_target_.callback()));
     dns_client_->ares_ = &ares_;
     dns_client_->time_ = &time_;
+    dns_client_->dns_cache_ = &dns_cache_;
+    dns_client_->set_use_cache(use_cache_);
+    dns_cache_.time_ = &time_;
   }
 
   void SetActive() {
@@ -234,12 +284,15 @@ class DNSClientTest : public Test {
   StrictMock<DNSCallbackTarget> callback_target_;
   StrictMock<MockAres> ares_;
   StrictMock<MockTime> time_;
+  DNSCache dns_cache_;
   struct timeval time_val_;
   struct timeval ares_timeout_;
   struct hostent hostent_;
   int ares_result_;
   Error error_result_;
   IPAddress address_result_;
+  // Whether clients created by CreateClient() use |dns_cache_|.
+  bool use_cache_;
 };
 
 class SentinelIOHandler : public IOHandler {
@@ -436,4 +489,174 @@ TEST_F(DNSClientTest, IOHandleDeallocStop) {
   dns_client_->Stop();
 }
 
+// A second lookup of the same name is answered from the cache without
+// querying the DNS servers.
+TEST_F(DNSClientTest, GoodRequestFromCache) {
+  use_cache_ = true;
+  StartValidRequest();
+  TestValidCompletion();
+  EXPECT_EQ(1, dns_cache_.misses());
+
+  ExpectPostCompletionTask();
+  Error error;
+  ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+  EXPECT_TRUE(error.IsSuccess());
+  EXPECT_TRUE(dns_client_->IsActive());
+  EXPECT_EQ(1, dns_cache_.hits());
+
+  IPAddress ipaddr(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(ipaddr.SetAddressFromString(kResult));
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), _))
+      .WillOnce(Invoke(this, &DNSClientTest::SaveCallbackArgs));
+  CallCompletion();
+  EXPECT_TRUE(ipaddr.Equals(address_result_));
+  EXPECT_FALSE(dns_client_->IsActive());
+}
+
+// Expired answers are not used.
+TEST_F(DNSClientTest, CachedAnswerExpires) {
+  use_cache_ = true;
+  StartValidRequest();
+  TestValidCompletion();
+
+  AdvanceTime(DNSCache::kDefaultTTLSeconds * 1000);
+  EXPECT_CALL(ares_, GetHostByName(kAresChannel, StrEq(kGoodName), _, _, _));
+  EXPECT_CALL(dispatcher_, PostDelayedTask(_, kAresWaitMS));
+  Error error;
+  ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+  EXPECT_EQ(0, dns_cache_.hits());
+  EXPECT_EQ(2, dns_cache_.misses());
+}
+
+// Clients that have not opted in to the cache neither fill it nor answer
+// from it, even when another client has cached the name.
+TEST_F(DNSClientTest, CacheDisabledByDefault) {
+  StartValidRequest();
+  EXPECT_FALSE(dns_client_->use_cache());
+  TestValidCompletion();
+  EXPECT_EQ(0, dns_cache_.size());
+
+  IPAddress address(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(address.SetAddressFromString(kResult));
+  dns_cache_.Insert(IPAddress::kFamilyIPv4, kGoodName, kNetworkInterface,
+                    vector<string>{kGoodServer}, address,
+                    DNSCache::kDefaultTTLSeconds);
+  EXPECT_CALL(ares_, GetHostByName(kAresChannel, StrEq(kGoodName), _, _, _));
+  EXPECT_CALL(dispatcher_, PostDelayedTask(_, kAresWaitMS));
+  Error error;
+  ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+  EXPECT_EQ(0, dns_cache_.hits());
+  EXPECT_EQ(0, dns_cache_.misses());
+}
+
+// Stopping a request answered from the cache cancels its completion.
+TEST_F(DNSClientTest, StopCachedRequest) {
+  use_cache_ = true;
+  IPAddress address(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(address.SetAddressFromString(kResult));
+  vector<string> dns_servers;
+  dns_servers.push_back(kGoodServer);
+  CreateClient(dns_servers, kAresTimeoutMS);
+  dns_cache_.Insert(IPAddress::kFamilyIPv4, kGoodName, kNetworkInterface,
+                    dns_servers, address, DNSCache::kDefaultTTLSeconds);
+
+  ExpectPostCompletionTask();
+  Error error;
+  ASSERT_TRUE(dns_client_->Start(kGoodName, &error));
+  EXPECT_TRUE(dns_client_->IsActive());
+  dns_client_->Stop();
+  EXPECT_FALSE(dns_client_->IsActive());
+  ExpectReset();
+}
+
+// Servers are raced fastest first, with unmeasured servers ahead of
+// measured ones, up to the configured count.
+TEST_F(DNSClientTest, RaceServerOrder) {
+  vector<string> dns_servers{kGoodServer, kSecondServer, kThirdServer};
+  CreateClient(dns_servers, kAresTimeoutMS);
+  dns_client_->set_race_server_count(2);
+  EXPECT_EQ((vector<string>{kGoodServer, kSecondServer}), GetRaceServers());
+
+  dns_cache_.RecordServerLatency(kNetworkInterface, kGoodServer, 500);
+  dns_cache_.RecordServerLatency(kNetworkInterface, kSecondServer, 100);
+  EXPECT_EQ((vector<string>{kThirdServer, kSecondServer}), GetRaceServers());
+
+  dns_cache_.RecordServerLatency(kNetworkInterface, kThirdServer, 200);
+  dns_client_->set_race_server_count(3);
+  EXPECT_EQ((vector<string>{kSecondServer, kThirdServer, kGoodServer}),
+            GetRaceServers());
+}
+
+// The first successful answer wins, and the other query is abandoned.
+TEST_F(DNSClientTest, RaceFirstAnswerWins) {
+  StartRace();
+  AdvanceTime(200);
+  EXPECT_CALL(dispatcher_, PostTask(_)).Times(2);
+  CallRaceReplyCB(1, ARES_SUCCESS);
+  // The outstanding query to the first server is stopped.
+  EXPECT_CALL(ares_, Destroy(kAresChannel));
+  CallRaceCompletion(1);
+  EXPECT_EQ(200, dns_cache_.GetServerLatency(kNetworkInterface,
+                                             kSecondServer));
+  EXPECT_EQ(200, dns_cache_.GetServerLatency(kNetworkInterface,
+                                             kGoodServer));
+
+  IPAddress ipaddr(IPAddress::kFamilyIPv4);
+  ASSERT_TRUE(ipaddr.SetAddressFromString(kResult));
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), _))
+      .WillOnce(Invoke(this, &DNSClientTest::SaveCallbackArgs));
+  // Releasing the winning client destroys its channel.
+  EXPECT_CALL(ares_, Destroy(kAresChannel));
+  CallCompletion();
+  EXPECT_TRUE(ipaddr.Equals(address_result_));
+  EXPECT_FALSE(dns_client_->IsActive());
+}
+
+// A server that never answers keeps its latency when another server wins,
+// rather than drifting toward the winner's, so it does not move up the
+// ranking.
+TEST_F(DNSClientTest, RaceAbandonedServerKeepsLatency) {
+  dns_cache_.RecordServerLatency(kNetworkInterface, kGoodServer, 1000);
+  dns_cache_.RecordServerLatency(kNetworkInterface, kSecondServer, 300);
+  StartRace();  // Queries |kSecondServer| first.
+  AdvanceTime(100);
+  EXPECT_CALL(dispatcher_, PostTask(_)).Times(2);
+  CallRaceReplyCB(0, ARES_SUCCESS);
+  EXPECT_EQ(1000, dns_cache_.GetServerLatency(kNetworkInterface,
+                                              kGoodServer));
+  EXPECT_EQ(250, dns_cache_.GetServerLatency(kNetworkInterface,
+                                             kSecondServer));
+  EXPECT_EQ((vector<string>{kSecondServer, kGoodServer}), GetRaceServers());
+
+  EXPECT_CALL(ares_, Destroy(kAresChannel)).Times(2);
+  CallRaceCompletion(0);
+  EXPECT_CALL(callback_target_, CallTarget(IsSuccess(), _));
+  CallCompletion();
+  EXPECT_FALSE(dns_client_->IsActive());
+}
+
+// The race fails only once every server has failed.
+TEST_F(DNSClientTest, RaceAllServersFail) {
+  StartRace();
+  AdvanceTime(100);
+  EXPECT_CALL(dispatcher_, PostTask(_));
+  CallRaceReplyCB(0, ARES_ENOTFOUND);
+  EXPECT_CALL(ares_, Destroy(kAresChannel));
+  CallRaceCompletion(0);
+  EXPECT_TRUE(dns_client_->IsActive());
+
+  AdvanceTime(kAresTimeoutMS);
+  EXPECT_CALL(dispatcher_, PostTask(_)).Times(2);
+  CallRaceReplyCB(1, ARES_ETIMEOUT);
+  EXPECT_CALL(ares_, Destroy(kAresChannel));
+  CallRaceCompletion(1);
+  EXPECT_EQ(kAresTimeoutMS,
+            dns_cache_.GetServerLatency(kNetworkInterface, kSecondServer));
+
+  EXPECT_CALL(callback_target_, CallTarget(
+      ErrorIs(Error::kOperationTimeout, DNSClient::kErrorTimedOut), _));
+  CallCompletion();
+  EXPECT_FALSE(dns_client_->IsActive());
+}
+
 }  // namespace shill
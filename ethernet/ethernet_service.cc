@@ -142,7 +142,7 @@ bool EthernetService::IsAutoConnectable(const char** reason) const {
 }
 
 void EthernetService::OnVisibilityChanged() {
-  NotifyPropertyChanges();
+  NotifyPropertyChange(kVisibleProperty);
 }
 
 string EthernetService::GetTethering(Error* /*error*/) const {
@@ -75,6 +75,8 @@ bool FakeStore::Flush() {
   return true;
 }
 
+void FakeStore::ClearDecryptionCache() {}
+
 bool FakeStore::MarkAsCorrupted() {
   return true;
 }
@@ -41,6 +41,7 @@ class FakeStore : public StoreInterface {
   bool Open() override;
   bool Close() override;
   bool Flush() override;
+  void ClearDecryptionCache() override;
   bool MarkAsCorrupted() override;
   std::set<std::string> GetGroups() const override;
   std::set<std::string> GetGroupsWithKey(const std::string& key) const override;
@@ -0,0 +1,808 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/http_proxy_session.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <linux/if.h>  // NOLINT - Needs definitions from netinet/in.h
+
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
+
+#include "shill/async_connection.h"
+#include "shill/connection.h"
+#include "shill/dns_client.h"
+#include "shill/event_dispatcher.h"
+#include "shill/logging.h"
+#include "shill/net/ip_address.h"
+#include "shill/net/sockets.h"
+
+using base::Bind;
+using base::StringPrintf;
+using std::string;
+using std::vector;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kHTTPProxy;
+static string ObjectID(Connection* c) {
+  return c->interface_name();
+}
+}
+
+const int HTTPProxySession::kClientHeaderTimeoutSeconds = 1;
+const int HTTPProxySession::kConnectTimeoutSeconds = 10;
+const int HTTPProxySession::kDNSTimeoutSeconds = 5;
+const int HTTPProxySession::kDefaultServerPort = 80;
+const int HTTPProxySession::kInputTimeoutSeconds = 30;
+const size_t HTTPProxySession::kMaxHeaderCount = 128;
+const size_t HTTPProxySession::kMaxHeaderSize = 2048;
+const size_t HTTPProxySession::kSpliceChunkSize = 65536;
+const int HTTPProxySession::kTransactionTimeoutSeconds = 600;
+
+const char HTTPProxySession::kHTTPMethodConnect[] = "connect";
+const char HTTPProxySession::kHTTPMethodTerminator[] = " ";
+const char HTTPProxySession::kHTTPURLDelimiters[] = " /#?";
+const char HTTPProxySession::kHTTPURLPrefix[] = "http://";
+const char HTTPProxySession::kHTTPVersionPrefix[] = " HTTP/1";
+const char HTTPProxySession::kInternalErrorMsg[] =
+    "Proxy Failed: Internal Error";
+
+HTTPProxySession::HTTPProxySession(
+    ConnectionRefPtr connection,
+    EventDispatcher* dispatcher,
+    Sockets* sockets,
+    const base::Callback<void(HTTPProxySession*)>& done_callback)
+    : state_(kStateIdle),
+      connection_(connection),
+      dispatcher_(dispatcher),
+      sockets_(sockets),
+      done_callback_(done_callback),
+      weak_ptr_factory_(this),
+      connect_completion_callback_(
+          Bind(&HTTPProxySession::OnConnectCompletion,
+               weak_ptr_factory_.GetWeakPtr())),
+      dns_client_callback_(Bind(&HTTPProxySession::GetDNSResult,
+                                weak_ptr_factory_.GetWeakPtr())),
+      read_client_callback_(Bind(&HTTPProxySession::ReadFromClient,
+                                 weak_ptr_factory_.GetWeakPtr())),
+      read_server_callback_(Bind(&HTTPProxySession::ReadFromServer,
+                                 weak_ptr_factory_.GetWeakPtr())),
+      splice_client_callback_(Bind(&HTTPProxySession::SpliceFromClient,
+                                   weak_ptr_factory_.GetWeakPtr())),
+      splice_server_callback_(Bind(&HTTPProxySession::SpliceFromServer,
+                                   weak_ptr_factory_.GetWeakPtr())),
+      write_client_callback_(Bind(&HTTPProxySession::WriteToClient,
+                                  weak_ptr_factory_.GetWeakPtr())),
+      write_server_callback_(Bind(&HTTPProxySession::WriteToServer,
+                                  weak_ptr_factory_.GetWeakPtr())),
+      dns_client_(new DNSClient(IPAddress::kFamilyIPv4,
+                                connection->interface_name(),
+                                connection->dns_servers(),
+                                kDNSTimeoutSeconds * 1000,
+                                dispatcher,
+                                dns_client_callback_)),
+      server_async_connection_(
+          new AsyncConnection(connection->interface_name(), dispatcher,
+                              sockets, connect_completion_callback_)),
+      use_splice_(true),
+      client_socket_(-1),
+      server_port_(kDefaultServerPort),
+      server_socket_(-1),
+      is_route_requested_(false),
+      is_splicing_(false) {
+  dns_client_->set_use_cache(true);
+  dns_client_->set_race_server_count(DNSClient::kDefaultRaceServerCount);
+}
+
+HTTPProxySession::~HTTPProxySession() {
+  Stop();
+}
+
+// Start reading a request from the client the HTTPProxy accepted on
+// |client_socket|.
+void HTTPProxySession::Start(int client_socket) {
+  SLOG(connection_.get(), 3) << "In " << __func__ << " fd " << client_socket;
+  CHECK_EQ(kStateIdle, state_);
+
+  client_socket_ = client_socket;
+
+  sockets_->SetNonBlocking(client_socket_);
+  read_client_handler_.reset(dispatcher_->CreateInputHandler(
+      client_socket_,
+      read_client_callback_,
+      Bind(&HTTPProxySession::OnReadError, weak_ptr_factory_.GetWeakPtr())));
+  // Overall transaction timeout.
+  transaction_timeout_.Reset(Bind(&HTTPProxySession::StopClient,
+                                  weak_ptr_factory_.GetWeakPtr()));
+  dispatcher_->PostDelayedTask(transaction_timeout_.callback(),
+                               kTransactionTimeoutSeconds * 1000);
+
+  state_ = kStateReadClientHeader;
+  StartIdleTimeout();
+}
+
+void HTTPProxySession::Stop() {
+  SLOG(connection_.get(), 3) << "In " << __func__;
+
+  if (is_route_requested_) {
+    connection_->ReleaseRouting();
+    is_route_requested_ = false;
+  }
+  write_client_handler_.reset();
+  read_client_handler_.reset();
+  if (client_socket_ != -1) {
+    sockets_->Close(client_socket_);
+    client_socket_ = -1;
+  }
+  client_headers_.clear();
+  client_method_.clear();
+  client_version_.clear();
+  server_port_ = kDefaultServerPort;
+  write_server_handler_.reset();
+  read_server_handler_.reset();
+  if (server_socket_ != -1) {
+    sockets_->Close(server_socket_);
+    server_socket_ = -1;
+  }
+  server_hostname_.clear();
+  client_data_.Clear();
+  server_data_.Clear();
+  StopSplice();
+  dns_client_->Stop();
+  server_async_connection_->Stop();
+  idle_timeout_.Cancel();
+  transaction_timeout_.Cancel();
+  state_ = kStateIdle;
+}
+
+bool HTTPProxySession::ConnectServer(const IPAddress& address, int port) {
+  state_ = kStateConnectServer;
+  if (!server_async_connection_->Start(address, port)) {
+    SendClientError(500, "Could not create socket to connect to server");
+    return false;
+  }
+  StartIdleTimeout();
+  return true;
+}
+
+// DNSClient callback that fires when the DNS request completes.
+void HTTPProxySession::GetDNSResult(const Error& error,
+                                    const IPAddress& address) {
+  if (!error.IsSuccess()) {
+    SendClientError(502, string("Could not resolve hostname: ") +
+                    error.message());
+    return;
+  }
+  ConnectServer(address, server_port_);
+}
+
+// IOReadyHandler callback routine which fires when the asynchronous Connect()
+// to the remote server completes (or fails).
+void HTTPProxySession::OnConnectCompletion(bool success, int fd) {
+  if (!success) {
+    SendClientError(500, string("Socket connection delayed failure: ") +
+                    server_async_connection_->error());
+    return;
+  }
+  server_socket_ = fd;
+  state_ = kStateTunnelData;
+
+  // Prepare to splice tunnel data between the sockets.  Should the pipes
+  // be unavailable, data continues to be copied through our own buffers.
+  if (use_splice_ &&
+      (sockets_->Pipe(&client_pipe_.read_fd, &client_pipe_.write_fd) < 0 ||
+       sockets_->Pipe(&server_pipe_.read_fd, &server_pipe_.write_fd) < 0)) {
+    PLOG(WARNING) << "Could not create splice pipes; copying tunnel data";
+    StopSplice();
+  }
+
+  // If this was a "CONNECT" request, notify the client that the connection
+  // has been established by sending an "OK" response.
+  if (base::LowerCaseEqualsASCII(client_method_, kHTTPMethodConnect)) {
+    SetClientResponse(200, "OK", "", "");
+    StartReceive();
+  }
+
+  StartTransmit();
+}
+
+void HTTPProxySession::OnReadError(const string& error_msg) {
+  StopClient();
+}
+
+// Read through the header lines from the client, modifying or adding
+// lines as necessary.  Perform final determination of the hostname/port
+// we should connect to and either start a DNS request or connect to a
+// numeric address.
+bool HTTPProxySession::ParseClientRequest() {
+  SLOG(connection_.get(), 3) << "In " << __func__;
+
+  string host;
+  bool found_via = false;
+  bool found_connection = false;
+  for (auto& header : client_headers_) {
+    if (base::StartsWith(header, "Host:",
+                         base::CompareCase::INSENSITIVE_ASCII)) {
+      host = header.substr(5);
+    } else if (base::StartsWith(header, "Via:",
+                                base::CompareCase::INSENSITIVE_ASCII)) {
+      found_via = true;
+      header.append(StringPrintf(", %s shill-proxy", client_version_.c_str()));
+    } else if (base::StartsWith(header, "Connection:",
+                                base::CompareCase::INSENSITIVE_ASCII)) {
+      found_connection = true;
+      header.assign("Connection: close");
+    } else if (base::StartsWith(header, "Proxy-Connection:",
+                                base::CompareCase::INSENSITIVE_ASCII)) {
+      header.assign("Proxy-Connection: close");
+    }
+  }
+
+  if (!found_connection) {
+    client_headers_.push_back("Connection: close");
+  }
+  if (!found_via) {
+    client_headers_.push_back(
+        StringPrintf("Via: %s shill-proxy", client_version_.c_str()));
+  }
+
+  // Assemble the request as it will be sent to the server.
+  client_data_.Clear();
+  if (!base::LowerCaseEqualsASCII(client_method_, kHTTPMethodConnect)) {
+    for (const auto& header : client_headers_) {
+      client_data_.Append(ByteString(header + "\r\n", false));
+    }
+    client_data_.Append(ByteString(string("\r\n"), false));
+  }
+
+  base::TrimWhitespaceASCII(host, base::TRIM_ALL, &host);
+  if (host.empty()) {
+    // Revert to using the hostname in the URL if no "Host:" header exists.
+    host = server_hostname_;
+  }
+
+  if (host.empty()) {
+    SendClientError(400, "I don't know what host you want me to connect to");
+    return false;
+  }
+
+  server_port_ = 80;
+  vector<string> host_parts = base::SplitString(
+      host, ":", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+
+  if (host_parts.size() > 2) {
+    SendClientError(400, "Too many colons in hostname");
+    return false;
+  } else if (host_parts.size() == 2) {
+    server_hostname_ = host_parts[0];
+    if (!base::StringToInt(host_parts[1], &server_port_)) {
+      SendClientError(400, "Could not parse port number");
+      return false;
+    }
+  } else {
+    server_hostname_ = host;
+  }
+
+  connection_->RequestRouting();
+  is_route_requested_ = true;
+
+  IPAddress addr(IPAddress::kFamilyIPv4);
+  if (addr.SetAddressFromString(server_hostname_)) {
+    if (!ConnectServer(addr, server_port_)) {
+      return false;
+    }
+  } else {
+    SLOG(connection_.get(), 3) << "Looking up host: " << server_hostname_;
+    Error error;
+    if (!dns_client_->Start(server_hostname_, &error)) {
+      SendClientError(502, "Could not resolve hostname: " + error.message());
+      return false;
+    }
+    state_ = kStateLookupServer;
+  }
+  return true;
+}
+
+// Accept a new line into the client headers.  Returns false if a parse
+// error occurs.
+bool HTTPProxySession::ProcessLastHeaderLine() {
+  string* header = &client_headers_.back();
+  base::TrimString(*header, "\r", header);
+
+  if (header->empty()) {
+    // Empty line terminates client headers.
+    client_headers_.pop_back();
+    if (!ParseClientRequest()) {
+      return false;
+    }
+  }
+
+  // Is this is the first header line?
+  if (client_headers_.size() == 1) {
+    if (!ReadClientHTTPMethod(header) ||
+        !ReadClientHTTPVersion(header) ||
+        !ReadClientHostname(header)) {
+      return false;
+    }
+  }
+
+  if (client_headers_.size() >= kMaxHeaderCount) {
+    SendClientError(500, kInternalErrorMsg);
+    return false;
+  }
+
+  return true;
+}
+
+// Split input from client into header lines, and consume parsed lines
+// from InputData.  The passed in |data| is modified to indicate the
+// characters consumed.
+bool HTTPProxySession::ReadClientHeaders(InputData* data) {
+  unsigned char* ptr = data->buf;
+  unsigned char* end = ptr + data->len;
+
+  if (client_headers_.empty()) {
+    client_headers_.push_back(string());
+  }
+
+  for (; ptr < end && state_ == kStateReadClientHeader; ++ptr) {
+    if (*ptr == '\n') {
+      if (!ProcessLastHeaderLine()) {
+        return false;
+      }
+
+      // Start a new line.  New chararacters we receive will be appended there.
+      client_headers_.push_back(string());
+      continue;
+    }
+
+    string* header = &client_headers_.back();
+    // Is the first character of the header line a space or tab character?
+    if (header->empty() && (*ptr == ' ' || *ptr == '\t') &&
+        client_headers_.size() > 1) {
+      // Line Continuation: Add this character to the previous header line.
+      // This way, all of the data (including newlines and line continuation
+      // characters) related to a specific header will be contained within
+      // a single element of |client_headers_|, and manipulation of headers
+      // such as appending will be simpler.  This is accomplished by removing
+      // the empty line we started, and instead appending the whitespace
+      // and following characters to the previous line.
+      client_headers_.pop_back();
+      header = &client_headers_.back();
+      header->append("\r\n");
+    }
+
+    if (header->length() >= kMaxHeaderSize) {
+      SendClientError(500, kInternalErrorMsg);
+      return false;
+    }
+    header->push_back(*ptr);
+  }
+
+  // Return the remaining data to the caller -- this could be POST data
+  // or other non-header data sent with the client request.
+  data->buf = ptr;
+  data->len = end - ptr;
+
+  return true;
+}
+
+// Finds the URL in the first line of an HTTP client header, and extracts
+// and removes the hostname (and port) from the URL.  Returns false if a
+// parse error occurs, and true otherwise (whether or not the hostname was
+// found).
+bool HTTPProxySession::ReadClientHostname(string* header) {
+  const string http_url_prefix(kHTTPURLPrefix);
+  size_t url_idx = header->find(http_url_prefix);
+  if (url_idx != string::npos) {
+    size_t host_start = url_idx + http_url_prefix.length();
+    size_t host_end =
+      header->find_first_of(kHTTPURLDelimiters, host_start);
+    if (host_end != string::npos) {
+      server_hostname_ = header->substr(host_start,
+                                        host_end - host_start);
+      // Modify the URL passed upstream to remove "http://<hostname>".
+      header->erase(url_idx, host_end - url_idx);
+      if ((*header)[url_idx] != '/') {
+        header->insert(url_idx, "/");
+      }
+    } else {
+      LOG(ERROR) << "Could not find end of hostname in request.  Line was: "
+                 << *header;
+      SendClientError(500, kInternalErrorMsg);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HTTPProxySession::ReadClientHTTPMethod(string* header) {
+  size_t method_end = header->find(kHTTPMethodTerminator);
+  if (method_end == string::npos || method_end == 0) {
+    LOG(ERROR) << "Could not parse HTTP method.  Line was: " << *header;
+    SendClientError(501, "Server could not parse HTTP method");
+    return false;
+  }
+  client_method_ = header->substr(0, method_end);
+  return true;
+}
+
+// Extract the HTTP version number from the first line of the client headers.
+// Returns true if found.
+bool HTTPProxySession::ReadClientHTTPVersion(string* header) {
+  const string http_version_prefix(kHTTPVersionPrefix);
+  size_t http_ver_pos = header->find(http_version_prefix);
+  if (http_ver_pos != string::npos) {
+    client_version_ =
+      header->substr(http_ver_pos + http_version_prefix.length() - 1);
+  } else {
+    SendClientError(501, "Server only accepts HTTP/1.x requests");
+    return false;
+  }
+  return true;
+}
+
+// IOInputHandler callback that fires when data is read from the client.
+// This could be header data, or perhaps POST data that follows the headers.
+void HTTPProxySession::ReadFromClient(InputData* data) {
+  SLOG(connection_.get(), 3) << "In " << __func__ << " length " << data->len;
+
+  if (data->len == 0) {
+    // EOF from client.
+    StopClient();
+    return;
+  }
+
+  if (state_ == kStateReadClientHeader) {
+    if (!ReadClientHeaders(data)) {
+      return;
+    }
+    if (state_ == kStateReadClientHeader) {
+      // Still consuming client headers; restart the input timer.
+      StartIdleTimeout();
+      return;
+    }
+  }
+
+  // Check data->len again since ReadClientHeaders() may have consumed some
+  // part of it.
+  if (data->len != 0) {
+    // The client sent some information after its headers.  Buffer the client
+    // input and temporarily disable input events from the client.
+    client_data_.Append(ByteString(data->buf, data->len));
+    read_client_handler_->Stop();
+    StartTransmit();
+  }
+}
+
+// IOInputHandler callback which fires when data has been read from the
+// server.
+void HTTPProxySession::ReadFromServer(InputData* data) {
+  SLOG(connection_.get(), 3) << "In " << __func__ << " length " << data->len;
+  if (data->len == 0) {
+    // Server closed connection.
+    if (server_data_.IsEmpty()) {
+      StopClient();
+      return;
+    }
+    state_ = kStateFlushResponse;
+  } else {
+    read_server_handler_->Stop();
+  }
+
+  server_data_.Append(ByteString(data->buf, data->len));
+
+  StartTransmit();
+}
+
+// Return an HTTP error message back to the client.
+void HTTPProxySession::SendClientError(int code, const string& error) {
+  SLOG(connection_.get(), 3) << "In " << __func__;
+  LOG(ERROR) << "Sending error " << error;
+  SetClientResponse(code, "ERROR", "text/plain", error);
+  state_ = kStateFlushResponse;
+  StartTransmit();
+}
+
+// Create an HTTP response message to be sent to the client.
+void HTTPProxySession::SetClientResponse(int code, const string& type,
+                                         const string& content_type,
+                                         const string& message) {
+  string content_line;
+  if (!message.empty() && !content_type.empty()) {
+    content_line = StringPrintf("Content-Type: %s\r\n", content_type.c_str());
+  }
+  string response = StringPrintf("HTTP/1.1 %d %s\r\n"
+                                 "%s\r\n"
+                                 "%s", code, type.c_str(),
+                                 content_line.c_str(),
+                                 message.c_str());
+  server_data_ = ByteString(response, false);
+}
+
+// IOReadyHandler callback which fires when the client socket has data to
+// be spliced towards the server.
+void HTTPProxySession::SpliceFromClient(int fd) {
+  CHECK_EQ(client_socket_, fd);
+  SpliceIn(fd, &client_pipe_, splice_client_handler_.get());
+}
+
+// IOReadyHandler callback which fires when the server socket has data to
+// be spliced towards the client.
+void HTTPProxySession::SpliceFromServer(int fd) {
+  CHECK_EQ(server_socket_, fd);
+  SpliceIn(fd, &server_pipe_, splice_server_handler_.get());
+}
+
+// Move up to kSpliceChunkSize bytes from socket |fd| into |pipe|.  Input
+// events from |fd| are disabled through |handler| until the pipe has been
+// drained into the other socket.  End-of-file from either side ends the
+// transaction, as it does when copying.
+void HTTPProxySession::SpliceIn(int fd, SplicePipe* pipe, IOHandler* handler) {
+  ssize_t ret = sockets_->Splice(fd, pipe->write_fd, kSpliceChunkSize,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  SLOG(connection_.get(), 3) << "In " << __func__ << " spliced " << ret
+                             << " from " << fd;
+  if (ret < 0 && sockets_->Error() == EAGAIN) {
+    return;
+  }
+  if (ret <= 0) {
+    if (ret < 0) {
+      PLOG(ERROR) << "Splice read failed";
+    }
+    StopClient();
+    return;
+  }
+
+  pipe->pending += ret;
+  handler->Stop();
+  StartTransmit();
+}
+
+// Move the data waiting in |pipe| out to socket |fd|.  Output events for
+// |fd| are disabled through |handler| once the pipe is empty.
+void HTTPProxySession::SpliceOut(SplicePipe* pipe, int fd, IOHandler* handler) {
+  ssize_t ret = sockets_->Splice(pipe->read_fd, fd, pipe->pending,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  SLOG(connection_.get(), 3) << "In " << __func__ << " spliced " << ret
+                             << " of " << pipe->pending << " to " << fd;
+  if (ret < 0 && sockets_->Error() == EAGAIN) {
+    return;
+  }
+  if (ret <= 0) {
+    PLOG(ERROR) << "Splice write failed";
+    StopClient();
+    return;
+  }
+
+  pipe->pending -= ret;
+  if (pipe->pending == 0) {
+    handler->Stop();
+  }
+
+  StartReceive();
+}
+
+// Start a timeout for "the next event".  This timeout augments the overall
+// transaction timeout to make sure there is some activity occurring at
+// reasonable intervals.
+void HTTPProxySession::StartIdleTimeout() {
+  int timeout_seconds = 0;
+  switch (state_) {
+    case kStateReadClientHeader:
+      timeout_seconds = kClientHeaderTimeoutSeconds;
+      break;
+    case kStateConnectServer:
+      timeout_seconds = kConnectTimeoutSeconds;
+      break;
+    case kStateLookupServer:
+      // DNSClient has its own internal timeout, so we need not set one here.
+      timeout_seconds = 0;
+      break;
+    default:
+      timeout_seconds = kInputTimeoutSeconds;
+      break;
+  }
+  idle_timeout_.Cancel();
+  if (timeout_seconds != 0) {
+    idle_timeout_.Reset(Bind(&HTTPProxySession::StopClient,
+                             weak_ptr_factory_.GetWeakPtr()));
+    dispatcher_->PostDelayedTask(idle_timeout_.callback(),
+                                 timeout_seconds * 1000);
+  }
+}
+
+// Start the various input handlers.  Listen for new data only if we have
+// completely written the last data we've received to the other end.
+void HTTPProxySession::StartReceive() {
+  if (state_ == kStateTunnelData && !is_splicing_ &&
+      client_pipe_.read_fd != -1 && client_data_.IsEmpty() &&
+      server_data_.IsEmpty()) {
+    StartSplice();
+  }
+  if (state_ == kStateTunnelData && client_data_.IsEmpty()) {
+    if (!is_splicing_) {
+      read_client_handler_->Start();
+    } else if (client_pipe_.pending == 0) {
+      splice_client_handler_->Start();
+    }
+  }
+  if (server_data_.IsEmpty()) {
+    if (state_ == kStateTunnelData) {
+      if (is_splicing_) {
+        if (server_pipe_.pending == 0) {
+          splice_server_handler_->Start();
+        }
+      } else if (read_server_handler_.get()) {
+        read_server_handler_->Start();
+      } else {
+        read_server_handler_.reset(dispatcher_->CreateInputHandler(
+            server_socket_,
+            read_server_callback_,
+            Bind(&HTTPProxySession::OnReadError,
+                 weak_ptr_factory_.GetWeakPtr())));
+      }
+    } else if (state_ == kStateFlushResponse) {
+      StopClient();
+      return;
+    }
+  }
+  StartIdleTimeout();
+}
+
+// Switch the tunnel from copying data to splicing it.  This is done only
+// once everything read into |client_data_| and |server_data_| has been
+// written out, so the order of the data on each stream is preserved.
+void HTTPProxySession::StartSplice() {
+  SLOG(connection_.get(), 3) << "In " << __func__;
+  read_client_handler_->Stop();
+  if (read_server_handler_.get()) {
+    read_server_handler_->Stop();
+  }
+  splice_client_handler_.reset(
+      dispatcher_->CreateReadyHandler(client_socket_,
+                                      IOHandler::kModeInput,
+                                      splice_client_callback_));
+  splice_server_handler_.reset(
+      dispatcher_->CreateReadyHandler(server_socket_,
+                                      IOHandler::kModeInput,
+                                      splice_server_callback_));
+  is_splicing_ = true;
+}
+
+// Start the various output-ready handlers for the endpoints we have
+// data waiting for.
+void HTTPProxySession::StartTransmit() {
+  if (state_ == kStateTunnelData &&
+      (!client_data_.IsEmpty() || client_pipe_.pending != 0)) {
+    if (write_server_handler_.get()) {
+      write_server_handler_->Start();
+    } else {
+      write_server_handler_.reset(
+          dispatcher_->CreateReadyHandler(server_socket_,
+                                          IOHandler::kModeOutput,
+                                          write_server_callback_));
+    }
+  }
+  if ((state_ == kStateFlushResponse || state_ == kStateTunnelData) &&
+      (!server_data_.IsEmpty() || server_pipe_.pending != 0)) {
+    if (write_client_handler_.get()) {
+      write_client_handler_->Start();
+    } else {
+      write_client_handler_.reset(
+          dispatcher_->CreateReadyHandler(client_socket_,
+                                          IOHandler::kModeOutput,
+                                          write_client_callback_));
+    }
+  }
+  StartIdleTimeout();
+}
+
+// End the transaction with the client and let the HTTPProxy know that
+// this session is done.  This function is called during various error
+// conditions and is a callback for all timeouts.
+void HTTPProxySession::StopClient() {
+  Stop();
+  done_callback_.Run(this);
+}
+
+
+// Close the splice pipes, discarding any data still waiting in them.
+void HTTPProxySession::StopSplice() {
+  splice_client_handler_.reset();
+  splice_server_handler_.reset();
+  for (SplicePipe* pipe : { &client_pipe_, &server_pipe_ }) {
+    if (pipe->read_fd != -1) {
+      sockets_->Close(pipe->read_fd);
+      pipe->read_fd = -1;
+    }
+    if (pipe->write_fd != -1) {
+      sockets_->Close(pipe->write_fd);
+      pipe->write_fd = -1;
+    }
+    pipe->pending = 0;
+  }
+  is_splicing_ = false;
+}
+
+// Output ReadyHandler callback which fires when the client socket is
+// ready for data to be sent to it.
+void HTTPProxySession::WriteToClient(int fd) {
+  CHECK_EQ(client_socket_, fd);
+  if (is_splicing_) {
+    SpliceOut(&server_pipe_, fd, write_client_handler_.get());
+    return;
+  }
+  int ret = sockets_->Send(fd, server_data_.GetConstData(),
+                           server_data_.GetLength(), 0);
+  SLOG(connection_.get(), 3) << "In " << __func__ << " wrote " << ret << " of "
+                             << server_data_.GetLength();
+  if (ret < 0) {
+    LOG(ERROR) << "Server write failed";
+    StopClient();
+    return;
+  }
+
+  server_data_ = ByteString(server_data_.GetConstData() + ret,
+                            server_data_.GetLength() - ret);
+
+  if (server_data_.IsEmpty()) {
+    write_client_handler_->Stop();
+  }
+
+  StartReceive();
+}
+
+// Output ReadyHandler callback which fires when the server socket is
+// ready for data to be sent to it.
+void HTTPProxySession::WriteToServer(int fd) {
+  CHECK_EQ(server_socket_, fd);
+  if (is_splicing_) {
+    SpliceOut(&client_pipe_, fd, write_server_handler_.get());
+    return;
+  }
+  int ret = sockets_->Send(fd, client_data_.GetConstData(),
+                           client_data_.GetLength(), 0);
+  SLOG(connection_.get(), 3) << "In " << __func__ << " wrote " << ret << " of "
+                             << client_data_.GetLength();
+
+  if (ret < 0) {
+    LOG(ERROR) << "Client write failed";
+    StopClient();
+    return;
+  }
+
+  client_data_ = ByteString(client_data_.GetConstData() + ret,
+                            client_data_.GetLength() - ret);
+
+  if (client_data_.IsEmpty()) {
+    write_server_handler_->Stop();
+  }
+
+  StartReceive();
+}
+
+}  // namespace shill
@@ -0,0 +1,204 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SHILL_HTTP_PROXY_SESSION_H_
+#define SHILL_HTTP_PROXY_SESSION_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/cancelable_callback.h>
+#include <base/memory/weak_ptr.h>
+
+#include "shill/net/byte_string.h"
+#include "shill/refptr_types.h"
+
+namespace shill {
+
+class AsyncConnection;
+class DNSClient;
+class Error;
+class EventDispatcher;
+struct InputData;
+class IOHandler;
+class IPAddress;
+class Sockets;
+
+// An HTTPProxySession carries a single client connection accepted by the
+// HTTPProxy through to a remote server.  It reads the client's request
+// headers, resolves and connects to the server named in them, and then
+// tunnels data in both directions until either end closes.  Each session
+// has its own sockets, DNS lookup and buffers, so a slow server only holds
+// up the client that asked for it.
+//
+// The memory held by a session is bounded: request headers are limited to
+// kMaxHeaderCount lines of kMaxHeaderSize bytes, the copy buffers hold at
+// most one read from each socket, and a splice pipe at most
+// kSpliceChunkSize bytes in each direction.
+class HTTPProxySession {
+ public:
+  enum State {
+    kStateIdle,
+    kStateReadClientHeader,
+    kStateLookupServer,
+    kStateConnectServer,
+    kStateTunnelData,
+    kStateFlushResponse,
+  };
+
+  // |done_callback| is run once the session has ended and closed its
+  // sockets.  The session must not be destroyed from within the callback.
+  HTTPProxySession(ConnectionRefPtr connection,
+                   EventDispatcher* dispatcher,
+                   Sockets* sockets,
+                   const base::Callback<void(HTTPProxySession*)>&
+                       done_callback);
+  virtual ~HTTPProxySession();
+
+  // Start serving the client connected on |client_socket|.  The session
+  // takes ownership of the socket.
+  void Start(int client_socket);
+
+  // Close the client and server connections.  |done_callback| is not run.
+  void Stop();
+
+  void set_use_splice(bool use_splice) { use_splice_ = use_splice; }
+
+  State state() const { return state_; }
+
+ private:
+  friend class HTTPProxySessionTest;
+  friend class HTTPProxyTest;
+
+  // A kernel pipe through which tunnel data moves from one socket to the
+  // other using splice(), without being copied into user space.
+  struct SplicePipe {
+    SplicePipe() : read_fd(-1), write_fd(-1), pending(0) {}
+    int read_fd;
+    int write_fd;
+    size_t pending;  // Number of bytes waiting in the pipe.
+  };
+
+  // Time to wait for initial headers from client.
+  static const int kClientHeaderTimeoutSeconds;
+  // Time to wait for connection to remote server.
+  static const int kConnectTimeoutSeconds;
+  // Time to wait for DNS server.
+  static const int kDNSTimeoutSeconds;
+  // Default port on remote server to connect to.
+  static const int kDefaultServerPort;
+  // Time to wait for any input from either server or client.
+  static const int kInputTimeoutSeconds;
+  // Maximum number of header lines to accept.
+  static const size_t kMaxHeaderCount;
+  // Maximum length of an individual header line.
+  static const size_t kMaxHeaderSize;
+  // Maximum number of bytes moved into a splice pipe at a time.
+  static const size_t kSpliceChunkSize;
+  // Timeout for whole transaction.
+  static const int kTransactionTimeoutSeconds;
+
+  static const char kHTTPMethodConnect[];
+  static const char kHTTPMethodTerminator[];
+  static const char kHTTPURLDelimiters[];
+  static const char kHTTPURLPrefix[];
+  static const char kHTTPVersionPrefix[];
+  static const char kInternalErrorMsg[];  // Message to send on failure.
+
+  bool ConnectServer(const IPAddress& address, int port);
+  void GetDNSResult(const Error& error, const IPAddress& address);
+  void OnReadError(const std::string& error_msg);
+  void OnConnectCompletion(bool success, int fd);
+  bool ParseClientRequest();
+  bool ProcessLastHeaderLine();
+  bool ReadClientHeaders(InputData* data);
+  bool ReadClientHostname(std::string* header);
+  bool ReadClientHTTPMethod(std::string* header);
+  bool ReadClientHTTPVersion(std::string* header);
+  void ReadFromClient(InputData* data);
+  void ReadFromServer(InputData* data);
+  void SetClientResponse(int code, const std::string& type,
+                         const std::string& content_type,
+                         const std::string& message);
+  void SendClientError(int code, const std::string& error);
+  void SpliceFromClient(int fd);
+  void SpliceFromServer(int fd);
+  void SpliceIn(int fd, SplicePipe* pipe, IOHandler* handler);
+  void SpliceOut(SplicePipe* pipe, int fd, IOHandler* handler);
+  void StartIdleTimeout();
+  void StartReceive();
+  void StartSplice();
+  void StartTransmit();
+  void StopClient();
+  void StopSplice();
+  void WriteToClient(int fd);
+  void WriteToServer(int fd);
+
+  // State held for the lifetime of the session.
+  State state_;
+  ConnectionRefPtr connection_;
+  EventDispatcher* dispatcher_;
+  Sockets* sockets_;
+  base::Callback<void(HTTPProxySession*)> done_callback_;
+  base::WeakPtrFactory<HTTPProxySession> weak_ptr_factory_;
+  base::Callback<void(bool, int)> connect_completion_callback_;
+  base::Callback<void(const Error&, const IPAddress&)> dns_client_callback_;
+  base::Callback<void(InputData*)> read_client_callback_;
+  base::Callback<void(InputData*)> read_server_callback_;
+  base::Callback<void(int)> splice_client_callback_;
+  base::Callback<void(int)> splice_server_callback_;
+  base::Callback<void(int)> write_client_callback_;
+  base::Callback<void(int)> write_server_callback_;
+  std::unique_ptr<DNSClient> dns_client_;
+  std::unique_ptr<AsyncConnection> server_async_connection_;
+  // Whether tunnel data should be moved with splice() instead of being
+  // copied through |client_data_| and |server_data_|.
+  bool use_splice_;
+
+  // State held while the client is being served.
+  int client_socket_;
+  std::string client_method_;
+  std::string client_version_;
+  int server_port_;
+  int server_socket_;
+  bool is_route_requested_;
+  base::CancelableClosure idle_timeout_;
+  base::CancelableClosure transaction_timeout_;
+  std::vector<std::string> client_headers_;
+  std::string server_hostname_;
+  ByteString client_data_;
+  ByteString server_data_;
+  std::unique_ptr<IOHandler> read_client_handler_;
+  std::unique_ptr<IOHandler> write_client_handler_;
+  std::unique_ptr<IOHandler> read_server_handler_;
+  std::unique_ptr<IOHandler> write_server_handler_;
+  // Once the request and any data buffered along with it have been passed
+  // on, the tunnel moves data through these pipes: |client_pipe_| carries
+  // data from the client to the server and |server_pipe_| the reverse.
+  bool is_splicing_;
+  SplicePipe client_pipe_;
+  SplicePipe server_pipe_;
+  std::unique_ptr<IOHandler> splice_client_handler_;
+  std::unique_ptr<IOHandler> splice_server_handler_;
+
+  DISALLOW_COPY_AND_ASSIGN(HTTPProxySession);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_HTTP_PROXY_SESSION_H_
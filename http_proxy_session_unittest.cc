@@ -0,0 +1,918 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/http_proxy_session.h"
+
+#include <netinet/in.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/strings/stringprintf.h>
+#include <gtest/gtest.h>
+
+#include "shill/mock_async_connection.h"
+#include "shill/mock_connection.h"
+#include "shill/mock_control.h"
+#include "shill/mock_device_info.h"
+#include "shill/mock_dns_client.h"
+#include "shill/mock_event_dispatcher.h"
+#include "shill/net/ip_address.h"
+#include "shill/net/mock_sockets.h"
+
+using base::Bind;
+using base::StringPrintf;
+using base::Unretained;
+using std::string;
+using std::vector;
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::AtLeast;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::ReturnArg;
+using ::testing::ReturnNew;
+using ::testing::ReturnRef;
+using ::testing::SetArgumentPointee;
+using ::testing::StrEq;
+using ::testing::StrictMock;
+using ::testing::Test;
+
+namespace shill {
+
+namespace {
+const char kBadHeaderMissingURL[] = "BLAH\r\n";
+const char kBadHeaderMissingVersion[] = "BLAH http://hostname\r\n";
+const char kBadHostnameLine[] = "GET HTTP/1.1 http://hostname\r\n";
+const char kBasicGetHeader[] = "GET / HTTP/1.1\r\n";
+const char kBasicGetHeaderWithURL[] =
+    "GET http://www.chromium.org/ HTTP/1.1\r\n";
+const char kBasicGetHeaderWithURLNoTrailingSlash[] =
+    "GET http://www.chromium.org HTTP/1.1\r\n";
+const char kConnectQuery[] =
+    "CONNECT 10.10.10.10:443 HTTP/1.1\r\n"
+    "Host: 10.10.10.10:443\r\n\r\n";
+const char kQueryTemplate[] = "GET %s HTTP/%s\r\n%s"
+    "User-Agent: Mozilla/5.0 (X11; CrOS i686 1299.0.2011) "
+    "AppleWebKit/535.8 (KHTML, like Gecko) Chrome/17.0.936.0 Safari/535.8\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;"
+    "q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip,deflate,sdch\r\n"
+    "Accept-Language: en-US,en;q=0.8,ja;q=0.6\r\n"
+    "Accept-Charset: ISO-8859-1,utf-8;q=0.7,*;q=0.3\r\n"
+    "Cookie: PREF=ID=xxxxxxxxxxxxxxxx:U=xxxxxxxxxxxxxxxx:FF=0:"
+    "TM=1317340083:LM=1317390705:GM=1:S=_xxxxxxxxxxxxxxx; "
+    "NID=52=xxxxxxxxxxxxxxxxxxxx-xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx_xxxxxxxxxxxxxxxxxxxxxxx; "
+    "HSID=xxxxxxxxxxxx-xxxx; APISID=xxxxxxxxxxxxxxxx/xxxxxxxxxxxxxxxxx; "
+    "SID=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx_xxxxxxxxxxx"
+    "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx-xxxxxxxxxxxxxxx"
+    "xxx_xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx-xxxxxxxxxxxxxxxxxx"
+    "_xxxxx-xxxxxxxxxxxxxxxxxxxxxxxxxx-xx-xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+    "xxxxxxxxxxxxxxxx\r\n\r\n";
+const char kInterfaceName[] = "int0";
+const char kDNSServer0[] = "8.8.8.8";
+const char kDNSServer1[] = "8.8.4.4";
+const char kServerAddress[] = "10.10.10.10";
+const char* kDNSServers[] = { kDNSServer0, kDNSServer1 };
+const int kServerFD = 10204;
+const int kClientFD = 10205;
+const int kClientPipeReadFD = 10206;
+const int kClientPipeWriteFD = 10207;
+const int kServerPipeReadFD = 10208;
+const int kServerPipeWriteFD = 10209;
+const int kServerPort = 40506;
+const int kConnectPort = 443;
+}  // namespace
+
+MATCHER_P(IsIPAddress, address, "") {
+  IPAddress ip_address(IPAddress::kFamilyIPv4);
+  EXPECT_TRUE(ip_address.SetAddressFromString(address));
+  return ip_address.Equals(arg);
+}
+
+MATCHER_P(CallbackEq, callback, "") {
+  return arg.Equals(callback);
+}
+
+class HTTPProxySessionTest : public Test {
+ public:
+  HTTPProxySessionTest()
+      : interface_name_(kInterfaceName),
+        server_async_connection_(nullptr),
+        dns_servers_(kDNSServers, kDNSServers + 2),
+        dns_client_(nullptr),
+        created_dns_client_uses_cache_(false),
+        device_info_(
+            new NiceMock<MockDeviceInfo>(&control_, nullptr, nullptr, nullptr)),
+        connection_(new StrictMock<MockConnection>(device_info_.get())) {}
+
+  MOCK_METHOD1(SessionDone, void(HTTPProxySession* session));
+
+ protected:
+  virtual void SetUp() {
+    EXPECT_CALL(*connection_.get(), interface_name())
+        .WillRepeatedly(ReturnRef(interface_name_));
+    EXPECT_CALL(*connection_.get(), dns_servers())
+        .WillRepeatedly(ReturnRef(dns_servers_));
+    session_.reset(new HTTPProxySession(
+        connection_, &dispatcher_, &sockets_,
+        Bind(&HTTPProxySessionTest::SessionDone, Unretained(this))));
+    created_dns_client_uses_cache_ = session_->dns_client_->use_cache();
+    dns_client_ = new StrictMock<MockDNSClient>();
+    // Passes ownership.
+    session_->dns_client_.reset(dns_client_);
+    server_async_connection_ = new StrictMock<MockAsyncConnection>();
+    // Passes ownership.
+    session_->server_async_connection_.reset(server_async_connection_);
+    // Most tests cover the tunnel copying data through the session's own
+    // buffers; the splice tests enable splicing explicitly.
+    session_->set_use_splice(false);
+  }
+  virtual void TearDown() {
+    ExpectStop();
+    const int session_fds[] = {
+      session_->client_socket_,
+      session_->server_socket_,
+      session_->client_pipe_.read_fd,
+      session_->client_pipe_.write_fd,
+      session_->server_pipe_.read_fd,
+      session_->server_pipe_.write_fd
+    };
+    for (const int fd : session_fds) {
+      if (fd != -1) {
+        EXPECT_CALL(sockets_, Close(fd));
+      }
+    }
+  }
+  string CreateRequest(const string& url, const string& http_version,
+                       const string& extra_lines) {
+    string append_lines(extra_lines);
+    if (append_lines.size()) {
+      append_lines.append("\r\n");
+    }
+    return StringPrintf(kQueryTemplate, url.c_str(), http_version.c_str(),
+                        append_lines.c_str());
+  }
+  void  InvokeSyncConnect(const IPAddress& /*address*/, int /*port*/) {
+    session_->OnConnectCompletion(true, kServerFD);
+  }
+  size_t FindInRequest(const string& find_string) {
+    const ByteString& request_data = GetClientData();
+    string request_string(
+        reinterpret_cast<const char*>(request_data.GetConstData()),
+        request_data.GetLength());
+    return request_string.find(find_string);
+  }
+  // Accessors
+  bool created_dns_client_uses_cache() const {
+    return created_dns_client_uses_cache_;
+  }
+  const ByteString& GetClientData() {
+    return session_->client_data_;
+  }
+  HTTPProxySession::State GetSessionState() {
+    return session_->state_;
+  }
+  const ByteString& GetServerData() {
+    return session_->server_data_;
+  }
+  size_t GetClientPipePending() {
+    return session_->client_pipe_.pending;
+  }
+  size_t GetServerPipePending() {
+    return session_->server_pipe_.pending;
+  }
+  bool IsSplicing() {
+    return session_->is_splicing_;
+  }
+  void EnableSplice() {
+    session_->set_use_splice(true);
+  }
+  MockSockets& sockets() { return sockets_; }
+  MockEventDispatcher& dispatcher() { return dispatcher_; }
+
+
+  // Expectations
+  void ExpectClientReset() {
+    EXPECT_EQ(-1, session_->client_socket_);
+    EXPECT_TRUE(session_->client_version_.empty());
+    EXPECT_EQ(HTTPProxySession::kDefaultServerPort, session_->server_port_);
+    EXPECT_EQ(-1, session_->server_socket_);
+    EXPECT_TRUE(session_->idle_timeout_.IsCancelled());
+    EXPECT_TRUE(session_->client_headers_.empty());
+    EXPECT_TRUE(session_->server_hostname_.empty());
+    EXPECT_TRUE(session_->client_data_.IsEmpty());
+    EXPECT_TRUE(session_->server_data_.IsEmpty());
+    EXPECT_FALSE(session_->read_client_handler_.get());
+    EXPECT_FALSE(session_->write_client_handler_.get());
+    EXPECT_FALSE(session_->read_server_handler_.get());
+    EXPECT_FALSE(session_->write_server_handler_.get());
+    EXPECT_FALSE(session_->is_route_requested_);
+    EXPECT_FALSE(session_->is_splicing_);
+    EXPECT_EQ(-1, session_->client_pipe_.read_fd);
+    EXPECT_EQ(-1, session_->server_pipe_.read_fd);
+    EXPECT_FALSE(session_->splice_client_handler_.get());
+    EXPECT_FALSE(session_->splice_server_handler_.get());
+  }
+  void ExpectStop() {
+    EXPECT_CALL(*dns_client_, Stop())
+        .Times(AtLeast(1));
+    EXPECT_CALL(*server_async_connection_, Stop())
+        .Times(AtLeast(1));
+    if (session_->is_route_requested_) {
+      EXPECT_CALL(*connection_.get(), ReleaseRouting());
+    }
+  }
+  void ExpectSessionDone() {
+    EXPECT_CALL(*this, SessionDone(session_.get()));
+  }
+  void ExpectClientInput(int fd) {
+    EXPECT_CALL(sockets(), SetNonBlocking(fd))
+        .WillOnce(Return(0));
+    EXPECT_CALL(dispatcher(),
+                CreateInputHandler(
+                    fd, CallbackEq(session_->read_client_callback_), _))
+        .WillOnce(ReturnNew<IOHandler>());
+    ExpectTransactionTimeout();
+    ExpectClientHeaderTimeout();
+  }
+  void ExpectTimeout(int timeout) {
+    EXPECT_CALL(dispatcher_, PostDelayedTask(_, timeout * 1000));
+  }
+  void ExpectClientHeaderTimeout() {
+    ExpectTimeout(HTTPProxySession::kClientHeaderTimeoutSeconds);
+  }
+  void ExpectConnectTimeout() {
+    ExpectTimeout(HTTPProxySession::kConnectTimeoutSeconds);
+  }
+  void ExpectInputTimeout() {
+    ExpectTimeout(HTTPProxySession::kInputTimeoutSeconds);
+  }
+  void ExpectRepeatedInputTimeout() {
+    EXPECT_CALL(dispatcher_,
+                PostDelayedTask(
+                    _, HTTPProxySession::kInputTimeoutSeconds * 1000))
+        .Times(AnyNumber());
+  }
+  void ExpectTransactionTimeout() {
+    ExpectTimeout(HTTPProxySession::kTransactionTimeoutSeconds);
+  }
+  void ExpectInClientResponse(const string& response_data) {
+    string server_data(
+        reinterpret_cast<char*>(session_->server_data_.GetData()),
+        session_->server_data_.GetLength());
+    EXPECT_NE(string::npos, server_data.find(response_data));
+  }
+  void ExpectClientError(int code, const string& error) {
+    EXPECT_EQ(HTTPProxySession::kStateFlushResponse, GetSessionState());
+    string status_line = StringPrintf("HTTP/1.1 %d ERROR", code);
+    ExpectInClientResponse(status_line);
+    ExpectInClientResponse(error);
+  }
+  void ExpectClientInternalError() {
+    ExpectClientError(500, HTTPProxySession::kInternalErrorMsg);
+  }
+  void ExpectClientVersion(const string& version) {
+    EXPECT_EQ(version, session_->client_version_);
+  }
+  void ExpectServerHostname(const string& hostname) {
+    EXPECT_EQ(hostname, session_->server_hostname_);
+  }
+  void ExpectFirstLine(const string& line) {
+    EXPECT_EQ(line, session_->client_headers_[0] + "\r\n");
+  }
+  void ExpectDNSRequest(const string& host, bool return_value) {
+    EXPECT_CALL(*dns_client_, Start(StrEq(host), _))
+        .WillOnce(Return(return_value));
+  }
+  void ExpectAsyncConnect(const string& address, int port,
+                          bool return_value) {
+    EXPECT_CALL(*server_async_connection_, Start(IsIPAddress(address), port))
+        .WillOnce(Return(return_value));
+  }
+  void ExpectSyncConnect(const string& address, int port) {
+    EXPECT_CALL(*server_async_connection_, Start(IsIPAddress(address), port))
+        .WillOnce(DoAll(Invoke(this, &HTTPProxySessionTest::InvokeSyncConnect),
+                        Return(true)));
+  }
+  void ExpectClientData() {
+    EXPECT_CALL(dispatcher(),
+                CreateReadyHandler(
+                    kClientFD, IOHandler::kModeOutput,
+                    CallbackEq(session_->write_client_callback_)))
+        .WillOnce(ReturnNew<IOHandler>());
+  }
+  void ExpectClientResult() {
+    ExpectClientData();
+    ExpectInputTimeout();
+  }
+  void ExpectServerInput() {
+    EXPECT_CALL(dispatcher(),
+                CreateInputHandler(
+                    kServerFD, CallbackEq(session_->read_server_callback_), _))
+        .WillOnce(ReturnNew<IOHandler>());
+    ExpectInputTimeout();
+  }
+  void ExpectServerOutput() {
+    EXPECT_CALL(dispatcher(),
+                CreateReadyHandler(
+                    kServerFD, IOHandler::kModeOutput,
+                    CallbackEq(session_->write_server_callback_)))
+        .WillOnce(ReturnNew<IOHandler>());
+    ExpectInputTimeout();
+  }
+  void ExpectRepeatedServerOutput() {
+    EXPECT_CALL(dispatcher(),
+                CreateReadyHandler(
+                    kServerFD, IOHandler::kModeOutput,
+                    CallbackEq(session_->write_server_callback_)))
+        .WillOnce(ReturnNew<IOHandler>());
+    ExpectRepeatedInputTimeout();
+  }
+  void ExpectSplicePipes() {
+    EXPECT_CALL(sockets(), Pipe(_, _))
+        .WillOnce(DoAll(SetArgumentPointee<0>(kClientPipeReadFD),
+                        SetArgumentPointee<1>(kClientPipeWriteFD),
+                        Return(0)))
+        .WillOnce(DoAll(SetArgumentPointee<0>(kServerPipeReadFD),
+                        SetArgumentPointee<1>(kServerPipeWriteFD),
+                        Return(0)));
+  }
+  void ExpectSpliceInput() {
+    EXPECT_CALL(dispatcher(),
+                CreateReadyHandler(
+                    kClientFD, IOHandler::kModeInput,
+                    CallbackEq(session_->splice_client_callback_)))
+        .WillOnce(ReturnNew<IOHandler>());
+    EXPECT_CALL(dispatcher(),
+                CreateReadyHandler(
+                    kServerFD, IOHandler::kModeInput,
+                    CallbackEq(session_->splice_server_callback_)))
+        .WillOnce(ReturnNew<IOHandler>());
+  }
+  void ExpectSplicePipesClose() {
+    for (const int fd : { kClientPipeReadFD, kClientPipeWriteFD,
+                          kServerPipeReadFD, kServerPipeWriteFD }) {
+      EXPECT_CALL(sockets(), Close(fd)).WillOnce(Return(0));
+    }
+  }
+  void ExpectTunnelClose() {
+    EXPECT_CALL(sockets(), Close(kClientFD))
+        .WillOnce(Return(0));
+    EXPECT_CALL(sockets(), Close(kServerFD))
+        .WillOnce(Return(0));
+    ExpectStop();
+    ExpectSessionDone();
+  }
+  void ExpectRouteRequest() {
+    EXPECT_CALL(*connection_.get(), RequestRouting());
+  }
+  void ExpectRouteRelease() {
+    EXPECT_CALL(*connection_.get(), ReleaseRouting());
+  }
+
+  // Callers for various private routines in the session
+  void GetDNSResultFailure(const string& error_msg) {
+    Error error(Error::kOperationFailed, error_msg);
+    IPAddress address(IPAddress::kFamilyUnknown);
+    session_->GetDNSResult(error, address);
+  }
+  void GetDNSResultSuccess(const IPAddress& address) {
+    Error error;
+    session_->GetDNSResult(error, address);
+  }
+  void OnConnectCompletion(bool result, int sockfd) {
+    session_->OnConnectCompletion(result, sockfd);
+  }
+  void ReadFromClient(const string& data) {
+    const unsigned char* ptr =
+        reinterpret_cast<const unsigned char*>(data.c_str());
+    vector<unsigned char> data_bytes(ptr, ptr + data.length());
+    InputData proxy_data(data_bytes.data(), data_bytes.size());
+    session_->ReadFromClient(&proxy_data);
+  }
+  void ReadFromServer(const string& data) {
+    const unsigned char* ptr =
+        reinterpret_cast<const unsigned char*>(data.c_str());
+    vector<unsigned char> data_bytes(ptr, ptr + data.length());
+    InputData proxy_data(data_bytes.data(), data_bytes.size());
+    session_->ReadFromServer(&proxy_data);
+  }
+  void SendClientError(int code, const string& error) {
+    session_->SendClientError(code, error);
+    EXPECT_FALSE(session_->server_data_.IsEmpty());
+  }
+  void StopClient() {
+    EXPECT_CALL(*dns_client_, Stop());
+    EXPECT_CALL(*server_async_connection_, Stop());
+    ExpectSessionDone();
+    session_->StopClient();
+  }
+  void WriteToClient(int fd) {
+    session_->WriteToClient(fd);
+  }
+  void WriteToServer(int fd) {
+    session_->WriteToServer(fd);
+  }
+  void SpliceFromClient(int fd) {
+    session_->SpliceFromClient(fd);
+  }
+  void SpliceFromServer(int fd) {
+    session_->SpliceFromServer(fd);
+  }
+
+  void SetupClient() {
+    ExpectClientInput(kClientFD);
+    session_->Start(kClientFD);
+    EXPECT_EQ(HTTPProxySession::kStateReadClientHeader, GetSessionState());
+  }
+  void SetupConnectWithRequest(const string& url, const string& http_version,
+                               const string& extra_lines) {
+    ExpectDNSRequest("www.chromium.org", true);
+    ExpectRouteRequest();
+    ReadFromClient(CreateRequest(url, http_version, extra_lines));
+    IPAddress addr(IPAddress::kFamilyIPv4);
+    EXPECT_TRUE(addr.SetAddressFromString(kServerAddress));
+    GetDNSResultSuccess(addr);
+  }
+  void SetupConnect() {
+    SetupConnectWithRequest("/", "1.1", "Host: www.chromium.org:40506");
+  }
+  void SetupConnectAsync() {
+    SetupClient();
+    ExpectAsyncConnect(kServerAddress, kServerPort, true);
+    ExpectConnectTimeout();
+    SetupConnect();
+  }
+  void SetupConnectComplete() {
+    SetupConnectAsync();
+    ExpectServerOutput();
+    OnConnectCompletion(true, kServerFD);
+    EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+  }
+  void SetupSpliceTunnel() {
+    EnableSplice();
+    SetupConnectAsync();
+    ExpectServerOutput();
+    ExpectSplicePipes();
+    OnConnectCompletion(true, kServerFD);
+    EXPECT_FALSE(IsSplicing());
+
+    // The request is still copied to the server, after which the tunnel
+    // switches over to splicing.
+    EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+        .WillOnce(ReturnArg<2>());
+    ExpectSpliceInput();
+    ExpectRepeatedInputTimeout();
+    WriteToServer(kServerFD);
+    EXPECT_TRUE(IsSplicing());
+    EXPECT_TRUE(GetClientData().IsEmpty());
+  }
+  void CauseReadError() {
+    session_->OnReadError(string());
+  }
+
+ private:
+  const string interface_name_;
+  // Owned by the HTTPProxySession, but tracked here for EXPECT().
+  StrictMock<MockAsyncConnection>* server_async_connection_;
+  vector<string> dns_servers_;
+  // Owned by the HTTPProxySession, but tracked here for EXPECT().
+  StrictMock<MockDNSClient>* dns_client_;
+  // Whether the DNSClient that HTTPProxySession created for itself, before
+  // it was replaced by |dns_client_|, used the DNS cache.
+  bool created_dns_client_uses_cache_;
+  MockEventDispatcher dispatcher_;
+  MockControl control_;
+  std::unique_ptr<MockDeviceInfo> device_info_;
+  scoped_refptr<MockConnection> connection_;
+  StrictMock<MockSockets> sockets_;
+  // Destroy first, before anything it references.
+  std::unique_ptr<HTTPProxySession> session_;
+};
+
+// Proxied user traffic shares DNS answers through the cache.
+TEST_F(HTTPProxySessionTest, DNSClientUsesCache) {
+  EXPECT_TRUE(created_dns_client_uses_cache());
+}
+
+TEST_F(HTTPProxySessionTest, SendClientError) {
+  SetupClient();
+  ExpectClientResult();
+  SendClientError(500, "This is an error");
+  ExpectClientError(500, "This is an error");
+
+  // We succeed in sending all but one byte of the client response.
+  int buf_len = GetServerData().GetLength();
+  EXPECT_CALL(sockets(), Send(kClientFD, _, buf_len, 0))
+      .WillOnce(Return(buf_len - 1));
+  ExpectInputTimeout();
+  WriteToClient(kClientFD);
+  EXPECT_EQ(1, GetServerData().GetLength());
+  EXPECT_EQ(HTTPProxySession::kStateFlushResponse, GetSessionState());
+
+  // When we are able to send the last byte, we close the connection.
+  EXPECT_CALL(sockets(), Send(kClientFD, _, 1, 0))
+      .WillOnce(Return(1));
+  EXPECT_CALL(sockets(), Close(kClientFD))
+      .WillOnce(Return(0));
+  ExpectStop();
+  ExpectSessionDone();
+  WriteToClient(kClientFD);
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, ReadMissingURL) {
+  SetupClient();
+  ExpectClientResult();
+  ReadFromClient(kBadHeaderMissingURL);
+  ExpectClientError(501, "Server could not parse HTTP method");
+}
+
+TEST_F(HTTPProxySessionTest, ReadMissingVersion) {
+  SetupClient();
+  ExpectClientResult();
+  ReadFromClient(kBadHeaderMissingVersion);
+  ExpectClientError(501, "Server only accepts HTTP/1.x requests");
+}
+
+TEST_F(HTTPProxySessionTest, ReadBadHostname) {
+  SetupClient();
+  ExpectClientResult();
+  ReadFromClient(kBadHostnameLine);
+  ExpectClientInternalError();
+}
+
+TEST_F(HTTPProxySessionTest, GoodFirstLineWithoutURL) {
+  SetupClient();
+  ExpectClientHeaderTimeout();
+  ReadFromClient(kBasicGetHeader);
+  ExpectClientVersion("1.1");
+  ExpectServerHostname("");
+  ExpectFirstLine(kBasicGetHeader);
+}
+
+TEST_F(HTTPProxySessionTest, GoodFirstLineWithURL) {
+  SetupClient();
+  ExpectClientHeaderTimeout();
+  ReadFromClient(kBasicGetHeaderWithURL);
+  ExpectClientVersion("1.1");
+  ExpectServerHostname("www.chromium.org");
+  ExpectFirstLine(kBasicGetHeader);
+}
+
+TEST_F(HTTPProxySessionTest, GoodFirstLineWithURLNoSlash) {
+  SetupClient();
+  ExpectClientHeaderTimeout();
+  ReadFromClient(kBasicGetHeaderWithURLNoTrailingSlash);
+  ExpectClientVersion("1.1");
+  ExpectServerHostname("www.chromium.org");
+  ExpectFirstLine(kBasicGetHeader);
+}
+
+TEST_F(HTTPProxySessionTest, NoHostInRequest) {
+  SetupClient();
+  ExpectClientResult();
+  ReadFromClient(CreateRequest("/", "1.1", ""));
+  ExpectClientError(400, "I don't know what host you want me to connect to");
+}
+
+TEST_F(HTTPProxySessionTest, TooManyColonsInHost) {
+  SetupClient();
+  ExpectClientResult();
+  ReadFromClient(CreateRequest("/", "1.1", "Host: www.chromium.org:80:40506"));
+  ExpectClientError(400, "Too many colons in hostname");
+}
+
+TEST_F(HTTPProxySessionTest, ClientReadError) {
+  SetupClient();
+  EXPECT_CALL(sockets(), Close(kClientFD))
+      .WillOnce(Return(0));
+  ExpectStop();
+  ExpectSessionDone();
+  CauseReadError();
+  ExpectClientReset();
+}
+
+TEST_F(HTTPProxySessionTest, DNSRequestFailure) {
+  SetupClient();
+  ExpectRouteRequest();
+  ExpectDNSRequest("www.chromium.org", false);
+  ExpectClientResult();
+  ReadFromClient(CreateRequest("/", "1.1", "Host: www.chromium.org:40506"));
+  ExpectClientError(502, "Could not resolve hostname");
+}
+
+TEST_F(HTTPProxySessionTest, DNSRequestDelayedFailure) {
+  SetupClient();
+  ExpectRouteRequest();
+  ExpectDNSRequest("www.chromium.org", true);
+  ReadFromClient(CreateRequest("/", "1.1", "Host: www.chromium.org:40506"));
+  ExpectClientResult();
+  const std::string not_found_error(DNSClient::kErrorNotFound);
+  GetDNSResultFailure(not_found_error);
+  ExpectClientError(502, string("Could not resolve hostname: ") +
+                    not_found_error);
+}
+
+TEST_F(HTTPProxySessionTest, TrailingClientData) {
+  SetupClient();
+  ExpectRouteRequest();
+  ExpectDNSRequest("www.chromium.org", true);
+  const string trailing_data("Trailing client data");
+  ReadFromClient(CreateRequest("/", "1.1", "Host: www.chromium.org:40506") +
+                 trailing_data);
+  EXPECT_EQ(GetClientData().GetLength() - trailing_data.length(),
+            FindInRequest(trailing_data));
+  EXPECT_EQ(HTTPProxySession::kStateLookupServer, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, LineContinuation) {
+  SetupClient();
+  ExpectRouteRequest();
+  ExpectDNSRequest("www.chromium.org", true);
+  string text_to_keep("X-Long-Header: this is one line\r\n"
+                      "\tand this is another");
+  ReadFromClient(CreateRequest("http://www.chromium.org/", "1.1",
+                               text_to_keep));
+  EXPECT_NE(string::npos, FindInRequest(text_to_keep));
+}
+
+// NB: This tests two different things:
+//   1) That the system replaces the value for "Proxy-Connection" headers.
+//   2) That when it replaces a header, it also removes the text in the line
+//      continuation.
+TEST_F(HTTPProxySessionTest, LineContinuationRemoval) {
+  SetupClient();
+  ExpectRouteRequest();
+  ExpectDNSRequest("www.chromium.org", true);
+  string text_to_remove("remove this text please");
+  ReadFromClient(CreateRequest("http://www.chromium.org/", "1.1",
+                               string("Proxy-Connection: stuff\r\n\t") +
+                               text_to_remove));
+  EXPECT_EQ(string::npos, FindInRequest(text_to_remove));
+  EXPECT_NE(string::npos, FindInRequest("Proxy-Connection: close\r\n"));
+}
+
+TEST_F(HTTPProxySessionTest, ConnectSynchronousFailure) {
+  SetupClient();
+  ExpectAsyncConnect(kServerAddress, kServerPort, false);
+  ExpectClientResult();
+  SetupConnect();
+  ExpectClientError(500, "Could not create socket to connect to server");
+}
+
+TEST_F(HTTPProxySessionTest, ConnectAsyncConnectFailure) {
+  SetupConnectAsync();
+  ExpectClientResult();
+  OnConnectCompletion(false, -1);
+  ExpectClientError(500, "Socket connection delayed failure");
+}
+
+TEST_F(HTTPProxySessionTest, ConnectSynchronousSuccess) {
+  SetupClient();
+  ExpectSyncConnect(kServerAddress, 999);
+  ExpectRepeatedServerOutput();
+  SetupConnectWithRequest("/", "1.1", "Host: www.chromium.org:999");
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, ConnectIPAddresss) {
+  SetupClient();
+  ExpectSyncConnect(kServerAddress, 999);
+  ExpectRepeatedServerOutput();
+  ExpectRouteRequest();
+  ReadFromClient(CreateRequest("/", "1.1",
+                               StringPrintf("Host: %s:999", kServerAddress)));
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, ConnectAsyncConnectSuccess) {
+  SetupConnectComplete();
+}
+
+TEST_F(HTTPProxySessionTest, HTTPConnectMethod) {
+  SetupClient();
+  ExpectAsyncConnect(kServerAddress, kConnectPort, true);
+  ExpectConnectTimeout();
+  ExpectRouteRequest();
+  ReadFromClient(kConnectQuery);
+  ExpectRepeatedInputTimeout();
+  ExpectClientData();
+  OnConnectCompletion(true, kServerFD);
+  ExpectInClientResponse("HTTP/1.1 200 OK\r\n\r\n");
+}
+
+TEST_F(HTTPProxySessionTest, TunnelData) {
+  SetupConnectComplete();
+
+  // The session is waiting for the server to be ready to accept data.
+  EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+      .WillOnce(Return(10));
+  ExpectServerInput();
+  WriteToServer(kServerFD);
+  EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+      .WillOnce(ReturnArg<2>());
+  ExpectInputTimeout();
+  WriteToServer(kServerFD);
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+
+  // Tunnel a reply back to the client.
+  const string server_result("200 OK ... and so on");
+  ExpectClientResult();
+  ReadFromServer(server_result);
+  EXPECT_EQ(server_result,
+            string(reinterpret_cast<const char*>(
+                GetServerData().GetConstData()),
+                   GetServerData().GetLength()));
+
+  // Allow part of the result string to be sent to the client.
+  const int part = server_result.length() / 2;
+  EXPECT_CALL(sockets(), Send(kClientFD, _, server_result.length(), 0))
+      .WillOnce(Return(part));
+  ExpectInputTimeout();
+  WriteToClient(kClientFD);
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+
+  // The Server closes the connection while the client is still reading.
+  ExpectInputTimeout();
+  ReadFromServer("");
+  EXPECT_EQ(HTTPProxySession::kStateFlushResponse, GetSessionState());
+
+  // When the last part of the response is written to the client, we close
+  // all connections.
+  EXPECT_CALL(sockets(), Send(kClientFD, _, server_result.length() - part, 0))
+      .WillOnce(ReturnArg<2>());
+  ExpectTunnelClose();
+  WriteToClient(kClientFD);
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, TunnelDataFailWriteClient) {
+  SetupConnectComplete();
+  EXPECT_CALL(sockets(), Send(kClientFD, _, _, 0))
+      .WillOnce(Return(-1));
+  ExpectTunnelClose();
+  WriteToClient(kClientFD);
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, TunnelDataFailWriteServer) {
+  SetupConnectComplete();
+  EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+      .WillOnce(Return(-1));
+  ExpectTunnelClose();
+  WriteToServer(kServerFD);
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, TunnelDataFailReadServer) {
+  SetupConnectComplete();
+  EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+      .WillOnce(Return(10));
+  ExpectServerInput();
+  WriteToServer(kServerFD);
+  ExpectTunnelClose();
+  CauseReadError();
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, TunnelDataFailClientClose) {
+  SetupConnectComplete();
+  ExpectTunnelClose();
+  ReadFromClient("");
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, TunnelDataFailServerClose) {
+  SetupConnectComplete();
+  ExpectTunnelClose();
+  ReadFromServer("");
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, SpliceTunnelData) {
+  SetupSpliceTunnel();
+
+  // Data from the server is spliced into the pipe and from there to the
+  // client, without passing through the session's buffers.
+  const size_t kReplyLength = 100;
+  EXPECT_CALL(sockets(), Splice(kServerFD, kServerPipeWriteFD,
+                                HTTPProxySession::kSpliceChunkSize, _))
+      .WillOnce(Return(kReplyLength));
+  ExpectClientData();
+  SpliceFromServer(kServerFD);
+  EXPECT_EQ(kReplyLength, GetServerPipePending());
+  EXPECT_TRUE(GetServerData().IsEmpty());
+
+  const size_t kPart = kReplyLength / 4;
+  EXPECT_CALL(sockets(), Splice(kServerPipeReadFD, kClientFD, kReplyLength, _))
+      .WillOnce(Return(kPart));
+  WriteToClient(kClientFD);
+  EXPECT_EQ(kReplyLength - kPart, GetServerPipePending());
+
+  EXPECT_CALL(sockets(), Splice(kServerPipeReadFD, kClientFD,
+                                kReplyLength - kPart, _))
+      .WillOnce(Return(kReplyLength - kPart));
+  WriteToClient(kClientFD);
+  EXPECT_EQ(0, GetServerPipePending());
+
+  // Client data takes the pipe in the other direction.
+  EXPECT_CALL(sockets(), Splice(kClientFD, kClientPipeWriteFD,
+                                HTTPProxySession::kSpliceChunkSize, _))
+      .WillOnce(Return(kPart));
+  SpliceFromClient(kClientFD);
+  EXPECT_EQ(kPart, GetClientPipePending());
+  EXPECT_CALL(sockets(), Splice(kClientPipeReadFD, kServerFD, kPart, _))
+      .WillOnce(Return(kPart));
+  WriteToServer(kServerFD);
+  EXPECT_EQ(0, GetClientPipePending());
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+
+  // The server closing its connection ends the transaction.
+  EXPECT_CALL(sockets(), Splice(kServerFD, kServerPipeWriteFD, _, _))
+      .WillOnce(Return(0));
+  ExpectTunnelClose();
+  ExpectSplicePipesClose();
+  SpliceFromServer(kServerFD);
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, SpliceWouldBlock) {
+  SetupSpliceTunnel();
+  EXPECT_CALL(sockets(), Splice(kClientFD, kClientPipeWriteFD, _, _))
+      .WillOnce(Return(-1));
+  EXPECT_CALL(sockets(), Error()).WillOnce(Return(EAGAIN));
+  SpliceFromClient(kClientFD);
+  EXPECT_EQ(0, GetClientPipePending());
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, SpliceWriteFailure) {
+  SetupSpliceTunnel();
+  EXPECT_CALL(sockets(), Splice(kClientFD, kClientPipeWriteFD, _, _))
+      .WillOnce(Return(10));
+  SpliceFromClient(kClientFD);
+  EXPECT_CALL(sockets(), Splice(kClientPipeReadFD, kServerFD, 10, _))
+      .WillOnce(Return(-1));
+  EXPECT_CALL(sockets(), Error()).WillOnce(Return(EPIPE));
+  ExpectTunnelClose();
+  ExpectSplicePipesClose();
+  WriteToServer(kServerFD);
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, SplicePipeFailure) {
+  EnableSplice();
+  SetupConnectAsync();
+  ExpectServerOutput();
+  EXPECT_CALL(sockets(), Pipe(_, _)).WillOnce(Return(-1));
+  OnConnectCompletion(true, kServerFD);
+
+  // Without pipes, the tunnel keeps copying data.
+  EXPECT_CALL(sockets(), Send(kServerFD, _, _, 0))
+      .WillOnce(ReturnArg<2>());
+  ExpectServerInput();
+  WriteToServer(kServerFD);
+  EXPECT_FALSE(IsSplicing());
+  EXPECT_EQ(HTTPProxySession::kStateTunnelData, GetSessionState());
+}
+
+TEST_F(HTTPProxySessionTest, StopClient) {
+  SetupConnectComplete();
+  EXPECT_CALL(sockets(), Close(kClientFD))
+      .WillOnce(Return(0));
+  EXPECT_CALL(sockets(), Close(kServerFD))
+      .WillOnce(Return(0));
+  ExpectRouteRelease();
+  StopClient();
+  ExpectClientReset();
+  EXPECT_EQ(HTTPProxySession::kStateIdle, GetSessionState());
+}
+
+}  // namespace shill
@@ -84,7 +84,9 @@ HTTPRequest::HTTPRequest(ConnectionRefPtr connection,
       server_port_(-1),
       server_socket_(-1),
       timeout_result_(kResultUnknown),
-      is_running_(false) { }
+      is_running_(false) {
+  dns_client_->set_race_server_count(DNSClient::kDefaultRaceServerCount);
+}
 
 HTTPRequest::~HTTPRequest() {
   Stop();
@@ -93,6 +93,7 @@ class HTTPRequestTest : public Test {
         server_async_connection_(new StrictMock<MockAsyncConnection>()),
         dns_servers_(kDNSServers, kDNSServers + 2),
         dns_client_(new StrictMock<MockDNSClient>()),
+        created_dns_client_uses_cache_(true),
         device_info_(
             new NiceMock<MockDeviceInfo>(&control_, nullptr, nullptr, nullptr)),
         connection_(new StrictMock<MockConnection>(device_info_.get())) {}
@@ -131,6 +132,7 @@ class HTTPRequestTest : public Test {
         .WillRepeatedly(ReturnRef(dns_servers_));
 
     request_.reset(new HTTPRequest(connection_, &dispatcher_, &sockets_));
+    created_dns_client_uses_cache_ = request_->dns_client_->use_cache();
     // Passes ownership.
     request_->dns_client_.reset(dns_client_);
     // Passes ownership.
@@ -157,6 +159,9 @@ class HTTPRequestTest : public Test {
   }
   HTTPRequest* request() { return request_.get(); }
   MockSockets& sockets() { return sockets_; }
+  bool created_dns_client_uses_cache() const {
+    return created_dns_client_uses_cache_;
+  }
 
   // Expectations
   void ExpectReset() {
@@ -337,6 +342,9 @@ class HTTPRequestTest : public Test {
   vector<string> dns_servers_;
   // Owned by the HTTPRequest, but tracked here for EXPECT().
   StrictMock<MockDNSClient>* dns_client_;
+  // Whether the DNSClient that HTTPRequest created for itself, before it
+  // was replaced by |dns_client_|, used the DNS cache.
+  bool created_dns_client_uses_cache_;
   StrictMock<MockEventDispatcher> dispatcher_;
   MockControl control_;
   std::unique_ptr<MockDeviceInfo> device_info_;
@@ -351,6 +359,12 @@ TEST_F(HTTPRequestTest, Constructor) {
   ExpectReset();
 }
 
+// Portal detection and connectivity trials run through HTTPRequest, so they
+// must not be answered with addresses cached from before a portal sign-in.
+TEST_F(HTTPRequestTest, DNSClientBypassesCache) {
+  EXPECT_FALSE(created_dns_client_uses_cache());
+}
+
 
 TEST_F(HTTPRequestTest, FailConnectNumericSynchronous) {
   ExpectRouteRequest();
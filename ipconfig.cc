@@ -64,7 +64,8 @@ IPConfig::IPConfig(ControlInterface* control_interface,
     : device_name_(device_name),
       type_(kType),
       serial_(global_serial_++),
-      adaptor_(control_interface->CreateIPConfigAdaptor(this)) {
+      adaptor_(control_interface->CreateIPConfigAdaptor(this)),
+      parsed_properties_(IPAddress::kFamilyUnknown) {
   Init();
 }
 
@@ -74,7 +75,8 @@ IPConfig::IPConfig(ControlInterface* control_interface,
     : device_name_(device_name),
       type_(type),
       serial_(global_serial_++),
-      adaptor_(control_interface->CreateIPConfigAdaptor(this)) {
+      adaptor_(control_interface->CreateIPConfigAdaptor(this)),
+      parsed_properties_(IPAddress::kFamilyUnknown) {
   Init();
 }
 
@@ -138,12 +140,14 @@ void IPConfig::Refresh(Error* /*error*/) {
 void IPConfig::ApplyStaticIPParameters(
     StaticIPParameters* static_ip_parameters) {
   static_ip_parameters->ApplyTo(&properties_);
+  UpdateParsedProperties();
   EmitChanges();
 }
 
 void IPConfig::RestoreSavedIPParameters(
     StaticIPParameters* static_ip_parameters) {
   static_ip_parameters->RestoreTo(&properties_);
+  UpdateParsedProperties();
   EmitChanges();
 }
 
@@ -182,6 +186,7 @@ void IPConfig::UpdateProperties(const Properties& properties,
   IPConfigRefPtr me = this;
 
   properties_ = properties;
+  UpdateParsedProperties();
 
   if (!update_callback_.is_null()) {
     update_callback_.Run(this, new_lease_acquired);
@@ -228,11 +233,50 @@ void IPConfig::RegisterExpireCallback(const Callback& callback) {
   expire_callback_ = callback;
 }
 
+void IPConfig::set_properties(const Properties& props) {
+  properties_ = props;
+  UpdateParsedProperties();
+}
+
 void IPConfig::ResetProperties() {
   properties_ = Properties();
+  UpdateParsedProperties();
   EmitChanges();
 }
 
+void IPConfig::UpdateParsedProperties() {
+  parsed_properties_ = ParseProperties(properties_);
+}
+
+// static
+IPConfig::ParsedProperties IPConfig::ParseProperties(
+    const Properties& properties) {
+  const IPAddress::Family family = properties.address_family;
+  ParsedProperties parsed(family);
+  if (parsed.local.SetAddressFromString(properties.address)) {
+    parsed.local.set_prefix(properties.subnet_prefix);
+  }
+  if (!properties.broadcast_address.empty()) {
+    parsed.broadcast.SetAddressFromString(properties.broadcast_address);
+  }
+  if (!properties.peer_address.empty()) {
+    parsed.peer.SetAddressFromString(properties.peer_address);
+  }
+  if (!properties.gateway.empty()) {
+    parsed.gateway.SetAddressFromString(properties.gateway);
+  }
+  for (const auto& route : properties.routes) {
+    ParsedRoute parsed_route(family);
+    if (parsed_route.destination.SetAddressFromString(route.host)) {
+      parsed_route.destination.set_prefix(
+          IPAddress::GetPrefixLengthFromMask(family, route.netmask));
+    }
+    parsed_route.gateway.SetAddressFromString(route.gateway);
+    parsed.routes.push_back(parsed_route);
+  }
+  return parsed;
+}
+
 void IPConfig::EmitChanges() {
   adaptor_->EmitStringChanged(kAddressProperty, properties_.address);
   adaptor_->EmitStringsChanged(kNameServersProperty, properties_.dns_servers);
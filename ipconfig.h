@@ -93,6 +93,34 @@ class IPConfig : public base::RefCounted<IPConfig> {
     uint32_t lease_duration_seconds;
   };
 
+  // A route from Properties::routes with its addresses parsed.  The
+  // destination carries the prefix length derived from the netmask.
+  struct ParsedRoute {
+    explicit ParsedRoute(IPAddress::Family family)
+        : destination(family), gateway(family) {}
+
+    IPAddress destination;
+    IPAddress gateway;
+  };
+
+  // The addresses of Properties in parsed form.  These are computed once
+  // each time the properties change, so that consumers such as Connection
+  // and RoutingTable need not re-parse the string representations, which
+  // are kept for RPC.  An address that is unset or fails to parse is left
+  // invalid.
+  struct ParsedProperties {
+    explicit ParsedProperties(IPAddress::Family family)
+        : local(family), broadcast(family), peer(family), gateway(family) {}
+
+    // Carries Properties::subnet_prefix as its prefix.
+    IPAddress local;
+    IPAddress broadcast;
+    IPAddress peer;
+    IPAddress gateway;
+    // Parallel to Properties::routes.
+    std::vector<ParsedRoute> routes;
+  };
+
   enum Method {
     kMethodUnknown,
     kMethodPPP,
@@ -155,8 +183,11 @@ class IPConfig : public base::RefCounted<IPConfig> {
   // allowing clients to more easily manage multiple IP configurations.
   void RegisterExpireCallback(const Callback& callback);
 
-  void set_properties(const Properties& props) { properties_ = props; }
+  void set_properties(const Properties& props);
   virtual const Properties& properties() const { return properties_; }
+  virtual const ParsedProperties& parsed_properties() const {
+    return parsed_properties_;
+  }
 
   // Update DNS servers setting for this ipconfig, this allows Chrome
   // to retrieve the new DNS servers.
@@ -215,6 +246,9 @@ class IPConfig : public base::RefCounted<IPConfig> {
   // Notifies registered listeners that the lease has expired.
   virtual void NotifyExpiry();
 
+  // Returns the addresses and routes of |properties| in parsed form.
+  static ParsedProperties ParseProperties(const Properties& properties);
+
  private:
   friend class IPConfigAdaptorInterface;
   friend class IPConfigTest;
@@ -241,6 +275,9 @@ class IPConfig : public base::RefCounted<IPConfig> {
 
   void Init();
 
+  // Recomputes |parsed_properties_| from |properties_|.
+  void UpdateParsedProperties();
+
   static uint global_serial_;
   PropertyStore store_;
   const std::string device_name_;
@@ -248,6 +285,7 @@ class IPConfig : public base::RefCounted<IPConfig> {
   const uint serial_;
   std::unique_ptr<IPConfigAdaptorInterface> adaptor_;
   Properties properties_;
+  ParsedProperties parsed_properties_;
   UpdateCallback update_callback_;
   Callback failure_callback_;
   Callback refresh_callback_;
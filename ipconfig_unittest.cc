@@ -30,6 +30,7 @@
 #include "shill/logging.h"
 #include "shill/mock_adaptors.h"
 #include "shill/mock_control.h"
+#include "shill/mock_ipconfig.h"
 #include "shill/mock_log.h"
 #include "shill/mock_store.h"
 #include "shill/net/mock_time.h"
@@ -42,7 +43,9 @@ using testing::_;
 using testing::EndsWith;
 using testing::DoAll;
 using testing::Mock;
+using testing::NiceMock;
 using testing::Return;
+using testing::ReturnRef;
 using testing::SaveArg;
 using testing::SetArgPointee;
 using testing::SetArgumentPointee;
@@ -179,6 +182,56 @@ TEST_F(IPConfigTest, UpdateProperties) {
   ExpectPropertiesEqual(IPConfig::Properties());
 }
 
+TEST_F(IPConfigTest, ParsedProperties) {
+  IPConfig::Properties properties;
+  properties.address_family = IPAddress::kFamilyIPv4;
+  properties.address = "1.2.3.4";
+  properties.subnet_prefix = 24;
+  properties.gateway = "5.6.7.8";
+  properties.peer_address = "not an address";
+  IPConfig::Route route;
+  route.host = "10.0.0.0";
+  route.netmask = "255.255.0.0";
+  route.gateway = "5.6.7.9";
+  properties.routes.push_back(route);
+  UpdateProperties(properties);
+
+  const IPConfig::ParsedProperties& parsed = ipconfig_->parsed_properties();
+  EXPECT_EQ("1.2.3.4", parsed.local.ToString());
+  EXPECT_EQ(24, parsed.local.prefix());
+  EXPECT_EQ("5.6.7.8", parsed.gateway.ToString());
+  // Unset and unparseable addresses are left invalid.
+  EXPECT_FALSE(parsed.broadcast.IsValid());
+  EXPECT_FALSE(parsed.peer.IsValid());
+  ASSERT_EQ(1, parsed.routes.size());
+  EXPECT_EQ("10.0.0.0", parsed.routes[0].destination.ToString());
+  EXPECT_EQ(16, parsed.routes[0].destination.prefix());
+  EXPECT_EQ("5.6.7.9", parsed.routes[0].gateway.ToString());
+
+  // The parsed form follows properties set directly.
+  properties.address = "1.2.3.5";
+  properties.routes.clear();
+  ipconfig_->set_properties(properties);
+  EXPECT_EQ("1.2.3.5", ipconfig_->parsed_properties().local.ToString());
+  EXPECT_TRUE(ipconfig_->parsed_properties().routes.empty());
+
+  ipconfig_->ResetProperties();
+  EXPECT_FALSE(ipconfig_->parsed_properties().local.IsValid());
+}
+
+TEST_F(IPConfigTest, MockParsedPropertiesFollowMockedProperties) {
+  scoped_refptr<NiceMock<MockIPConfig>> ipconfig(
+      new NiceMock<MockIPConfig>(&control_, kDeviceName));
+  IPConfig::Properties properties;
+  properties.address_family = IPAddress::kFamilyIPv4;
+  properties.address = "1.2.3.4";
+  properties.subnet_prefix = 24;
+  EXPECT_CALL(*ipconfig, properties()).WillRepeatedly(ReturnRef(properties));
+  const IPConfig::ParsedProperties& parsed = ipconfig->parsed_properties();
+  EXPECT_EQ("1.2.3.4", parsed.local.ToString());
+  EXPECT_EQ(24, parsed.local.prefix());
+}
+
 TEST_F(IPConfigTest, Callbacks) {
   ipconfig_->RegisterUpdateCallback(
       Bind(&IPConfigTest::OnIPConfigUpdated, Unretained(this)));
@@ -27,6 +27,7 @@
 #include <typeinfo>
 #include <vector>
 
+#include <base/bind.h>
 #include <base/files/important_file_writer.h>
 #include <base/files/file_util.h>
 #include <base/json/json_string_value_serializer.h>
@@ -39,6 +40,7 @@
 #include "shill/crypto_rot47.h"
 #include "shill/logging.h"
 #include "shill/scoped_umask.h"
+#include "shill/storage_worker.h"
 
 using std::map;
 using std::set;
@@ -330,11 +332,15 @@ scoped_ptr<base::DictionaryValue> ConvertVariantDictionaryToDictionaryValue(
 }  // namespace
 
 JsonStore::JsonStore(const base::FilePath& path)
-    : path_(path) {
+    : path_(path),
+      storage_worker_(nullptr),
+      queued_write_failed_(false),
+      weak_ptr_factory_(this) {
   CHECK(!path_.empty());
 }
 
 bool JsonStore::IsNonEmpty() const {
+  WaitForPendingWrites();
   int64_t file_size = 0;
   return base::GetFileSize(path_, &file_size) && file_size != 0;
 }
@@ -395,6 +401,7 @@ bool JsonStore::Open() {
     LOG(INFO) << "Clearing existing settings on open.";
     group_name_to_settings_.clear();
   }
+  decryption_cache_.Clear();
 
   base::DictionaryValue::Iterator it(*settings_dictionary);
   while (!it.IsAtEnd()) {
@@ -421,10 +428,20 @@ bool JsonStore::Open() {
 }
 
 bool JsonStore::Close() {
-  return Flush();
+  bool success = Persist(true);
+  decryption_cache_.Clear();
+  return success;
 }
 
 bool JsonStore::Flush() {
+  return Persist(false);
+}
+
+void JsonStore::ClearDecryptionCache() {
+  decryption_cache_.Clear();
+}
+
+bool JsonStore::Persist(bool synchronous) {
   auto groups(make_scoped_ptr(new base::DictionaryValue()));
   for (const auto& group_name_and_settings : group_name_to_settings_) {
     const auto& group_name = group_name_and_settings.first;
@@ -453,6 +470,25 @@ bool JsonStore::Flush() {
     return false;
   }
 
+  if (storage_worker_ && !synchronous) {
+    // |json_string| is an immutable snapshot of the store, so the store may
+    // continue to be modified while the worker writes it out.
+    storage_worker_->PostWrite(
+        path_, json_string,
+        base::Bind(&JsonStore::OnQueuedWriteDone,
+                   weak_ptr_factory_.GetWeakPtr()));
+    bool success = !queued_write_failed_;
+    queued_write_failed_ = false;
+    return success;
+  }
+
+  // A queued snapshot is older than |json_string|, so it must not land on
+  // disk after this write. Once this write is done, the results of queued
+  // writes no longer say anything about the contents of |path_|.
+  WaitForPendingWrites();
+  weak_ptr_factory_.InvalidateWeakPtrs();
+  queued_write_failed_ = false;
+
   ScopedUmask owner_only_umask(~(S_IRUSR | S_IWUSR) & 0777);
   if (!base::ImportantFileWriter::WriteFileAtomically(path_, json_string)) {
     LOG(ERROR) << "Failed to write JSON file: |" << path_.value() << "|.";
@@ -464,6 +500,7 @@ bool JsonStore::Flush() {
 
 bool JsonStore::MarkAsCorrupted() {
   LOG(INFO) << "In " << __func__ << " for " << path_.value();
+  WaitForPendingWrites();
   string corrupted_path = path_.value() + kCorruptSuffix;
   int ret = rename(path_.value().c_str(), corrupted_path.c_str());
   if (ret != 0) {
@@ -481,6 +518,20 @@ set<string> JsonStore::GetGroups() const {
   return matching_groups;
 }
 
+void JsonStore::WaitForPendingWrites() const {
+  if (storage_worker_) {
+    storage_worker_->WaitForPendingWrites();
+  }
+}
+
+void JsonStore::OnQueuedWriteDone(bool success) {
+  if (!success) {
+    LOG(ERROR) << "Queued write of JSON file failed: |" << path_.value()
+               << "|.";
+    queued_write_failed_ = true;
+  }
+}
+
 // Returns a set so that caller can easily test whether a particular group
 // is contained within this collection.
 set<string> JsonStore::GetGroupsWithKey(const string& key) const {
@@ -516,6 +567,7 @@ bool JsonStore::ContainsGroup(const string& group) const {
 }
 
 bool JsonStore::DeleteKey(const string& group, const string& key) {
+  decryption_cache_.InvalidateKey(group, key);
   const auto& group_name_and_settings = group_name_to_settings_.find(group);
   if (group_name_and_settings == group_name_to_settings_.end()) {
     LOG(ERROR) << "Could not find group |" << group << "|.";
@@ -532,6 +584,7 @@ bool JsonStore::DeleteKey(const string& group, const string& key) {
 }
 
 bool JsonStore::DeleteGroup(const string& group) {
+  decryption_cache_.InvalidateGroup(group);
   auto group_name_and_settings = group_name_to_settings_.find(group);
   if (group_name_and_settings != group_name_to_settings_.end()) {
     group_name_to_settings_.erase(group_name_and_settings);
@@ -552,6 +605,7 @@ bool JsonStore::GetString(const string& group,
 
 bool JsonStore::SetString(
     const string& group, const string& key, const string& value) {
+  decryption_cache_.InvalidateKey(group, key);
   return WriteSetting(group, key, value);
 }
 
@@ -600,18 +654,27 @@ bool JsonStore::GetCryptedString(
     return false;
   }
 
+  string decrypted_value;
+  if (decryption_cache_.Lookup(group, key, encrypted_value,
+                               &decrypted_value)) {
+    if (value) {
+      *value = decrypted_value;
+    }
+    return true;
+  }
+
   // TODO(quiche): Once we've removed the glib dependency in
   // CryptoProvider, move to using CryptoProvider, instead of
   // CryptoROT47 directly. This change should be done before using
   // JsonStore in production, as the on-disk format of crypted strings
   // will change.
   CryptoROT47 rot47;
-  string decrypted_value;
   if (!rot47.Decrypt(encrypted_value, &decrypted_value)) {
     LOG(ERROR) << "Failed to decrypt value for |" << group << "|"
                << ":|" << key << "|.";
     return false;
   }
+  decryption_cache_.Insert(group, key, encrypted_value, decrypted_value);
 
   if (value) {
     *value = decrypted_value;
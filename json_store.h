@@ -23,13 +23,17 @@
 #include <vector>
 
 #include <base/files/file_path.h>
+#include <base/memory/weak_ptr.h>
 #include <brillo/variant_dictionary.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
+#include "shill/decryption_cache.h"
 #include "shill/store_interface.h"
 
 namespace shill {
 
+class StorageWorker;
+
 class JsonStore : public StoreInterface {
  public:
   explicit JsonStore(const base::FilePath& path);
@@ -40,8 +44,13 @@ class JsonStore : public StoreInterface {
   // Inherited from StoreInterface.
   bool IsNonEmpty() const override;
   bool Open() override;
+  // Waits for any queued write and writes the store out before returning,
+  // so that the result reflects the final contents on disk.
   bool Close() override;
+  // With a storage worker set, returns false if the write queued by an
+  // earlier Flush() failed, since that failure could not be reported then.
   bool Flush() override;
+  void ClearDecryptionCache() override;
   bool MarkAsCorrupted() override;
   std::set<std::string> GetGroups() const override;
   std::set<std::string> GetGroupsWithKey(const std::string& key) const override;
@@ -90,8 +99,17 @@ class JsonStore : public StoreInterface {
                         const std::string& key,
                         const std::string& value) override;
 
+  // When set, Flush() hands a snapshot of the store contents to
+  // |storage_worker| instead of writing to disk on the calling thread.
+  // Does not take ownership.
+  void set_storage_worker(StorageWorker* storage_worker) {
+    storage_worker_ = storage_worker;
+  }
+
  private:
   FRIEND_TEST(JsonStoreTest, CanPersistAndRestoreHeader);  // file_description_
+  FRIEND_TEST(JsonStoreTest, CryptedStringDecryptionIsCached);
+  FRIEND_TEST(JsonStoreTest, DecryptionCacheIsClearedOnRequestAndOnClose);
   // Tests which use |group_name_to_settings_|.
   FRIEND_TEST(JsonStoreTest, CanPersistAndRestoreAllTypes);
   FRIEND_TEST(JsonStoreTest, CanPersistAndRestoreNonUtf8Strings);
@@ -103,6 +121,15 @@ class JsonStore : public StoreInterface {
   // Tests which modify |path_|.
   FRIEND_TEST(JsonStoreTest, FlushFailsWhenPathComponentDoesNotExist);
 
+  // Blocks until every write queued on |storage_worker_| is done.  The
+  // worker is shared by all stores, so this includes writes of other files.
+  void WaitForPendingWrites() const;
+  // Serializes the store and writes it to |path_|.  The write is queued on
+  // |storage_worker_| if there is one, unless |synchronous| is true.
+  bool Persist(bool synchronous);
+  // Called with the result of a write queued on |storage_worker_|.
+  void OnQueuedWriteDone(bool success);
+
   template<typename T> bool ReadSetting(
       const std::string& group, const std::string& key, T* out) const;
   template<typename T> bool WriteSetting(
@@ -111,6 +138,11 @@ class JsonStore : public StoreInterface {
   const base::FilePath path_;
   std::string file_description_;
   std::map<std::string, brillo::VariantDictionary> group_name_to_settings_;
+  StorageWorker* storage_worker_;
+  // Set when a queued write fails, until the next Flush() reports it.
+  bool queued_write_failed_;
+  DecryptionCache decryption_cache_;
+  base::WeakPtrFactory<JsonStore> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(JsonStore);
 };
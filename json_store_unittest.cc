@@ -31,6 +31,8 @@
 #include <gtest/gtest.h>
 
 #include "shill/mock_log.h"
+#include "shill/storage_worker.h"
+#include "shill/test_event_dispatcher.h"
 
 using base::FileEnumerator;
 using base::FilePath;
@@ -179,6 +181,40 @@ TEST_F(JsonStoreTest, RawValuesOfCryptedStringsDifferFromOriginalValues) {
   }
 }
 
+TEST_F(JsonStoreTest, CryptedStringDecryptionIsCached) {
+  string value_from_store;
+  EXPECT_TRUE(store_->SetCryptedString("group_a", "knob_1", "some stuff"));
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+  EXPECT_EQ("some stuff", value_from_store);
+  EXPECT_EQ(1, store_->decryption_cache_.hit_count());
+
+  EXPECT_TRUE(store_->SetCryptedString("group_a", "knob_1", "other stuff"));
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+  EXPECT_EQ("other stuff", value_from_store);
+  EXPECT_EQ(1, store_->decryption_cache_.hit_count());
+
+  EXPECT_TRUE(store_->DeleteGroup("group_a"));
+  EXPECT_FALSE(
+      store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+}
+
+TEST_F(JsonStoreTest, DecryptionCacheIsClearedOnRequestAndOnClose) {
+  string value_from_store;
+  EXPECT_TRUE(store_->SetCryptedString("group_a", "knob_1", "some stuff"));
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+
+  store_->ClearDecryptionCache();
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+  EXPECT_EQ("some stuff", value_from_store);
+  EXPECT_EQ(0, store_->decryption_cache_.hit_count());
+
+  EXPECT_TRUE(store_->Close());
+  EXPECT_TRUE(store_->GetCryptedString("group_a", "knob_1", &value_from_store));
+  EXPECT_EQ("some stuff", value_from_store);
+  EXPECT_EQ(0, store_->decryption_cache_.hit_count());
+}
+
 TEST_F(JsonStoreTest, DifferentGroupsCanHaveDifferentValuesForSameKey) {
   store_->SetString("group_a", "knob_1", "value_1");
   store_->SetString("group_b", "knob_1", "value_2");
@@ -1096,6 +1132,73 @@ TEST_F(JsonStoreTest, CanDeleteGroupFromPersistedData) {
   EXPECT_FALSE(persisted_data_v2.GetString("group_a", "knob_1", nullptr));
 }
 
+TEST_F(JsonStoreTest, CanPersistAndRestoreThroughStorageWorker) {
+  EventDispatcherForTest dispatcher;
+  StorageWorker storage_worker;
+  ASSERT_TRUE(storage_worker.Start());
+  store_->set_storage_worker(&storage_worker);
+  store_->SetString("group_a", "knob_1", "first string");
+  EXPECT_TRUE(store_->Flush());
+  // Changes made after Flush() returns are not part of the queued snapshot.
+  store_->SetString("group_a", "knob_1", "second string");
+
+  // IsNonEmpty() waits for the queued write to complete.
+  EXPECT_TRUE(store_->IsNonEmpty());
+  JsonStore persisted_data(test_file_);
+  persisted_data.Open();
+  string value;
+  EXPECT_TRUE(persisted_data.GetString("group_a", "knob_1", &value));
+  EXPECT_EQ("first string", value);
+  storage_worker.Stop();
+}
+
+TEST_F(JsonStoreTest, FailedQueuedWriteIsReportedByNextFlush) {
+  EventDispatcherForTest dispatcher;
+  StorageWorker storage_worker;
+  ASSERT_TRUE(storage_worker.Start());
+  store_->set_storage_worker(&storage_worker);
+  // A directory in place of the store file makes the queued write fail.
+  ASSERT_TRUE(base::CreateDirectory(test_file_));
+  EXPECT_TRUE(store_->Flush());
+  storage_worker.WaitForPendingWrites();
+  dispatcher.DispatchPendingEvents();
+
+  ASSERT_TRUE(base::DeleteFile(test_file_, false));
+  EXPECT_FALSE(store_->Flush());
+  storage_worker.WaitForPendingWrites();
+  dispatcher.DispatchPendingEvents();
+  EXPECT_TRUE(store_->Flush());
+  storage_worker.Stop();
+}
+
+TEST_F(JsonStoreTest, CloseReportsWriteFailureWithStorageWorker) {
+  EventDispatcherForTest dispatcher;
+  StorageWorker storage_worker;
+  ASSERT_TRUE(storage_worker.Start());
+  store_->set_storage_worker(&storage_worker);
+  ASSERT_TRUE(base::CreateDirectory(test_file_));
+  EXPECT_FALSE(store_->Close());
+
+  ASSERT_TRUE(base::DeleteFile(test_file_, false));
+  store_->SetString("group_a", "knob_1", "a string");
+  EXPECT_TRUE(store_->Close());
+  // Close() does not return until the store is on disk.
+  JsonStore persisted_data(test_file_);
+  persisted_data.Open();
+  string value;
+  EXPECT_TRUE(persisted_data.GetString("group_a", "knob_1", &value));
+  EXPECT_EQ("a string", value);
+  storage_worker.Stop();
+}
+
+TEST_F(JsonStoreTest, FlushReportsWriteFailureAfterStorageWorkerStops) {
+  StorageWorker storage_worker;
+  store_->set_storage_worker(&storage_worker);
+  // A stopped worker writes on the calling thread, so the result is known.
+  ASSERT_TRUE(base::CreateDirectory(test_file_));
+  EXPECT_FALSE(store_->Flush());
+}
+
 // File operations: file management.
 TEST_F(JsonStoreTest, MarkAsCorruptedFailsWhenStoreHasNotBeenPersisted) {
   EXPECT_CALL(log_,
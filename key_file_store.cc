@@ -18,6 +18,7 @@
 
 #include <map>
 
+#include <base/bind.h>
 #include <base/files/important_file_writer.h>
 #include <base/files/file_util.h>
 #include <base/strings/string_number_conversions.h>
@@ -30,6 +31,7 @@
 #include "shill/key_value_store.h"
 #include "shill/logging.h"
 #include "shill/scoped_umask.h"
+#include "shill/storage_worker.h"
 
 using std::map;
 using std::set;
@@ -60,7 +62,10 @@ const char KeyFileStore::kCorruptSuffix[] = ".corrupted";
 KeyFileStore::KeyFileStore(const base::FilePath& path)
     : crypto_(),
       key_file_(nullptr),
-      path_(path) {
+      path_(path),
+      storage_worker_(nullptr),
+      queued_write_failed_(false),
+      weak_ptr_factory_(this) {
   CHECK(!path_.empty());
 }
 
@@ -69,13 +74,28 @@ KeyFileStore::~KeyFileStore() {
 }
 
 void KeyFileStore::ReleaseKeyFile() {
+  decryption_cache_.Clear();
   if (key_file_) {
     g_key_file_free(key_file_);
     key_file_ = nullptr;
   }
 }
 
+void KeyFileStore::WaitForPendingWrites() const {
+  if (storage_worker_) {
+    storage_worker_->WaitForPendingWrites();
+  }
+}
+
+void KeyFileStore::OnQueuedWriteDone(bool success) {
+  if (!success) {
+    LOG(ERROR) << "Queued write of key file failed: " << path_.value();
+    queued_write_failed_ = true;
+  }
+}
+
 bool KeyFileStore::IsNonEmpty() const {
+  WaitForPendingWrites();
   int64_t file_size = 0;
   return base::GetFileSize(path_, &file_size) && file_size != 0;
 }
@@ -104,12 +124,20 @@ bool KeyFileStore::Open() {
 }
 
 bool KeyFileStore::Close() {
-  bool success = Flush();
+  bool success = Persist(true);
   ReleaseKeyFile();
   return success;
 }
 
 bool KeyFileStore::Flush() {
+  return Persist(false);
+}
+
+void KeyFileStore::ClearDecryptionCache() {
+  decryption_cache_.Clear();
+}
+
+bool KeyFileStore::Persist(bool synchronous) {
   CHECK(key_file_);
   GError* error = nullptr;
   gsize length = 0;
@@ -121,7 +149,22 @@ bool KeyFileStore::Flush() {
                << ConvertErrorToMessage(error);
     success = false;
   }
-  if (success) {
+  if (success && storage_worker_ && !synchronous) {
+    // |data| is an immutable snapshot of the key file, so the store may
+    // continue to be modified while the worker writes it out.
+    storage_worker_->PostWrite(
+        path_, string(data, length),
+        base::Bind(&KeyFileStore::OnQueuedWriteDone,
+                   weak_ptr_factory_.GetWeakPtr()));
+    success = !queued_write_failed_;
+    queued_write_failed_ = false;
+  } else if (success) {
+    // A queued snapshot is older than |data|, so it must not land on disk
+    // after this write. Once this write is done, the results of queued
+    // writes no longer say anything about the contents of |path_|.
+    WaitForPendingWrites();
+    weak_ptr_factory_.InvalidateWeakPtrs();
+    queued_write_failed_ = false;
     ScopedUmask owner_only_umask(~(S_IRUSR | S_IWUSR) & 0777);
     success = base::ImportantFileWriter::WriteFileAtomically(path_, data);
     if (!success) {
@@ -134,6 +177,7 @@ bool KeyFileStore::Flush() {
 
 bool KeyFileStore::MarkAsCorrupted() {
   LOG(INFO) << "In " << __func__ << " for " << path_.value();
+  WaitForPendingWrites();
   string corrupted_path = path_.value() + kCorruptSuffix;
   int ret =  rename(path_.value().c_str(), corrupted_path.c_str());
   if (ret != 0) {
@@ -188,6 +232,7 @@ bool KeyFileStore::ContainsGroup(const string& group) const {
 
 bool KeyFileStore::DeleteKey(const string& group, const string& key) {
   CHECK(key_file_);
+  decryption_cache_.InvalidateKey(group, key);
   GError* error = nullptr;
   g_key_file_remove_key(key_file_, group.c_str(), key.c_str(), &error);
   if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
@@ -200,6 +245,7 @@ bool KeyFileStore::DeleteKey(const string& group, const string& key) {
 
 bool KeyFileStore::DeleteGroup(const string& group) {
   CHECK(key_file_);
+  decryption_cache_.InvalidateGroup(group);
   GError* error = nullptr;
   g_key_file_remove_group(key_file_, group.c_str(), &error);
   if (error && error->code != G_KEY_FILE_ERROR_GROUP_NOT_FOUND) {
@@ -244,6 +290,7 @@ bool KeyFileStore::SetString(const string& group,
                              const string& key,
                              const string& value) {
   CHECK(key_file_);
+  decryption_cache_.InvalidateKey(group, key);
   g_key_file_set_string(key_file_, group.c_str(), key.c_str(), value.c_str());
   return true;
 }
@@ -372,11 +419,14 @@ bool KeyFileStore::SetStringList(const string& group,
 bool KeyFileStore::GetCryptedString(const string& group,
                                     const string& key,
                                     string* value) {
-  if (!GetString(group, key, value)) {
+  string ciphertext;
+  if (!GetString(group, key, &ciphertext)) {
     return false;
   }
-  if (value) {
-    *value = crypto_.Decrypt(*value);
+  if (value &&
+      !decryption_cache_.Lookup(group, key, ciphertext, value)) {
+    *value = crypto_.Decrypt(ciphertext);
+    decryption_cache_.Insert(group, key, ciphertext, *value);
   }
   return true;
 }
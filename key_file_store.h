@@ -23,13 +23,17 @@
 
 #include <glib.h>  // Can't forward-declare GKeyFile due to typedef.
 #include <base/files/file_path.h>
+#include <base/memory/weak_ptr.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
 #include "shill/crypto_provider.h"
+#include "shill/decryption_cache.h"
 #include "shill/store_interface.h"
 
 namespace shill {
 
+class StorageWorker;
+
 // A key file store implementation of the store interface. See
 // http://www.gtk.org/api/2.6/glib/glib-Key-value-file-parser.html for details
 // of the key file format.
@@ -41,8 +45,13 @@ class KeyFileStore : public StoreInterface {
   // Inherited from StoreInterface.
   bool IsNonEmpty() const override;
   bool Open() override;
+  // Waits for any queued write and writes the store out before returning,
+  // so that the result reflects the final contents on disk.
   bool Close() override;
+  // With a storage worker set, returns false if the write queued by an
+  // earlier Flush() failed, since that failure could not be reported then.
   bool Flush() override;
+  void ClearDecryptionCache() override;
   bool MarkAsCorrupted() override;
   std::set<std::string> GetGroups() const override;
   std::set<std::string> GetGroupsWithKey(const std::string& key) const override;
@@ -89,19 +98,41 @@ class KeyFileStore : public StoreInterface {
                         const std::string& key,
                         const std::string& value) override;
 
+  // When set, Flush() hands a snapshot of the store contents to
+  // |storage_worker| instead of writing to disk on the calling thread.
+  // Does not take ownership.
+  void set_storage_worker(StorageWorker* storage_worker) {
+    storage_worker_ = storage_worker;
+  }
+
  private:
   FRIEND_TEST(KeyFileStoreTest, OpenClose);
+  FRIEND_TEST(KeyFileStoreTest, CryptedStringDecryptionIsCached);
+  FRIEND_TEST(KeyFileStoreTest, DecryptionCacheIsClearedOnRequest);
   FRIEND_TEST(KeyFileStoreTest, OpenFail);
 
   static const char kCorruptSuffix[];
 
   void ReleaseKeyFile();
+  // Blocks until every write queued on |storage_worker_| is done.  The
+  // worker is shared by all stores, so this includes writes of other files.
+  void WaitForPendingWrites() const;
+  // Serializes the key file and writes it to |path_|.  The write is queued
+  // on |storage_worker_| if there is one, unless |synchronous| is true.
+  bool Persist(bool synchronous);
+  // Called with the result of a write queued on |storage_worker_|.
+  void OnQueuedWriteDone(bool success);
   bool DoesGroupMatchProperties(const std::string& group,
                                 const KeyValueStore& properties) const;
 
   CryptoProvider crypto_;
+  DecryptionCache decryption_cache_;
   GKeyFile* key_file_;
   const base::FilePath path_;
+  StorageWorker* storage_worker_;
+  // Set when a queued write fails, until the next Flush() reports it.
+  bool queued_write_failed_;
+  base::WeakPtrFactory<KeyFileStore> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(KeyFileStore);
 };
@@ -32,6 +32,8 @@
 #include <gtest/gtest.h>
 
 #include "shill/key_value_store.h"
+#include "shill/storage_worker.h"
+#include "shill/test_event_dispatcher.h"
 
 using base::FileEnumerator;
 using base::FilePath;
@@ -134,6 +136,58 @@ TEST_F(KeyFileStoreTest, MarkAsCorrupted) {
   EXPECT_TRUE(base::PathExists(FilePath(test_file_.value() + ".corrupted")));
 }
 
+TEST_F(KeyFileStoreTest, FlushThroughStorageWorker) {
+  EventDispatcherForTest dispatcher;
+  StorageWorker storage_worker;
+  ASSERT_TRUE(storage_worker.Start());
+  store_->set_storage_worker(&storage_worker);
+  ASSERT_TRUE(store_->Open());
+  ASSERT_TRUE(store_->SetString("group", "key", "value"));
+  ASSERT_TRUE(store_->Close());
+  storage_worker.WaitForPendingWrites();
+
+  // The file is written with the same permissions as a synchronous flush.
+  FileEnumerator file_enumerator(temp_dir_.path(),
+                                 false /* not recursive */,
+                                 FileEnumerator::FILES);
+  EXPECT_EQ(test_file_.value(), file_enumerator.Next().value());
+  EXPECT_EQ(S_IFREG | S_IRUSR | S_IWUSR,
+            file_enumerator.GetInfo().stat().st_mode);
+
+  ASSERT_TRUE(store_->Open());
+  string value;
+  EXPECT_TRUE(store_->GetString("group", "key", &value));
+  EXPECT_EQ("value", value);
+  ASSERT_TRUE(store_->Close());
+  storage_worker.Stop();
+}
+
+TEST_F(KeyFileStoreTest, FailedQueuedWriteIsReportedByNextFlush) {
+  EventDispatcherForTest dispatcher;
+  StorageWorker storage_worker;
+  ASSERT_TRUE(storage_worker.Start());
+  store_->set_storage_worker(&storage_worker);
+  ASSERT_TRUE(store_->Open());
+  // A directory in place of the store file makes the queued write fail.
+  ASSERT_TRUE(base::CreateDirectory(test_file_));
+  EXPECT_TRUE(store_->Flush());
+  storage_worker.WaitForPendingWrites();
+  dispatcher.DispatchPendingEvents();
+
+  ASSERT_TRUE(base::DeleteFile(test_file_, false));
+  EXPECT_FALSE(store_->Flush());
+  storage_worker.WaitForPendingWrites();
+  dispatcher.DispatchPendingEvents();
+  EXPECT_TRUE(store_->Flush());
+  storage_worker.WaitForPendingWrites();
+
+  // Close() writes synchronously and reports its own result.
+  ASSERT_TRUE(base::DeleteFile(test_file_, false));
+  ASSERT_TRUE(base::CreateDirectory(test_file_));
+  EXPECT_FALSE(store_->Close());
+  storage_worker.Stop();
+}
+
 TEST_F(KeyFileStoreTest, GetGroups) {
   static const char kGroupA[] = "g-a";
   static const char kGroupB[] = "g-b";
@@ -646,6 +700,55 @@ TEST_F(KeyFileStoreTest, SetCryptedString) {
             ReadKeyFile());
 }
 
+TEST_F(KeyFileStoreTest, CryptedStringDecryptionIsCached) {
+  static const char kGroup[] = "crypto-group";
+  static const char kKey[] = "secret";
+  WriteKeyFile(base::StringPrintf("[%s]\n"
+                                  "%s=%s\n",
+                                  kGroup, kKey, kROT47Text));
+  ASSERT_TRUE(store_->Open());
+  string value;
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+  EXPECT_EQ(kPlainText, value);
+  EXPECT_EQ(0, store_->decryption_cache_.hit_count());
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+  EXPECT_EQ(kPlainText, value);
+  EXPECT_EQ(1, store_->decryption_cache_.hit_count());
+
+  // Setting a new value invalidates the cached plaintext.
+  ASSERT_TRUE(store_->SetCryptedString(kGroup, kKey, "new secret"));
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+  EXPECT_EQ("new secret", value);
+  EXPECT_EQ(1, store_->decryption_cache_.hit_count());
+
+  // So does overwriting the ciphertext directly.
+  ASSERT_TRUE(store_->SetString(kGroup, kKey, kROT47Text));
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+  EXPECT_EQ(kPlainText, value);
+  EXPECT_EQ(1, store_->decryption_cache_.hit_count());
+
+  ASSERT_TRUE(store_->DeleteKey(kGroup, kKey));
+  EXPECT_FALSE(store_->GetCryptedString(kGroup, kKey, &value));
+  ASSERT_TRUE(store_->Close());
+}
+
+TEST_F(KeyFileStoreTest, DecryptionCacheIsClearedOnRequest) {
+  static const char kGroup[] = "crypto-group";
+  static const char kKey[] = "secret";
+  WriteKeyFile(base::StringPrintf("[%s]\n"
+                                  "%s=%s\n",
+                                  kGroup, kKey, kROT47Text));
+  ASSERT_TRUE(store_->Open());
+  string value;
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+
+  store_->ClearDecryptionCache();
+  EXPECT_TRUE(store_->GetCryptedString(kGroup, kKey, &value));
+  EXPECT_EQ(kPlainText, value);
+  EXPECT_EQ(0, store_->decryption_cache_.hit_count());
+  ASSERT_TRUE(store_->Close());
+}
+
 TEST_F(KeyFileStoreTest, PersistAcrossClose) {
   static const char kGroup[] = "string-group";
   static const char kKey1[] = "test-string";
@@ -120,6 +120,10 @@ const char* Manager::kProbeTechnologies[] = {
 
 // static
 const char Manager::kDefaultClaimerName[] = "";
+// static
+const char Manager::kPortalFallbackURLsProperty[] = "PortalFallbackURLs";
+// static
+const char Manager::kConnectTracesProperty[] = "ConnectTraces";
 
 Manager::Manager(ControlInterface* control_interface,
                  EventDispatcher* dispatcher,
@@ -184,6 +188,8 @@ Manager::Manager(ControlInterface* control_interface,
   HelpRegisterDerivedString(kCheckPortalListProperty,
                             &Manager::GetCheckPortalList,
                             &Manager::SetCheckPortalList);
+  HelpRegisterConstDerivedStrings(kConnectTracesProperty,
+                                  &Manager::GetConnectTraces);
   HelpRegisterConstDerivedStrings(kConnectedTechnologiesProperty,
                                   &Manager::ConnectedTechnologies);
   store_.RegisterConstString(kConnectionStateProperty, &connection_state_);
@@ -212,6 +218,8 @@ Manager::Manager(ControlInterface* control_interface,
                         &props_.no_auto_connect_technologies);
   store_.RegisterBool(kOfflineModeProperty, &props_.offline_mode);
   store_.RegisterString(kPortalURLProperty, &props_.portal_url);
+  store_.RegisterString(kPortalFallbackURLsProperty,
+                        &props_.portal_fallback_urls);
   store_.RegisterInt32(kPortalCheckIntervalProperty,
                        &props_.portal_check_interval_seconds);
   HelpRegisterConstDerivedRpcIdentifiers(kProfilesProperty,
@@ -301,7 +309,9 @@ void Manager::Stop() {
     // Since this happens in a loop, the current manager state is stored to
     // all default profiles in the stack.  This is acceptable because the
     // only time multiple default profiles are loaded are during autotests.
-    profile->Save();
+    if (!profile->Save()) {
+      LOG(ERROR) << "Failed to save profile " << profile->GetFriendlyName();
+    }
   }
 
   Error e;
@@ -573,6 +583,9 @@ void Manager::PopProfileInternal() {
     // Service was totally unloaded. No advance of iterator in this
     // case, as UnloadService has updated the iterator for us.
   }
+  // Services that were not unloaded keep a reference to the profile, but
+  // the credentials it decrypted should not outlive the unload.
+  active_profile->GetStorage()->ClearDecryptionCache();
   SortServices();
   OnProfilesChanged();
   LOG(INFO) << __func__ << " finished; " << profiles_.size()
@@ -1191,6 +1204,11 @@ bool Manager::IsDHCPv6EnabledForDevice(const string& device_name) const {
                    device_name) != dhcpv6_enabled_devices_.end();
 }
 
+vector<string> Manager::GetPortalFallbackURLs() const {
+  return base::SplitString(props_.portal_fallback_urls, ",",
+                           base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+}
+
 vector<string> Manager::FilterPrependDNSServersByFamily(
     IPAddress::Family family) const {
   vector<string> dns_servers;
@@ -2154,6 +2172,13 @@ string Manager::DefaultTechnology(Error* /*error*/) {
       services_[0]->GetTechnologyString() : "";
 }
 
+vector<string> Manager::GetConnectTraces(Error* /*error*/) {
+  if (!metrics_) {
+    return vector<string>();
+  }
+  return metrics_->connect_tracer().FormatTraces();
+}
+
 vector<string> Manager::EnabledTechnologies(Error* /*error*/) {
   set<string> unique_technologies;
   for (const auto& device : devices_) {
@@ -2544,10 +2569,17 @@ void Manager::RecheckPortalOnService(const ServiceRefPtr& service) {
 void Manager::RequestScan(Device::ScanType scan_type,
                           const string& technology, Error* error) {
   if (technology == kTypeWifi || technology == "") {
+#if !defined(DISABLE_WIFI)
+    // Idle devices on different phys split the band between them.
+    wifi_provider_->StartScanFanOut();
+#endif  // DISABLE_WIFI
     for (const auto& wifi_device : FilterByTechnology(Technology::kWifi)) {
       metrics_->NotifyUserInitiatedEvent(Metrics::kUserInitiatedEventWifiScan);
       wifi_device->Scan(scan_type, error, __func__);
     }
+#if !defined(DISABLE_WIFI)
+    wifi_provider_->FinishScanFanOut();
+#endif  // DISABLE_WIFI
   } else {
     // TODO(quiche): support scanning for other technologies?
     Error::PopulateAndLog(FROM_HERE, error, Error::kInvalidArguments,
@@ -80,6 +80,12 @@ class Manager : public base::SupportsWeakPtr<Manager> {
  public:
   typedef base::Callback<void(const ServiceRefPtr& service)> ServiceCallback;
 
+  // Comma-separated list of URLs that portal detection probes alongside
+  // the portal check URL.
+  static const char kPortalFallbackURLsProperty[];
+  // Timelines of the most recent connects, one string per connect.
+  static const char kConnectTracesProperty[];
+
   struct Properties {
    public:
     Properties()
@@ -93,6 +99,8 @@ class Manager : public base::SupportsWeakPtr<Manager> {
     std::string country;
     int32_t portal_check_interval_seconds;
     std::string portal_url;
+    // Comma-separated list of URLs probed concurrently with |portal_url|.
+    std::string portal_fallback_urls;
     std::string host_name;
     // Whether to ARP for the default gateway in the DHCP client after
     // acquiring a lease.
@@ -373,6 +381,7 @@ class Manager : public base::SupportsWeakPtr<Manager> {
   virtual const std::string& GetPortalCheckURL() const {
     return props_.portal_url;
   }
+  std::vector<std::string> GetPortalFallbackURLs() const;
 
   virtual DeviceInfo* device_info() { return &device_info_; }
 #if !defined(DISABLE_CELLULAR)
@@ -649,6 +658,7 @@ class Manager : public base::SupportsWeakPtr<Manager> {
   void AutoConnect();
   std::vector<std::string> AvailableTechnologies(Error* error);
   std::vector<std::string> ConnectedTechnologies(Error* error);
+  std::vector<std::string> GetConnectTraces(Error* error);
   std::string DefaultTechnology(Error* error);
   std::vector<std::string> EnabledTechnologies(Error* error);
   std::vector<std::string> UninitializedTechnologies(Error* error);
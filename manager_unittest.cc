@@ -1553,6 +1553,12 @@ TEST_F(ManagerTest, PopProfileWithUnload) {
   EXPECT_CALL(*profile0, GetRpcIdentifier()).Times(AnyNumber());
   EXPECT_CALL(*profile1, GetRpcIdentifier()).Times(AnyNumber());
 
+  // Credentials decrypted by profile1 are dropped, even though the services
+  // that were not unloaded still refer to it.
+  MockStore storage;
+  EXPECT_CALL(*profile1, GetStorage()).WillOnce(Return(&storage));
+  EXPECT_CALL(storage, ClearDecryptionCache());
+
   // This will pop profile1, which should cause all our profiles to unload.
   manager()->PopProfileInternal();
   CompleteServiceSort();
@@ -1616,13 +1622,26 @@ TEST_F(ManagerTest, RequestScan) {
     manager()->RegisterDevice(mock_devices_[1].get());
     EXPECT_CALL(*mock_devices_[0], technology())
         .WillRepeatedly(Return(Technology::kWifi));
-    EXPECT_CALL(*mock_devices_[0], Scan(Device::kFullScan, _, _));
     EXPECT_CALL(*mock_devices_[1], technology())
         .WillRepeatedly(Return(Technology::kUnknown));
     EXPECT_CALL(*mock_devices_[1], Scan(_, _, _)).Times(0);
     EXPECT_CALL(*metrics(), NotifyUserInitiatedEvent(
         Metrics::kUserInitiatedEventWifiScan)).Times(1);
+#if !defined(DISABLE_WIFI)
+    {
+      // The WiFi devices scan within a single fan-out.
+      InSequence seq;
+      EXPECT_CALL(*wifi_provider_, StartScanFanOut());
+      EXPECT_CALL(*mock_devices_[0], Scan(Device::kFullScan, _, _));
+      EXPECT_CALL(*wifi_provider_, FinishScanFanOut());
+    }
+#else
+    EXPECT_CALL(*mock_devices_[0], Scan(Device::kFullScan, _, _));
+#endif  // DISABLE_WIFI
     manager()->RequestScan(Device::kFullScan, kTypeWifi, &error);
+#if !defined(DISABLE_WIFI)
+    Mock::VerifyAndClearExpectations(wifi_provider_);
+#endif  // DISABLE_WIFI
     manager()->DeregisterDevice(mock_devices_[0].get());
     manager()->DeregisterDevice(mock_devices_[1].get());
     Mock::VerifyAndClearExpectations(mock_devices_[0].get());
@@ -161,6 +161,9 @@ const int Metrics::kMetricPortalAttemptsToOnlineNumBuckets = 10;
 
 const char Metrics::kMetricPortalResultSuffix[] = "PortalResult";
 
+const char Metrics::kMetricPortalTimeToVerdictMillisecondsSuffix[] =
+    "PortalTimeToVerdict";
+
 const char Metrics::kMetricFrequenciesConnectedEver[] =
     "Network.Shill.WiFi.FrequenciesConnectedEver";
 const int Metrics::kMetricFrequenciesConnectedMax = 50;
@@ -172,6 +175,14 @@ const char Metrics::kMetricScanResult[] =
 const char Metrics::kMetricWiFiScanTimeInEbusyMilliseconds[] =
     "Network.Shill.WiFi.ScanTimeInEbusy";
 
+const char Metrics::kMetricProgressiveScanRequestsToCandidate[] =
+    "Network.Shill.WiFi.ProgressiveScanRequestsToCandidate";
+const char Metrics::kMetricProgressiveScanExpectedRequestsToCandidate[] =
+    "Network.Shill.WiFi.ProgressiveScanExpectedRequestsToCandidate";
+const int Metrics::kMetricProgressiveScanRequestsMax = 20;
+const int Metrics::kMetricProgressiveScanRequestsMin = 1;
+const int Metrics::kMetricProgressiveScanRequestsNumBuckets = 20;
+
 const char Metrics::kMetricTerminationActionTimeTaken[] =
     "Network.Shill.TerminationActionTimeTaken";
 const char Metrics::kMetricTerminationActionResult[] =
@@ -330,6 +341,24 @@ const int Metrics::kMetricExpiredLeaseLengthSecondsNumBuckets =
     Metrics::kMetricExpiredLeaseLengthSecondsMax;
 
 // static
+const char Metrics::kMetricWifiResumeToConnectedMilliseconds[] =
+    "Network.Shill.WiFi.ResumeToConnected";
+const int Metrics::kMetricWifiResumeToConnectedMillisecondsMax = 60000;
+const int Metrics::kMetricWifiResumeToConnectedMillisecondsMin = 1;
+const int Metrics::kMetricWifiResumeToConnectedMillisecondsNumBuckets = 60;
+
+const char Metrics::kMetricWifiSuspendActionsMilliseconds[] =
+    "Network.Shill.WiFi.SuspendActionsTime";
+const int Metrics::kMetricWifiSuspendActionsMillisecondsMax = 10000;
+const int Metrics::kMetricWifiSuspendActionsMillisecondsMin = 1;
+const int Metrics::kMetricWifiSuspendActionsMillisecondsNumBuckets = 50;
+
+const char Metrics::kMetricWifiDarkResumeActionsMilliseconds[] =
+    "Network.Shill.WiFi.DarkResumeActionsTime";
+const int Metrics::kMetricWifiDarkResumeActionsMillisecondsMax = 20000;
+const int Metrics::kMetricWifiDarkResumeActionsMillisecondsMin = 1;
+const int Metrics::kMetricWifiDarkResumeActionsMillisecondsNumBuckets = 50;
+
 const char Metrics::kMetricWifiAutoConnectableServices[] =
     "Network.Shill.WiFi.AutoConnectableServices";
 const int Metrics::kMetricWifiAutoConnectableServicesMax = 50;
@@ -657,6 +686,7 @@ void Metrics::RegisterService(const Service& service) {
 
 void Metrics::DeregisterService(const Service& service) {
   services_metrics_.erase(&service);
+  connect_tracer_.NotifyServiceRemoved(service.unique_name());
 }
 
 void Metrics::AddServiceStateTransitionTimer(
@@ -736,6 +766,9 @@ void Metrics::NotifyServiceStateChanged(const Service& service,
   }
   ServiceMetrics* service_metrics = it->second.get();
   UpdateServiceStateTransitionMetrics(service_metrics, new_state);
+  connect_tracer_.NotifyServiceStateChanged(service.unique_name(),
+                                            service.technology(),
+                                            new_state);
 
   if (new_state == Service::kStateFailure)
     SendServiceFailure(service);
@@ -931,6 +964,16 @@ void Metrics::NotifyDarkResumeScanResultsReceived() {
   --num_scan_results_expected_in_dark_resume_;
 }
 
+void Metrics::NotifyPortalDetectionTimeToVerdict(
+    Technology::Identifier technology, int milliseconds) {
+  SendToUMA(GetFullMetricName(kMetricPortalTimeToVerdictMillisecondsSuffix,
+                              technology),
+            milliseconds,
+            kTimerHistogramMillisecondsMin,
+            kTimerHistogramMillisecondsMax,
+            kTimerHistogramNumBuckets);
+}
+
 void Metrics::NotifyLinkMonitorFailure(
     Technology::Identifier technology,
     LinkMonitorFailure failure,
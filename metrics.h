@@ -26,6 +26,7 @@
 #include <metrics/metrics_library.h>
 #include <metrics/timer.h>
 
+#include "shill/connect_tracer.h"
 #include "shill/connectivity_trial.h"
 #include "shill/event_dispatcher.h"
 #include "shill/portal_detector.h"
@@ -587,6 +588,9 @@ class Metrics {
   // The result of the portal detection.
   static const char kMetricPortalResultSuffix[];
 
+  // The time from the start of portal detection to its final result.
+  static const char kMetricPortalTimeToVerdictMillisecondsSuffix[];
+
   // Wifi connection frequencies.
   static const char kMetricFrequenciesConnectedEver[];
   static const int kMetricFrequenciesConnectedMax;
@@ -596,6 +600,14 @@ class Metrics {
   static const char kMetricScanResult[];
   static const char kMetricWiFiScanTimeInEbusyMilliseconds[];
 
+  // Progressive scan requests issued before a candidate was found, and the
+  // number expected from the frequency history.
+  static const char kMetricProgressiveScanRequestsToCandidate[];
+  static const char kMetricProgressiveScanExpectedRequestsToCandidate[];
+  static const int kMetricProgressiveScanRequestsMax;
+  static const int kMetricProgressiveScanRequestsMin;
+  static const int kMetricProgressiveScanRequestsNumBuckets;
+
   static const char kMetricPowerManagerKey[];
 
   // LinkMonitor statistics.
@@ -708,6 +720,27 @@ class Metrics {
   static const int kMetricExpiredLeaseLengthSecondsMin;
   static const int kMetricExpiredLeaseLengthSecondsNumBuckets;
 
+  // Time from resume until a wifi device that was not connected at resume
+  // is connected.
+  static const char kMetricWifiResumeToConnectedMilliseconds[];
+  static const int kMetricWifiResumeToConnectedMillisecondsMax;
+  static const int kMetricWifiResumeToConnectedMillisecondsMin;
+  static const int kMetricWifiResumeToConnectedMillisecondsNumBuckets;
+
+  // Time taken by wake on WiFi actions before suspend, from the start of
+  // those actions until the suspend delay is reported ready.
+  static const char kMetricWifiSuspendActionsMilliseconds[];
+  static const int kMetricWifiSuspendActionsMillisecondsMax;
+  static const int kMetricWifiSuspendActionsMillisecondsMin;
+  static const int kMetricWifiSuspendActionsMillisecondsNumBuckets;
+
+  // Time from the start of a dark resume until shill reports that it is ready
+  // to suspend again.
+  static const char kMetricWifiDarkResumeActionsMilliseconds[];
+  static const int kMetricWifiDarkResumeActionsMillisecondsMax;
+  static const int kMetricWifiDarkResumeActionsMillisecondsMin;
+  static const int kMetricWifiDarkResumeActionsMillisecondsNumBuckets;
+
   // Number of wifi services available when auto-connect is initiated.
   static const char kMetricWifiAutoConnectableServices[];
   static const int kMetricWifiAutoConnectableServicesMax;
@@ -820,6 +853,9 @@ class Metrics {
   // will be removed.
   void DeregisterService(const Service& service);
 
+  // Timelines of the most recent connects.
+  const ConnectTracer& connect_tracer() const { return connect_tracer_; }
+
   // Tracks the time it takes |service| to go from |start_state| to
   // |stop_state|.  When |stop_state| is reached, the time is sent to UMA.
   virtual void AddServiceStateTransitionTimer(
@@ -891,6 +927,11 @@ class Metrics {
   // Notifies this object that a scan results have been received in dark resume.
   void NotifyDarkResumeScanResultsReceived();
 
+  // Notifies this object that portal detection on a device of |technology|
+  // reached its final result after |milliseconds|.
+  virtual void NotifyPortalDetectionTimeToVerdict(
+      Technology::Identifier technology, int milliseconds);
+
   // Notifies this object of a failure in LinkMonitor.
   void NotifyLinkMonitorFailure(
       Technology::Identifier technology,
@@ -1225,6 +1266,7 @@ class Metrics {
   MetricsLibrary metrics_library_;
   MetricsLibraryInterface* library_;
   ServiceMetricsLookupMap services_metrics_;
+  ConnectTracer connect_tracer_;
   Technology::Identifier last_default_technology_;
   bool was_online_;
   std::unique_ptr<chromeos_metrics::Timer> time_online_timer_;
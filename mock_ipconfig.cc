@@ -22,9 +22,12 @@ namespace shill {
 
 MockIPConfig::MockIPConfig(ControlInterface* control_interface,
                            const std::string& device_name)
-    : IPConfig(control_interface, device_name) {
+    : IPConfig(control_interface, device_name),
+      parsed_mocked_properties_(IPAddress::kFamilyUnknown) {
   ON_CALL(*this, properties())
       .WillByDefault(Invoke(this, &MockIPConfig::real_properties));
+  ON_CALL(*this, parsed_properties())
+      .WillByDefault(Invoke(this, &MockIPConfig::ParseMockedProperties));
 }
 
 MockIPConfig::~MockIPConfig() {}
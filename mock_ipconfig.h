@@ -34,6 +34,7 @@ class MockIPConfig : public IPConfig {
   ~MockIPConfig() override;
 
   MOCK_CONST_METHOD0(properties, const Properties& (void));
+  MOCK_CONST_METHOD0(parsed_properties, const ParsedProperties& (void));
   MOCK_METHOD0(RequestIP, bool(void));
   MOCK_METHOD0(RenewIP, bool(void));
   MOCK_METHOD1(ReleaseIP, bool(ReleaseReason reason));
@@ -49,6 +50,15 @@ class MockIPConfig : public IPConfig {
     return IPConfig::properties();
   }
 
+  // Parses whatever properties() returns, so that the two agree when
+  // properties() is mocked.
+  const ParsedProperties& ParseMockedProperties() {
+    parsed_mocked_properties_ = ParseProperties(properties());
+    return parsed_mocked_properties_;
+  }
+
+  ParsedProperties parsed_mocked_properties_;
+
   DISALLOW_COPY_AND_ASSIGN(MockIPConfig);
 };
 
@@ -92,6 +92,8 @@ class MockMetrics : public Metrics {
   MOCK_METHOD0(NotifyWakeOnWiFiThrottled, void());
   MOCK_METHOD0(NotifySuspendWithWakeOnWiFiEnabledDone, void());
   MOCK_METHOD0(NotifyDarkResumeInitiateScan, void());
+  MOCK_METHOD2(NotifyPortalDetectionTimeToVerdict,
+               void(Technology::Identifier technology, int milliseconds));
   MOCK_METHOD0(NotifyWakeupReasonReceived, void());
 #if !defined(DISABLE_WIFI)
   MOCK_METHOD1(NotifyWakeOnWiFiOnDarkResume,
@@ -38,6 +38,7 @@ class MockStore : public StoreInterface {
   MOCK_METHOD0(Open, bool());
   MOCK_METHOD0(Close, bool());
   MOCK_METHOD0(Flush, bool());
+  MOCK_METHOD0(ClearDecryptionCache, void());
   MOCK_METHOD0(MarkAsCorrupted, bool());
   MOCK_CONST_METHOD0(GetGroups, std::set<std::string>());
   MOCK_CONST_METHOD1(GetGroupsWithKey,
@@ -21,6 +21,7 @@ namespace shill {
 
 namespace IEEE_80211 {
 // Information Element Ids from IEEE 802.11-2012 Section 8.4.2
+const uint8_t kElemIdBSSLoad = 0x0b;
 const uint8_t kElemIdChannels = 0x24;
 const uint8_t kElemIdChallengeText = 0x10;
 const uint8_t kElemIdCountry = 0x07;
@@ -61,6 +62,9 @@ const uint16_t kWPSElementModelName = 0x1023;
 const uint16_t kWPSElementModelNumber = 0x1024;
 const uint16_t kWPSElementDeviceName = 0x1011;
 
+const int kBSSLoadStationCountLen = 2;
+const int kBSSLoadChannelUtilizationLen = 1;
+
 const int kRSNIEVersionLen = 2;
 const int kRSNIESelectorLen = 4;
 const int kRSNIECipherCountOffset = kRSNIEVersionLen + kRSNIESelectorLen;
@@ -48,6 +48,7 @@ class MockSockets : public Sockets {
   MOCK_CONST_METHOD1(GetSocketError, int(int fd));
   MOCK_CONST_METHOD3(Ioctl, int(int d, int request, void* argp));
   MOCK_CONST_METHOD2(Listen, int(int d, int backlog));
+  MOCK_CONST_METHOD2(Pipe, int(int* read_fd, int* write_fd));
   MOCK_CONST_METHOD6(RecvFrom, ssize_t(int sockfd,
                                        void* buf,
                                        size_t len,
@@ -71,6 +72,8 @@ class MockSockets : public Sockets {
   MOCK_CONST_METHOD2(SetReceiveBuffer, int(int sockfd, int size));
   MOCK_CONST_METHOD2(ShutDown, int(int sockfd, int how));
   MOCK_CONST_METHOD3(Socket, int(int domain, int type, int protocol));
+  MOCK_CONST_METHOD4(Splice, ssize_t(int fd_in, int fd_out, size_t len,
+                                     unsigned int flags));
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockSockets);
@@ -119,6 +119,16 @@ int Sockets::Listen(int sockfd, int backlog) const {
   return listen(sockfd, backlog);
 }
 
+int Sockets::Pipe(int* read_fd, int* write_fd) const {
+  int fds[2];
+  if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+    return -1;
+  }
+  *read_fd = fds[0];
+  *write_fd = fds[1];
+  return 0;
+}
+
 ssize_t Sockets::RecvFrom(int sockfd,
                           void* buf,
                           size_t len,
@@ -170,6 +180,11 @@ int Sockets::Socket(int domain, int type, int protocol) const {
   return socket(domain, type, protocol);
 }
 
+ssize_t Sockets::Splice(int fd_in, int fd_out, size_t len,
+                        unsigned int flags) const {
+  return HANDLE_EINTR(splice(fd_in, nullptr, fd_out, nullptr, len, flags));
+}
+
 ScopedSocketCloser::ScopedSocketCloser(Sockets* sockets, int fd)
     : sockets_(sockets),
       fd_(fd) {}
@@ -89,6 +89,9 @@ class SHILL_EXPORT Sockets {
   // listen
   virtual int Listen(int sockfd, int backlog) const;
 
+  // pipe2(..., O_NONBLOCK | O_CLOEXEC)
+  virtual int Pipe(int* read_fd, int* write_fd) const;
+
   // recvfrom
   virtual ssize_t RecvFrom(int sockfd, void* buf, size_t len, int flags,
                            struct sockaddr* src_addr, socklen_t* addrlen) const;
@@ -126,6 +129,10 @@ class SHILL_EXPORT Sockets {
   // socket
   virtual int Socket(int domain, int type, int protocol) const;
 
+  // splice(fd_in, nullptr, fd_out, nullptr, len, flags)
+  virtual ssize_t Splice(int fd_in, int fd_out, size_t len,
+                         unsigned int flags) const;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Sockets);
 };
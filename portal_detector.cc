@@ -36,6 +36,7 @@ using base::Bind;
 using base::Callback;
 using base::StringPrintf;
 using std::string;
+using std::vector;
 
 namespace shill {
 
@@ -70,7 +71,9 @@ PortalDetector::PortalDetector(
           new ConnectivityTrial(connection_,
                                 dispatcher_,
                                 kRequestTimeoutSeconds,
-                                connectivity_trial_callback_)) { }
+                                connectivity_trial_callback_)),
+      fallback_succeeded_(false),
+      first_attempt_start_time_((struct timeval){0}) { }
 
 PortalDetector::~PortalDetector() {
   Stop();
@@ -87,23 +90,48 @@ bool PortalDetector::StartAfterDelay(const string& url_string,
   if (!connectivity_trial_->Start(url_string, delay_seconds * 1000)) {
     return false;
   }
+  fallback_succeeded_ = false;
+  for (size_t i = 0; i < fallback_trials_.size(); ++i) {
+    if (!fallback_trials_[i]->Start(fallback_urls_[i], delay_seconds * 1000)) {
+      LOG(ERROR) << "Failed to start portal probe of " << fallback_urls_[i];
+    }
+  }
   attempt_count_ = 1;
   // The attempt_start_time_ is calculated based on the current time and
   // |delay_seconds|.  This is used to determine if a portal detection attempt
   // is in progress.
   UpdateAttemptTime(delay_seconds);
+  first_attempt_start_time_ = attempt_start_time_;
   // If we're starting a new set of attempts, discard past failure history.
   failures_in_content_phase_ = 0;
   return true;
 }
 
+void PortalDetector::set_fallback_urls(const vector<string>& url_strings) {
+  fallback_urls_.clear();
+  fallback_trials_.clear();
+  for (const auto& url_string : url_strings) {
+    fallback_urls_.push_back(url_string);
+    fallback_trials_.emplace_back(
+        new ConnectivityTrial(connection_,
+                              dispatcher_,
+                              kRequestTimeoutSeconds,
+                              Bind(&PortalDetector::CompleteFallbackAttempt,
+                                   weak_ptr_factory_.GetWeakPtr())));
+  }
+}
+
 void PortalDetector::Stop() {
   SLOG(connection_.get(), 3) << "In " << __func__;
 
   attempt_count_ = 0;
   failures_in_content_phase_ = 0;
+  fallback_succeeded_ = false;
   if (connectivity_trial_.get())
     connectivity_trial_->Stop();
+  for (auto& trial : fallback_trials_) {
+    trial->Stop();
+  }
 }
 
 // IsInProgress returns true if a ConnectivityTrial is actively testing the
@@ -121,6 +149,12 @@ bool PortalDetector::IsInProgress() {
 }
 
 void PortalDetector::CompleteAttempt(ConnectivityTrial::Result trial_result) {
+  // Only the portal check URL decides the outcome of an attempt, so abandon
+  // the fallback probes that have not reported yet.
+  for (auto& trial : fallback_trials_) {
+    trial->Stop();
+  }
+
   Result result = Result(trial_result);
   if (trial_result.status == ConnectivityTrial::kStatusFailure &&
       trial_result.phase == ConnectivityTrial::kPhaseContent) {
@@ -141,16 +175,47 @@ void PortalDetector::CompleteAttempt(ConnectivityTrial::Result trial_result) {
       failures_in_content_phase_ >= kMaxFailuresInContentPhase) {
     result.num_attempts = attempt_count_;
     result.final = true;
+    struct timeval now, elapsed_time;
+    time_->GetTimeMonotonic(&now);
+    timersub(&now, &first_attempt_start_time_, &elapsed_time);
+    result.time_to_verdict_milliseconds =
+        elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000;
     Stop();
   } else {
     attempt_count_++;
-    int retry_delay_seconds = AdjustStartDelay(0);
+    // A fallback endpoint that answered shows the network is reachable, so
+    // the failure of the portal check URL is likely transient.  Retry it
+    // without waiting out the minimum time between attempts.
+    int retry_delay_seconds = fallback_succeeded_ ? 0 : AdjustStartDelay(0);
+    fallback_succeeded_ = false;
     connectivity_trial_->Retry(retry_delay_seconds * 1000);
+    // The fallback trials were stopped above, which drops their requests,
+    // so they need to be started again rather than retried.
+    for (size_t i = 0; i < fallback_trials_.size(); ++i) {
+      if (!fallback_trials_[i]->Start(fallback_urls_[i],
+                                      retry_delay_seconds * 1000)) {
+        LOG(ERROR) << "Failed to restart portal probe of "
+                   << fallback_urls_[i];
+      }
+    }
     UpdateAttemptTime(retry_delay_seconds);
   }
   portal_result_callback_.Run(result);
 }
 
+void PortalDetector::CompleteFallbackAttempt(
+    ConnectivityTrial::Result trial_result) {
+  SLOG(connection_.get(), 3) << "Fallback portal probe completed with phase=="
+                             << ConnectivityTrial::PhaseToString(
+                                    trial_result.phase)
+                             << ", status=="
+                             << ConnectivityTrial::StatusToString(
+                                    trial_result.status);
+  if (trial_result.status == ConnectivityTrial::kStatusSuccess) {
+    fallback_succeeded_ = true;
+  }
+}
+
 void PortalDetector::UpdateAttemptTime(int delay_seconds) {
   time_->GetTimeMonotonic(&attempt_start_time_);
   struct timeval delay_timeval = { delay_seconds, 0 };
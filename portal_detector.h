@@ -58,17 +58,20 @@ class PortalDetector {
     Result()
         : trial_result(ConnectivityTrial::Result()),
           num_attempts(0),
-          final(false) {}
+          final(false),
+          time_to_verdict_milliseconds(0) {}
     explicit Result(ConnectivityTrial::Result result_in)
         : trial_result(result_in),
           num_attempts(0),
-          final(false) {}
+          final(false),
+          time_to_verdict_milliseconds(0) {}
     Result(ConnectivityTrial::Result result_in,
            int num_attempts_in,
            int final_in)
         : trial_result(result_in),
           num_attempts(num_attempts_in),
-          final(final_in) {}
+          final(final_in),
+          time_to_verdict_milliseconds(0) {}
 
     ConnectivityTrial::Result trial_result;
 
@@ -77,6 +80,9 @@ class PortalDetector {
     // This only valid when |final| is true.
     int num_attempts;
     bool final;
+    // Time from the start of the first attempt to the final result.
+    // This is only valid when |final| is true.
+    int time_to_verdict_milliseconds;
   };
 
   static const int kDefaultCheckIntervalSeconds;
@@ -104,6 +110,13 @@ class PortalDetector {
   virtual bool StartAfterDelay(const std::string& url_string,
                                int delay_seconds);
 
+  // Probe each of |url_strings| concurrently with the URL passed to Start()
+  // on every attempt.  Only the result for the URL passed to Start() ends
+  // an attempt; if it fails while one of these probes has succeeded, the
+  // next attempt starts without waiting out the minimum time between
+  // attempts.  Takes effect on the next Start().
+  void set_fallback_urls(const std::vector<std::string>& url_strings);
+
   // End the current portal detection process if one exists, and do not call
   // the callback.
   virtual void Stop();
@@ -130,6 +143,10 @@ class PortalDetector {
   FRIEND_TEST(PortalDetectorTest, ReadCompleteHeader);
   FRIEND_TEST(PortalDetectorTest, ReadMatchingHeader);
   FRIEND_TEST(PortalDetectorTest, InvalidURL);
+  FRIEND_TEST(PortalDetectorTest, FallbackSuccessIsNotFinal);
+  FRIEND_TEST(PortalDetectorTest, FallbackSuccessRetriesImmediately);
+  FRIEND_TEST(PortalDetectorTest, FallbackContentFailures);
+  FRIEND_TEST(PortalDetectorTest, FallbackProbesRunOnEveryAttempt);
 
   // Minimum time between attempts to connect to server.
   static const int kMinTimeBetweenAttemptsSeconds;
@@ -154,6 +171,9 @@ class PortalDetector {
   // determine connectivity status.
   void CompleteAttempt(ConnectivityTrial::Result result);
 
+  // Callback used by the trials for |fallback_urls_|.
+  void CompleteFallbackAttempt(ConnectivityTrial::Result result);
+
   int attempt_count_;
   struct timeval attempt_start_time_;
   ConnectionRefPtr connection_;
@@ -164,7 +184,11 @@ class PortalDetector {
   Time* time_;
   int failures_in_content_phase_;
   std::unique_ptr<ConnectivityTrial> connectivity_trial_;
-
+  std::vector<std::string> fallback_urls_;
+  std::vector<std::unique_ptr<ConnectivityTrial>> fallback_trials_;
+  // True if a fallback probe has succeeded during the current attempt.
+  bool fallback_succeeded_;
+  struct timeval first_attempt_start_time_;
 
   DISALLOW_COPY_AND_ASSIGN(PortalDetector);
 };
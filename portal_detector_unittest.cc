@@ -37,8 +37,10 @@ using base::Unretained;
 using std::string;
 using std::vector;
 using testing::_;
+using testing::AllOf;
 using testing::AtLeast;
 using testing::DoAll;
+using testing::Field;
 using testing::InSequence;
 using testing::Mock;
 using testing::NiceMock;
@@ -54,6 +56,7 @@ namespace {
 const char kBadURL[] = "badurl";
 const char kInterfaceName[] = "int0";
 const char kURL[] = "http://www.chromium.org";
+const char kFallbackURL[] = "http://www.google.com/gen_204";
 const char kDNSServer0[] = "8.8.8.8";
 const char kDNSServer1[] = "8.8.4.4";
 const char* kDNSServers[] = { kDNSServer0, kDNSServer1 };
@@ -160,6 +163,22 @@ class PortalDetectorTest : public Test {
     EXPECT_TRUE(StartPortalRequest(kURL));
   }
 
+  // Configures a single fallback URL whose trial is a mock, and starts an
+  // attempt probing both URLs.
+  MockConnectivityTrial* StartConcurrentAttempt() {
+    portal_detector_->set_fallback_urls(vector<string>{kFallbackURL});
+    MockConnectivityTrial* fallback_trial =
+        new StrictMock<MockConnectivityTrial>(
+            connection_, PortalDetector::kRequestTimeoutSeconds);
+    portal_detector_->fallback_trials_[0].reset(fallback_trial);
+    EXPECT_CALL(*fallback_trial, Stop()).Times(AtLeast(0));
+    EXPECT_CALL(*connectivity_trial(), Start(kURL, 0)).WillOnce(Return(true));
+    EXPECT_CALL(*fallback_trial, Start(kFallbackURL, 0))
+        .WillOnce(Return(true));
+    EXPECT_TRUE(StartPortalRequest(kURL));
+    return fallback_trial;
+  }
+
  private:
   int GetTimeMonotonic(struct timeval* tv) {
     *tv = current_time_;
@@ -468,4 +487,141 @@ TEST_F(PortalDetectorTest, ReadMatchingHeader) {
   portal_detector()->CompleteAttempt(r);
 }
 
+TEST_F(PortalDetectorTest, FallbackSuccessIsNotFinal) {
+  MockConnectivityTrial* fallback_trial = StartConcurrentAttempt();
+
+  // A fallback probe alone never decides the outcome.
+  EXPECT_CALL(callback_target(), ResultCallback(_)).Times(0);
+  portal_detector()->CompleteFallbackAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseContent,
+                                ConnectivityTrial::kStatusSuccess));
+  Mock::VerifyAndClearExpectations(&callback_target());
+  EXPECT_TRUE(portal_detector()->fallback_succeeded_);
+
+  // The result for the portal check URL does, and stops the other probes.
+  AdvanceTime(1500);
+  EXPECT_CALL(*connectivity_trial(), Stop()).Times(AtLeast(1));
+  EXPECT_CALL(*fallback_trial, Stop()).Times(AtLeast(1));
+  EXPECT_CALL(callback_target(),
+              ResultCallback(AllOf(
+                  IsResult(PortalDetector::Result(
+                      ConnectivityTrial::Result(
+                          ConnectivityTrial::kPhaseContent,
+                          ConnectivityTrial::kStatusSuccess),
+                      kNumAttempts,
+                      true)),
+                  Field(&PortalDetector::Result::time_to_verdict_milliseconds,
+                        1500))));
+  portal_detector()->CompleteAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseContent,
+                                ConnectivityTrial::kStatusSuccess));
+  ExpectReset();
+  EXPECT_FALSE(portal_detector()->fallback_succeeded_);
+}
+
+TEST_F(PortalDetectorTest, FallbackSuccessRetriesImmediately) {
+  MockConnectivityTrial* fallback_trial = StartConcurrentAttempt();
+  portal_detector()->CompleteFallbackAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseContent,
+                                ConnectivityTrial::kStatusSuccess));
+
+  // The portal check URL failing while a fallback endpoint answered is
+  // retried without waiting out the minimum time between attempts.
+  EXPECT_CALL(callback_target(),
+              ResultCallback(IsResult(
+                  PortalDetector::Result(
+                      ConnectivityTrial::Result(
+                          ConnectivityTrial::kPhaseConnection,
+                          ConnectivityTrial::kStatusFailure),
+                      kNumAttempts,
+                      false))));
+  EXPECT_CALL(*connectivity_trial(), Retry(0));
+  EXPECT_CALL(*fallback_trial, Start(kFallbackURL, 0))
+      .WillOnce(Return(true));
+  portal_detector()->CompleteAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseConnection,
+                                ConnectivityTrial::kStatusFailure));
+  Mock::VerifyAndClearExpectations(connectivity_trial());
+  Mock::VerifyAndClearExpectations(fallback_trial);
+  EXPECT_EQ(2, portal_detector()->attempt_count_);
+  EXPECT_FALSE(portal_detector()->fallback_succeeded_);
+
+  // Without a fallback success, the usual spacing applies.
+  EXPECT_CALL(*fallback_trial, Stop()).Times(AtLeast(0));
+  ExpectAttemptRetry(
+      PortalDetector::Result(
+          ConnectivityTrial::Result(
+              ConnectivityTrial::kPhaseConnection,
+              ConnectivityTrial::kStatusFailure),
+          kNumAttempts,
+          false));
+  EXPECT_CALL(*fallback_trial,
+              Start(kFallbackURL,
+                    PortalDetector::kMinTimeBetweenAttemptsSeconds * 1000))
+      .WillOnce(Return(true));
+  portal_detector()->CompleteAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseConnection,
+                                ConnectivityTrial::kStatusFailure));
+  EXPECT_EQ(3, portal_detector()->attempt_count_);
+}
+
+TEST_F(PortalDetectorTest, FallbackContentFailures) {
+  MockConnectivityTrial* fallback_trial = StartConcurrentAttempt();
+
+  // Unexpected content from fallback endpoints, such as a block page or a
+  // proxied response, neither ends the attempt nor counts toward declaring
+  // a portal.
+  EXPECT_CALL(callback_target(), ResultCallback(_)).Times(0);
+  for (int i = 0; i < PortalDetector::kMaxFailuresInContentPhase; ++i) {
+    portal_detector()->CompleteFallbackAttempt(
+        ConnectivityTrial::Result(ConnectivityTrial::kPhaseContent,
+                                  ConnectivityTrial::kStatusFailure));
+  }
+  Mock::VerifyAndClearExpectations(&callback_target());
+  EXPECT_EQ(0, portal_detector()->failures_in_content_phase_);
+
+  // A content failure from the portal check URL is retried as usual.
+  ExpectAttemptRetry(
+      PortalDetector::Result(
+          ConnectivityTrial::Result(
+              ConnectivityTrial::kPhaseContent,
+              ConnectivityTrial::kStatusFailure),
+          kNumAttempts,
+          false));
+  EXPECT_CALL(*fallback_trial,
+              Start(kFallbackURL,
+                    PortalDetector::kMinTimeBetweenAttemptsSeconds * 1000))
+      .WillOnce(Return(true));
+  portal_detector()->CompleteAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseContent,
+                                ConnectivityTrial::kStatusFailure));
+  EXPECT_EQ(1, portal_detector()->failures_in_content_phase_);
+}
+
+TEST_F(PortalDetectorTest, FallbackProbesRunOnEveryAttempt) {
+  // Keep the real trial for the fallback URL: it drops its request when the
+  // attempt ends, and must still post a new probe for the next attempt.
+  portal_detector()->set_fallback_urls(vector<string>{kFallbackURL});
+  EXPECT_CALL(*connectivity_trial(), Start(kURL, 0)).WillOnce(Return(true));
+  EXPECT_CALL(dispatcher(), PostDelayedTask(_, 0));
+  EXPECT_TRUE(StartPortalRequest(kURL));
+  Mock::VerifyAndClearExpectations(&dispatcher());
+
+  // The second attempt probes the fallback URL again.
+  ExpectAttemptRetry(
+      PortalDetector::Result(
+          ConnectivityTrial::Result(
+              ConnectivityTrial::kPhaseConnection,
+              ConnectivityTrial::kStatusFailure),
+          kNumAttempts,
+          false));
+  EXPECT_CALL(dispatcher(),
+              PostDelayedTask(
+                  _, PortalDetector::kMinTimeBetweenAttemptsSeconds * 1000));
+  portal_detector()->CompleteAttempt(
+      ConnectivityTrial::Result(ConnectivityTrial::kPhaseConnection,
+                                ConnectivityTrial::kStatusFailure));
+  Mock::VerifyAndClearExpectations(&dispatcher());
+}
+
 }  // namespace shill
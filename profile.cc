@@ -37,6 +37,7 @@
 #include "shill/manager.h"
 #include "shill/property_accessor.h"
 #include "shill/service.h"
+#include "shill/storage_worker.h"
 #include "shill/store_factory.h"
 #include "shill/store_interface.h"
 #include "shill/stub_storage.h"
@@ -161,6 +162,13 @@ bool Profile::RemoveStorage(Error* error) {
   CHECK(!storage_.get());
   CHECK(!persistent_profile_path_.empty());
 
+  // A write of the final contents of this profile may still be queued.
+  StorageWorker* storage_worker =
+      StoreFactory::GetInstance()->storage_worker();
+  if (storage_worker) {
+    storage_worker->WaitForPendingWrites();
+  }
+
   if (!base::DeleteFile(persistent_profile_path_, false)) {
     Error::PopulateAndLog(
         FROM_HERE, error, Error::kOperationFailed,
@@ -18,6 +18,7 @@
 #define SHILL_PROPERTY_ITERATOR_H_
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "shill/accessor_interface.h"
@@ -33,7 +34,7 @@ class ReadablePropertyConstIterator {
  public:
   ~ReadablePropertyConstIterator() {}
 
-  bool AtEnd() const { return it_ == collection_.end(); }
+  bool AtEnd() const { return it_ == collection_->end(); }
 
   void Advance() {
     if (!AtEnd()) {
@@ -51,11 +52,14 @@ class ReadablePropertyConstIterator {
   friend class PropertyStore;
 
   typedef std::shared_ptr<AccessorInterface<V>> VAccessorPtr;
+  typedef std::map<std::string, VAccessorPtr> VAccessorMap;
 
+  // Copies of the iterator share |collection|, so they stay valid after the
+  // iterator is returned by value.
   explicit ReadablePropertyConstIterator(
-      const typename std::map<std::string, VAccessorPtr>& collection)
+      const std::shared_ptr<const VAccessorMap>& collection)
       : collection_(collection),
-        it_(collection_.begin()),
+        it_(collection_->begin()),
         value_() {
     if (MustAdvance()) {
       Advance();
@@ -70,8 +74,8 @@ class ReadablePropertyConstIterator {
     return error.IsSuccess();
   }
 
-  const typename std::map<std::string, VAccessorPtr>& collection_;
-  typename std::map<std::string, VAccessorPtr>::const_iterator it_;
+  std::shared_ptr<const VAccessorMap> collection_;
+  typename VAccessorMap::const_iterator it_;
   V value_;
 };
 
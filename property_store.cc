@@ -16,10 +16,13 @@
 
 #include "shill/property_store.h"
 
+#include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <base/rand_util.h>
 #include <base/stl_util.h>
 #include <dbus/object_path.h>
 
@@ -38,30 +41,30 @@ static auto kModuleLogScope = ScopeLogger::kProperty;
 static string ObjectID(const PropertyStore* p) { return "(property_store)"; }
 }
 
-PropertyStore::PropertyStore() {}
+namespace {
+
+// Returns a random generation to start counting from, leaving room for
+// 2^32 changes in the low bits.
+uint64_t PickFirstGeneration() {
+  return static_cast<uint64_t>(
+      base::RandInt(1, std::numeric_limits<int32_t>::max())) << 32;
+}
+
+}  // namespace
+
+PropertyStore::PropertyStore()
+    : first_generation_(PickFirstGeneration()),
+      generation_(first_generation_) {}
 
 PropertyStore::PropertyStore(PropertyChangeCallback on_property_changed) :
+    first_generation_(PickFirstGeneration()),
+    generation_(first_generation_),
     property_changed_callback_(on_property_changed) {}
 
 PropertyStore::~PropertyStore() {}
 
 bool PropertyStore::Contains(const string& prop) const {
-  return (ContainsKey(bool_properties_, prop)  ||
-          ContainsKey(int16_properties_, prop) ||
-          ContainsKey(int32_properties_, prop) ||
-          ContainsKey(key_value_store_properties_, prop) ||
-          ContainsKey(string_properties_, prop) ||
-          ContainsKey(stringmap_properties_, prop) ||
-          ContainsKey(stringmaps_properties_, prop) ||
-          ContainsKey(strings_properties_, prop) ||
-          ContainsKey(uint8_properties_, prop) ||
-          ContainsKey(bytearray_properties_, prop) ||
-          ContainsKey(uint16_properties_, prop) ||
-          ContainsKey(uint16s_properties_, prop) ||
-          ContainsKey(uint32_properties_, prop) ||
-          ContainsKey(uint64_properties_, prop) ||
-          ContainsKey(rpc_identifier_properties_, prop) ||
-          ContainsKey(rpc_identifiers_properties_, prop));
+  return ContainsKey(property_info_, prop);
 }
 
 bool PropertyStore::SetAnyProperty(const string& name,
@@ -121,250 +124,321 @@ bool PropertyStore::SetProperties(const brillo::VariantDictionary& in,
 }
 
 bool PropertyStore::GetProperties(brillo::VariantDictionary* out,
-                                  Error* error) const {
-  {
-    ReadablePropertyConstIterator<bool> it = GetBoolPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+                                  Error* /*error*/) const {
+  for (const auto& name_and_info : property_info_) {
+    brillo::Any value;
+    if (GetPropertyAsAny(name_and_info.second, &value)) {
+      out->insert(std::make_pair(name_and_info.first, value));
     }
   }
-  {
-    ReadablePropertyConstIterator<int16_t> it = GetInt16PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+  return true;
+}
+
+bool PropertyStore::GetPropertiesChangedSince(uint64_t generation,
+                                              brillo::VariantDictionary* out,
+                                              uint64_t* current_generation,
+                                              Error* /*error*/) {
+  // Derived values may change without passing through this store, so
+  // compare them against what was read last time.
+  for (auto& name_and_info : property_info_) {
+    PropertyInfo& info = name_and_info.second;
+    if (!info.derived) {
+      continue;
     }
-  }
-  {
-    ReadablePropertyConstIterator<int32_t> it = GetInt32PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    brillo::Any value;
+    if (GetPropertyAsAny(info, &value) && value != info.derived_value) {
+      info.derived_value = value;
+      info.generation = ++generation_;
     }
   }
-  {
-    ReadablePropertyConstIterator<RpcIdentifier> it =
-        GetRpcIdentifierPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(
-          std::make_pair(it.Key(),
-                         brillo::Any(dbus::ObjectPath(it.value()))));
+
+  if (generation < first_generation_ || generation > generation_) {
+    generation = 0;
+  }
+  for (const auto& name_and_info : property_info_) {
+    if (name_and_info.second.generation <= generation) {
+      continue;
+    }
+    brillo::Any value;
+    if (GetPropertyAsAny(name_and_info.second, &value)) {
+      out->insert(std::make_pair(name_and_info.first, value));
     }
   }
-  {
-    ReadablePropertyConstIterator<RpcIdentifiers> it =
-        GetRpcIdentifiersPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
+  *current_generation = generation_;
+  return true;
+}
+
+bool PropertyStore::GetPropertyAsAny(const PropertyInfo& info,
+                                     brillo::Any* value) const {
+  switch (info.type) {
+    case kBoolProperty: {
+      bool v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
+    }
+    case kInt16Property: {
+      int16_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
+    }
+    case kInt32Property: {
+      int32_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
+    }
+    case kKeyValueStoreProperty: {
+      KeyValueStore v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      brillo::VariantDictionary dict;
+      KeyValueStore::ConvertToVariantDictionary(v, &dict);
+      *value = brillo::Any(dict);
+      return true;
+    }
+    case kRpcIdentifierProperty: {
+      RpcIdentifier v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(dbus::ObjectPath(v));
+      return true;
+    }
+    case kRpcIdentifiersProperty: {
+      RpcIdentifiers v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
       vector<dbus::ObjectPath> rpc_identifiers_as_paths;
-      for (const auto& path : it.value()) {
+      for (const auto& path : v) {
         rpc_identifiers_as_paths.push_back(dbus::ObjectPath(path));
       }
-      out->insert(
-          std::make_pair(it.Key(), brillo::Any(rpc_identifiers_as_paths)));
+      *value = brillo::Any(rpc_identifiers_as_paths);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<string> it = GetStringPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
-    }
-  }
-  {
-    ReadablePropertyConstIterator<Stringmap> it = GetStringmapPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kStringProperty: {
+      string v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<Stringmaps> it =
-        GetStringmapsPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kStringmapProperty: {
+      Stringmap v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<Strings> it = GetStringsPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kStringmapsProperty: {
+      Stringmaps v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<uint8_t> it = GetUint8PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kStringsProperty: {
+      Strings v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<ByteArray> it = GetByteArrayPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kUint8Property: {
+      uint8_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<uint16_t> it = GetUint16PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kByteArrayProperty: {
+      ByteArray v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<Uint16s> it = GetUint16sPropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kUint16Property: {
+      uint16_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<uint32_t> it = GetUint32PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kUint16sProperty: {
+      Uint16s v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<uint64_t> it = GetUint64PropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      out->insert(std::make_pair(it.Key(), brillo::Any(it.value())));
+    case kUint32Property: {
+      uint32_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
-  }
-  {
-    ReadablePropertyConstIterator<KeyValueStore> it =
-        GetKeyValueStorePropertiesIter();
-    for ( ; !it.AtEnd(); it.Advance()) {
-      brillo::VariantDictionary dict;
-      KeyValueStore::ConvertToVariantDictionary(it.value(), &dict);
-      out->insert(std::make_pair(it.Key(), dict));
+    case kUint64Property: {
+      uint64_t v;
+      if (!ReadProperty(info, &v)) {
+        return false;
+      }
+      *value = brillo::Any(v);
+      return true;
     }
   }
-
-  return true;
+  return false;
 }
 
 bool PropertyStore::GetBoolProperty(const string& name,
                                     bool* value,
                                     Error* error) const {
-  return GetProperty(name, value, error, bool_properties_, "a bool");
+  return GetProperty(name, value, error, kBoolProperty, "a bool");
 }
 
 bool PropertyStore::GetInt16Property(const string& name,
                                      int16_t* value,
                                      Error* error) const {
-  return GetProperty(name, value, error, int16_properties_, "an int16_t");
+  return GetProperty(name, value, error, kInt16Property, "an int16_t");
 }
 
 bool PropertyStore::GetInt32Property(const string& name,
                                      int32_t* value,
                                      Error* error) const {
-  return GetProperty(name, value, error, int32_properties_, "an int32_t");
+  return GetProperty(name, value, error, kInt32Property, "an int32_t");
 }
 
 bool PropertyStore::GetKeyValueStoreProperty(const string& name,
                                              KeyValueStore* value,
                                              Error* error) const {
-  return GetProperty(name, value, error, key_value_store_properties_,
+  return GetProperty(name, value, error, kKeyValueStoreProperty,
                      "a key value store");
 }
 
 bool PropertyStore::GetRpcIdentifierProperty(const string& name,
                                              RpcIdentifier* value,
                                              Error* error) const {
-  return GetProperty(name, value, error, rpc_identifier_properties_,
+  return GetProperty(name, value, error, kRpcIdentifierProperty,
                      "an rpc_identifier");
 }
 
 bool PropertyStore::GetStringProperty(const string& name,
                                       string* value,
                                       Error* error) const {
-  return GetProperty(name, value, error, string_properties_, "a string");
+  return GetProperty(name, value, error, kStringProperty, "a string");
 }
 
 bool PropertyStore::GetStringmapProperty(const string& name,
                                          Stringmap* values,
                                          Error* error) const {
-  return GetProperty(name, values, error, stringmap_properties_,
+  return GetProperty(name, values, error, kStringmapProperty,
                      "a string map");
 }
 
 bool PropertyStore::GetStringmapsProperty(const string& name,
                                           Stringmaps* values,
                                           Error* error) const {
-  return GetProperty(name, values, error, stringmaps_properties_,
+  return GetProperty(name, values, error, kStringmapsProperty,
                      "a string map list");
 }
 
 bool PropertyStore::GetStringsProperty(const string& name,
                                        Strings* values,
                                        Error* error) const {
-  return GetProperty(name, values, error, strings_properties_, "a string list");
+  return GetProperty(name, values, error, kStringsProperty, "a string list");
 }
 
 bool PropertyStore::GetUint8Property(const string& name,
                                      uint8_t* value,
                                      Error* error) const {
-  return GetProperty(name, value, error, uint8_properties_, "a uint8_t");
+  return GetProperty(name, value, error, kUint8Property, "a uint8_t");
 }
 
 bool PropertyStore::GetByteArrayProperty(const string& name,
                                          ByteArray* value,
                                          Error *error) const {
-  return GetProperty(name, value, error, bytearray_properties_, "a byte array");
+  return GetProperty(name, value, error, kByteArrayProperty, "a byte array");
 }
 
 bool PropertyStore::GetUint16Property(const string& name,
                                       uint16_t* value,
                                       Error* error) const {
-  return GetProperty(name, value, error, uint16_properties_, "a uint16_t");
+  return GetProperty(name, value, error, kUint16Property, "a uint16_t");
 }
 
 bool PropertyStore::GetUint16sProperty(const string& name,
                                        Uint16s* value,
                                        Error* error) const {
-  return GetProperty(name, value, error, uint16s_properties_,
+  return GetProperty(name, value, error, kUint16sProperty,
                      "a uint16_t list");
 }
 
 bool PropertyStore::GetUint32Property(const string& name,
                                       uint32_t* value,
                                       Error* error) const {
-  return GetProperty(name, value, error, uint32_properties_, "a uint32_t");
+  return GetProperty(name, value, error, kUint32Property, "a uint32_t");
 }
 
 bool PropertyStore::GetUint64Property(const string& name,
                                       uint64_t* value,
                                       Error* error) const {
-  return GetProperty(name, value, error, uint64_properties_, "a uint64_t");
+  return GetProperty(name, value, error, kUint64Property, "a uint64_t");
 }
 
 bool PropertyStore::SetBoolProperty(const string& name,
                                     bool value,
                                     Error* error) {
-  return SetProperty(name, value, error, &bool_properties_, "a bool");
+  return SetProperty(name, value, error, kBoolProperty, "a bool");
 }
 
 bool PropertyStore::SetInt16Property(const string& name,
                                      int16_t value,
                                      Error* error) {
-  return SetProperty(name, value, error, &int16_properties_, "an int16_t");
+  return SetProperty(name, value, error, kInt16Property, "an int16_t");
 }
 
 bool PropertyStore::SetInt32Property(const string& name,
                                      int32_t value,
                                      Error* error) {
-  return SetProperty(name, value, error, &int32_properties_, "an int32_t.");
+  return SetProperty(name, value, error, kInt32Property, "an int32_t.");
 }
 
 bool PropertyStore::SetKeyValueStoreProperty(const string& name,
                                              const KeyValueStore& value,
                                              Error* error) {
-  return SetProperty(name, value, error, &key_value_store_properties_,
+  return SetProperty(name, value, error, kKeyValueStoreProperty,
                      "a key value store");
 }
 
 bool PropertyStore::SetStringProperty(const string& name,
                                       const string& value,
                                       Error* error) {
-  return SetProperty(name, value, error, &string_properties_, "a string");
+  return SetProperty(name, value, error, kStringProperty, "a string");
 }
 
 bool PropertyStore::SetStringmapProperty(const string& name,
                                          const map<string, string>& values,
                                          Error* error) {
-  return SetProperty(name, values, error, &stringmap_properties_,
+  return SetProperty(name, values, error, kStringmapProperty,
                      "a string map");
 }
 
@@ -372,99 +446,122 @@ bool PropertyStore::SetStringmapsProperty(
     const string& name,
     const vector<map<string, string>>& values,
     Error* error) {
-  return SetProperty(name, values, error, &stringmaps_properties_,
+  return SetProperty(name, values, error, kStringmapsProperty,
                      "a stringmaps");
 }
 
 bool PropertyStore::SetStringsProperty(const string& name,
                                        const vector<string>& values,
                                        Error* error) {
-  return SetProperty(name, values, error, &strings_properties_,
+  return SetProperty(name, values, error, kStringsProperty,
                      "a string list");
 }
 
 bool PropertyStore::SetUint8Property(const string& name,
                                      uint8_t value,
                                      Error* error) {
-  return SetProperty(name, value, error, &uint8_properties_, "a uint8_t");
+  return SetProperty(name, value, error, kUint8Property, "a uint8_t");
 }
 
 bool PropertyStore::SetByteArrayProperty(const string& name,
                                          const ByteArray& value,
                                          Error *error) {
-  return SetProperty(name, value, error, &bytearray_properties_, "a byte array");
+  return SetProperty(name, value, error, kByteArrayProperty, "a byte array");
 }
 
 bool PropertyStore::SetUint16Property(const string& name,
                                       uint16_t value,
                                       Error* error) {
-  return SetProperty(name, value, error, &uint16_properties_, "a uint16_t");
+  return SetProperty(name, value, error, kUint16Property, "a uint16_t");
 }
 
 bool PropertyStore::SetUint16sProperty(const string& name,
                                        const vector<uint16_t>& value,
                                        Error* error) {
-  return SetProperty(name, value, error, &uint16s_properties_,
+  return SetProperty(name, value, error, kUint16sProperty,
                      "a uint16_t list");
 }
 
 bool PropertyStore::SetUint32Property(const string& name,
                                       uint32_t value,
                                       Error* error) {
-  return SetProperty(name, value, error, &uint32_properties_, "a uint32_t");
+  return SetProperty(name, value, error, kUint32Property, "a uint32_t");
 }
 
 bool PropertyStore::SetUint64Property(const string& name,
                                       uint64_t value,
                                       Error* error) {
-  return SetProperty(name, value, error, &uint64_properties_, "a uint64_t");
+  return SetProperty(name, value, error, kUint64Property, "a uint64_t");
 }
 
 bool PropertyStore::SetRpcIdentifierProperty(const string& name,
                                              const RpcIdentifier& value,
                                              Error* error) {
-  return SetProperty(name, value, error, &rpc_identifier_properties_,
+  return SetProperty(name, value, error, kRpcIdentifierProperty,
                      "an rpc_identifier");
 }
 
 bool PropertyStore::ClearProperty(const string& name, Error* error) {
   SLOG(this, 2) << "Clearing " << name << ".";
 
-  if (ContainsKey(bool_properties_, name)) {
-    bool_properties_[name]->Clear(error);
-  } else if (ContainsKey(int16_properties_, name)) {
-    int16_properties_[name]->Clear(error);
-  } else if (ContainsKey(int32_properties_, name)) {
-    int32_properties_[name]->Clear(error);
-  } else if (ContainsKey(key_value_store_properties_, name)) {
-    key_value_store_properties_[name]->Clear(error);
-  } else if (ContainsKey(string_properties_, name)) {
-    string_properties_[name]->Clear(error);
-  } else if (ContainsKey(stringmap_properties_, name)) {
-    stringmap_properties_[name]->Clear(error);
-  } else if (ContainsKey(stringmaps_properties_, name)) {
-    stringmaps_properties_[name]->Clear(error);
-  } else if (ContainsKey(strings_properties_, name)) {
-    strings_properties_[name]->Clear(error);
-  } else if (ContainsKey(uint8_properties_, name)) {
-    uint8_properties_[name]->Clear(error);
-  } else if (ContainsKey(uint16_properties_, name)) {
-    uint16_properties_[name]->Clear(error);
-  } else if (ContainsKey(uint16s_properties_, name)) {
-    uint16s_properties_[name]->Clear(error);
-  } else if (ContainsKey(uint32_properties_, name)) {
-    uint32_properties_[name]->Clear(error);
-  } else if (ContainsKey(uint64_properties_, name)) {
-    uint64_properties_[name]->Clear(error);
-  } else if (ContainsKey(rpc_identifier_properties_, name)) {
-    rpc_identifier_properties_[name]->Clear(error);
-  } else if (ContainsKey(rpc_identifiers_properties_, name)) {
-    rpc_identifiers_properties_[name]->Clear(error);
-  } else {
+  const auto it = property_info_.find(name);
+  if (it == property_info_.end()) {
     error->Populate(
         Error::kInvalidProperty, "Property " + name + " does not exist.");
+    return false;
+  }
+  switch (it->second.type) {
+    case kBoolProperty:
+      GetAccessor<bool>(it->second)->Clear(error);
+      break;
+    case kInt16Property:
+      GetAccessor<int16_t>(it->second)->Clear(error);
+      break;
+    case kInt32Property:
+      GetAccessor<int32_t>(it->second)->Clear(error);
+      break;
+    case kKeyValueStoreProperty:
+      GetAccessor<KeyValueStore>(it->second)->Clear(error);
+      break;
+    case kRpcIdentifierProperty:
+      GetAccessor<RpcIdentifier>(it->second)->Clear(error);
+      break;
+    case kRpcIdentifiersProperty:
+      GetAccessor<RpcIdentifiers>(it->second)->Clear(error);
+      break;
+    case kStringProperty:
+      GetAccessor<string>(it->second)->Clear(error);
+      break;
+    case kStringmapProperty:
+      GetAccessor<Stringmap>(it->second)->Clear(error);
+      break;
+    case kStringmapsProperty:
+      GetAccessor<Stringmaps>(it->second)->Clear(error);
+      break;
+    case kStringsProperty:
+      GetAccessor<Strings>(it->second)->Clear(error);
+      break;
+    case kUint8Property:
+      GetAccessor<uint8_t>(it->second)->Clear(error);
+      break;
+    case kByteArrayProperty:
+      GetAccessor<ByteArray>(it->second)->Clear(error);
+      break;
+    case kUint16Property:
+      GetAccessor<uint16_t>(it->second)->Clear(error);
+      break;
+    case kUint16sProperty:
+      GetAccessor<Uint16s>(it->second)->Clear(error);
+      break;
+    case kUint32Property:
+      GetAccessor<uint32_t>(it->second)->Clear(error);
+      break;
+    case kUint64Property:
+      GetAccessor<uint64_t>(it->second)->Clear(error);
+      break;
   }
   if (error->IsSuccess()) {
+    it->second.generation = ++generation_;
     if (!property_changed_callback_.is_null()) {
       property_changed_callback_.Run(name);
     }
@@ -472,483 +569,453 @@ bool PropertyStore::ClearProperty(const string& name, Error* error) {
   return error->IsSuccess();
 }
 
+void PropertyStore::MarkPropertyChanged(const string& name) {
+  auto it = property_info_.find(name);
+  if (it != property_info_.end()) {
+    it->second.generation = ++generation_;
+  }
+}
+
 ReadablePropertyConstIterator<bool> PropertyStore::GetBoolPropertiesIter()
     const {
-  return ReadablePropertyConstIterator<bool>(bool_properties_);
+  return GetPropertiesIter<bool>(kBoolProperty);
 }
 
 ReadablePropertyConstIterator<int16_t> PropertyStore::GetInt16PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<int16_t>(int16_properties_);
+  return GetPropertiesIter<int16_t>(kInt16Property);
 }
 
 ReadablePropertyConstIterator<int32_t> PropertyStore::GetInt32PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<int32_t>(int32_properties_);
+  return GetPropertiesIter<int32_t>(kInt32Property);
 }
 
 ReadablePropertyConstIterator<KeyValueStore>
 PropertyStore::GetKeyValueStorePropertiesIter() const {
-  return
-      ReadablePropertyConstIterator<KeyValueStore>(key_value_store_properties_);
+  return GetPropertiesIter<KeyValueStore>(kKeyValueStoreProperty);
 }
 
 ReadablePropertyConstIterator<RpcIdentifier>
 PropertyStore::GetRpcIdentifierPropertiesIter() const {
-  return ReadablePropertyConstIterator<RpcIdentifier>(
-      rpc_identifier_properties_);
+  return GetPropertiesIter<RpcIdentifier>(kRpcIdentifierProperty);
 }
 
 ReadablePropertyConstIterator<RpcIdentifiers>
 PropertyStore::GetRpcIdentifiersPropertiesIter() const {
-  return ReadablePropertyConstIterator<RpcIdentifiers>(
-      rpc_identifiers_properties_);
+  return GetPropertiesIter<RpcIdentifiers>(kRpcIdentifiersProperty);
 }
 
 ReadablePropertyConstIterator<string>
 PropertyStore::GetStringPropertiesIter() const {
-  return ReadablePropertyConstIterator<string>(string_properties_);
+  return GetPropertiesIter<string>(kStringProperty);
 }
 
 ReadablePropertyConstIterator<Stringmap>
 PropertyStore::GetStringmapPropertiesIter() const {
-  return ReadablePropertyConstIterator<Stringmap>(stringmap_properties_);
+  return GetPropertiesIter<Stringmap>(kStringmapProperty);
 }
 
 ReadablePropertyConstIterator<Stringmaps>
 PropertyStore::GetStringmapsPropertiesIter()
     const {
-  return ReadablePropertyConstIterator<Stringmaps>(stringmaps_properties_);
+  return GetPropertiesIter<Stringmaps>(kStringmapsProperty);
 }
 
 ReadablePropertyConstIterator<Strings> PropertyStore::GetStringsPropertiesIter()
     const {
-  return ReadablePropertyConstIterator<Strings>(strings_properties_);
+  return GetPropertiesIter<Strings>(kStringsProperty);
 }
 
 ReadablePropertyConstIterator<uint8_t> PropertyStore::GetUint8PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<uint8_t>(uint8_properties_);
+  return GetPropertiesIter<uint8_t>(kUint8Property);
 }
 
 ReadablePropertyConstIterator<ByteArray> PropertyStore::GetByteArrayPropertiesIter()
     const {
-  return ReadablePropertyConstIterator<ByteArray>(bytearray_properties_);
+  return GetPropertiesIter<ByteArray>(kByteArrayProperty);
 }
 
 ReadablePropertyConstIterator<uint16_t> PropertyStore::GetUint16PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<uint16_t>(uint16_properties_);
+  return GetPropertiesIter<uint16_t>(kUint16Property);
 }
 
 ReadablePropertyConstIterator<Uint16s> PropertyStore::GetUint16sPropertiesIter()
     const {
-  return ReadablePropertyConstIterator<Uint16s>(uint16s_properties_);
+  return GetPropertiesIter<Uint16s>(kUint16sProperty);
 }
 
 ReadablePropertyConstIterator<uint32_t> PropertyStore::GetUint32PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<uint32_t>(uint32_properties_);
+  return GetPropertiesIter<uint32_t>(kUint32Property);
 }
 
 ReadablePropertyConstIterator<uint64_t> PropertyStore::GetUint64PropertiesIter()
     const {
-  return ReadablePropertyConstIterator<uint64_t>(uint64_properties_);
+  return GetPropertiesIter<uint64_t>(kUint64Property);
 }
 
 void PropertyStore::RegisterBool(const string& name, bool* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bool_properties_, name))
-      << "(Already registered " << name << ")";
-  bool_properties_[name] = BoolAccessor(new PropertyAccessor<bool>(prop));
+  RegisterProperty(name, kBoolProperty,
+                   BoolAccessor(new PropertyAccessor<bool>(prop)));
 }
 
 void PropertyStore::RegisterConstBool(const string& name, const bool* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bool_properties_, name))
-      << "(Already registered " << name << ")";
-  bool_properties_[name] = BoolAccessor(new ConstPropertyAccessor<bool>(prop));
+  RegisterProperty(name, kBoolProperty,
+                   BoolAccessor(new ConstPropertyAccessor<bool>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyBool(const string& name, bool* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bool_properties_, name))
-      << "(Already registered " << name << ")";
-  bool_properties_[name] = BoolAccessor(
-      new WriteOnlyPropertyAccessor<bool>(prop));
+  RegisterProperty(name, kBoolProperty,
+                   BoolAccessor(new WriteOnlyPropertyAccessor<bool>(prop)));
 }
 
 void PropertyStore::RegisterInt16(const string& name, int16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int16_properties_, name))
-      << "(Already registered " << name << ")";
-  int16_properties_[name] = Int16Accessor(new PropertyAccessor<int16_t>(prop));
+  RegisterProperty(name, kInt16Property,
+                   Int16Accessor(new PropertyAccessor<int16_t>(prop)));
 }
 
 void PropertyStore::RegisterConstInt16(const string& name,
                                        const int16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int16_properties_, name))
-      << "(Already registered " << name << ")";
-  int16_properties_[name] =
-      Int16Accessor(new ConstPropertyAccessor<int16_t>(prop));
+  RegisterProperty(name, kInt16Property,
+                   Int16Accessor(new ConstPropertyAccessor<int16_t>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyInt16(const string& name, int16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int16_properties_, name))
-      << "(Already registered " << name << ")";
-  int16_properties_[name] =
-      Int16Accessor(new WriteOnlyPropertyAccessor<int16_t>(prop));
+  RegisterProperty(name, kInt16Property,
+                   Int16Accessor(new WriteOnlyPropertyAccessor<int16_t>(prop)));
 }
 void PropertyStore::RegisterInt32(const string& name, int32_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int32_properties_, name))
-      << "(Already registered " << name << ")";
-  int32_properties_[name] = Int32Accessor(new PropertyAccessor<int32_t>(prop));
+  RegisterProperty(name, kInt32Property,
+                   Int32Accessor(new PropertyAccessor<int32_t>(prop)));
 }
 
 void PropertyStore::RegisterConstInt32(const string& name,
                                        const int32_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int32_properties_, name))
-      << "(Already registered " << name << ")";
-  int32_properties_[name] =
-      Int32Accessor(new ConstPropertyAccessor<int32_t>(prop));
+  RegisterProperty(name, kInt32Property,
+                   Int32Accessor(new ConstPropertyAccessor<int32_t>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyInt32(const string& name, int32_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(int32_properties_, name))
-      << "(Already registered " << name << ")";
-  int32_properties_[name] =
-      Int32Accessor(new WriteOnlyPropertyAccessor<int32_t>(prop));
+  RegisterProperty(name, kInt32Property,
+                   Int32Accessor(new WriteOnlyPropertyAccessor<int32_t>(prop)));
 }
 
 void PropertyStore::RegisterString(const string& name, string* prop) {
-  DCHECK(!Contains(name) || ContainsKey(string_properties_, name))
-      << "(Already registered " << name << ")";
-  string_properties_[name] = StringAccessor(new PropertyAccessor<string>(prop));
+  RegisterProperty(name, kStringProperty,
+                   StringAccessor(new PropertyAccessor<string>(prop)));
 }
 
 void PropertyStore::RegisterConstString(const string& name,
                                         const string* prop) {
-  DCHECK(!Contains(name) || ContainsKey(string_properties_, name))
-      << "(Already registered " << name << ")";
-  string_properties_[name] =
-      StringAccessor(new ConstPropertyAccessor<string>(prop));
+  RegisterProperty(name, kStringProperty,
+                   StringAccessor(new ConstPropertyAccessor<string>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyString(const string& name, string* prop) {
-  DCHECK(!Contains(name) || ContainsKey(string_properties_, name))
-      << "(Already registered " << name << ")";
-  string_properties_[name] =
-      StringAccessor(new WriteOnlyPropertyAccessor<string>(prop));
+  RegisterProperty(name, kStringProperty,
+                   StringAccessor(new WriteOnlyPropertyAccessor<string>(prop)));
 }
 
 void PropertyStore::RegisterStringmap(const string& name, Stringmap* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmap_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmap_properties_[name] =
-      StringmapAccessor(new PropertyAccessor<Stringmap>(prop));
+  RegisterProperty(name, kStringmapProperty,
+                   StringmapAccessor(new PropertyAccessor<Stringmap>(prop)));
 }
 
 void PropertyStore::RegisterConstStringmap(const string& name,
                                            const Stringmap* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmap_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmap_properties_[name] =
-      StringmapAccessor(new ConstPropertyAccessor<Stringmap>(prop));
+  RegisterProperty(
+      name, kStringmapProperty,
+      StringmapAccessor(new ConstPropertyAccessor<Stringmap>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyStringmap(const string& name,
                                                Stringmap* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmap_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmap_properties_[name] =
-      StringmapAccessor(new WriteOnlyPropertyAccessor<Stringmap>(prop));
+  RegisterProperty(
+      name, kStringmapProperty,
+      StringmapAccessor(new WriteOnlyPropertyAccessor<Stringmap>(prop)));
 }
 
 void PropertyStore::RegisterStringmaps(const string& name, Stringmaps* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmaps_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmaps_properties_[name] =
-      StringmapsAccessor(new PropertyAccessor<Stringmaps>(prop));
+  RegisterProperty(name, kStringmapsProperty,
+                   StringmapsAccessor(new PropertyAccessor<Stringmaps>(prop)));
 }
 
 void PropertyStore::RegisterConstStringmaps(const string& name,
                                             const Stringmaps* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmaps_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmaps_properties_[name] =
-      StringmapsAccessor(new ConstPropertyAccessor<Stringmaps>(prop));
+  RegisterProperty(
+      name, kStringmapsProperty,
+      StringmapsAccessor(new ConstPropertyAccessor<Stringmaps>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyStringmaps(const string& name,
                                                 Stringmaps* prop) {
-  DCHECK(!Contains(name) || ContainsKey(stringmaps_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmaps_properties_[name] =
-      StringmapsAccessor(new WriteOnlyPropertyAccessor<Stringmaps>(prop));
+  RegisterProperty(
+      name, kStringmapsProperty,
+      StringmapsAccessor(new WriteOnlyPropertyAccessor<Stringmaps>(prop)));
 }
 
 void PropertyStore::RegisterStrings(const string& name, Strings* prop) {
-  DCHECK(!Contains(name) || ContainsKey(strings_properties_, name))
-      << "(Already registered " << name << ")";
-  strings_properties_[name] =
-      StringsAccessor(new PropertyAccessor<Strings>(prop));
+  RegisterProperty(name, kStringsProperty,
+                   StringsAccessor(new PropertyAccessor<Strings>(prop)));
 }
 
 void PropertyStore::RegisterConstStrings(const string& name,
                                          const Strings* prop) {
-  DCHECK(!Contains(name) || ContainsKey(strings_properties_, name))
-      << "(Already registered " << name << ")";
-  strings_properties_[name] =
-      StringsAccessor(new ConstPropertyAccessor<Strings>(prop));
+  RegisterProperty(name, kStringsProperty,
+                   StringsAccessor(new ConstPropertyAccessor<Strings>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyStrings(const string& name,
                                              Strings* prop) {
-  DCHECK(!Contains(name) || ContainsKey(strings_properties_, name))
-      << "(Already registered " << name << ")";
-  strings_properties_[name] =
-      StringsAccessor(new WriteOnlyPropertyAccessor<Strings>(prop));
+  RegisterProperty(
+      name, kStringsProperty,
+      StringsAccessor(new WriteOnlyPropertyAccessor<Strings>(prop)));
 }
 
 void PropertyStore::RegisterUint8(const string& name, uint8_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint8_properties_, name))
-      << "(Already registered " << name << ")";
-  uint8_properties_[name] = Uint8Accessor(new PropertyAccessor<uint8_t>(prop));
+  RegisterProperty(name, kUint8Property,
+                   Uint8Accessor(new PropertyAccessor<uint8_t>(prop)));
 }
 
 void PropertyStore::RegisterConstUint8(const string& name,
                                        const uint8_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint8_properties_, name))
-      << "(Already registered " << name << ")";
-  uint8_properties_[name] =
-      Uint8Accessor(new ConstPropertyAccessor<uint8_t>(prop));
+  RegisterProperty(name, kUint8Property,
+                   Uint8Accessor(new ConstPropertyAccessor<uint8_t>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyUint8(const string& name, uint8_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint8_properties_, name))
-      << "(Already registered " << name << ")";
-  uint8_properties_[name] =
-      Uint8Accessor(new WriteOnlyPropertyAccessor<uint8_t>(prop));
+  RegisterProperty(name, kUint8Property,
+                   Uint8Accessor(new WriteOnlyPropertyAccessor<uint8_t>(prop)));
 }
 
 void PropertyStore::RegisterByteArray(const string& name, ByteArray* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bytearray_properties_, name))
-      << "(Already registered " << name << ")";
-  bytearray_properties_[name] =
-      ByteArrayAccessor(new PropertyAccessor<ByteArray>(prop));
+  RegisterProperty(name, kByteArrayProperty,
+                   ByteArrayAccessor(new PropertyAccessor<ByteArray>(prop)));
 }
 
 void PropertyStore::RegisterConstByteArray(const string& name,
                                            const ByteArray* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bytearray_properties_, name))
-      << "(Already registered " << name << ")";
-  bytearray_properties_[name] =
-      ByteArrayAccessor(new ConstPropertyAccessor<ByteArray>(prop));
+  RegisterProperty(
+      name, kByteArrayProperty,
+      ByteArrayAccessor(new ConstPropertyAccessor<ByteArray>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyByteArray(const string& name,
                                                ByteArray* prop) {
-  DCHECK(!Contains(name) || ContainsKey(bytearray_properties_, name))
-      << "(Already registered " << name << ")";
-  bytearray_properties_[name] =
-      ByteArrayAccessor(new WriteOnlyPropertyAccessor<ByteArray>(prop));
+  RegisterProperty(
+      name, kByteArrayProperty,
+      ByteArrayAccessor(new WriteOnlyPropertyAccessor<ByteArray>(prop)));
 }
 
 void PropertyStore::RegisterUint16(const string& name, uint16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint16_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16_properties_[name] =
-      Uint16Accessor(new PropertyAccessor<uint16_t>(prop));
+  RegisterProperty(name, kUint16Property,
+                   Uint16Accessor(new PropertyAccessor<uint16_t>(prop)));
 }
 
 void PropertyStore::RegisterUint16s(const string& name, Uint16s* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint16s_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16s_properties_[name] =
-      Uint16sAccessor(new PropertyAccessor<Uint16s>(prop));
+  RegisterProperty(name, kUint16sProperty,
+                   Uint16sAccessor(new PropertyAccessor<Uint16s>(prop)));
 }
 
 void PropertyStore::RegisterUint32(const std::string& name, uint32_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint32_properties_, name))
-      << "(Already registered " << name << ")";
-  uint32_properties_[name] =
-      Uint32Accessor(new PropertyAccessor<uint32_t>(prop));
+  RegisterProperty(name, kUint32Property,
+                   Uint32Accessor(new PropertyAccessor<uint32_t>(prop)));
 }
 
 void PropertyStore::RegisterConstUint32(const string& name,
                                         const uint32_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint32_properties_, name))
-      << "(Already registered " << name << ")";
-  uint32_properties_[name] =
-      Uint32Accessor(new ConstPropertyAccessor<uint32_t>(prop));
+  RegisterProperty(name, kUint32Property,
+                   Uint32Accessor(new ConstPropertyAccessor<uint32_t>(prop)));
 }
 
 void PropertyStore::RegisterConstUint16(const string& name,
                                         const uint16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint16_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16_properties_[name] =
-      Uint16Accessor(new ConstPropertyAccessor<uint16_t>(prop));
+  RegisterProperty(name, kUint16Property,
+                   Uint16Accessor(new ConstPropertyAccessor<uint16_t>(prop)));
 }
 
 void PropertyStore::RegisterConstUint16s(const string& name,
                                          const Uint16s* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint16s_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16s_properties_[name] =
-      Uint16sAccessor(new ConstPropertyAccessor<Uint16s>(prop));
+  RegisterProperty(name, kUint16sProperty,
+                   Uint16sAccessor(new ConstPropertyAccessor<Uint16s>(prop)));
 }
 
 void PropertyStore::RegisterWriteOnlyUint16(const string& name,
                                             uint16_t* prop) {
-  DCHECK(!Contains(name) || ContainsKey(uint16_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16_properties_[name] =
-      Uint16Accessor(new WriteOnlyPropertyAccessor<uint16_t>(prop));
+  RegisterProperty(
+      name, kUint16Property,
+      Uint16Accessor(new WriteOnlyPropertyAccessor<uint16_t>(prop)));
 }
 
 void PropertyStore::RegisterDerivedBool(const string& name,
                                         const BoolAccessor& accessor) {
-  DCHECK(!Contains(name) || ContainsKey(bool_properties_, name))
-      << "(Already registered " << name << ")";
-  bool_properties_[name] = accessor;
+  RegisterDerivedProperty(name, kBoolProperty, accessor);
 }
 
 void PropertyStore::RegisterDerivedInt32(const string& name,
                                          const Int32Accessor& accessor) {
-  DCHECK(!Contains(name) || ContainsKey(int32_properties_, name))
-      << "(Already registered " << name << ")";
-  int32_properties_[name] = accessor;
+  RegisterDerivedProperty(name, kInt32Property, accessor);
 }
 
 void PropertyStore::RegisterDerivedKeyValueStore(
     const string& name,
     const KeyValueStoreAccessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(key_value_store_properties_, name))
-      << "(Already registered " << name << ")";
-  key_value_store_properties_[name] = acc;
+  RegisterDerivedProperty(name, kKeyValueStoreProperty, acc);
 }
 
 void PropertyStore::RegisterDerivedRpcIdentifier(
     const string& name,
     const RpcIdentifierAccessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(rpc_identifier_properties_, name))
-      << "(Already registered " << name << ")";
-  rpc_identifier_properties_[name] = acc;
+  RegisterDerivedProperty(name, kRpcIdentifierProperty, acc);
 }
 
 void PropertyStore::RegisterDerivedRpcIdentifiers(
     const string& name,
     const RpcIdentifiersAccessor& accessor) {
-  DCHECK(!Contains(name) || ContainsKey(rpc_identifiers_properties_, name))
-      << "(Already registered " << name << ")";
-  rpc_identifiers_properties_[name] = accessor;
+  RegisterDerivedProperty(name, kRpcIdentifiersProperty, accessor);
 }
 
 void PropertyStore::RegisterDerivedString(const string& name,
                                           const StringAccessor& accessor) {
-  DCHECK(!Contains(name) || ContainsKey(string_properties_, name))
-      << "(Already registered " << name << ")";
-  string_properties_[name] = accessor;
+  RegisterDerivedProperty(name, kStringProperty, accessor);
 }
 
 void PropertyStore::RegisterDerivedStrings(const string& name,
                                            const StringsAccessor& accessor) {
-  DCHECK(!Contains(name) || ContainsKey(strings_properties_, name))
-      << "(Already registered " << name << ")";
-  strings_properties_[name] = accessor;
+  RegisterDerivedProperty(name, kStringsProperty, accessor);
 }
 
 void PropertyStore::RegisterDerivedStringmap(const string& name,
                                              const StringmapAccessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(stringmap_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmap_properties_[name] = acc;
+  RegisterDerivedProperty(name, kStringmapProperty, acc);
 }
 
 void PropertyStore::RegisterDerivedStringmaps(const string& name,
                                               const StringmapsAccessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(stringmaps_properties_, name))
-      << "(Already registered " << name << ")";
-  stringmaps_properties_[name] = acc;
+  RegisterDerivedProperty(name, kStringmapsProperty, acc);
 }
 
 void PropertyStore::RegisterDerivedUint16(const string& name,
                                           const Uint16Accessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(uint16_properties_, name))
-      << "(Already registered " << name << ")";
-  uint16_properties_[name] = acc;
+  RegisterDerivedProperty(name, kUint16Property, acc);
 }
 
 void PropertyStore::RegisterDerivedUint64(const string& name,
                                           const Uint64Accessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(uint64_properties_, name))
-      << "(Already registered " << name << ")";
-  uint64_properties_[name] = acc;
+  RegisterDerivedProperty(name, kUint64Property, acc);
 }
 
 void PropertyStore::RegisterDerivedByteArray(const string& name,
                                              const ByteArrayAccessor& acc) {
-  DCHECK(!Contains(name) || ContainsKey(bytearray_properties_, name))
-      << "(Already registered " << name << ")";
-  bytearray_properties_[name] = acc;
+  RegisterDerivedProperty(name, kByteArrayProperty, acc);
 }
 
 // private methods
 
 template <class V>
-bool PropertyStore::GetProperty(
-    const string& name,
-    V* value,
-    Error* error,
-    const map<string, std::shared_ptr<AccessorInterface<V>>>& collection,
-    const string& value_type_english) const {
+bool PropertyStore::GetProperty(const string& name,
+                                V* value,
+                                Error* error,
+                                PropertyType type,
+                                const string& value_type_english) const {
   SLOG(this, 2) << "Getting " << name << " as " << value_type_english
                 << ".";
-  typename map<string, std::shared_ptr<AccessorInterface<V>>>::const_iterator
-      it = collection.find(name);
-  if (it != collection.end()) {
-    V val = it->second->Get(error);
+  const auto it = property_info_.find(name);
+  if (it == property_info_.end()) {
+    error->Populate(
+        Error::kInvalidProperty, "Property " + name + " does not exist.");
+  } else if (it->second.type != type) {
+    error->Populate(
+        Error::kInvalidArguments,
+        "Property " + name + " is not " + value_type_english + ".");
+  } else {
+    V val = GetAccessor<V>(it->second)->Get(error);
     if (error->IsSuccess()) {
       *value = val;
     }
-  } else {
-    if (Contains(name)) {
-      error->Populate(
-          Error::kInvalidArguments,
-          "Property " + name + " is not " + value_type_english + ".");
-    } else {
-      error->Populate(
-          Error::kInvalidProperty, "Property " + name + " does not exist.");
-    }
   }
   return error->IsSuccess();
 }
 
 template <class V>
-bool PropertyStore::SetProperty(
-    const string& name,
-    const V& value,
-    Error* error,
-    map<string, std::shared_ptr<AccessorInterface<V>>>* collection,
-    const string& value_type_english) {
+bool PropertyStore::SetProperty(const string& name,
+                                const V& value,
+                                Error* error,
+                                PropertyType type,
+                                const string& value_type_english) {
   bool ret = false;
   SLOG(this, 2) << "Setting " << name << " as " << value_type_english
                 << ".";
-  if (ContainsKey(*collection, name)) {
-    ret = (*collection)[name]->Set(value, error);
+  auto it = property_info_.find(name);
+  if (it == property_info_.end()) {
+    error->Populate(
+        Error::kInvalidProperty, "Property " + name + " does not exist.");
+  } else if (it->second.type != type) {
+    error->Populate(
+        Error::kInvalidArguments,
+        "Property " + name + " is not " + value_type_english + ".");
+  } else {
+    ret = GetAccessor<V>(it->second)->Set(value, error);
     if (ret) {
+      it->second.generation = ++generation_;
       if (!property_changed_callback_.is_null()) {
         property_changed_callback_.Run(name);
       }
     }
-  } else {
-    if (Contains(name)) {
-      error->Populate(
-          Error::kInvalidArguments,
-          "Property " + name + " is not " + value_type_english + ".");
-    } else {
-      error->Populate(
-          Error::kInvalidProperty, "Property " + name + " does not exist.");
-    }
   }
   return ret;
 }
 
+template <class V>
+void PropertyStore::RegisterProperty(
+    const string& name,
+    PropertyType type,
+    const std::shared_ptr<AccessorInterface<V>>& accessor) {
+  auto it = property_info_.find(name);
+  DCHECK(it == property_info_.end() || it->second.type == type)
+      << "(Already registered " << name << ")";
+  PropertyInfo& info = property_info_[name];
+  info.type = type;
+  info.accessor = accessor;
+  info.generation = ++generation_;
+  info.derived = false;
+  info.derived_value = brillo::Any();
+}
+
+template <class V>
+void PropertyStore::RegisterDerivedProperty(
+    const string& name,
+    PropertyType type,
+    const std::shared_ptr<AccessorInterface<V>>& accessor) {
+  RegisterProperty(name, type, accessor);
+  property_info_[name].derived = true;
+}
+
+template <class V>
+bool PropertyStore::ReadProperty(const PropertyInfo& info, V* value) const {
+  Error error;
+  *value = GetAccessor<V>(info)->Get(&error);
+  return error.IsSuccess();
+}
+
+template <class V>
+ReadablePropertyConstIterator<V> PropertyStore::GetPropertiesIter(
+    PropertyType type) const {
+  // Iteration is rare (mostly diagnostics), so collect the matching
+  // accessors in name order rather than keeping a collection per type.
+  auto collection = std::make_shared<
+      typename ReadablePropertyConstIterator<V>::VAccessorMap>();
+  for (const auto& name_and_info : property_info_) {
+    if (name_and_info.second.type == type) {
+      (*collection)[name_and_info.first] =
+          std::static_pointer_cast<AccessorInterface<V>>(
+              name_and_info.second.accessor);
+    }
+  }
+  return ReadablePropertyConstIterator<V>(collection);
+}
+
 }  // namespace shill
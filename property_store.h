@@ -18,7 +18,9 @@
 #define SHILL_PROPERTY_STORE_H_
 
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <base/callback.h>
@@ -52,6 +54,34 @@ class PropertyStore {
   // (std::map<std::string, brillo::Any>).
   bool GetProperties(brillo::VariantDictionary* out, Error* error) const;
 
+  // Retrieve the readable properties that have been registered or changed
+  // after |generation|, store them in |out|, and set |current_generation|
+  // to the generation to pass to the next call.  A generation that this
+  // store did not hand out, such as 0 or one from before a restart,
+  // retrieves all properties.
+  //
+  // Derived properties are computed on read, so this call reads each of
+  // them and records a change when its value differs from the one it saw
+  // last.  Other changes are tracked when they are made through this store
+  // or recorded with MarkPropertyChanged(); owners that modify the value
+  // backing a property directly must call MarkPropertyChanged() for the
+  // change to be reported.
+  bool GetPropertiesChangedSince(uint64_t generation,
+                                 brillo::VariantDictionary* out,
+                                 uint64_t* current_generation,
+                                 Error* error);
+
+  // Returns the generation of the most recent property registration or
+  // change.  Generations increase monotonically.  Changes of derived
+  // properties are only recorded by GetPropertiesChangedSince().
+  uint64_t generation() const { return generation_; }
+
+  // Records that the value of property |name| has changed.  Changes made
+  // through this PropertyStore are recorded automatically; owners call
+  // this for changes they make directly, such as those that are announced
+  // through a PropertyChanged signal.
+  void MarkPropertyChanged(const std::string& name);
+
   // Methods to allow the getting of properties stored in the referenced
   // |store_| by name. Upon success, these methods return true and return the
   // property value in |value|. Upon failure, they return false and
@@ -268,41 +298,92 @@ class PropertyStore {
                                 const ByteArrayAccessor& accessor);
 
  private:
+  // Identifies the type of the accessor for a property.  Some types share a
+  // C++ representation (e.g. strings and RPC identifiers), so the type is
+  // recorded explicitly rather than derived from the accessor.
+  enum PropertyType {
+    kBoolProperty,
+    kInt16Property,
+    kInt32Property,
+    kKeyValueStoreProperty,
+    kRpcIdentifierProperty,
+    kRpcIdentifiersProperty,
+    kStringProperty,
+    kStringmapProperty,
+    kStringmapsProperty,
+    kStringsProperty,
+    kUint8Property,
+    kByteArrayProperty,
+    kUint16Property,
+    kUint16sProperty,
+    kUint32Property,
+    kUint64Property
+  };
+
+  struct PropertyInfo {
+    PropertyType type;
+    // An AccessorInterface<V> for the C++ type V that matches |type|.
+    std::shared_ptr<void> accessor;
+    // Value of |generation_| when the property was last registered or
+    // changed.
+    uint64_t generation;
+    // True if the property was registered through a RegisterDerived*()
+    // method.
+    bool derived;
+    // For a derived property, the value GetPropertiesChangedSince() read
+    // last.
+    brillo::Any derived_value;
+  };
+
   template <class V>
-  bool GetProperty(
-      const std::string& name,
-      V* value,
-      Error* error,
-      const std::map<std::string,
-                     std::shared_ptr<AccessorInterface<V>>>& collection,
-      const std::string& value_type_english) const;
+  static AccessorInterface<V>* GetAccessor(const PropertyInfo& info) {
+    return static_cast<AccessorInterface<V>*>(info.accessor.get());
+  }
+
+  template <class V>
+  bool GetProperty(const std::string& name,
+                   V* value,
+                   Error* error,
+                   PropertyType type,
+                   const std::string& value_type_english) const;
 
   template <class V>
-  bool SetProperty(
+  bool SetProperty(const std::string& name,
+                   const V& value,
+                   Error* error,
+                   PropertyType type,
+                   const std::string& value_type_english);
+
+  template <class V>
+  void RegisterProperty(const std::string& name,
+                        PropertyType type,
+                        const std::shared_ptr<AccessorInterface<V>>& accessor);
+
+  template <class V>
+  void RegisterDerivedProperty(
       const std::string& name,
-      const V& value,
-      Error* error,
-      std::map<std::string, std::shared_ptr<AccessorInterface<V>>>* collection,
-      const std::string& value_type_english);
-
-  // These are std::maps instead of something cooler because the common
-  // operation is iterating through them and returning all properties.
-  std::map<std::string, BoolAccessor> bool_properties_;
-  std::map<std::string, Int16Accessor> int16_properties_;
-  std::map<std::string, Int32Accessor> int32_properties_;
-  std::map<std::string, KeyValueStoreAccessor> key_value_store_properties_;
-  std::map<std::string, RpcIdentifierAccessor> rpc_identifier_properties_;
-  std::map<std::string, RpcIdentifiersAccessor> rpc_identifiers_properties_;
-  std::map<std::string, StringAccessor> string_properties_;
-  std::map<std::string, StringmapAccessor> stringmap_properties_;
-  std::map<std::string, StringmapsAccessor> stringmaps_properties_;
-  std::map<std::string, StringsAccessor> strings_properties_;
-  std::map<std::string, Uint8Accessor> uint8_properties_;
-  std::map<std::string, ByteArrayAccessor> bytearray_properties_;
-  std::map<std::string, Uint16Accessor> uint16_properties_;
-  std::map<std::string, Uint16sAccessor> uint16s_properties_;
-  std::map<std::string, Uint32Accessor> uint32_properties_;
-  std::map<std::string, Uint64Accessor> uint64_properties_;
+      PropertyType type,
+      const std::shared_ptr<AccessorInterface<V>>& accessor);
+
+  // Reads the property described by |info| into |value|, converted to the
+  // representation used by GetProperties().  Returns false if the property
+  // is not readable.
+  bool GetPropertyAsAny(const PropertyInfo& info, brillo::Any* value) const;
+
+  template <class V>
+  bool ReadProperty(const PropertyInfo& info, V* value) const;
+
+  template <class V>
+  ReadablePropertyConstIterator<V> GetPropertiesIter(PropertyType type) const;
+
+  // Index from property name to its type and accessor, so that every access
+  // to a property is a single hash lookup.
+  std::unordered_map<std::string, PropertyInfo> property_info_;
+  // The first generation of this store.  It is picked at random, so that
+  // generations handed out by an earlier instance are not mistaken for
+  // ones of this store.
+  uint64_t first_generation_;
+  uint64_t generation_;
 
   PropertyChangeCallback property_changed_callback_;
 
@@ -44,6 +44,7 @@ using std::map;
 using std::string;
 using std::vector;
 using ::testing::_;
+using ::testing::Mock;
 using ::testing::Return;
 using ::testing::Values;
 
@@ -286,6 +287,46 @@ TEST_F(PropertyStoreTest, ClearPropertyNonexistent) {
   EXPECT_EQ(Error::kInvalidProperty, error.type());
 }
 
+TEST_F(PropertyStoreTest, ClearByteArrayProperty) {
+  PropertyStore store;
+  Error error;
+  const ByteArray default_value{1, 2, 3};
+  ByteArray bytes = default_value;
+  store.RegisterByteArray("some bytes", &bytes);
+  EXPECT_TRUE(store.SetByteArrayProperty("some bytes", ByteArray{4}, &error));
+
+  EXPECT_TRUE(store.ClearProperty("some bytes", &error));
+  EXPECT_EQ(default_value, bytes);
+}
+
+TEST_F(PropertyStoreTest, AccessPropertyOfWrongType) {
+  PropertyStore store(Bind(&PropertyStoreTest::TestCallback,
+                           Unretained(this)));
+  string value("value");
+  store.RegisterString("some string", &value);
+  EXPECT_TRUE(store.Contains("some string"));
+  EXPECT_FALSE(store.Contains("some other string"));
+
+  EXPECT_CALL(*this, TestCallback(_)).Times(0);
+  {
+    Error error;
+    bool bool_value;
+    EXPECT_FALSE(store.GetBoolProperty("some string", &bool_value, &error));
+    EXPECT_EQ(Error::kInvalidArguments, error.type());
+  }
+  {
+    Error error;
+    EXPECT_FALSE(store.SetUint32Property("some string", 1, &error));
+    EXPECT_EQ(Error::kInvalidArguments, error.type());
+  }
+  {
+    Error error;
+    EXPECT_FALSE(store.SetUint32Property("some other string", 1, &error));
+    EXPECT_EQ(Error::kInvalidProperty, error.type());
+  }
+  EXPECT_EQ("value", value);
+}
+
 // Separate from SetPropertyNonexistent, because
 // SetAnyProperty doesn't support Stringmaps.
 TEST_F(PropertyStoreTest, SetStringmapsProperty) {
@@ -832,4 +873,135 @@ TEST_F(PropertyStoreTest, SetAndGetProperties) {
   EXPECT_EQ(new_uint32_value, result_dict[kUint32Key].Get<uint32_t>());
 }
 
+TEST_F(PropertyStoreTest, GetPropertiesChangedSince) {
+  PropertyStore store;
+  bool bool_value = true;
+  string string_value = "string";
+  uint32_t uint32_value = 32;
+  const uint64_t kInitialGeneration = store.generation();
+  store.RegisterBool("boolp", &bool_value);
+  store.RegisterString("stringp", &string_value);
+  store.RegisterUint32("uint32p", &uint32_value);
+  EXPECT_LT(kInitialGeneration, store.generation());
+
+  // Every registered property is newer than the initial generation.
+  Error error;
+  uint64_t generation = 0;
+  brillo::VariantDictionary all_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      kInitialGeneration, &all_dict, &generation, &error));
+  EXPECT_EQ(3, all_dict.size());
+  EXPECT_EQ(store.generation(), generation);
+
+  // Nothing has changed since the current generation.
+  brillo::VariantDictionary empty_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      generation, &empty_dict, &generation, &error));
+  EXPECT_TRUE(empty_dict.empty());
+
+  // Changes made through the store are tracked.
+  EXPECT_TRUE(store.SetStringProperty("stringp", "new string", &error));
+  EXPECT_LT(generation, store.generation());
+  brillo::VariantDictionary string_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      generation, &string_dict, &generation, &error));
+  ASSERT_EQ(1, string_dict.size());
+  EXPECT_EQ("new string", string_dict["stringp"].Get<string>());
+
+  // Setting a property to its current value is not a change.
+  EXPECT_FALSE(store.SetStringProperty("stringp", "new string", &error));
+  EXPECT_EQ(generation, store.generation());
+
+  // Changes made directly to the backing value are tracked once marked.
+  uint32_value = 33;
+  store.MarkPropertyChanged("uint32p");
+  store.MarkPropertyChanged("nonexistent");
+  brillo::VariantDictionary uint32_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      generation, &uint32_dict, &generation, &error));
+  ASSERT_EQ(1, uint32_dict.size());
+  EXPECT_EQ(33, uint32_dict["uint32p"].Get<uint32_t>());
+}
+
+TEST_F(PropertyStoreTest, GetPropertiesChangedSinceUnknownGeneration) {
+  PropertyStore store;
+  bool bool_value = true;
+  string string_value = "string";
+  store.RegisterBool("boolp", &bool_value);
+  store.RegisterString("stringp", &string_value);
+
+  // Generations that this store did not hand out, such as ones from a
+  // previous instance or from the future, retrieve every property.
+  PropertyStore other_store;
+  other_store.RegisterString("stringp", &string_value);
+  for (uint64_t unknown : {static_cast<uint64_t>(0),
+                           other_store.generation(),
+                           store.generation() + 1}) {
+    if (unknown == store.generation()) {
+      continue;
+    }
+    Error error;
+    uint64_t generation = 0;
+    brillo::VariantDictionary dict;
+    EXPECT_TRUE(
+        store.GetPropertiesChangedSince(unknown, &dict, &generation, &error));
+    EXPECT_EQ(2, dict.size());
+    EXPECT_EQ(store.generation(), generation);
+  }
+}
+
+TEST_F(PropertyStoreTest, GetPropertiesChangedSinceTracksDerived) {
+  PropertyStore store;
+  bool bool_value = true;
+  const char kKey[] = "key";
+  store.RegisterBool("boolp", &bool_value);
+  store.RegisterDerivedKeyValueStore(
+      kKey,
+      KeyValueStoreAccessor(
+          new CustomAccessor<PropertyStoreTest, KeyValueStore>(
+              this, &PropertyStoreTest::GetKeyValueStoreCallback,
+              &PropertyStoreTest::SetKeyValueStoreCallback)));
+
+  // The first read of a derived value is reported as a change.
+  KeyValueStore kvs;
+  kvs.SetString("string", "value");
+  EXPECT_CALL(*this, GetKeyValueStoreCallback(_)).WillRepeatedly(Return(kvs));
+  Error error;
+  uint64_t generation = store.generation();
+  brillo::VariantDictionary dict;
+  EXPECT_TRUE(
+      store.GetPropertiesChangedSince(generation, &dict, &generation, &error));
+  ASSERT_EQ(1, dict.size());
+  EXPECT_EQ(1, dict.count(kKey));
+
+  // A derived value that reads the same as last time is not reported.
+  brillo::VariantDictionary unchanged_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      generation, &unchanged_dict, &generation, &error));
+  EXPECT_TRUE(unchanged_dict.empty());
+  Mock::VerifyAndClearExpectations(this);
+
+  // A derived value that changed without passing through the store is
+  // reported.
+  kvs.SetString("string", "new value");
+  EXPECT_CALL(*this, GetKeyValueStoreCallback(_)).WillRepeatedly(Return(kvs));
+  brillo::VariantDictionary changed_dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(
+      generation, &changed_dict, &generation, &error));
+  ASSERT_EQ(1, changed_dict.size());
+  EXPECT_EQ(1, changed_dict.count(kKey));
+}
+
+TEST_F(PropertyStoreTest, GetPropertiesChangedSinceSkipsWriteOnly) {
+  PropertyStore store;
+  string string_value = "string";
+  store.RegisterWriteOnlyString("stringp", &string_value);
+
+  Error error;
+  uint64_t generation = 0;
+  brillo::VariantDictionary dict;
+  EXPECT_TRUE(store.GetPropertiesChangedSince(0, &dict, &generation, &error));
+  EXPECT_TRUE(dict.empty());
+}
+
 }  // namespace shill
@@ -61,6 +61,11 @@ bool Resolver::SetDNSFromLists(const std::vector<std::string>& dns_servers,
     return ClearDNS();
   }
 
+  return WriteResolvConf(FormatResolvConf(dns_servers, domain_search));
+}
+
+string Resolver::FormatResolvConf(const vector<string>& dns_servers,
+                                  const vector<string>& domain_search) const {
   vector<string> lines;
   vector<string>::const_iterator iter;
   for (iter = dns_servers.begin();
@@ -98,12 +103,7 @@ bool Resolver::SetDNSFromLists(const std::vector<std::string>& dns_servers,
   // Newline at end of file
   lines.push_back("");
 
-  string contents = base::JoinString(lines, "\n");
-
-  SLOG(this, 2) << "Writing DNS out to " << path_.value();
-  int count = base::WriteFile(path_, contents.c_str(), contents.size());
-
-  return count == static_cast<int>(contents.size());
+  return base::JoinString(lines, "\n");
 }
 
 bool Resolver::ClearDNS() {
@@ -111,7 +111,40 @@ bool Resolver::ClearDNS() {
 
   CHECK(!path_.empty());
 
+  written_contents_.clear();
   return base::DeleteFile(path_, false);
 }
 
+bool Resolver::WriteResolvConf(const string& contents) {
+  CHECK(!path_.empty());
+
+  if (contents == written_contents_ && base::PathExists(path_)) {
+    SLOG(this, 2) << "DNS configuration unchanged; not rewriting "
+                  << path_.value();
+    return true;
+  }
+
+  // Write to a temporary file next to |path_| and rename it into place, so
+  // that readers of |path_| always see either the old or the new contents.
+  SLOG(this, 2) << "Writing DNS out to " << path_.value();
+  base::FilePath temp_path = path_.AddExtension("tmp");
+  int count = base::WriteFile(temp_path, contents.c_str(), contents.size());
+  if (count != static_cast<int>(contents.size())) {
+    LOG(ERROR) << "Failed to write " << temp_path.value();
+    base::DeleteFile(temp_path, false);
+    written_contents_.clear();
+    return false;
+  }
+  base::File::Error error;
+  if (!base::ReplaceFile(temp_path, path_, &error)) {
+    LOG(ERROR) << "Failed to replace " << path_.value() << ": "
+               << base::File::ErrorToString(error);
+    base::DeleteFile(temp_path, false);
+    written_contents_.clear();
+    return false;
+  }
+  written_contents_ = contents;
+  return true;
+}
+
 }  // namespace shill
@@ -29,7 +29,9 @@
 namespace shill {
 
 // This provides a static function for dumping the DNS information out
-// of an ipconfig into a "resolv.conf" formatted file.
+// of an ipconfig into a "resolv.conf" formatted file.  The file is
+// replaced atomically, so readers never see a partially written file, and
+// it is only rewritten when its contents would change.
 class Resolver {
  public:
   // The default comma-separated list of search-list prefixes that
@@ -45,7 +47,10 @@ class Resolver {
   // Since this is a singleton, use Resolver::GetInstance()->Foo().
   static Resolver* GetInstance();
 
-  virtual void set_path(const base::FilePath& path) { path_ = path; }
+  virtual void set_path(const base::FilePath& path) {
+    path_ = path;
+    written_contents_.clear();
+  }
 
   // Install domain name service parameters, given a list of
   // DNS servers in |dns_servers|, and a list of DNS search suffixes in
@@ -70,8 +75,19 @@ class Resolver {
   friend struct base::DefaultLazyInstanceTraits<Resolver>;
   friend class ResolverTest;
 
+  // Returns the contents of a resolv.conf for the given parameters.
+  std::string FormatResolvConf(
+      const std::vector<std::string>& dns_servers,
+      const std::vector<std::string>& domain_search) const;
+
+  // Writes |contents| to |path_| by atomically replacing it, unless
+  // |path_| already holds exactly |contents|.
+  bool WriteResolvConf(const std::string& contents);
+
   base::FilePath path_;
   std::vector<std::string> ignored_search_list_;
+  // The contents last written to |path_|, or empty if unknown.
+  std::string written_contents_;
 
   DISALLOW_COPY_AND_ASSIGN(Resolver);
 };
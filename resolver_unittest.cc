@@ -130,4 +130,35 @@ TEST_F(ResolverTest, IgnoredSearchList) {
   EXPECT_TRUE(resolver_->ClearDNS());
 }
 
+TEST_F(ResolverTest, UnchangedContentsNotRewritten) {
+  vector<string> dns_servers;
+  vector<string> domain_search;
+  dns_servers.push_back(kNameServer0);
+  dns_servers.push_back(kNameServer1);
+  domain_search.push_back(kSearchDomain0);
+  domain_search.push_back(kSearchDomain1);
+  EXPECT_TRUE(resolver_->SetDNSFromLists(dns_servers, domain_search));
+  EXPECT_EQ(kExpectedOutput, ReadFile());
+  EXPECT_FALSE(base::PathExists(path_.AddExtension("tmp")));
+
+  // Mark the file so that a rewrite would be visible.
+  const string kMarker("marker");
+  ASSERT_EQ(kMarker.size(),
+            base::WriteFile(path_, kMarker.c_str(), kMarker.size()));
+  EXPECT_TRUE(resolver_->SetDNSFromLists(dns_servers, domain_search));
+  EXPECT_EQ(kMarker, ReadFile());
+
+  // A missing file is always rewritten.
+  ASSERT_TRUE(base::DeleteFile(path_, false));
+  EXPECT_TRUE(resolver_->SetDNSFromLists(dns_servers, domain_search));
+  EXPECT_EQ(kExpectedOutput, ReadFile());
+
+  // Changed contents are rewritten.
+  domain_search.pop_back();
+  EXPECT_TRUE(resolver_->SetDNSFromLists(dns_servers, domain_search));
+  EXPECT_NE(kExpectedOutput, ReadFile());
+
+  EXPECT_TRUE(resolver_->ClearDNS());
+}
+
 }  // namespace shill
@@ -198,33 +198,34 @@ bool RoutingTable::ConfigureRoutes(int interface_index,
 
   IPAddress::Family address_family = ipconfig->properties().address_family;
   const vector<IPConfig::Route>& routes = ipconfig->properties().routes;
+  const vector<IPConfig::ParsedRoute>& parsed_routes =
+      ipconfig->parsed_properties().routes;
+  DCHECK_EQ(routes.size(), parsed_routes.size());
 
-  for (const auto& route : routes) {
+  for (size_t i = 0; i < routes.size() && i < parsed_routes.size(); ++i) {
+    const IPConfig::Route& route = routes[i];
+    const IPConfig::ParsedRoute& parsed_route = parsed_routes[i];
     SLOG(this, 3) << "Installing route:"
                   << " Destination: " << route.host
                   << " Netmask: " << route.netmask
                   << " Gateway: " << route.gateway;
-    IPAddress destination_address(address_family);
     IPAddress source_address(address_family);  // Left as default.
-    IPAddress gateway_address(address_family);
-    if (!destination_address.SetAddressFromString(route.host)) {
+    if (!parsed_route.destination.IsValid()) {
       LOG(ERROR) << "Failed to parse host "
                  << route.host;
       ret = false;
       continue;
     }
-    if (!gateway_address.SetAddressFromString(route.gateway)) {
+    if (!parsed_route.gateway.IsValid()) {
       LOG(ERROR) << "Failed to parse gateway "
                  << route.gateway;
       ret = false;
       continue;
     }
-    destination_address.set_prefix(
-        IPAddress::GetPrefixLengthFromMask(address_family, route.netmask));
     if (!AddRoute(interface_index,
-                  RoutingTableEntry(destination_address,
+                  RoutingTableEntry(parsed_route.destination,
                                     source_address,
-                                    gateway_address,
+                                    parsed_route.gateway,
                                     metric,
                                     RT_SCOPE_UNIVERSE,
                                     false,
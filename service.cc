@@ -1642,6 +1642,10 @@ void Service::NotifyPropertyChanges() {
   property_change_notifier_->UpdatePropertyObservers();
 }
 
+void Service::NotifyPropertyChange(const string& name) {
+  property_change_notifier_->UpdatePropertyObserver(name);
+}
+
 Strings Service::GetDisconnectsProperty(Error* /*error*/) const {
   return disconnects_.ExtractWallClockToStrings();
 }
@@ -383,6 +383,9 @@ class Service : public base::RefCounted<Service> {
     return explicitly_disconnected_;
   }
 
+  // Returns true while a connection requested over RPC is in progress.
+  virtual bool is_in_user_connect() const { return is_in_user_connect_; }
+
   // Return RPC identifier for device that's internal to this service, which is
   // not registered with the manager.
   virtual std::string GetInnerDeviceRpcIdentifier() const { return ""; }
@@ -654,6 +657,9 @@ class Service : public base::RefCounted<Service> {
 
   // Emit property change notifications for all observed properties.
   void NotifyPropertyChanges();
+  // Emit a property change notification for the observed property |name|
+  // if its value has changed, without evaluating any other observers.
+  void NotifyPropertyChange(const std::string& name);
 
  private:
   friend class ActivePassiveOutOfCreditsDetectorTest;
@@ -35,7 +35,7 @@ ServicePropertyChangeNotifier::~ServicePropertyChangeNotifier() {}
 
 void ServicePropertyChangeNotifier::AddBoolPropertyObserver(
     const string& name, BoolAccessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<bool>(
           accessor,
           Bind(&ServicePropertyChangeNotifier::BoolPropertyUpdater,
@@ -45,7 +45,7 @@ void ServicePropertyChangeNotifier::AddBoolPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddUint8PropertyObserver(
     const string& name, Uint8Accessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<uint8_t>(
           accessor,
           Bind(&ServicePropertyChangeNotifier::Uint8PropertyUpdater,
@@ -55,7 +55,7 @@ void ServicePropertyChangeNotifier::AddUint8PropertyObserver(
 
 void ServicePropertyChangeNotifier::AddUint16PropertyObserver(
     const string& name, Uint16Accessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<uint16_t>(
           accessor,
           Bind(&ServicePropertyChangeNotifier::Uint16PropertyUpdater,
@@ -65,7 +65,7 @@ void ServicePropertyChangeNotifier::AddUint16PropertyObserver(
 
 void ServicePropertyChangeNotifier::AddUint16sPropertyObserver(
     const string& name, Uint16sAccessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<Uint16s>(
           accessor,
           Bind(&ServiceAdaptorInterface::EmitUint16sChanged,
@@ -75,7 +75,7 @@ void ServicePropertyChangeNotifier::AddUint16sPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddUintPropertyObserver(
     const string& name, Uint32Accessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<uint32_t>(
           accessor,
           Bind(&ServicePropertyChangeNotifier::Uint32PropertyUpdater,
@@ -85,7 +85,7 @@ void ServicePropertyChangeNotifier::AddUintPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddIntPropertyObserver(
     const string& name, Int32Accessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<int32_t>(
           accessor,
           Bind(&ServicePropertyChangeNotifier::Int32PropertyUpdater,
@@ -95,7 +95,7 @@ void ServicePropertyChangeNotifier::AddIntPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddRpcIdentifierPropertyObserver(
     const string& name, RpcIdentifierAccessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<string>(
           accessor,
           Bind(&ServiceAdaptorInterface::EmitRpcIdentifierChanged,
@@ -105,7 +105,7 @@ void ServicePropertyChangeNotifier::AddRpcIdentifierPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddStringPropertyObserver(
     const string& name, StringAccessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<string>(
           accessor,
           Bind(&ServiceAdaptorInterface::EmitStringChanged,
@@ -115,7 +115,7 @@ void ServicePropertyChangeNotifier::AddStringPropertyObserver(
 
 void ServicePropertyChangeNotifier::AddStringmapPropertyObserver(
     const string& name, StringmapAccessor accessor) {
-  property_observers_.emplace_back(
+  property_observers_[name].reset(
       new PropertyObserver<Stringmap>(
           accessor,
           Bind(&ServiceAdaptorInterface::EmitStringmapChanged,
@@ -124,8 +124,15 @@ void ServicePropertyChangeNotifier::AddStringmapPropertyObserver(
 }
 
 void ServicePropertyChangeNotifier::UpdatePropertyObservers() {
-  for (const auto& observer : property_observers_) {
-    observer->Update();
+  for (const auto& name_and_observer : property_observers_) {
+    name_and_observer.second->Update();
+  }
+}
+
+void ServicePropertyChangeNotifier::UpdatePropertyObserver(const string& name) {
+  auto it = property_observers_.find(name);
+  if (it != property_observers_.end()) {
+    it->second->Update();
   }
 }
 
@@ -17,9 +17,9 @@
 #ifndef SHILL_SERVICE_PROPERTY_CHANGE_NOTIFIER_H_
 #define SHILL_SERVICE_PROPERTY_CHANGE_NOTIFIER_H_
 
+#include <map>
 #include <memory>
 #include <string>
-#include <vector>
 
 #include <base/callback.h>
 #include <base/macros.h>
@@ -59,7 +59,13 @@ class ServicePropertyChangeNotifier {
                                          StringAccessor accessor);
   virtual void AddStringmapPropertyObserver(const std::string& name,
                                             StringmapAccessor accessor);
+  // Compares every observed property with its saved value, and emits
+  // change notifications for those that differ.
   virtual void UpdatePropertyObservers();
+  // Compares only the observed property |name| with its saved value.  Used
+  // when the owner knows which property may have changed, so that the
+  // accessors of unrelated properties are not evaluated.
+  virtual void UpdatePropertyObserver(const std::string& name);
 
  private:
   // Redirects templated calls to a value reference to a by-copy version.
@@ -70,7 +76,8 @@ class ServicePropertyChangeNotifier {
   void Int32PropertyUpdater(const std::string& name, const int32_t& value);
 
   ServiceAdaptorInterface* rpc_adaptor_;
-  std::vector<std::unique_ptr<PropertyObserverInterface>> property_observers_;
+  std::map<std::string, std::unique_ptr<PropertyObserverInterface>>
+      property_observers_;
 
   DISALLOW_COPY_AND_ASSIGN(ServicePropertyChangeNotifier);
 };
@@ -0,0 +1,102 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/service_property_change_notifier.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "shill/accessor_interface.h"
+#include "shill/error.h"
+#include "shill/mock_adaptors.h"
+
+using testing::_;
+using testing::Mock;
+using testing::Return;
+
+namespace shill {
+
+namespace {
+const char kFirstProperty[] = "First";
+const char kSecondProperty[] = "Second";
+}  // namespace
+
+class TestBoolAccessor : public AccessorInterface<bool> {
+ public:
+  MOCK_METHOD1(Clear, void(Error* error));
+  MOCK_METHOD1(Get, bool(Error* error));
+  MOCK_METHOD2(Set, bool(const bool& value, Error* error));
+};
+
+class ServicePropertyChangeNotifierTest : public testing::Test {
+ public:
+  ServicePropertyChangeNotifierTest()
+      : first_accessor_(new TestBoolAccessor()),
+        second_accessor_(new TestBoolAccessor()),
+        first_bool_accessor_(first_accessor_),
+        second_bool_accessor_(second_accessor_),
+        notifier_(&adaptor_) {}
+  virtual ~ServicePropertyChangeNotifierTest() {}
+
+  virtual void SetUp() {
+    EXPECT_CALL(*first_accessor_, Get(_)).WillOnce(Return(false));
+    EXPECT_CALL(*second_accessor_, Get(_)).WillOnce(Return(false));
+    notifier_.AddBoolPropertyObserver(kFirstProperty, first_bool_accessor_);
+    notifier_.AddBoolPropertyObserver(kSecondProperty, second_bool_accessor_);
+    Mock::VerifyAndClearExpectations(first_accessor_);
+    Mock::VerifyAndClearExpectations(second_accessor_);
+  }
+
+ protected:
+  TestBoolAccessor* first_accessor_;
+  TestBoolAccessor* second_accessor_;
+  BoolAccessor first_bool_accessor_;  // Owns |first_accessor_|.
+  BoolAccessor second_bool_accessor_;  // Owns |second_accessor_|.
+  ServiceMockAdaptor adaptor_;
+  ServicePropertyChangeNotifier notifier_;
+};
+
+TEST_F(ServicePropertyChangeNotifierTest, UpdatePropertyObservers) {
+  EXPECT_CALL(*first_accessor_, Get(_)).WillOnce(Return(true));
+  EXPECT_CALL(*second_accessor_, Get(_)).WillOnce(Return(false));
+  EXPECT_CALL(adaptor_, EmitBoolChanged(kFirstProperty, true));
+  EXPECT_CALL(adaptor_, EmitBoolChanged(kSecondProperty, _)).Times(0);
+  notifier_.UpdatePropertyObservers();
+}
+
+TEST_F(ServicePropertyChangeNotifierTest, UpdatePropertyObserver) {
+  // Only the accessor of the named property is evaluated.
+  EXPECT_CALL(*first_accessor_, Get(_)).WillOnce(Return(true));
+  EXPECT_CALL(*second_accessor_, Get(_)).Times(0);
+  EXPECT_CALL(adaptor_, EmitBoolChanged(kFirstProperty, true));
+  notifier_.UpdatePropertyObserver(kFirstProperty);
+  Mock::VerifyAndClearExpectations(first_accessor_);
+  Mock::VerifyAndClearExpectations(second_accessor_);
+  Mock::VerifyAndClearExpectations(&adaptor_);
+
+  // An unchanged value is not signalled again.
+  EXPECT_CALL(*first_accessor_, Get(_)).WillOnce(Return(true));
+  EXPECT_CALL(adaptor_, EmitBoolChanged(_, _)).Times(0);
+  notifier_.UpdatePropertyObserver(kFirstProperty);
+  Mock::VerifyAndClearExpectations(first_accessor_);
+
+  // Unknown properties are ignored.
+  EXPECT_CALL(*first_accessor_, Get(_)).Times(0);
+  EXPECT_CALL(*second_accessor_, Get(_)).Times(0);
+  notifier_.UpdatePropertyObserver("Unknown");
+}
+
+}  // namespace shill
@@ -364,6 +364,7 @@
           'sources': [
             'wifi/callback80211_metrics.cc',
             'wifi/mac80211_monitor.cc',
+            'wifi/roam_scorer.cc',
             'wifi/scan_session.cc',
             'wifi/tdls_manager.cc',
             'wifi/wake_on_wifi.cc',
@@ -441,6 +442,7 @@
         'arp_packet.cc',
         'async_connection.cc',
         'certificate_file.cc',
+        'connect_tracer.cc',
         'connection.cc',
         'connection_diagnostics.cc',
         'connection_health_checker.cc',
@@ -469,6 +471,7 @@
         'dbus/chromeos_third_party_vpn_dbus_adaptor.cc',
         'dbus/chromeos_upstart_proxy.cc',
         'dbus/dbus_service_watcher_factory.cc',
+        'decryption_cache.cc',
         'default_profile.cc',
         'device.cc',
         'device_claimer.cc',
@@ -477,6 +480,7 @@
         'dhcp/dhcp_config.cc',
         'dhcp/dhcp_provider.cc',
         'dhcp/dhcpv4_config.cc',
+        'dns_cache.cc',
         'dns_client.cc',
         'dns_client_factory.cc',
         'dns_server_tester.cc',
@@ -493,6 +497,7 @@
         'geolocation_info.cc',
         'hook_table.cc',
         'http_proxy.cc',
+        'http_proxy_session.cc',
         'http_request.cc',
         'http_url.cc',
         'icmp.cc',
@@ -531,6 +536,7 @@
         'socket_info.cc',
         'socket_info_reader.cc',
         'static_ip_parameters.cc',
+        'storage_worker.cc',
         'store_factory.cc',
         'technology.cc',
         'tethering.cc',
@@ -678,6 +684,7 @@
             'arp_packet_unittest.cc',
             'async_connection_unittest.cc',
             'certificate_file_unittest.cc',
+            'connect_tracer_unittest.cc',
             'connection_diagnostics_unittest.cc',
             'connection_health_checker_unittest.cc',
             'connection_info_reader_unittest.cc',
@@ -692,6 +699,7 @@
             'daemon_task_unittest.cc',
             'dbus/chromeos_dbus_adaptor_unittest.cc',
             'dbus/chromeos_manager_dbus_adaptor_unittest.cc',
+            'decryption_cache_unittest.cc',
             'default_profile_unittest.cc',
             'device_claimer_unittest.cc',
             'device_info_unittest.cc',
@@ -703,6 +711,7 @@
             'dhcp/mock_dhcp_provider.cc',
             'dhcp/mock_dhcp_proxy.cc',
             'dhcp_properties_unittest.cc',
+            'dns_cache_unittest.cc',
             'dns_client_unittest.cc',
             'dns_server_tester_unittest.cc',
             'error_unittest.cc',
@@ -715,6 +724,7 @@
             'file_reader_unittest.cc',
             'hook_table_unittest.cc',
             'http_proxy_unittest.cc',
+            'http_proxy_session_unittest.cc',
             'http_request_unittest.cc',
             'http_url_unittest.cc',
             'icmp_unittest.cc',
@@ -801,6 +811,7 @@
             'routing_table_unittest.cc',
             'rpc_task_unittest.cc',
             'scope_logger_unittest.cc',
+            'service_property_change_notifier_unittest.cc',
             'service_property_change_test.cc',
             'service_under_test.cc',
             'service_unittest.cc',
@@ -809,6 +820,7 @@
             'socket_info_reader_unittest.cc',
             'socket_info_unittest.cc',
             'static_ip_parameters_unittest.cc',
+            'storage_worker_unittest.cc',
             'technology_unittest.cc',
             'testrunner.cc',
             'traffic_monitor_unittest.cc',
@@ -907,12 +919,14 @@
                 'wifi/callback80211_metrics_unittest.cc',
                 'wifi/mac80211_monitor_unittest.cc',
                 'wifi/mock_mac80211_monitor.cc',
+                'wifi/mock_roam_scorer.cc',
                 'wifi/mock_scan_session.cc',
                 'wifi/mock_tdls_manager.cc',
                 'wifi/mock_wake_on_wifi.cc',
                 'wifi/mock_wifi.cc',
                 'wifi/mock_wifi_provider.cc',
                 'wifi/mock_wifi_service.cc',
+                'wifi/roam_scorer_unittest.cc',
                 'wifi/scan_session_unittest.cc',
                 'wifi/tdls_manager_unittest.cc',
                 'wifi/wake_on_wifi_unittest.cc',
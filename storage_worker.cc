@@ -0,0 +1,127 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "shill/storage_worker.h"
+
+#include <base/bind.h>
+#include <base/files/important_file_writer.h>
+#include <base/location.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/task_runner_util.h>
+
+#include "shill/logging.h"
+
+using base::FilePath;
+using std::string;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kStorage;
+static string ObjectID(StorageWorker* s) { return "(storage_worker)"; }
+}
+
+namespace {
+const char kStorageWorkerThreadName[] = "shill_storage";
+}  // namespace
+
+StorageWorker::StorageWorker() : thread_(kStorageWorkerThreadName) {}
+
+StorageWorker::~StorageWorker() {
+  Stop();
+}
+
+bool StorageWorker::Start() {
+  if (thread_.IsRunning()) {
+    return true;
+  }
+  if (!thread_.Start()) {
+    LOG(ERROR) << "Failed to start storage worker thread.";
+    return false;
+  }
+  SLOG(this, 2) << "Storage worker started.";
+  return true;
+}
+
+void StorageWorker::Stop() {
+  if (!thread_.IsRunning()) {
+    return;
+  }
+  // base::Thread::Stop() runs the tasks that are already queued before the
+  // thread exits, so no pending write is lost.
+  thread_.Stop();
+  SLOG(this, 2) << "Storage worker stopped.";
+}
+
+bool StorageWorker::IsRunning() const {
+  return thread_.IsRunning();
+}
+
+void StorageWorker::PostWrite(const FilePath& path,
+                              const string& contents,
+                              const WriteCallback& callback) {
+  SLOG(this, 3) << __func__ << ": " << path.value()
+                << " (" << contents.size() << " bytes)";
+  if (!thread_.IsRunning()) {
+    bool success = WriteFileAtomically(path, contents);
+    if (!callback.is_null()) {
+      callback.Run(success);
+    }
+    return;
+  }
+  if (callback.is_null()) {
+    thread_.task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(base::IgnoreResult(&StorageWorker::WriteFileAtomically),
+                   path, contents));
+    return;
+  }
+  base::PostTaskAndReplyWithResult(
+      thread_.task_runner().get(),
+      FROM_HERE,
+      base::Bind(&StorageWorker::WriteFileAtomically, path, contents),
+      callback);
+}
+
+void StorageWorker::WaitForPendingWrites() {
+  if (!thread_.IsRunning()) {
+    return;
+  }
+  base::WaitableEvent writes_done(false /* manual_reset */,
+                                  false /* initially_signaled */);
+  thread_.task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(&base::WaitableEvent::Signal,
+                 base::Unretained(&writes_done)));
+  writes_done.Wait();
+}
+
+// static
+bool StorageWorker::WriteFileAtomically(const FilePath& path,
+                                        const string& contents) {
+  // ImportantFileWriter creates its temporary file with mkstemp(), which
+  // gives it mode 0600 irrespective of the process umask. We deliberately
+  // do not use ScopedUmask here, since the umask is process-wide and this
+  // function may run concurrently with the main thread.
+  if (!base::ImportantFileWriter::WriteFileAtomically(path, contents)) {
+    LOG(ERROR) << "Failed to write " << path.value();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shill
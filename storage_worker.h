@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#ifndef SHILL_STORAGE_WORKER_H_
+#define SHILL_STORAGE_WORKER_H_
+
+#include <string>
+
+#include <base/callback.h>
+#include <base/files/file_path.h>
+#include <base/macros.h>
+#include <base/threading/thread.h>
+
+namespace shill {
+
+// StorageWorker moves the disk I/O of persistent stores off the main event
+// loop.  Stores serialize an immutable snapshot of their contents on the
+// main thread and hand it to the worker, which writes it out on a dedicated
+// thread.  Writes are performed in the order in which they were posted, so
+// the ordering of successive Flush() calls on a store is preserved.
+// Completion callbacks are run on the thread that posted the write.
+class StorageWorker {
+ public:
+  // Called with true if the file was successfully written.
+  typedef base::Callback<void(bool)> WriteCallback;
+
+  StorageWorker();
+  virtual ~StorageWorker();
+
+  // Starts the worker thread.  Returns true on success.
+  virtual bool Start();
+
+  // Runs all pending writes to completion and stops the worker thread.
+  virtual void Stop();
+
+  virtual bool IsRunning() const;
+
+  // Queues an atomic write of |contents| to |path|.  |callback| is run on
+  // the calling thread's message loop once the write completes.
+  virtual void PostWrite(const base::FilePath& path,
+                         const std::string& contents,
+                         const WriteCallback& callback);
+
+  // Blocks until all writes posted before this call have completed.  This
+  // must be called before synchronously reading, renaming or deleting a file
+  // that may have a pending write.
+  virtual void WaitForPendingWrites();
+
+  // Atomically replaces |path| with |contents|.  The file is created
+  // readable and writable by the owner only.  Returns true on success.
+  static bool WriteFileAtomically(const base::FilePath& path,
+                                  const std::string& contents);
+
+ private:
+  base::Thread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(StorageWorker);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_STORAGE_WORKER_H_
@@ -0,0 +1,118 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "shill/storage_worker.h"
+
+#include <string>
+
+#include <base/bind.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "shill/test_event_dispatcher.h"
+
+using base::FilePath;
+using base::ScopedTempDir;
+using std::string;
+using testing::_;
+using testing::Test;
+
+namespace shill {
+
+class StorageWorkerTest : public Test {
+ public:
+  StorageWorkerTest() {}
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().Append("test-storage-worker");
+  }
+
+  void TearDown() override {
+    worker_.Stop();
+  }
+
+  MOCK_METHOD1(WriteCompleted, void(bool success));
+
+ protected:
+  StorageWorker::WriteCallback GetWriteCallback() {
+    return base::Bind(&StorageWorkerTest::WriteCompleted,
+                      base::Unretained(this));
+  }
+
+  string ReadContents() {
+    string contents;
+    EXPECT_TRUE(base::ReadFileToString(path_, &contents));
+    return contents;
+  }
+
+  EventDispatcherForTest dispatcher_;
+  ScopedTempDir temp_dir_;
+  FilePath path_;
+  StorageWorker worker_;
+};
+
+TEST_F(StorageWorkerTest, WriteWithoutWorkerThreadIsSynchronous) {
+  EXPECT_FALSE(worker_.IsRunning());
+  EXPECT_CALL(*this, WriteCompleted(true));
+  worker_.PostWrite(path_, "contents", GetWriteCallback());
+  EXPECT_EQ("contents", ReadContents());
+}
+
+TEST_F(StorageWorkerTest, WriteOnWorkerThread) {
+  ASSERT_TRUE(worker_.Start());
+  EXPECT_TRUE(worker_.IsRunning());
+  EXPECT_CALL(*this, WriteCompleted(_)).Times(0);
+  worker_.PostWrite(path_, "contents", GetWriteCallback());
+  worker_.WaitForPendingWrites();
+  EXPECT_EQ("contents", ReadContents());
+  testing::Mock::VerifyAndClearExpectations(this);
+
+  // The completion callback runs on the thread that posted the write.
+  EXPECT_CALL(*this, WriteCompleted(true));
+  dispatcher_.DispatchPendingEvents();
+}
+
+TEST_F(StorageWorkerTest, WritesAreOrdered) {
+  ASSERT_TRUE(worker_.Start());
+  worker_.PostWrite(path_, "first", StorageWorker::WriteCallback());
+  worker_.PostWrite(path_, "second", StorageWorker::WriteCallback());
+  worker_.PostWrite(path_, "third", StorageWorker::WriteCallback());
+  worker_.WaitForPendingWrites();
+  EXPECT_EQ("third", ReadContents());
+}
+
+TEST_F(StorageWorkerTest, StopCompletesPendingWrites) {
+  ASSERT_TRUE(worker_.Start());
+  worker_.PostWrite(path_, "contents", StorageWorker::WriteCallback());
+  worker_.Stop();
+  EXPECT_FALSE(worker_.IsRunning());
+  EXPECT_EQ("contents", ReadContents());
+}
+
+TEST_F(StorageWorkerTest, WriteFailure) {
+  ASSERT_TRUE(worker_.Start());
+  worker_.PostWrite(temp_dir_.path().Append("missing").Append("file"),
+                    "contents", GetWriteCallback());
+  worker_.WaitForPendingWrites();
+  EXPECT_CALL(*this, WriteCompleted(false));
+  dispatcher_.DispatchPendingEvents();
+}
+
+}  // namespace shill
@@ -21,6 +21,7 @@
 #else
 #include "shill/key_file_store.h"
 #endif  // ENABLE_JSON_STORE
+#include "shill/storage_worker.h"
 
 namespace shill {
 
@@ -40,10 +41,32 @@ StoreFactory* StoreFactory::GetInstance() {
 
 StoreInterface* StoreFactory::CreateStore(const base::FilePath& path) {
 #if defined(ENABLE_JSON_STORE)
-  return new JsonStore(path);
+  JsonStore* store = new JsonStore(path);
 #else
-  return new KeyFileStore(path);
+  KeyFileStore* store = new KeyFileStore(path);
 #endif
+  store->set_storage_worker(storage_worker());
+  return store;
+}
+
+bool StoreFactory::StartStorageWorker() {
+  if (!storage_worker_) {
+    storage_worker_.reset(new StorageWorker());
+  }
+  return storage_worker_->Start();
+}
+
+void StoreFactory::StopStorageWorker() {
+  if (storage_worker_) {
+    storage_worker_->Stop();
+  }
+}
+
+StorageWorker* StoreFactory::storage_worker() const {
+  if (!storage_worker_ || !storage_worker_->IsRunning()) {
+    return nullptr;
+  }
+  return storage_worker_.get();
 }
 
 }  // namespace shill
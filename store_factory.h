@@ -17,6 +17,8 @@
 #ifndef SHILL_STORE_FACTORY_H_
 #define SHILL_STORE_FACTORY_H_
 
+#include <memory>
+
 #include <base/lazy_instance.h>
 
 namespace base {
@@ -25,6 +27,7 @@ class FilePath;
 
 namespace shill {
 
+class StorageWorker;
 class StoreInterface;
 
 class StoreFactory {
@@ -34,12 +37,25 @@ class StoreFactory {
 
   StoreInterface* CreateStore(const base::FilePath& path);
 
+  // Starts a StorageWorker thread.  Stores created after this call write
+  // their contents on that thread instead of blocking the caller.
+  bool StartStorageWorker();
+
+  // Completes all pending writes and stops the StorageWorker thread.  Stores
+  // fall back to synchronous writes once the worker is stopped.
+  void StopStorageWorker();
+
+  // Returns the running StorageWorker, or nullptr if there is none.
+  StorageWorker* storage_worker() const;
+
  protected:
   StoreFactory();
 
  private:
   friend struct base::DefaultLazyInstanceTraits<StoreFactory>;
 
+  std::unique_ptr<StorageWorker> storage_worker_;
+
   DISALLOW_COPY_AND_ASSIGN(StoreFactory);
 };
 
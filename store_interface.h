@@ -47,6 +47,9 @@ class StoreInterface {
   // Flush current in-memory data to disk.
   virtual bool Flush() = 0;
 
+  // Discard any values that GetCryptedString() keeps decrypted in memory.
+  virtual void ClearDecryptionCache() = 0;
+
   // Mark the underlying file store as corrupted, moving the data file
   // to a new filename.  This will prevent the file from being re-opened
   // the next time Open() is called.
@@ -16,9 +16,10 @@
 
 #include "shill/tethering.h"
 
+#include <algorithm>
+
 #include <base/macros.h>
 
-using std::set;
 using std::vector;
 
 namespace shill {
@@ -44,8 +45,8 @@ bool Tethering::IsLocallyAdministeredBSSID(const vector<uint8_t>& bssid) {
 }
 
 // static
-bool Tethering::HasIosOui(const set<uint32_t>& oui_set) {
-  return oui_set.find(kIosOui) != oui_set.end();
+bool Tethering::HasIosOui(const uint32_t* begin, const uint32_t* end) {
+  return std::find(begin, end, kIosOui) != end;
 }
 
 }  // namespace shill
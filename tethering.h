@@ -19,7 +19,6 @@
 
 #include <stdint.h>
 
-#include <set>
 #include <vector>
 
 namespace shill {
@@ -50,8 +49,8 @@ class Tethering {
   static bool IsLocallyAdministeredBSSID(const std::vector<uint8_t>& bssid);
 
   // Returns whether any of the organizationally unique identifiers in
-  // |oui_set| is commonly associated with IOS devices.
-  static bool HasIosOui(const std::set<uint32_t>& oui_set);
+  // [|begin|, |end|) is commonly associated with IOS devices.
+  static bool HasIosOui(const uint32_t* begin, const uint32_t* end);
 };
 
 }  // namespace shill
@@ -0,0 +1,51 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SHILL_WIFI_MOCK_ROAM_SCORER_H_
+#define SHILL_WIFI_MOCK_ROAM_SCORER_H_
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "shill/wifi/roam_scorer.h"
+
+namespace shill {
+
+class MockRoamScorer : public RoamScorer {
+ public:
+  MockRoamScorer();
+  ~MockRoamScorer() override;
+
+  MOCK_METHOD1(RecordSignal, void(const WiFiEndpointConstRefPtr& endpoint));
+  MOCK_METHOD1(ForgetSignal, void(const std::string& bssid));
+  MOCK_METHOD1(RecordFailure, void(const std::string& bssid));
+  MOCK_METHOD2(RecordRoam, void(const std::string& from_bssid,
+                                const std::string& to_bssid));
+  MOCK_METHOD1(IsDegrading, bool(const WiFiEndpointConstRefPtr& endpoint));
+  MOCK_METHOD2(SelectRoamCandidate,
+               WiFiEndpointConstRefPtr(
+                   const WiFiEndpointConstRefPtr& current,
+                   const std::vector<WiFiEndpointConstRefPtr>& candidates));
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MockRoamScorer);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_WIFI_MOCK_ROAM_SCORER_H_
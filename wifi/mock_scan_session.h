@@ -49,6 +49,7 @@ class MockScanSession : public ScanSession {
   MOCK_CONST_METHOD0(HasMoreFrequencies, bool());
   MOCK_METHOD1(AddSsid, void(const ByteString& ssid));
   MOCK_METHOD0(InitiateScan, void());
+  MOCK_METHOD0(ReportCandidateFound, void());
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockScanSession);
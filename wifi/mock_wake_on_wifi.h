@@ -34,9 +34,10 @@ class MockWakeOnWiFi : public WakeOnWiFi {
   ~MockWakeOnWiFi() override;
 
   MOCK_METHOD0(OnAfterResume, void());
-  MOCK_METHOD7(OnBeforeSuspend,
+  MOCK_METHOD8(OnBeforeSuspend,
                void(bool is_connected,
                     const std::vector<ByteString>& ssid_whitelist,
+                    const WiFi::FreqSet& dark_resume_scan_freqs,
                     const ResultCallback& done_callback,
                     const base::Closure& renew_dhcp_lease_callback,
                     const base::Closure& remove_supplicant_networks_callback,
@@ -59,6 +59,8 @@ class MockWiFi : public WiFi {
   MOCK_CONST_METHOD0(IsIdle, bool());
   MOCK_METHOD1(NotifyEndpointChanged,
                void(const WiFiEndpointConstRefPtr& endpoint));
+  MOCK_METHOD1(NotifyEndpointSignalChanged,
+               void(const WiFiEndpointConstRefPtr& endpoint));
   MOCK_METHOD1(DestroyIPConfigLease, void(const std::string&));
   MOCK_CONST_METHOD0(IsConnectedViaTether, bool());
 
@@ -17,6 +17,9 @@
 #ifndef SHILL_WIFI_MOCK_WIFI_PROVIDER_H_
 #define SHILL_WIFI_MOCK_WIFI_PROVIDER_H_
 
+#include <set>
+#include <string>
+
 #include <gmock/gmock.h>
 
 #include "shill/wifi/wifi_endpoint.h"
@@ -46,12 +49,23 @@ class MockWiFiProvider : public WiFiProvider {
                WiFiServiceRefPtr(const WiFiEndpointConstRefPtr& endpoint));
   MOCK_METHOD1(OnEndpointUpdated,
                void(const WiFiEndpointConstRefPtr& endpoint));
+  MOCK_METHOD1(OnEndpointSignalChanged,
+               void(const WiFiEndpointConstRefPtr& endpoint));
   MOCK_METHOD1(OnServiceUnloaded, bool(const WiFiServiceRefPtr& service));
   MOCK_METHOD0(GetHiddenSSIDList, ByteArrays());
   MOCK_METHOD1(LoadAndFixupServiceEntries, void(Profile* storage));
   MOCK_CONST_METHOD1(Save, bool(StoreInterface* storage));
   MOCK_METHOD1(IncrementConnectCount, void(uint16_t frequency));
   MOCK_METHOD0(NumAutoConnectableServices, int());
+  MOCK_METHOD3(RegisterScanDevice,
+               void(const WiFi* wifi,
+                    const std::string& phy_name,
+                    const std::set<uint16_t>& frequencies));
+  MOCK_METHOD1(DeregisterScanDevice, void(const WiFi* wifi));
+  MOCK_METHOD0(StartScanFanOut, void());
+  MOCK_METHOD2(JoinScanFanOut,
+               bool(const WiFi* wifi, const ScanPartitionCallback& callback));
+  MOCK_METHOD0(FinishScanFanOut, void());
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockWiFiProvider);
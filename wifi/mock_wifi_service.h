@@ -56,6 +56,8 @@ class MockWiFiService : public WiFiService {
                void(const WiFiEndpointConstRefPtr& endpoint));
   MOCK_METHOD1(NotifyEndpointUpdated,
                void(const WiFiEndpointConstRefPtr& endpoint));
+  MOCK_METHOD1(NotifyEndpointSignalChanged,
+               void(const WiFiEndpointConstRefPtr& endpoint));
   MOCK_METHOD3(DisconnectWithFailure,
                void(ConnectFailure failure, Error* error, const char* reason));
   MOCK_METHOD1(IsActive, bool(Error* error));
@@ -68,6 +70,7 @@ class MockWiFiService : public WiFiService {
   MOCK_CONST_METHOD0(GetSupplicantConfigurationParameters, KeyValueStore());
   MOCK_CONST_METHOD1(IsAutoConnectable, bool(const char** reason));
   MOCK_CONST_METHOD0(HasStaticIPAddress, bool());
+  MOCK_CONST_METHOD0(is_in_user_connect, bool());
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MockWiFiService);
@@ -0,0 +1,238 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/wifi/roam_scorer.h"
+
+#include <algorithm>
+
+#include "shill/logging.h"
+#include "shill/net/shill_time.h"
+#include "shill/wifi/wifi_endpoint.h"
+
+using std::string;
+using std::vector;
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kWiFi;
+static string ObjectID(RoamScorer* r) { return "(roam_scorer)"; }
+}
+
+// Signal samples older than this do not contribute to the mean or trend.
+const int RoamScorer::kSignalWindowSeconds = 30;
+const size_t RoamScorer::kMaxSignalSamples = 10;
+// How far ahead the signal trend is projected.
+const int RoamScorer::kTrendHorizonSeconds = 10;
+const int RoamScorer::kMaxTrendAdjustmentDb = 10;
+const int RoamScorer::kDegradedSignalDbm = -70;
+// Anything above the 2.4 GHz band.
+const uint16_t RoamScorer::kMin5GHzFrequency = 3000;
+const int RoamScorer::kBand5GHzBonusDb = 5;
+// Penalty for a fully loaded channel; lighter loads scale linearly.
+const int RoamScorer::kMaxChannelLoadPenaltyDb = 10;
+const int RoamScorer::kFailureWindowSeconds = 300;
+const int RoamScorer::kFailurePenaltyDb = 10;
+const size_t RoamScorer::kMaxFailures = 3;
+// A BSS we roamed away from is penalized for this long, so that two BSSes
+// of similar quality do not trade places on every scan.
+const int RoamScorer::kRoamBackoffSeconds = 60;
+const int RoamScorer::kRoamBackoffPenaltyDb = 15;
+const int RoamScorer::kRoamHysteresisDb = 8;
+
+RoamScorer::RoamScorer(Time* time) : time_(time) {}
+
+RoamScorer::~RoamScorer() {}
+
+void RoamScorer::RecordSignal(const WiFiEndpointConstRefPtr& endpoint) {
+  time_t now;
+  if (!time_->GetSecondsMonotonic(&now)) {
+    return;
+  }
+  BSSHistory& history = history_by_bssid_[endpoint->bssid_string()];
+  history.signal_samples.push_back({now, endpoint->signal_strength()});
+  if (history.signal_samples.size() > kMaxSignalSamples) {
+    history.signal_samples.pop_front();
+  }
+}
+
+void RoamScorer::ForgetSignal(const string& bssid) {
+  auto it = history_by_bssid_.find(bssid);
+  if (it == history_by_bssid_.end()) {
+    return;
+  }
+  it->second.signal_samples.clear();
+  if (it->second.failures.empty() && !it->second.left_at) {
+    history_by_bssid_.erase(it);
+  }
+}
+
+void RoamScorer::RecordFailure(const string& bssid) {
+  time_t now;
+  if (!time_->GetSecondsMonotonic(&now)) {
+    return;
+  }
+  SLOG(this, 2) << __func__ << ": " << bssid;
+  BSSHistory& history = history_by_bssid_[bssid];
+  history.failures.push_back(now);
+  if (history.failures.size() > kMaxFailures) {
+    history.failures.pop_front();
+  }
+}
+
+void RoamScorer::RecordRoam(const string& from_bssid, const string& to_bssid) {
+  time_t now;
+  if (from_bssid.empty() || from_bssid == to_bssid ||
+      !time_->GetSecondsMonotonic(&now)) {
+    return;
+  }
+  history_by_bssid_[from_bssid].left_at = now;
+}
+
+bool RoamScorer::IsDegrading(const WiFiEndpointConstRefPtr& endpoint) {
+  time_t now;
+  BSSHistory* history = nullptr;
+  if (time_->GetSecondsMonotonic(&now)) {
+    history = FindHistory(endpoint->bssid_string(), now);
+  }
+  return ProjectedSignal(endpoint, history) < kDegradedSignalDbm;
+}
+
+WiFiEndpointConstRefPtr RoamScorer::SelectRoamCandidate(
+    const WiFiEndpointConstRefPtr& current,
+    const vector<WiFiEndpointConstRefPtr>& candidates) {
+  time_t now;
+  if (!time_->GetSecondsMonotonic(&now)) {
+    return nullptr;
+  }
+  const int current_score = Score(current);
+  WiFiEndpointConstRefPtr best;
+  int best_score = current_score + kRoamHysteresisDb - 1;
+  for (const auto& candidate : candidates) {
+    if (candidate->bssid_string() == current->bssid_string()) {
+      continue;
+    }
+    // Supplicant may still hold a BSS from an earlier scan.  Its signal
+    // strength is as old as that scan, so it is not worth roaming to.
+    const BSSHistory* history = FindHistory(candidate->bssid_string(), now);
+    if (!history || history->signal_samples.empty()) {
+      continue;
+    }
+    int score = Score(candidate);
+    if (score > best_score) {
+      best = candidate;
+      best_score = score;
+    }
+  }
+  if (best) {
+    SLOG(this, 2) << __func__ << ": " << best->bssid_string() << " scores "
+                  << best_score << " against " << current_score << " for "
+                  << current->bssid_string();
+  }
+  return best;
+}
+
+int RoamScorer::Score(const WiFiEndpointConstRefPtr& endpoint) {
+  time_t now;
+  BSSHistory* history = nullptr;
+  if (time_->GetSecondsMonotonic(&now)) {
+    history = FindHistory(endpoint->bssid_string(), now);
+  }
+  int score = ProjectedSignal(endpoint, history);
+  if (endpoint->frequency() >= kMin5GHzFrequency) {
+    score += kBand5GHzBonusDb;
+  }
+  int channel_utilization = endpoint->channel_utilization();
+  if (channel_utilization >= 0) {
+    score -= channel_utilization * kMaxChannelLoadPenaltyDb / 255;
+  }
+  if (history) {
+    score -= static_cast<int>(history->failures.size()) * kFailurePenaltyDb;
+    if (history->left_at) {
+      score -= kRoamBackoffPenaltyDb;
+    }
+  }
+  return score;
+}
+
+// static
+bool RoamScorer::ExpireHistory(time_t now, BSSHistory* history) {
+  while (!history->signal_samples.empty() &&
+         now - history->signal_samples.front().time > kSignalWindowSeconds) {
+    history->signal_samples.pop_front();
+  }
+  while (!history->failures.empty() &&
+         now - history->failures.front() > kFailureWindowSeconds) {
+    history->failures.pop_front();
+  }
+  if (history->left_at && now - history->left_at > kRoamBackoffSeconds) {
+    history->left_at = 0;
+  }
+  return history->signal_samples.empty() && history->failures.empty() &&
+      !history->left_at;
+}
+
+// static
+int RoamScorer::ProjectedSignal(const WiFiEndpointConstRefPtr& endpoint,
+                                const BSSHistory* history) {
+  if (!history || history->signal_samples.empty()) {
+    return endpoint->signal_strength();
+  }
+
+  // Least-squares fit of signal against time, with time measured from the
+  // oldest sample.
+  const time_t origin = history->signal_samples.front().time;
+  double mean_time = 0;
+  double mean_signal = 0;
+  for (const auto& sample : history->signal_samples) {
+    mean_time += sample.time - origin;
+    mean_signal += sample.signal;
+  }
+  mean_time /= history->signal_samples.size();
+  mean_signal /= history->signal_samples.size();
+  double covariance = 0;
+  double variance = 0;
+  for (const auto& sample : history->signal_samples) {
+    double time_delta = (sample.time - origin) - mean_time;
+    covariance += time_delta * (sample.signal - mean_signal);
+    variance += time_delta * time_delta;
+  }
+  double adjustment = 0;
+  if (variance > 0) {
+    const double projection_time =
+        (history->signal_samples.back().time - origin) + kTrendHorizonSeconds;
+    adjustment = covariance / variance * (projection_time - mean_time);
+    adjustment = std::max<double>(-kMaxTrendAdjustmentDb,
+                                  std::min<double>(kMaxTrendAdjustmentDb,
+                                                   adjustment));
+  }
+  return static_cast<int>(mean_signal + adjustment);
+}
+
+RoamScorer::BSSHistory* RoamScorer::FindHistory(const string& bssid,
+                                                time_t now) {
+  auto it = history_by_bssid_.find(bssid);
+  if (it == history_by_bssid_.end()) {
+    return nullptr;
+  }
+  if (ExpireHistory(now, &it->second)) {
+    history_by_bssid_.erase(it);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+}  // namespace shill
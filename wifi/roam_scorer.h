@@ -0,0 +1,124 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SHILL_WIFI_ROAM_SCORER_H_
+#define SHILL_WIFI_ROAM_SCORER_H_
+
+#include <time.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <base/macros.h>
+
+#include "shill/refptr_types.h"
+
+namespace shill {
+
+class Time;
+
+// RoamScorer ranks the endpoints of the connected service as roam
+// candidates.  Scores are in dB-like units: the recent signal of an
+// endpoint, projected along its trend, adjusted for band, advertised
+// channel load, recent failures on the BSSID, and recent roams away from
+// it.  All state is keyed by BSSID, so it survives supplicant removing and
+// re-adding a BSS.
+class RoamScorer {
+ public:
+  explicit RoamScorer(Time* time);
+  virtual ~RoamScorer();
+
+  // Records the current signal strength of |endpoint|.
+  virtual void RecordSignal(const WiFiEndpointConstRefPtr& endpoint);
+  // Forgets the signal history of |bssid|, which is no longer visible.
+  virtual void ForgetSignal(const std::string& bssid);
+  // Records a failed connection to, or an unexpected disconnection from,
+  // |bssid|.
+  virtual void RecordFailure(const std::string& bssid);
+  // Records that we moved from |from_bssid|, which may be empty, to
+  // |to_bssid|.
+  virtual void RecordRoam(const std::string& from_bssid,
+                          const std::string& to_bssid);
+
+  // Returns true if the signal of |endpoint| is weak, or falling fast
+  // enough to become weak within kTrendHorizonSeconds.
+  virtual bool IsDegrading(const WiFiEndpointConstRefPtr& endpoint);
+  // Returns the member of |candidates| with the best score, if that score
+  // beats the score of |current| by at least kRoamHysteresisDb.  Only
+  // candidates whose signal was recorded within kSignalWindowSeconds are
+  // considered.  Returns nullptr otherwise.
+  virtual WiFiEndpointConstRefPtr SelectRoamCandidate(
+      const WiFiEndpointConstRefPtr& current,
+      const std::vector<WiFiEndpointConstRefPtr>& candidates);
+
+  // Returns the score of |endpoint|.  Higher is better.
+  int Score(const WiFiEndpointConstRefPtr& endpoint);
+
+ private:
+  friend class RoamScorerTest;
+
+  struct SignalSample {
+    time_t time;
+    int16_t signal;
+  };
+
+  struct BSSHistory {
+    BSSHistory() : left_at(0) {}
+
+    std::deque<SignalSample> signal_samples;
+    std::deque<time_t> failures;
+    // When we last roamed away from this BSS, or 0 if we never did.
+    time_t left_at;
+  };
+
+  static const int kSignalWindowSeconds;
+  static const size_t kMaxSignalSamples;
+  static const int kTrendHorizonSeconds;
+  static const int kMaxTrendAdjustmentDb;
+  static const int kDegradedSignalDbm;
+  static const uint16_t kMin5GHzFrequency;
+  static const int kBand5GHzBonusDb;
+  static const int kMaxChannelLoadPenaltyDb;
+  static const int kFailureWindowSeconds;
+  static const int kFailurePenaltyDb;
+  static const size_t kMaxFailures;
+  static const int kRoamBackoffSeconds;
+  static const int kRoamBackoffPenaltyDb;
+  static const int kRoamHysteresisDb;
+
+  // Drops the parts of |history| that are older than their windows as of
+  // |now|.  Returns true if nothing is left.
+  static bool ExpireHistory(time_t now, BSSHistory* history);
+  // Returns the mean signal of |history|, moved along its trend by up to
+  // kMaxTrendAdjustmentDb.  Falls back to the signal of |endpoint| if
+  // |history| has no samples.
+  static int ProjectedSignal(const WiFiEndpointConstRefPtr& endpoint,
+                             const BSSHistory* history);
+
+  // Returns the history of |bssid|, or nullptr if there is none.
+  BSSHistory* FindHistory(const std::string& bssid, time_t now);
+
+  std::map<std::string, BSSHistory> history_by_bssid_;
+  Time* time_;
+
+  DISALLOW_COPY_AND_ASSIGN(RoamScorer);
+};
+
+}  // namespace shill
+
+#endif  // SHILL_WIFI_ROAM_SCORER_H_
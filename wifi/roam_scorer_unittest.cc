@@ -0,0 +1,268 @@
+//
+// Copyright (C) 2016 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "shill/wifi/roam_scorer.h"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "shill/net/mock_time.h"
+#include "shill/supplicant/wpa_supplicant.h"
+#include "shill/wifi/wifi_endpoint.h"
+
+using std::string;
+using std::vector;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace shill {
+
+namespace {
+
+const char kBSSIDA[] = "00:00:00:00:00:0a";
+const char kBSSIDB[] = "00:00:00:00:00:0b";
+const uint16_t kFrequency24GHz = 2412;
+const uint16_t kFrequency5GHz = 5180;
+
+}  // namespace
+
+class RoamScorerTest : public testing::Test {
+ public:
+  RoamScorerTest() : now_(1000), scorer_(&time_) {
+    ON_CALL(time_, GetSecondsMonotonic(_))
+        .WillByDefault(Invoke(this, &RoamScorerTest::GetSecondsMonotonic));
+  }
+
+ protected:
+  // Signal strengths of the two access points of a simulated service at a
+  // given second.
+  struct Step {
+    int16_t signal_a;
+    int16_t signal_b;
+  };
+
+  bool GetSecondsMonotonic(time_t* seconds) {
+    *seconds = now_;
+    return true;
+  }
+
+  WiFiEndpointRefPtr MakeEndpoint(const string& bssid,
+                                  uint16_t frequency,
+                                  int16_t signal_dbm) {
+    return WiFiEndpoint::MakeOpenEndpoint(
+        nullptr, nullptr, "ssid", bssid,
+        WPASupplicant::kNetworkModeInfrastructure, frequency, signal_dbm);
+  }
+
+  void SetChannelUtilization(const WiFiEndpointRefPtr& endpoint,
+                             int channel_utilization) {
+    endpoint->channel_utilization_ = channel_utilization;
+  }
+
+  void RecordSignal(const WiFiEndpointRefPtr& endpoint, int16_t signal_dbm) {
+    endpoint->signal_strength_ = signal_dbm;
+    scorer_.RecordSignal(endpoint);
+  }
+
+  // Plays |steps| one second apart against a station that starts out on
+  // access point A and roams whenever the scorer selects a candidate.
+  // Returns the BSSIDs roamed to, in order.
+  vector<string> Simulate(const vector<Step>& steps) {
+    WiFiEndpointRefPtr endpoint_a =
+        MakeEndpoint(kBSSIDA, kFrequency24GHz, steps.front().signal_a);
+    WiFiEndpointRefPtr endpoint_b =
+        MakeEndpoint(kBSSIDB, kFrequency24GHz, steps.front().signal_b);
+    const vector<WiFiEndpointConstRefPtr> candidates{endpoint_a, endpoint_b};
+    WiFiEndpointConstRefPtr current = endpoint_a;
+    vector<string> roams;
+    for (const auto& step : steps) {
+      RecordSignal(endpoint_a, step.signal_a);
+      RecordSignal(endpoint_b, step.signal_b);
+      WiFiEndpointConstRefPtr candidate =
+          scorer_.SelectRoamCandidate(current, candidates);
+      if (candidate) {
+        scorer_.RecordRoam(current->bssid_string(), candidate->bssid_string());
+        roams.push_back(candidate->bssid_string());
+        current = candidate;
+      }
+      ++now_;
+    }
+    return roams;
+  }
+
+  NiceMock<MockTime> time_;
+  time_t now_;
+  RoamScorer scorer_;
+};
+
+TEST_F(RoamScorerTest, ScoreWithoutHistory) {
+  EXPECT_EQ(-60, scorer_.Score(MakeEndpoint(kBSSIDA, kFrequency24GHz, -60)));
+  // 5 GHz is preferred at equal signal.
+  EXPECT_LT(-60, scorer_.Score(MakeEndpoint(kBSSIDB, kFrequency5GHz, -60)));
+}
+
+TEST_F(RoamScorerTest, ScoreChannelUtilization) {
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(kBSSIDA, kFrequency24GHz, -60);
+  SetChannelUtilization(endpoint, -1);
+  EXPECT_EQ(-60, scorer_.Score(endpoint));
+  SetChannelUtilization(endpoint, 0);
+  EXPECT_EQ(-60, scorer_.Score(endpoint));
+  SetChannelUtilization(endpoint, 128);
+  const int half_loaded_score = scorer_.Score(endpoint);
+  EXPECT_GT(-60, half_loaded_score);
+  SetChannelUtilization(endpoint, 255);
+  EXPECT_GT(half_loaded_score, scorer_.Score(endpoint));
+}
+
+TEST_F(RoamScorerTest, SignalTrend) {
+  WiFiEndpointRefPtr falling = MakeEndpoint(kBSSIDA, kFrequency24GHz, -60);
+  WiFiEndpointRefPtr steady = MakeEndpoint(kBSSIDB, kFrequency24GHz, -66);
+  for (int16_t signal : {-60, -62, -64, -66}) {
+    RecordSignal(falling, signal);
+    RecordSignal(steady, -66);
+    ++now_;
+  }
+  // Both endpoints now report -66 dBm, but only one is getting worse.
+  EXPECT_EQ(-66, scorer_.Score(steady));
+  EXPECT_FALSE(scorer_.IsDegrading(steady));
+  EXPECT_EQ(-73, scorer_.Score(falling));
+  EXPECT_TRUE(scorer_.IsDegrading(falling));
+}
+
+TEST_F(RoamScorerTest, SignalHistoryExpires) {
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(kBSSIDA, kFrequency24GHz, -80);
+  RecordSignal(endpoint, -80);
+  now_ += 60;
+  RecordSignal(endpoint, -50);
+  EXPECT_EQ(-50, scorer_.Score(endpoint));
+}
+
+TEST_F(RoamScorerTest, FailurePenalty) {
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(kBSSIDA, kFrequency24GHz, -60);
+  scorer_.RecordFailure(kBSSIDA);
+  const int one_failure_score = scorer_.Score(endpoint);
+  EXPECT_GT(-60, one_failure_score);
+  scorer_.RecordFailure(kBSSIDA);
+  EXPECT_GT(one_failure_score, scorer_.Score(endpoint));
+
+  // Losing sight of the BSS does not forget its failures...
+  scorer_.ForgetSignal(kBSSIDA);
+  EXPECT_GT(one_failure_score, scorer_.Score(endpoint));
+
+  // ...but time does.
+  now_ += 600;
+  EXPECT_EQ(-60, scorer_.Score(endpoint));
+}
+
+TEST_F(RoamScorerTest, TimeUnavailable) {
+  EXPECT_CALL(time_, GetSecondsMonotonic(_)).WillRepeatedly(Return(false));
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(kBSSIDA, kFrequency24GHz, -60);
+  RecordSignal(endpoint, -80);
+  scorer_.RecordFailure(kBSSIDA);
+  EXPECT_EQ(-80, scorer_.Score(endpoint));
+  EXPECT_TRUE(scorer_.IsDegrading(endpoint));
+}
+
+TEST_F(RoamScorerTest, SelectRoamCandidateHysteresis) {
+  WiFiEndpointRefPtr current = MakeEndpoint(kBSSIDA, kFrequency24GHz, -70);
+  WiFiEndpointRefPtr slightly_better =
+      MakeEndpoint(kBSSIDB, kFrequency24GHz, -66);
+  RecordSignal(slightly_better, -66);
+  EXPECT_FALSE(scorer_.SelectRoamCandidate(current, {slightly_better}));
+
+  WiFiEndpointRefPtr much_better =
+      MakeEndpoint("00:00:00:00:00:0c", kFrequency24GHz, -55);
+  RecordSignal(much_better, -55);
+  EXPECT_EQ(much_better.get(),
+            scorer_.SelectRoamCandidate(
+                current, {current, slightly_better, much_better}).get());
+}
+
+TEST_F(RoamScorerTest, SelectRoamCandidateSkipsStaleSignal) {
+  WiFiEndpointRefPtr current = MakeEndpoint(kBSSIDA, kFrequency24GHz, -75);
+  WiFiEndpointRefPtr candidate = MakeEndpoint(kBSSIDB, kFrequency24GHz, -45);
+
+  // A candidate whose signal was never recorded is not chosen.
+  EXPECT_FALSE(scorer_.SelectRoamCandidate(current, {candidate}));
+
+  RecordSignal(candidate, -45);
+  EXPECT_EQ(candidate.get(),
+            scorer_.SelectRoamCandidate(current, {candidate}).get());
+
+  // Once its last sample is older than the signal window, a strong
+  // candidate that supplicant still reports is not chosen either.
+  now_ += 60;
+  RecordSignal(current, -75);
+  EXPECT_FALSE(scorer_.SelectRoamCandidate(current, {candidate}));
+
+  // Nor is any candidate when the time is unavailable.
+  RecordSignal(candidate, -45);
+  EXPECT_CALL(time_, GetSecondsMonotonic(_)).WillRepeatedly(Return(false));
+  EXPECT_FALSE(scorer_.SelectRoamCandidate(current, {candidate}));
+}
+
+TEST_F(RoamScorerTest, SelectRoamCandidateSteadySignal) {
+  WiFiEndpointRefPtr current = MakeEndpoint(kBSSIDA, kFrequency24GHz, -75);
+  WiFiEndpointRefPtr candidate = MakeEndpoint(kBSSIDB, kFrequency24GHz, -45);
+
+  // A candidate seen by every scan stays eligible even though its signal
+  // never changes.
+  for (int i = 0; i < 5; ++i) {
+    RecordSignal(current, -75);
+    RecordSignal(candidate, -45);
+    EXPECT_EQ(candidate.get(),
+              scorer_.SelectRoamCandidate(current, {candidate}).get());
+    now_ += 20;
+  }
+}
+
+TEST_F(RoamScorerTest, SimulateWalkBetweenAccessPoints) {
+  // Walk from A to B at 1 dB per second; the signals cross at step 30.
+  vector<Step> steps;
+  for (int16_t i = 0; i <= 60; ++i) {
+    steps.push_back({static_cast<int16_t>(-45 - i),
+                     static_cast<int16_t>(-105 + i)});
+  }
+  EXPECT_EQ(vector<string>{kBSSIDB}, Simulate(steps));
+}
+
+TEST_F(RoamScorerTest, SimulateJitterDoesNotRoam) {
+  // Two access points of equal strength, each jittering by 2 dB.
+  vector<Step> steps;
+  for (int i = 0; i < 120; ++i) {
+    const int16_t jitter = (i % 2) ? 2 : -2;
+    steps.push_back({static_cast<int16_t>(-70 + jitter),
+                     static_cast<int16_t>(-70 - jitter)});
+  }
+  EXPECT_TRUE(Simulate(steps).empty());
+}
+
+TEST_F(RoamScorerTest, SimulateSpikeDoesNotPingPong) {
+  // B is clearly better, but A spikes briefly after we roam to B.
+  vector<Step> steps;
+  for (int i = 0; i < 60; ++i) {
+    steps.push_back({static_cast<int16_t>((i >= 10 && i < 16) ? -50 : -75),
+                     -65});
+  }
+  EXPECT_EQ(vector<string>{kBSSIDB}, Simulate(steps));
+}
+
+}  // namespace shill
@@ -77,6 +77,8 @@ ScanSession::ScanSession(
       on_scan_failed_(on_scan_failed),
       scan_tries_left_(kScanRetryCount),
       found_error_(false),
+      scans_initiated_(0),
+      expected_scans_to_candidate_(0.0),
       metrics_(metrics) {
   sort(frequency_list_.begin(), frequency_list_.end(),
        &ScanSession::CompareFrequencyCount);
@@ -100,6 +102,8 @@ ScanSession::ScanSession(
   }
 
   original_frequency_count_ = frequency_list_.size();
+  expected_scans_to_candidate_ = ComputeExpectedScans(
+      frequency_list_, fractions_, min_frequencies_, max_frequencies_);
   ebusy_timer_.Pause();
 }
 
@@ -119,25 +123,22 @@ vector<uint16_t> ScanSession::GetScanFrequencies(float fraction_wanted,
   total_fraction_wanted_ += fraction_wanted;
   float total_connects_wanted = total_fraction_wanted_ * total_connections_;
 
+  size_t frequency_count = CountScanFrequencies(frequency_list_,
+                                                0,
+                                                total_connects_wanted,
+                                                min_frequencies,
+                                                max_frequencies,
+                                                &total_connects_provided_);
   vector<uint16_t> frequencies;
-  WiFiProvider::FrequencyCountList::iterator freq_connect =
-      frequency_list_.begin();
   SLOG(this, 7) << "Scanning for frequencies:";
-  while (freq_connect != frequency_list_.end()) {
-    if (frequencies.size() >= min_frequencies) {
-      if (total_connects_provided_ >= total_connects_wanted)
-        break;
-      if (frequencies.size() >= max_frequencies)
-        break;
-    }
-    uint16_t frequency = freq_connect->frequency;
-    size_t connection_count = freq_connect->connection_count;
-    total_connects_provided_ += connection_count;
+  for (size_t i = 0; i < frequency_count; ++i) {
+    uint16_t frequency = frequency_list_[i].frequency;
     frequencies.push_back(frequency);
-    SLOG(this, 7) << "    freq[" << frequency << "] = " << connection_count;
-
-    freq_connect = frequency_list_.erase(freq_connect);
+    SLOG(this, 7) << "    freq[" << frequency << "] = "
+                  << frequency_list_[i].connection_count;
   }
+  frequency_list_.erase(frequency_list_.begin(),
+                        frequency_list_.begin() + frequency_count);
   return frequencies;
 }
 
@@ -150,9 +151,31 @@ void ScanSession::InitiateScan() {
   current_scan_frequencies_ = GetScanFrequencies(fraction_wanted,
                                                  min_frequencies_,
                                                  max_frequencies_);
+  ++scans_initiated_;
   DoScan(current_scan_frequencies_);
 }
 
+void ScanSession::ReportCandidateFound() {
+  if (!scans_initiated_) {
+    return;
+  }
+  LOG(INFO) << "Progressive scan found a candidate after " << scans_initiated_
+            << " scan(s); expected " << expected_scans_to_candidate_;
+  if (metrics_) {
+    metrics_->SendToUMA(Metrics::kMetricProgressiveScanRequestsToCandidate,
+                        scans_initiated_,
+                        Metrics::kMetricProgressiveScanRequestsMin,
+                        Metrics::kMetricProgressiveScanRequestsMax,
+                        Metrics::kMetricProgressiveScanRequestsNumBuckets);
+    metrics_->SendToUMA(
+        Metrics::kMetricProgressiveScanExpectedRequestsToCandidate,
+        static_cast<int>(expected_scans_to_candidate_ + 0.5),
+        Metrics::kMetricProgressiveScanRequestsMin,
+        Metrics::kMetricProgressiveScanRequestsMax,
+        Metrics::kMetricProgressiveScanRequestsNumBuckets);
+  }
+}
+
 void ScanSession::ReInitiateScan() {
   ebusy_timer_.Pause();
   DoScan(current_scan_frequencies_);
@@ -329,6 +352,70 @@ void ScanSession::AddSsid(const ByteString& ssid) {
   ssids_.insert(ssid);
 }
 
+// static
+size_t ScanSession::CountScanFrequencies(
+    const WiFiProvider::FrequencyCountList& frequencies,
+    size_t first,
+    float connects_wanted,
+    size_t min_frequencies,
+    size_t max_frequencies,
+    size_t* connects_provided) {
+  size_t count = 0;
+  for (size_t i = first; i < frequencies.size(); ++i, ++count) {
+    if (count >= min_frequencies) {
+      if (*connects_provided >= connects_wanted)
+        break;
+      if (count >= max_frequencies)
+        break;
+    }
+    *connects_provided += frequencies[i].connection_count;
+  }
+  return count;
+}
+
+// static
+float ScanSession::ComputeExpectedScans(
+    const WiFiProvider::FrequencyCountList& frequencies,
+    FractionList fractions,
+    size_t min_frequencies,
+    size_t max_frequencies) {
+  size_t total_connections = 0;
+  for (const auto& freq_conn : frequencies) {
+    total_connections += freq_conn.connection_count;
+  }
+  // Without any history, a candidate is as likely on one frequency as on
+  // any other.
+  float total_weight =
+      total_connections ? total_connections : frequencies.size();
+  float total_fraction_wanted = 0.0;
+  size_t connects_provided = 0;
+  size_t scanned = 0;
+  int scan = 0;
+  float expected = 0.0;
+  while (scanned < frequencies.size()) {
+    float fraction_wanted = kAllFrequencies;
+    if (!fractions.empty()) {
+      fraction_wanted = fractions.front();
+      fractions.pop_front();
+    }
+    total_fraction_wanted += fraction_wanted;
+    size_t count = CountScanFrequencies(
+        frequencies, scanned, total_fraction_wanted * total_connections,
+        min_frequencies, max_frequencies, &connects_provided);
+    if (!count) {
+      break;
+    }
+    float weight = 0.0;
+    for (size_t i = scanned; i < scanned + count; ++i) {
+      weight += total_connections ? frequencies[i].connection_count : 1;
+    }
+    ++scan;
+    expected += scan * weight / total_weight;
+    scanned += count;
+  }
+  return expected;
+}
+
 // static
 bool ScanSession::CompareFrequencyCount(
     const WiFiProvider::FrequencyCount& first,
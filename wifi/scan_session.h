@@ -134,6 +134,11 @@ class ScanSession {
   // need to reinitiate a scan.
   virtual void InitiateScan();
 
+  // Called when a scan issued by this session has turned up a candidate to
+  // connect to.  Reports how many scans it took against how many the
+  // frequency history predicted.
+  virtual void ReportCandidateFound();
+
   // Re-issues the previous scan (i.e., it uses the same frequency list as the
   // previous scan).  Other classes may use this when |on_scan_failed| is
   // called.  Called by |OnTriggerScanResponse| when the previous attempt to do
@@ -144,6 +149,7 @@ class ScanSession {
   friend class ScanSessionTest;
   friend class WiFiObjectTest;  // OnTriggerScanResponse.
   FRIEND_TEST(ScanSessionTest, EBusy);
+  FRIEND_TEST(ScanSessionTest, ExpectedScansToCandidate);
   FRIEND_TEST(ScanSessionTest, OnError);
   FRIEND_TEST(ScanSessionTest, OnTriggerScanResponse);
 
@@ -153,6 +159,29 @@ class ScanSession {
   // |on_scan_failed_|.
   static const size_t kScanRetryCount;
 
+  // Returns how many frequencies of |frequencies|, starting at index
+  // |first|, the next scan takes so that |connects_provided| reaches
+  // |connects_wanted|, within |min_frequencies| and |max_frequencies|.
+  // Adds the connection counts of those frequencies to |connects_provided|.
+  static size_t CountScanFrequencies(
+      const WiFiProvider::FrequencyCountList& frequencies,
+      size_t first,
+      float connects_wanted,
+      size_t min_frequencies,
+      size_t max_frequencies,
+      size_t* connects_provided);
+
+  // Returns the number of scans this session is expected to take to find a
+  // candidate.  Plans the scans the way |GetScanFrequencies| will for the
+  // sorted |frequencies| and |fractions|, and takes each scan to find the
+  // candidate with probability equal to the share of the frequency weight
+  // it covers.
+  static float ComputeExpectedScans(
+      const WiFiProvider::FrequencyCountList& frequencies,
+      FractionList fractions,
+      size_t min_frequencies,
+      size_t max_frequencies);
+
   // Assists with sorting the |previous_frequencies| passed to the
   // constructor.
   static bool CompareFrequencyCount(const WiFiProvider::FrequencyCount& first,
@@ -222,6 +251,8 @@ class ScanSession {
 
   // Statistics gathering.
   size_t original_frequency_count_;
+  size_t scans_initiated_;
+  float expected_scans_to_candidate_;
   chromeos_metrics::Timer ebusy_timer_;
   Metrics* metrics_;
 
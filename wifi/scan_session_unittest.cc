@@ -28,6 +28,7 @@
 #include <gtest/gtest.h>
 
 #include "shill/mock_event_dispatcher.h"
+#include "shill/mock_metrics.h"
 #include "shill/net/mock_netlink_manager.h"
 #include "shill/net/netlink_manager.h"
 #include "shill/net/netlink_message_matchers.h"
@@ -36,7 +37,9 @@
 using std::set;
 using std::vector;
 using testing::_;
+using testing::AnyNumber;
 using testing::ContainerEq;
+using testing::Mock;
 using testing::Test;
 
 namespace shill {
@@ -535,4 +538,88 @@ TEST_F(ScanSessionTest, ScanNoHidden) {
   scan_session()->InitiateScan();
 }
 
+TEST_F(ScanSessionTest, ExpectedScansToCandidate) {
+  const size_t kMaxFrequencies = std::numeric_limits<int>::max();
+  WiFiProvider::FrequencyCountList frequencies;
+  frequencies.push_back(WiFiProvider::FrequencyCount(kExpectedFreq5640, 10));
+  frequencies.push_back(WiFiProvider::FrequencyCount(kExpectedFreq5600, 5));
+  frequencies.push_back(WiFiProvider::FrequencyCount(kExpectedFreq5580, 5));
+
+  // With no fractions, the first scan covers everything.
+  EXPECT_FLOAT_EQ(1.0, ScanSession::ComputeExpectedScans(
+      frequencies, ScanSession::FractionList(), 1, kMaxFrequencies));
+
+  // The first half of the weight is on one frequency, the rest on two.
+  ScanSession::FractionList halves(2, 0.5);
+  EXPECT_FLOAT_EQ(1.5, ScanSession::ComputeExpectedScans(
+      frequencies, halves, 1, kMaxFrequencies));
+
+  // A scan covers whole frequencies, so it may cover more than its share.
+  // Here the first scan covers 50% and each of the others 25%.
+  ScanSession::FractionList thirds(3, 1.0 / 3);
+  EXPECT_FLOAT_EQ(1.75, ScanSession::ComputeExpectedScans(
+      frequencies, thirds, 1, kMaxFrequencies));
+
+  // The same plan finds a candidate sooner when the weight is concentrated.
+  frequencies[0].connection_count = 18;
+  frequencies[1].connection_count = 1;
+  frequencies[2].connection_count = 1;
+  EXPECT_FLOAT_EQ(1.1, ScanSession::ComputeExpectedScans(
+      frequencies, halves, 1, kMaxFrequencies));
+
+  // The frequency limits apply: at most one frequency per scan.
+  EXPECT_FLOAT_EQ(1.15, ScanSession::ComputeExpectedScans(
+      frequencies, halves, 1, 1));
+
+  // Without any history every frequency is equally likely, and each scan
+  // takes the minimum number of frequencies.
+  for (auto& freq_conn : frequencies) {
+    freq_conn.connection_count = 0;
+  }
+  frequencies.push_back(WiFiProvider::FrequencyCount(kExpectedFreq5560, 0));
+  EXPECT_FLOAT_EQ(1.5, ScanSession::ComputeExpectedScans(
+      frequencies, halves, 2, kMaxFrequencies));
+}
+
+TEST_F(ScanSessionTest, ReportCandidateFound) {
+  MockMetrics metrics(&dispatcher_);
+  WiFiProvider::FrequencyCountList connected_frequencies(
+      kConnectedFrequencies,
+      kConnectedFrequencies + arraysize(kConnectedFrequencies));
+  ScanSession::FractionList thirds(3, 1.0 / 3);
+  scan_session_.reset(new ScanSession(&netlink_manager_,
+                                      &dispatcher_,
+                                      connected_frequencies,
+                                      set<uint16_t>(),
+                                      0,
+                                      thirds,
+                                      1,
+                                      std::numeric_limits<int>::max(),
+                                      Bind(&ScanSessionTest::OnScanError,
+                                           weak_ptr_factory_.GetWeakPtr()),
+                                      &metrics));
+
+  // Nothing to report before the first scan.
+  EXPECT_CALL(metrics, SendToUMA(_, _, _, _, _)).Times(0);
+  scan_session()->ReportCandidateFound();
+  Mock::VerifyAndClearExpectations(&metrics);
+
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(2);
+  scan_session()->InitiateScan();
+  scan_session()->InitiateScan();
+  EXPECT_CALL(metrics,
+              SendToUMA(Metrics::kMetricProgressiveScanRequestsToCandidate,
+                        2, _, _, _));
+  EXPECT_CALL(
+      metrics,
+      SendToUMA(Metrics::kMetricProgressiveScanExpectedRequestsToCandidate,
+                2, _, _, _));
+  scan_session()->ReportCandidateFound();
+  Mock::VerifyAndClearExpectations(&metrics);
+
+  // The destructor reports EBUSY time.
+  EXPECT_CALL(metrics, SendToUMA(_, _, _, _, _)).Times(AnyNumber());
+  scan_session_.reset();
+}
+
 }  // namespace shill
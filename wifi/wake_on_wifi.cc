@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <linux/nl80211.h>
 #include <stdio.h>
+#include <sys/time.h>
 
 #include <algorithm>
 #include <set>
@@ -97,6 +98,9 @@ WakeOnWiFi::WakeOnWiFi(
       report_metrics_callback_(
           Bind(&WakeOnWiFi::ReportMetrics, base::Unretained(this))),
       num_set_wake_on_packet_retries_(0),
+      nic_settings_verified_(false),
+      nic_net_detect_scan_period_seconds_(0),
+      suspend_actions_started_at_((struct timeval){0}),
       wake_on_wifi_max_patterns_(0),
       wake_on_wifi_max_ssids_(0),
       wiphy_index_(0),
@@ -115,7 +119,10 @@ WakeOnWiFi::WakeOnWiFi(
       last_wake_reason_(kWakeTriggerUnsupported),
       force_wake_to_scan_timer_(false),
       dark_resume_scan_retries_left_(0),
+      dark_resume_planned_scan_(false),
+      dark_resume_started_at_((struct timeval){0}),
       record_wake_reason_callback_(record_wake_reason_callback),
+      time_(Time::GetInstance()),
       weak_ptr_factory_(this) {
   netlink_manager_->AddBroadcastHandler(Bind(
       &WakeOnWiFi::OnWakeupReasonReceived, weak_ptr_factory_.GetWeakPtr()));
@@ -173,11 +180,43 @@ bool WakeOnWiFi::SetWakeOnWiFiFeaturesEnabled(const std::string& enabled,
 
 void WakeOnWiFi::RunAndResetSuspendActionsDoneCallback(const Error& error) {
   if (!suspend_actions_done_callback_.is_null()) {
+    if (timerisset(&suspend_actions_started_at_)) {
+      int elapsed_milliseconds =
+          GetMillisecondsSince(suspend_actions_started_at_);
+      timerclear(&suspend_actions_started_at_);
+      SLOG(this, 2) << __func__ << ": suspend actions took "
+                    << elapsed_milliseconds << " milliseconds";
+      metrics_->SendToUMA(
+          Metrics::kMetricWifiSuspendActionsMilliseconds,
+          elapsed_milliseconds,
+          Metrics::kMetricWifiSuspendActionsMillisecondsMin,
+          Metrics::kMetricWifiSuspendActionsMillisecondsMax,
+          Metrics::kMetricWifiSuspendActionsMillisecondsNumBuckets);
+    }
+    if (timerisset(&dark_resume_started_at_)) {
+      int elapsed_milliseconds = GetMillisecondsSince(dark_resume_started_at_);
+      timerclear(&dark_resume_started_at_);
+      LOG(INFO) << __func__ << ": dark resume actions took "
+                << elapsed_milliseconds << " milliseconds";
+      metrics_->SendToUMA(
+          Metrics::kMetricWifiDarkResumeActionsMilliseconds,
+          elapsed_milliseconds,
+          Metrics::kMetricWifiDarkResumeActionsMillisecondsMin,
+          Metrics::kMetricWifiDarkResumeActionsMillisecondsMax,
+          Metrics::kMetricWifiDarkResumeActionsMillisecondsNumBuckets);
+    }
     suspend_actions_done_callback_.Run(error);
     suspend_actions_done_callback_.Reset();
   }
 }
 
+int WakeOnWiFi::GetMillisecondsSince(const struct timeval& start) {
+  struct timeval now, elapsed;
+  time_->GetTimeMonotonic(&now);
+  timersub(&now, &start, &elapsed);
+  return elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000;
+}
+
 // static
 bool WakeOnWiFi::ByteStringPairIsLessThan(
     const std::pair<ByteString, ByteString>& lhs,
@@ -880,6 +919,8 @@ void WakeOnWiFi::OnWakeOnWiFiSettingsErrorResponse(
           error.Populate(Error::kNotSupported);
         }
       }
+      // The NIC may be left in an unknown state.
+      nic_settings_verified_ = false;
       break;
 
     case NetlinkManager::kUnexpectedResponseType:
@@ -939,6 +980,7 @@ void WakeOnWiFi::VerifyWakeOnWiFiSettings(
                   << "Wake on WiFi settings successfully verified";
     metrics_->NotifyVerifyWakeOnWiFiSettingsResult(
         Metrics::kVerifyWakeOnWiFiSettingsResultSuccess);
+    RecordNICWakeOnWiFiSettings();
     RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
   } else {
     LOG(ERROR) << __func__ << " failed: discrepancy between wake-on-packet "
@@ -946,10 +988,54 @@ void WakeOnWiFi::VerifyWakeOnWiFiSettings(
                               "structure detected";
     metrics_->NotifyVerifyWakeOnWiFiSettingsResult(
         Metrics::kVerifyWakeOnWiFiSettingsResultFailure);
+    nic_settings_verified_ = false;
     RetrySetWakeOnPacketConnections();
   }
 }
 
+bool WakeOnWiFi::NICHasWakeOnWiFiSettings() const {
+  if (!nic_settings_verified_ ||
+      nic_wake_on_wifi_triggers_ != wake_on_wifi_triggers_) {
+    return false;
+  }
+  if (wake_on_wifi_triggers_.find(kWakeTriggerPattern) !=
+      wake_on_wifi_triggers_.end()) {
+    const IPAddressStore::IPAddresses& addresses =
+        wake_on_packet_connections_.GetIPAddresses();
+    if (addresses.size() != nic_wake_on_packet_addresses_.size() ||
+        !std::equal(addresses.begin(), addresses.end(),
+                    nic_wake_on_packet_addresses_.begin(),
+                    [](const IPAddress& lhs, const IPAddress& rhs) {
+                      return lhs.Equals(rhs);
+                    })) {
+      return false;
+    }
+  }
+  if (wake_on_wifi_triggers_.find(kWakeTriggerSSID) !=
+      wake_on_wifi_triggers_.end()) {
+    if (net_detect_scan_period_seconds_ !=
+            nic_net_detect_scan_period_seconds_ ||
+        wake_on_ssid_whitelist_.size() != nic_wake_on_ssid_whitelist_.size() ||
+        !std::equal(wake_on_ssid_whitelist_.begin(),
+                    wake_on_ssid_whitelist_.end(),
+                    nic_wake_on_ssid_whitelist_.begin(),
+                    [](const ByteString& lhs, const ByteString& rhs) {
+                      return lhs.Equals(rhs);
+                    })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void WakeOnWiFi::RecordNICWakeOnWiFiSettings() {
+  nic_settings_verified_ = true;
+  nic_wake_on_wifi_triggers_ = wake_on_wifi_triggers_;
+  nic_wake_on_packet_addresses_ = wake_on_packet_connections_.GetIPAddresses();
+  nic_net_detect_scan_period_seconds_ = net_detect_scan_period_seconds_;
+  nic_wake_on_ssid_whitelist_ = wake_on_ssid_whitelist_;
+}
+
 void WakeOnWiFi::ApplyWakeOnWiFiSettings() {
   SLOG(this, 3) << __func__;
   if (!wiphy_index_received_) {
@@ -961,6 +1047,13 @@ void WakeOnWiFi::ApplyWakeOnWiFiSettings() {
     DisableWakeOnWiFi();
     return;
   }
+  if (NICHasWakeOnWiFiSettings()) {
+    // NL80211_CMD_SET_WOWLAN replaces the NIC's entire wake on WiFi
+    // configuration, so the only delta worth acting on is "no change".
+    SLOG(this, 2) << __func__ << ": NIC already programmed with these settings";
+    RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
+    return;
+  }
 
   Error error;
   SetWakeOnPacketConnMessage set_wowlan_msg;
@@ -973,6 +1066,7 @@ void WakeOnWiFi::ApplyWakeOnWiFiSettings() {
         Error(Error::kOperationFailed, error.message()));
     return;
   }
+  nic_settings_verified_ = false;
   if (!netlink_manager_->SendNl80211Message(
           &set_wowlan_msg,
           Bind(&WakeOnWiFi::OnSetWakeOnPacketConnectionResponse),
@@ -997,6 +1091,12 @@ void WakeOnWiFi::DisableWakeOnWiFi() {
   Error error;
   SetWakeOnPacketConnMessage disable_wowlan_msg;
   CHECK(wiphy_index_received_);
+  if (nic_settings_verified_ && nic_wake_on_wifi_triggers_.empty()) {
+    SLOG(this, 2) << __func__ << ": wake on WiFi already disabled on NIC";
+    wake_on_wifi_triggers_.clear();
+    RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
+    return;
+  }
   if (!ConfigureDisableWakeOnWiFiMessage(&disable_wowlan_msg, wiphy_index_,
                                          &error)) {
     LOG(ERROR) << error.message();
@@ -1005,6 +1105,7 @@ void WakeOnWiFi::DisableWakeOnWiFi() {
     return;
   }
   wake_on_wifi_triggers_.clear();
+  nic_settings_verified_ = false;
   if (!netlink_manager_->SendNl80211Message(
           &disable_wowlan_msg,
           Bind(&WakeOnWiFi::OnSetWakeOnPacketConnectionResponse),
@@ -1238,6 +1339,7 @@ void WakeOnWiFi::OnWakeupReasonReceived(const NetlinkMessage& netlink_message) {
 void WakeOnWiFi::OnBeforeSuspend(
     bool is_connected,
     const vector<ByteString>& ssid_whitelist,
+    const WiFi::FreqSet& dark_resume_scan_freqs,
     const ResultCallback& done_callback,
     const Closure& renew_dhcp_lease_callback,
     const Closure& remove_supplicant_networks_callback, bool have_dhcp_lease,
@@ -1250,7 +1352,10 @@ void WakeOnWiFi::OnBeforeSuspend(
             << wake_on_wifi_features_enabled_;
   suspend_actions_done_callback_ = done_callback;
   wake_on_ssid_whitelist_ = ssid_whitelist;
+  dark_resume_scan_freqs_ = dark_resume_scan_freqs;
   dark_resume_history_.Clear();
+  // Only the suspend actions of a dark resume are timed.
+  timerclear(&dark_resume_started_at_);
   if (have_dhcp_lease && is_connected &&
       time_to_next_lease_renewal < kImmediateDHCPLeaseRenewalThresholdSeconds) {
     // Renew DHCP lease immediately if we have one that is expiring soon.
@@ -1273,6 +1378,9 @@ void WakeOnWiFi::OnAfterResume() {
   SLOG(this, 1) << __func__;
   wake_to_scan_timer_.Stop();
   dhcp_lease_renewal_timer_.Stop();
+  // A dark resume that turns into a full resume never completes its suspend
+  // actions.
+  timerclear(&dark_resume_started_at_);
   if (WakeOnWiFiPacketEnabledAndSupported() ||
       WakeOnWiFiDarkConnectEnabledAndSupported()) {
     // Unconditionally disable wake on WiFi on resume if these features
@@ -1296,7 +1404,9 @@ void WakeOnWiFi::OnDarkResume(
   LOG(INFO) << __func__ << ": "
             << "Wake reason " << last_wake_reason_;
   metrics_->NotifyWakeOnWiFiOnDarkResume(last_wake_reason_);
+  time_->GetTimeMonotonic(&dark_resume_started_at_);
   dark_resume_scan_retries_left_ = 0;
+  dark_resume_planned_scan_ = false;
   suspend_actions_done_callback_ = done_callback;
   wake_on_ssid_whitelist_ = ssid_whitelist;
 
@@ -1399,6 +1509,7 @@ void WakeOnWiFi::BeforeSuspendActions(
   // are already conditionally compiled based on DISABLE_WAKE_ON_WIFI.
 
   metrics_->NotifyBeforeSuspendActions(is_connected, in_dark_resume_);
+  time_->GetTimeMonotonic(&suspend_actions_started_at_);
   last_ssid_match_freqs_.clear();
   last_wake_reason_ = kWakeTriggerUnsupported;
   // Add relevant triggers to be programmed into the NIC.
@@ -1533,6 +1644,14 @@ void WakeOnWiFi::InitiateScanInDarkResume(
     const InitiateScanCallback& initiate_scan_callback,
     const WiFi::FreqSet& freqs) {
   SLOG(this, 3) << __func__;
+  if (freqs.empty() && !dark_resume_scan_freqs_.empty()) {
+    SLOG(this, 3) << __func__ << ": "
+                  << "Scanning " << dark_resume_scan_freqs_.size()
+                  << " frequencies whitelisted SSIDs were last seen on";
+    dark_resume_planned_scan_ = true;
+    initiate_scan_callback.Run(dark_resume_scan_freqs_);
+    return;
+  }
   if (!freqs.empty() && freqs.size() <= kMaxFreqsForDarkResumeScanRetries) {
     SLOG(this, 3) << __func__ << ": "
                   << "Allowing up to " << kMaxDarkResumeScanRetries
@@ -1597,6 +1716,13 @@ void WakeOnWiFi::OnNoAutoConnectableServicesAfterScan(
   if (!in_dark_resume_) {
     return;
   }
+  if (dark_resume_planned_scan_) {
+    dark_resume_planned_scan_ = false;
+    SLOG(this, 3) << __func__ << ": "
+                  << "Nothing found on planned frequencies; scanning all";
+    initiate_scan_callback.Run(WiFi::FreqSet());
+    return;
+  }
   if (dark_resume_scan_retries_left_) {
     --dark_resume_scan_retries_left_;
     SLOG(this, 3) << __func__ << ": "
@@ -1618,6 +1744,8 @@ void WakeOnWiFi::OnNoAutoConnectableServicesAfterScan(
 void WakeOnWiFi::OnWiphyIndexReceived(uint32_t index) {
   wiphy_index_ = index;
   wiphy_index_received_ = true;
+  // Nothing is known about how a newly reported wiphy is programmed.
+  nic_settings_verified_ = false;
 }
 
 void WakeOnWiFi::OnScanStarted(bool is_active_scan) {
@@ -37,6 +37,7 @@
 #include "shill/net/event_history.h"
 #include "shill/net/ip_address.h"
 #include "shill/net/netlink_manager.h"
+#include "shill/net/shill_time.h"
 #include "shill/refptr_types.h"
 #include "shill/wifi/wifi.h"
 
@@ -228,6 +229,10 @@ class WakeOnWiFi {
   //  - |is_connected|: whether the WiFi device is connected.
   //  - |ssid_whitelist|: list of SSIDs that the NIC will be programmed to wake
   //    the system on if the NIC is programmed to wake on SSID.
+  //  - |dark_resume_scan_freqs|: frequencies on which SSIDs in
+  //    |ssid_whitelist| were last seen. Dark resume scans that are not
+  //    restricted to the frequencies of a wake on SSID match cover these
+  //    frequencies first.
   //  - |done_callback|: callback to invoke when suspend  actions have
   //    completed.
   //  - |renew_dhcp_lease_callback|: callback to invoke to initiate DHCP lease
@@ -240,6 +245,7 @@ class WakeOnWiFi {
   virtual void OnBeforeSuspend(
       bool is_connected,
       const std::vector<ByteString>& ssid_whitelist,
+      const WiFi::FreqSet& dark_resume_scan_freqs,
       const ResultCallback& done_callback,
       const base::Closure& renew_dhcp_lease_callback,
       const base::Closure& remove_supplicant_networks_callback,
@@ -359,6 +365,9 @@ class WakeOnWiFi {
   bool SetWakeOnWiFiFeaturesEnabled(const std::string& enabled, Error* error);
   // Helper function to run and reset |suspend_actions_done_callback_|.
   void RunAndResetSuspendActionsDoneCallback(const Error& error);
+  // Returns the number of milliseconds elapsed since |start| on the monotonic
+  // clock.
+  int GetMillisecondsSince(const struct timeval& start);
   // Used for comparison of ByteString pairs in a set.
   static bool ByteStringPairIsLessThan(
       const std::pair<ByteString, ByteString>& lhs,
@@ -457,11 +466,19 @@ class WakeOnWiFi {
   // Sends an NL80211 message to program the NIC with wake on WiFi settings
   // configured in |wake_on_packet_connections_|, |wake_on_ssid_whitelist_|, and
   // |wake_on_wifi_triggers_|. If |wake_on_wifi_triggers_| is empty, calls
-  // WakeOnWiFi::DisableWakeOnWiFi.
+  // WakeOnWiFi::DisableWakeOnWiFi. If the NIC was last verified to hold
+  // exactly these settings, neither programs nor re-verifies the NIC.
   void ApplyWakeOnWiFiSettings();
   // Helper function called by |ApplyWakeOnWiFiSettings| that sends an NL80211
-  // message to program the NIC to disable wake on WiFi.
+  // message to program the NIC to disable wake on WiFi, unless the NIC was
+  // last verified to have wake on WiFi disabled.
   void DisableWakeOnWiFi();
+  // Returns true if the settings last verified to be programmed into the NIC
+  // are equivalent to the locally recorded wake on WiFi settings.
+  bool NICHasWakeOnWiFiSettings() const;
+  // Records the locally recorded wake on WiFi settings as those programmed
+  // into the NIC, after they have been verified.
+  void RecordNICWakeOnWiFiSettings();
   // Calls |ApplyWakeOnWiFiSettings| and counts this call as
   // a retry. If |kMaxSetWakeOnPacketRetries| retries have already been
   // performed, resets counter and returns.
@@ -509,7 +526,9 @@ class WakeOnWiFi {
       AttributeListConstRefPtr results_list);
 
   // Sets the |dark_resume_scan_retries_left_| counter if necessary, then runs
-  // |initiate_scan_callback| with |freqs|.
+  // |initiate_scan_callback| with |freqs|. If |freqs| is empty, scans
+  // |dark_resume_scan_freqs_| instead when that is known, leaving a scan of all
+  // frequencies as the fallback if that scan finds nothing to connect to.
   void InitiateScanInDarkResume(
       const InitiateScanCallback& initiate_scan_callback,
       const WiFi::FreqSet& freqs);
@@ -529,6 +548,18 @@ class WakeOnWiFi {
   base::CancelableClosure report_metrics_callback_;
   // Number of retry attempts to program the NIC's wake-on-packet settings.
   int num_set_wake_on_packet_retries_;
+  // True if the NIC was verified to hold the wake on WiFi settings in
+  // |nic_wake_on_wifi_triggers_|, |nic_wake_on_packet_addresses_|,
+  // |nic_net_detect_scan_period_seconds_| and |nic_wake_on_ssid_whitelist_|,
+  // and has not been programmed since.
+  bool nic_settings_verified_;
+  std::set<WakeOnWiFi::WakeOnWiFiTrigger> nic_wake_on_wifi_triggers_;
+  IPAddressStore::IPAddresses nic_wake_on_packet_addresses_;
+  uint32_t nic_net_detect_scan_period_seconds_;
+  std::vector<ByteString> nic_wake_on_ssid_whitelist_;
+  // Time at which the current round of suspend actions started, or zero if
+  // no suspend actions are outstanding.
+  struct timeval suspend_actions_started_at_;
   // Keeps track of triggers that the NIC will be programmed to wake from
   // while suspended.
   std::set<WakeOnWiFi::WakeOnWiFiTrigger> wake_on_wifi_triggers_;
@@ -580,11 +611,23 @@ class WakeOnWiFi {
   // How many more times to retry the last dark resume scan that shill launched
   // if no auto-connectable services were found.
   int dark_resume_scan_retries_left_;
+  // Frequencies on which whitelisted SSIDs were last seen before the current
+  // suspend. Computed before suspend so that dark resume scans can be limited
+  // to them without further work in the dark resume.
+  WiFi::FreqSet dark_resume_scan_freqs_;
+  // True if the last dark resume scan only covered |dark_resume_scan_freqs_|,
+  // so that all frequencies should be scanned if it finds nothing.
+  bool dark_resume_planned_scan_;
+  // Time at which the current dark resume started, or zero if not in a dark
+  // resume whose actions are outstanding.
+  struct timeval dark_resume_started_at_;
 
   // Callback invoked to report the wake reason for the current dark resume to
   // powerd.
   RecordWakeReasonCallback record_wake_reason_callback_;
 
+  Time* time_;
+
   base::WeakPtrFactory<WakeOnWiFi> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(WakeOnWiFi);
@@ -58,8 +58,11 @@ using std::string;
 using std::vector;
 using testing::_;
 using ::testing::AnyNumber;
+using ::testing::DoAll;
 using ::testing::HasSubstr;
+using ::testing::Mock;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 
 namespace shill {
 
@@ -631,6 +634,7 @@ class WakeOnWiFiTest : public ::testing::Test {
     // whitelisted SSIDs.
     wake_on_wifi_->wake_on_wifi_max_ssids_ = 999;
     wake_on_wifi_->dark_resume_history_.time_ = &time_;
+    wake_on_wifi_->time_ = &time_;
 
     ON_CALL(netlink_manager_, SendNl80211Message(_, _, _, _))
         .WillByDefault(Return(true));
@@ -736,6 +740,10 @@ class WakeOnWiFiTest : public ::testing::Test {
 
   void DisableWakeOnWiFi() { wake_on_wifi_->DisableWakeOnWiFi(); }
 
+  void OnWiphyIndexReceived(uint32_t index) {
+    wake_on_wifi_->OnWiphyIndexReceived(index);
+  }
+
   set<WakeOnWiFi::WakeOnWiFiTrigger>* GetWakeOnWiFiTriggers() {
     return &wake_on_wifi_->wake_on_wifi_triggers_;
   }
@@ -773,6 +781,10 @@ class WakeOnWiFiTest : public ::testing::Test {
     wake_on_wifi_->suspend_actions_done_callback_.Run(error);
   }
 
+  void RunAndResetSuspendActionsDoneCallback(const Error& error) {
+    wake_on_wifi_->RunAndResetSuspendActionsDoneCallback(error);
+  }
+
   int GetNumSetWakeOnPacketRetries() {
     return wake_on_wifi_->num_set_wake_on_packet_retries_;
   }
@@ -783,6 +795,7 @@ class WakeOnWiFiTest : public ::testing::Test {
 
   void OnBeforeSuspend(bool is_connected,
                        const vector<ByteString>& ssid_whitelist,
+                       const WiFi::FreqSet& dark_resume_scan_freqs,
                        bool have_dhcp_lease,
                        uint32_t time_to_next_lease_renewal) {
     ResultCallback done_callback(
@@ -791,7 +804,8 @@ class WakeOnWiFiTest : public ::testing::Test {
         Bind(&WakeOnWiFiTest::RenewDHCPLeaseCallback, Unretained(this)));
     Closure remove_supplicant_networks_callback(Bind(
         &WakeOnWiFiTest::RemoveSupplicantNetworksCallback, Unretained(this)));
-    wake_on_wifi_->OnBeforeSuspend(is_connected, ssid_whitelist, done_callback,
+    wake_on_wifi_->OnBeforeSuspend(is_connected, ssid_whitelist,
+                                   dark_resume_scan_freqs, done_callback,
                                    renew_dhcp_lease_callback,
                                    remove_supplicant_networks_callback,
                                    have_dhcp_lease, time_to_next_lease_renewal);
@@ -1012,6 +1026,10 @@ class WakeOnWiFiTest : public ::testing::Test {
     return wake_on_wifi_->last_ssid_match_freqs_;
   }
 
+  WiFi::FreqSet* GetDarkResumeScanFreqs() {
+    return &wake_on_wifi_->dark_resume_scan_freqs_;
+  }
+
   void AddResultToLastSSIDResults() {
     wake_on_wifi_->last_ssid_match_freqs_.insert(1);
   }
@@ -2039,6 +2057,100 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher, DisableWakeOnWiFi_ClearsTriggers) {
   EXPECT_TRUE(GetWakeOnWiFiTriggers()->empty());
 }
 
+TEST_F(WakeOnWiFiTestWithMockDispatcher,
+       ApplyWakeOnWiFiSettings_SkipsVerifiedSettings) {
+  // Verify that the NIC wakes on packets from 192.168.10.20 and on
+  // disconnects.
+  GetWakeOnPacketConnMessage msg;
+  NetlinkPacket packet(
+      kResponseIPV40WakeOnDisconnect, sizeof(kResponseIPV40WakeOnDisconnect));
+  msg.InitFromPacket(&packet, NetlinkMessage::MessageContext());
+  GetWakeOnPacketConnections()->AddUnique(IPAddress("192.168.10.20"));
+  GetWakeOnWiFiTriggers()->insert(WakeOnWiFi::kWakeTriggerPattern);
+  GetWakeOnWiFiTriggers()->insert(WakeOnWiFi::kWakeTriggerDisconnect);
+  VerifyWakeOnWiFiSettings(msg);
+
+  // Neither program nor verify the NIC again if the settings are unchanged.
+  SetSuspendActionsDoneCallback();
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(0);
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(0);
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess))).Times(1);
+  ApplyWakeOnWiFiSettings();
+  EXPECT_TRUE(SuspendActionsCallbackIsNull());
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Program and verify the NIC if the settings differ.
+  GetWakeOnPacketConnections()->AddUnique(IPAddress("1.1.1.1"));
+  SetSuspendActionsDoneCallback();
+  EXPECT_CALL(
+      netlink_manager_,
+      SendNl80211Message(IsNl80211Command(kNl80211FamilyId,
+                                          SetWakeOnPacketConnMessage::kCommand),
+                         _, _, _)).WillOnce(Return(true));
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(1);
+  EXPECT_CALL(*this, DoneCallback(_)).Times(0);
+  ApplyWakeOnWiFiSettings();
+  EXPECT_FALSE(SuspendActionsCallbackIsNull());
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+
+  // Settings are no longer known to be on the NIC once it has been
+  // reprogrammed, even if the local settings are reverted.
+  GetWakeOnPacketConnections()->Clear();
+  GetWakeOnPacketConnections()->AddUnique(IPAddress("192.168.10.20"));
+  EXPECT_CALL(
+      netlink_manager_,
+      SendNl80211Message(IsNl80211Command(kNl80211FamilyId,
+                                          SetWakeOnPacketConnMessage::kCommand),
+                         _, _, _)).WillOnce(Return(true));
+  ApplyWakeOnWiFiSettings();
+}
+
+TEST_F(WakeOnWiFiTestWithMockDispatcher,
+       DisableWakeOnWiFi_SkipsNICVerifiedDisabled) {
+  // Verify that the NIC has no wake on WiFi triggers programmed.
+  GetWakeOnPacketConnMessage msg;
+  NetlinkPacket packet(kResponseNoIPAddresses, sizeof(kResponseNoIPAddresses));
+  msg.InitFromPacket(&packet, NetlinkMessage::MessageContext());
+  VerifyWakeOnWiFiSettings(msg);
+
+  SetSuspendActionsDoneCallback();
+  GetWakeOnWiFiTriggers()->insert(WakeOnWiFi::kWakeTriggerPattern);
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(0);
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess))).Times(1);
+  DisableWakeOnWiFi();
+  EXPECT_TRUE(GetWakeOnWiFiTriggers()->empty());
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+
+  // Nothing is known about the state of a newly reported wiphy.
+  OnWiphyIndexReceived(1);
+  EXPECT_CALL(netlink_manager_,
+              SendNl80211Message(IsDisableWakeOnWiFiMsg(), _, _, _))
+      .WillOnce(Return(true));
+  DisableWakeOnWiFi();
+}
+
+TEST_F(WakeOnWiFiTestWithMockDispatcher,
+       BeforeSuspendActions_ReportsSuspendActionsTime) {
+  const struct timeval start_time = {1, 0};
+  const struct timeval done_time = {1, 250000};
+  // No triggers will be programmed into the NIC, so suspend actions are done
+  // immediately.
+  ClearWakeOnWiFiTriggersSupported();
+  SetSuspendActionsDoneCallback();
+  EXPECT_CALL(time_, GetTimeMonotonic(_))
+      .WillOnce(DoAll(SetArgPointee<0>(start_time), Return(0)))
+      .WillOnce(DoAll(SetArgPointee<0>(done_time), Return(0)));
+  EXPECT_CALL(
+      metrics_,
+      SendToUMA(Metrics::kMetricWifiSuspendActionsMilliseconds, 250,
+                Metrics::kMetricWifiSuspendActionsMillisecondsMin,
+                Metrics::kMetricWifiSuspendActionsMillisecondsMax,
+                Metrics::kMetricWifiSuspendActionsMillisecondsNumBuckets));
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess))).Times(1);
+  BeforeSuspendActions(false, false, 0);
+}
+
 TEST_F(WakeOnWiFiTestWithMockDispatcher, ParseWakeOnSSIDResults) {
   SetWakeOnPacketConnMessage msg;
   NetlinkPacket packet(kWakeReasonSSIDNlMsg, sizeof(kWakeReasonSSIDNlMsg));
@@ -2117,6 +2229,89 @@ TEST_F(WakeOnWiFiTestWithDispatcher, InitiateScanInDarkResume) {
             GetDarkResumeScanRetriesLeft());
 }
 
+TEST_F(WakeOnWiFiTestWithDispatcher, InitiateScanInDarkResume_Planned) {
+  vector<ByteString> whitelist;
+  AddSSIDToWhitelist(kSSIDBytes1, sizeof(kSSIDBytes1), &whitelist);
+  GetDarkResumeScanFreqs()->insert(2412);
+  GetDarkResumeScanFreqs()->insert(5180);
+  SetInDarkResume(true);
+
+  // With no frequencies to scan, scan the frequencies computed before suspend,
+  // without retries.
+  EXPECT_CALL(*this, InitiateScanCallback(*GetDarkResumeScanFreqs()));
+  InitiateScanInDarkResume(WiFi::FreqSet());
+  EXPECT_EQ(0, GetDarkResumeScanRetriesLeft());
+
+  // Fall back to scanning all frequencies if that finds nothing.
+  EXPECT_CALL(*this, InitiateScanCallback(WiFi::FreqSet()));
+  OnNoAutoConnectableServicesAfterScan(whitelist);
+
+  // Frequencies of wake on SSID matches take precedence.
+  WiFi::FreqSet freqs;
+  freqs.insert(2437);
+  EXPECT_CALL(*this, InitiateScanCallback(freqs));
+  InitiateScanInDarkResume(freqs);
+  EXPECT_EQ(WakeOnWiFi::kMaxDarkResumeScanRetries,
+            GetDarkResumeScanRetriesLeft());
+}
+
+TEST_F(WakeOnWiFiTestWithMockDispatcher, OnDarkResume_ReportsActionsTime) {
+  const struct timeval dark_resume_time = {10, 0};
+  const struct timeval done_time = {10, 400000};
+  vector<ByteString> whitelist;
+  SetLastWakeReason(WakeOnWiFi::kWakeTriggerPattern);
+  EXPECT_CALL(time_, GetTimeMonotonic(_))
+      .WillOnce(DoAll(SetArgPointee<0>(dark_resume_time), Return(0)))
+      .WillOnce(DoAll(SetArgPointee<0>(done_time), Return(0)));
+  OnDarkResume(true, whitelist);
+
+  EXPECT_CALL(
+      metrics_,
+      SendToUMA(Metrics::kMetricWifiDarkResumeActionsMilliseconds, 400,
+                Metrics::kMetricWifiDarkResumeActionsMillisecondsMin,
+                Metrics::kMetricWifiDarkResumeActionsMillisecondsMax,
+                Metrics::kMetricWifiDarkResumeActionsMillisecondsNumBuckets));
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess)));
+  RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
+}
+
+TEST_F(WakeOnWiFiTestWithMockDispatcher,
+       OnAfterResume_DropsDarkResumeActionsTime) {
+  const struct timeval now = {10, 0};
+  vector<ByteString> whitelist;
+  SetLastWakeReason(WakeOnWiFi::kWakeTriggerPattern);
+  EXPECT_CALL(time_, GetTimeMonotonic(_))
+      .WillRepeatedly(DoAll(SetArgPointee<0>(now), Return(0)));
+  OnDarkResume(true, whitelist);
+
+  // The dark resume turns into a full resume, so its actions never finish.
+  OnAfterResume();
+  EXPECT_CALL(metrics_,
+              SendToUMA(Metrics::kMetricWifiDarkResumeActionsMilliseconds, _,
+                        _, _, _)).Times(0);
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess)));
+  RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
+}
+
+TEST_F(WakeOnWiFiTestWithMockDispatcher,
+       OnBeforeSuspend_DropsDarkResumeActionsTime) {
+  const struct timeval now = {10, 0};
+  vector<ByteString> whitelist;
+  SetLastWakeReason(WakeOnWiFi::kWakeTriggerPattern);
+  EXPECT_CALL(time_, GetTimeMonotonic(_))
+      .WillRepeatedly(DoAll(SetArgPointee<0>(now), Return(0)));
+  OnDarkResume(true, whitelist);
+
+  // The actions of a regular suspend are not reported as dark resume ones.
+  EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(AnyNumber());
+  OnBeforeSuspend(true, whitelist, WiFi::FreqSet(), false, 0);
+  EXPECT_CALL(metrics_,
+              SendToUMA(Metrics::kMetricWifiDarkResumeActionsMilliseconds, _,
+                        _, _, _)).Times(0);
+  EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess)));
+  RunAndResetSuspendActionsDoneCallback(Error(Error::kSuccess));
+}
+
 TEST_F(WakeOnWiFiTestWithMockDispatcher, AddRemoveWakeOnPacketConnection) {
   const string bad_ip_string("1.1");
   const string ip_string1("192.168.0.19");
@@ -2247,7 +2442,7 @@ TEST_F(WakeOnWiFiTestWithDispatcher, OnBeforeSuspend_ClearsEventHistory) {
     GetDarkResumeHistory()->RecordEvent();
   }
   EXPECT_EQ(kNumEvents, GetDarkResumeHistory()->Size());
-  OnBeforeSuspend(true, whitelist, true, 0);
+  OnBeforeSuspend(true, whitelist, WiFi::FreqSet(), true, 0);
   EXPECT_TRUE(GetDarkResumeHistory()->Empty());
 }
 
@@ -2255,7 +2450,7 @@ TEST_F(WakeOnWiFiTestWithDispatcher, OnBeforeSuspend_SetsWakeOnSSIDWhitelist) {
   vector<ByteString> whitelist;
   AddSSIDToWhitelist(kSSIDBytes1, sizeof(kSSIDBytes1), &whitelist);
   EXPECT_TRUE(GetWakeOnSSIDWhitelist()->empty());
-  OnBeforeSuspend(true, whitelist, true, 0);
+  OnBeforeSuspend(true, whitelist, WiFi::FreqSet(), true, 0);
   EXPECT_FALSE(GetWakeOnSSIDWhitelist()->empty());
   EXPECT_EQ(1, GetWakeOnSSIDWhitelist()->size());
 }
@@ -2263,10 +2458,20 @@ TEST_F(WakeOnWiFiTestWithDispatcher, OnBeforeSuspend_SetsWakeOnSSIDWhitelist) {
 TEST_F(WakeOnWiFiTestWithDispatcher, OnBeforeSuspend_SetsDoneCallback) {
   vector<ByteString> whitelist;
   EXPECT_TRUE(SuspendActionsCallbackIsNull());
-  OnBeforeSuspend(true, whitelist, true, 0);
+  OnBeforeSuspend(true, whitelist, WiFi::FreqSet(), true, 0);
   EXPECT_FALSE(SuspendActionsCallbackIsNull());
 }
 
+TEST_F(WakeOnWiFiTestWithDispatcher, OnBeforeSuspend_SetsDarkResumeScanFreqs) {
+  vector<ByteString> whitelist;
+  WiFi::FreqSet freqs;
+  freqs.insert(2412);
+  freqs.insert(5180);
+  EXPECT_TRUE(GetDarkResumeScanFreqs()->empty());
+  OnBeforeSuspend(true, whitelist, freqs, true, 0);
+  EXPECT_EQ(freqs, *GetDarkResumeScanFreqs());
+}
+
 TEST_F(WakeOnWiFiTestWithMockDispatcher, OnBeforeSuspend_DHCPLeaseRenewal) {
   bool is_connected;
   bool have_dhcp_lease;
@@ -2278,7 +2483,7 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher, OnBeforeSuspend_DHCPLeaseRenewal) {
   have_dhcp_lease = true;
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(1);
   EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(1);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalShort);
 
   // No immediate DHCP lease renewal because we are not connected.
@@ -2286,7 +2491,7 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher, OnBeforeSuspend_DHCPLeaseRenewal) {
   have_dhcp_lease = true;
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(0);
   EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(1);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalShort);
 
   // No immediate DHCP lease renewal because the time to the next lease renewal
@@ -2295,7 +2500,7 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher, OnBeforeSuspend_DHCPLeaseRenewal) {
   have_dhcp_lease = true;
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(0);
   EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(1);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalLong);
 
   // No immediate DHCP lease renewal because we do not have a DHCP lease that
@@ -2304,7 +2509,7 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher, OnBeforeSuspend_DHCPLeaseRenewal) {
   have_dhcp_lease = false;
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(0);
   EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(1);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalLong);
 }
 
@@ -3221,12 +3426,12 @@ TEST_F(WakeOnWiFiTestWithMockDispatcher,
   AddSSIDToWhitelist(kSSIDBytes1, sizeof(kSSIDBytes1), &whitelist);
   EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess))).Times(1);
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(0);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalShort);
 
   EXPECT_CALL(*this, DoneCallback(ErrorTypeIs(Error::kSuccess))).Times(1);
   EXPECT_CALL(*this, RenewDHCPLeaseCallback()).Times(0);
-  OnBeforeSuspend(is_connected, whitelist, have_dhcp_lease,
+  OnBeforeSuspend(is_connected, whitelist, WiFi::FreqSet(), have_dhcp_lease,
                   kTimeToNextLeaseRenewalLong);
 }
 
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <set>
@@ -30,6 +31,7 @@
 #include <base/bind.h>
 #include <base/files/file_util.h>
 #include <base/files/file_path.h>
+#include <base/stl_util.h>
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
 #if defined(__ANDROID__)
@@ -64,6 +66,7 @@
 #include "shill/supplicant/wpa_supplicant.h"
 #include "shill/technology.h"
 #include "shill/wifi/mac80211_monitor.h"
+#include "shill/wifi/roam_scorer.h"
 #include "shill/wifi/scan_session.h"
 #include "shill/wifi/tdls_manager.h"
 #include "shill/wifi/wake_on_wifi.h"
@@ -99,6 +102,11 @@ const uint16_t WiFi::kBackgroundScanIntervalSeconds = 3601;
 // Age (in seconds) beyond which a BSS cache entry will not be preserved,
 // across a suspend/resume.
 const time_t WiFi::kMaxBSSResumeAgeSeconds = 10;
+// Endpoints seen before a suspend longer than this are not trusted to be in
+// range at resume.
+const time_t WiFi::kMaxResumeCacheAgeSeconds = 300;
+const int16_t WiFi::kMinResumeCacheSignalDbm = -75;
+const time_t WiFi::kMinRoamScanIntervalSeconds = 15;
 const char WiFi::kInterfaceStateUnknown[] = "shill-unknown";
 const time_t WiFi::kRescanIntervalSeconds = 1;
 const int WiFi::kNumFastScanAttempts = 3;
@@ -106,6 +114,11 @@ const int WiFi::kFastScanIntervalSeconds = 10;
 const int WiFi::kPendingTimeoutSeconds = 15;
 const int WiFi::kReconnectTimeoutSeconds = 10;
 const int WiFi::kRequestStationInfoPeriodSeconds = 20;
+const int WiFi::kRequestStationInfoFastPeriodSeconds = 5;
+const int WiFi::kStationInfoSignalDropDb = 5;
+const size_t WiFi::kStationInfoSignalWindow = 4;
+const int WiFi::kStationInfoWeakSignalDbm = -75;
+const uint32_t WiFi::kStationInfoActivePacketsPerSecond = 10;
 const size_t WiFi::kMinumumFrequenciesToScan = 4;  // Arbitrary but > 0.
 const float WiFi::kDefaultFractionPerScan = 0.34;
 const size_t WiFi::kStuckQueueLengthThreshold = 40;  // ~1 full-channel scan
@@ -152,6 +165,8 @@ WiFi::WiFi(ControlInterface* control_interface,
       supplicant_disconnect_reason_(kDefaultDisconnectReason),
       need_bss_flush_(false),
       resumed_at_((struct timeval){0}),
+      resume_cache_boottime_(0),
+      report_resume_to_connected_(false),
       fast_scans_remaining_(kNumFastScanAttempts),
       has_already_completed_(false),
       is_roaming_in_progress_(false),
@@ -164,6 +179,8 @@ WiFi::WiFi(ControlInterface* control_interface,
           base::Bind(&WiFi::RestartFastScanAttempts,
                      weak_ptr_factory_.GetWeakPtr()),
           metrics)),
+      roam_scorer_(new RoamScorer(time_)),
+      roam_scan_at_(0),
       bgscan_short_interval_seconds_(kDefaultBgscanShortIntervalSeconds),
       bgscan_signal_threshold_dbm_(kDefaultBgscanSignalThresholdDbm),
       roam_threshold_db_(kDefaultRoamThresholdDb),
@@ -174,10 +191,14 @@ WiFi::WiFi(ControlInterface* control_interface,
       min_frequencies_to_scan_(kMinumumFrequenciesToScan),
       max_frequencies_to_scan_(std::numeric_limits<int>::max()),
       scan_all_frequencies_(true),
+      partitioned_scan_(false),
       fraction_per_scan_(kDefaultFractionPerScan),
       scan_state_(kScanIdle),
       scan_method_(kScanMethodNone),
       receive_byte_count_at_connect_(0),
+      station_info_period_seconds_(kRequestStationInfoPeriodSeconds),
+      has_station_info_packet_count_(false),
+      station_info_packet_count_(0),
       wiphy_index_(kDefaultWiphyIndex),
       wake_on_wifi_(new WakeOnWiFi(netlink_manager_,
                                    dispatcher,
@@ -276,6 +297,11 @@ void WiFi::Stop(Error* error, const EnabledStateChangedCallback& /*callback*/) {
     provider_->OnEndpointRemoved(endpoint.second);
   }
   endpoint_by_rpcid_.clear();
+  for (const auto& endpoint : restored_endpoints_) {
+    provider_->OnEndpointRemoved(endpoint.second);
+  }
+  restored_endpoints_.clear();
+  resume_cache_.clear();
   for (const auto& map_entry : rpcid_by_service_) {
     RemoveNetwork(map_entry.second);
   }
@@ -297,6 +323,7 @@ void WiFi::Stop(Error* error, const EnabledStateChangedCallback& /*callback*/) {
   StopReconnectTimer();
   StopRequestingStationInfo();
   mac80211_monitor_->Stop();
+  provider_->DeregisterScanDevice(this);
 
   OnEnabledStateChanged(EnabledStateChangedCallback(), Error());
   if (error)
@@ -321,29 +348,80 @@ void WiFi::Scan(ScanType scan_type, Error* /*error*/, const string& reason) {
     SLOG(this, 2) << "Ignoring scan request while scanning or connecting.";
     return;
   }
-  if (progressive_scan_enabled_ && scan_type == kProgressiveScan) {
+  // On hosts with more than one radio, the idle devices that scan together
+  // for a single Manager scan request each cover only their share of the
+  // band; the endpoints found by all of them feed the same services.  The
+  // provider starts the scan once every device has joined.
+  if (progressive_scan_enabled_ && IsIdle() &&
+      provider_->JoinScanFanOut(this, Bind(&WiFi::StartScan,
+                                           weak_ptr_factory_.GetWeakPtr(),
+                                           scan_type, reason))) {
+    return;
+  }
+  StartScan(scan_type, reason, set<uint16_t>());
+}
+
+void WiFi::StartScan(ScanType scan_type,
+                     const string& reason,
+                     const set<uint16_t>& scan_partition) {
+  if (progressive_scan_enabled_ &&
+      (scan_type == kProgressiveScan || !scan_partition.empty())) {
     LOG(INFO) << __func__ << " [progressive] on " << link_name() << " from "
               << reason;
     LOG(INFO) << scan_configuration_;
+    if (partitioned_scan_ || !scan_partition.empty()) {
+      // A partition only holds for the scan request that assigned it, so
+      // never carry a partitioned session over from one request to another.
+      scan_session_.reset();
+    }
     if (!scan_session_) {
-      // TODO(wdg): Perform in-depth testing to determine the best values for
-      // the different scans. chromium:235293
+      WiFiProvider::FrequencyCountList previous_frequencies =
+          provider_->GetScanFrequencies();
+      set<uint16_t> available_frequencies =
+          scan_all_frequencies_ ? all_scan_frequencies_ : set<uint16_t>();
+      size_t min_frequencies = min_frequencies_to_scan_;
+      size_t max_frequencies = max_frequencies_to_scan_;
       ScanSession::FractionList scan_fractions;
-      float total_fraction = 0.0;
-      do {
-        total_fraction += fraction_per_scan_;
-        scan_fractions.push_back(fraction_per_scan_);
-      } while (total_fraction < 1.0);
+      partitioned_scan_ = !scan_partition.empty();
+      if (partitioned_scan_) {
+        LOG(INFO) << "Scanning " << scan_partition.size() << " of "
+                  << all_scan_frequencies_.size() << " frequencies on "
+                  << phy_name_;
+        WiFiProvider::FrequencyCountList partition_frequencies;
+        for (const auto& freq_count : previous_frequencies) {
+          if (ContainsKey(scan_partition, freq_count.frequency)) {
+            partition_frequencies.push_back(freq_count);
+          }
+        }
+        previous_frequencies.swap(partition_frequencies);
+        if (scan_type == kFullScan) {
+          // Cover the whole partition in a single scan.
+          available_frequencies = scan_partition;
+          scan_fractions.push_back(1.0);
+          min_frequencies = scan_partition.size();
+          max_frequencies = scan_partition.size();
+        } else if (scan_all_frequencies_) {
+          available_frequencies = scan_partition;
+        }
+      }
+      if (scan_fractions.empty()) {
+        // TODO(wdg): Perform in-depth testing to determine the best values
+        // for the different scans. chromium:235293
+        float total_fraction = 0.0;
+        do {
+          total_fraction += fraction_per_scan_;
+          scan_fractions.push_back(fraction_per_scan_);
+        } while (total_fraction < 1.0);
+      }
       scan_session_.reset(
           new ScanSession(netlink_manager_,
                           dispatcher(),
-                          provider_->GetScanFrequencies(),
-                          (scan_all_frequencies_ ? all_scan_frequencies_ :
-                           set<uint16_t>()),
+                          previous_frequencies,
+                          available_frequencies,
                           interface_index(),
                           scan_fractions,
-                          min_frequencies_to_scan_,
-                          max_frequencies_to_scan_,
+                          min_frequencies,
+                          max_frequencies,
                           Bind(&WiFi::OnFailedProgressiveScan,
                                weak_ptr_factory_.GetWeakPtr()),
                           metrics()));
@@ -683,6 +761,16 @@ void WiFi::NotifyEndpointChanged(const WiFiEndpointConstRefPtr& endpoint) {
   provider_->OnEndpointUpdated(endpoint);
 }
 
+void WiFi::NotifyEndpointSignalChanged(
+    const WiFiEndpointConstRefPtr& endpoint) {
+  roam_scorer_->RecordSignal(endpoint);
+  provider_->OnEndpointSignalChanged(endpoint);
+  EndpointMap::const_iterator it = endpoint_by_rpcid_.find(supplicant_bss_);
+  if (it != endpoint_by_rpcid_.end() && it->second.get() == endpoint.get()) {
+    ScanForRoamCandidates(endpoint);
+  }
+}
+
 void WiFi::AppendBgscan(WiFiService* service,
                         KeyValueStore* service_params) const {
   int scan_interval = kBackgroundScanIntervalSeconds;
@@ -793,6 +881,27 @@ void WiFi::ClearBgscanMethod(const int& /*argument*/, Error* /*error*/) {
 void WiFi::CurrentBSSChanged(const string& new_bss) {
   SLOG(this, 3) << "WiFi " << link_name() << " CurrentBSS "
                 << supplicant_bss_ << " -> " << new_bss;
+  string old_bssid;
+  EndpointMap::const_iterator old_it = endpoint_by_rpcid_.find(supplicant_bss_);
+  if (old_it != endpoint_by_rpcid_.end()) {
+    old_bssid = old_it->second->bssid_string();
+  }
+  if (new_bss == WPASupplicant::kCurrentBSSNull) {
+    // Falling off a BSS counts against it, unless the user asked us to
+    // disconnect or we are switching services.
+    WiFiService* affected_service = current_service_.get() ?
+        current_service_.get() : pending_service_.get();
+    if (!old_bssid.empty() && affected_service &&
+        !affected_service->explicitly_disconnected() &&
+        !(affected_service == current_service_.get() && pending_service_)) {
+      roam_scorer_->RecordFailure(old_bssid);
+    }
+  } else {
+    EndpointMap::const_iterator new_it = endpoint_by_rpcid_.find(new_bss);
+    if (new_it != endpoint_by_rpcid_.end()) {
+      roam_scorer_->RecordRoam(old_bssid, new_it->second->bssid_string());
+    }
+  }
   supplicant_bss_ = new_bss;
   has_already_completed_ = false;
   is_roaming_in_progress_ = false;
@@ -921,7 +1030,9 @@ void WiFi::HandleDisconnect() {
   if (affected_service == pending_service_.get()) {
     // The attempt to connect to |pending_service_| failed. Clear
     // |pending_service_|, to indicate we're no longer in the middle
-    // of a connect request.
+    // of a connect request.  Any of its endpoints that we restored at
+    // resume are unlikely to still exist.
+    ExpireRestoredEndpointsOfService(affected_service);
     SetPendingService(nullptr);
   } else if (pending_service_.get()) {
     // We've attributed the disconnection to what was the
@@ -1267,6 +1378,8 @@ void WiFi::BSSAddedTask(const string& path, const KeyValueStore& properties) {
   }
 
   provider_->OnEndpointAdded(endpoint);
+  MergeRestoredEndpoint(endpoint);
+  roam_scorer_->RecordSignal(endpoint);
 
   // Do this last, to maintain the invariant that any Endpoint we
   // know about has a corresponding Service.
@@ -1291,6 +1404,7 @@ void WiFi::BSSRemovedTask(const string& path) {
   WiFiEndpointRefPtr endpoint = i->second;
   CHECK(endpoint);
   endpoint_by_rpcid_.erase(i);
+  roam_scorer_->ForgetSignal(endpoint->bssid_string());
 
   WiFiServiceRefPtr service = provider_->OnEndpointRemoved(endpoint);
   if (!service) {
@@ -1422,6 +1536,16 @@ void WiFi::ScanDoneTask() {
     supplicant_interface_proxy_->FlushBSS(max_age);
     need_bss_flush_ = false;
   }
+  // Restored endpoints spared by an earlier scan because they backed the
+  // current or pending service are retired once they no longer do.
+  ExpireRestoredEndpoints();
+  // Endpoints only report a signal that changed, so record the signal of
+  // every BSS supplicant still lists after this scan; otherwise a roam
+  // candidate with a steady signal would look stale.
+  for (const auto& rpcid_endpoint : endpoint_by_rpcid_) {
+    roam_scorer_->RecordSignal(rpcid_endpoint.second);
+  }
+  EvaluateRoamCandidates();
   StartScanTimer();
 }
 
@@ -1522,6 +1646,13 @@ void WiFi::ProgressiveScanTask() {
   // start with a connection but one exists at this point.
   if (!IsIdle()) {
     SLOG(this, 2) << "Ignoring scan request while connecting to an AP.";
+    // Only an auto-connect tells how well the scan plan worked.  A user may
+    // pick a network at any point of the session.
+    WiFiServiceRefPtr service = pending_service_ ? pending_service_
+                                                 : current_service_;
+    if (!service->is_in_user_connect()) {
+      scan_session_->ReportCandidateFound();
+    }
     scan_session_.reset();
     return;
   }
@@ -1533,6 +1664,14 @@ void WiFi::ProgressiveScanTask() {
     scan_session_->InitiateScan();
     return;
   }
+  if (partitioned_scan_) {
+    // The other phys are covering the rest of the band, so a full scan from
+    // here would only repeat their work.
+    SLOG(this, 2) << "Finished scanning the partition of " << phy_name_;
+    scan_session_.reset();
+    SetScanState(kScanFoundNothing, scan_method_, __func__);
+    return;
+  }
   LOG(ERROR) << "A complete progressive scan turned-up nothing -- "
              << "do a regular scan";
   scan_session_.reset();
@@ -1849,6 +1988,8 @@ void WiFi::OnBeforeSuspend(const ResultCallback& callback) {
   LOG(INFO) << __func__ << ": "
             << (IsConnectedToCurrentService() ? "connected" : "not connected");
   StopScanTimer();
+  report_resume_to_connected_ = false;
+  SaveResumeCache();
   supplicant_process_proxy_->ExpectDisconnect();
   uint32_t time_to_next_lease_renewal;
   bool have_dhcp_lease =
@@ -1856,6 +1997,7 @@ void WiFi::OnBeforeSuspend(const ResultCallback& callback) {
   wake_on_wifi_->OnBeforeSuspend(
       IsConnectedToCurrentService(),
       provider_->GetSsidsConfiguredForAutoConnect(),
+      GetDarkResumeScanFrequencies(),
       callback,
       Bind(&Device::RenewDHCPLease, weak_ptr_factory_.GetWeakPtr()),
       Bind(&WiFi::RemoveSupplicantNetworks, weak_ptr_factory_.GetWeakPtr()),
@@ -1902,8 +2044,11 @@ void WiFi::OnAfterResume() {
   need_bss_flush_ = true;
 
   if (!IsConnectedToCurrentService()) {
+    report_resume_to_connected_ = true;
+    RestoreResumeCache();
     InitiateScan(kProgressiveScan);
   }
+  resume_cache_.clear();
 
   // Since we stopped the scan timer before suspending, start it again here.
   StartScanTimer();
@@ -1915,6 +2060,196 @@ void WiFi::OnAfterResume() {
   }
 }
 
+void WiFi::SaveResumeCache() {
+  resume_cache_.clear();
+  if (!time_->GetSecondsBoottime(&resume_cache_boottime_)) {
+    return;
+  }
+  for (const auto& rpcid_endpoint : endpoint_by_rpcid_) {
+    const WiFiEndpointRefPtr& endpoint = rpcid_endpoint.second;
+    if (endpoint->signal_strength() < kMinResumeCacheSignalDbm) {
+      continue;
+    }
+    WiFiServiceRefPtr service = provider_->FindServiceForEndpoint(endpoint);
+    if (!service || !service->auto_connect() ||
+        !service->has_ever_connected()) {
+      continue;
+    }
+    resume_cache_[endpoint->bssid_string()] = endpoint;
+  }
+  SLOG(this, 2) << __func__ << ": saved " << resume_cache_.size()
+                << " endpoints";
+}
+
+WiFi::FreqSet WiFi::GetDarkResumeScanFrequencies() {
+  FreqSet freqs;
+  for (const auto& rpcid_endpoint : endpoint_by_rpcid_) {
+    const WiFiEndpointRefPtr& endpoint = rpcid_endpoint.second;
+    WiFiServiceRefPtr service = provider_->FindServiceForEndpoint(endpoint);
+    if (service && service->auto_connect()) {
+      freqs.insert(endpoint->frequency());
+    }
+  }
+  return freqs;
+}
+
+void WiFi::RestoreResumeCache() {
+  time_t now;
+  if (resume_cache_.empty() || !time_->GetSecondsBoottime(&now)) {
+    return;
+  }
+  if (now - resume_cache_boottime_ > kMaxResumeCacheAgeSeconds) {
+    SLOG(this, 2) << __func__ << ": cache is " << now - resume_cache_boottime_
+                  << " seconds old; not restoring";
+    return;
+  }
+  set<string> visible_bssids;
+  for (const auto& rpcid_endpoint : endpoint_by_rpcid_) {
+    visible_bssids.insert(rpcid_endpoint.second->bssid_string());
+  }
+  for (const auto& bssid_endpoint : resume_cache_) {
+    const string& bssid = bssid_endpoint.first;
+    if (ContainsKey(visible_bssids, bssid) ||
+        ContainsKey(restored_endpoints_, bssid)) {
+      continue;
+    }
+    SLOG(this, 2) << __func__ << ": restoring endpoint " << bssid;
+    provider_->OnEndpointAdded(bssid_endpoint.second);
+    restored_endpoints_[bssid] = bssid_endpoint.second;
+  }
+}
+
+void WiFi::MergeRestoredEndpoint(const WiFiEndpointConstRefPtr& endpoint) {
+  EndpointMap::iterator it = restored_endpoints_.find(endpoint->bssid_string());
+  if (it == restored_endpoints_.end()) {
+    return;
+  }
+  // |endpoint| has already been added, so this never leaves its service
+  // without endpoints.
+  WiFiEndpointRefPtr restored_endpoint = it->second;
+  restored_endpoints_.erase(it);
+  provider_->OnEndpointRemoved(restored_endpoint);
+}
+
+void WiFi::ExpireRestoredEndpoints() {
+  EndpointMap::iterator it = restored_endpoints_.begin();
+  while (it != restored_endpoints_.end()) {
+    WiFiServiceRefPtr service = provider_->FindServiceForEndpoint(it->second);
+    if (service && (service == current_service_ ||
+                    service == pending_service_)) {
+      ++it;
+      continue;
+    }
+    SLOG(this, 2) << __func__ << ": endpoint " << it->first
+                  << " not seen since resume";
+    provider_->OnEndpointRemoved(it->second);
+    it = restored_endpoints_.erase(it);
+  }
+}
+
+void WiFi::ExpireRestoredEndpointsOfService(const WiFiService* service) {
+  EndpointMap::iterator it = restored_endpoints_.begin();
+  while (it != restored_endpoints_.end()) {
+    if (provider_->FindServiceForEndpoint(it->second).get() != service) {
+      ++it;
+      continue;
+    }
+    SLOG(this, 2) << __func__ << ": endpoint " << it->first
+                  << " failed to connect since resume";
+    provider_->OnEndpointRemoved(it->second);
+    it = restored_endpoints_.erase(it);
+  }
+}
+
+void WiFi::ReportResumeToConnected() {
+  if (!report_resume_to_connected_) {
+    return;
+  }
+  report_resume_to_connected_ = false;
+  struct timeval now, elapsed;
+  time_->GetTimeMonotonic(&now);
+  timersub(&now, &resumed_at_, &elapsed);
+  int elapsed_milliseconds = elapsed.tv_sec * 1000 + elapsed.tv_usec / 1000;
+  LOG(INFO) << "Connected " << elapsed_milliseconds
+            << " milliseconds after resume";
+  metrics()->SendToUMA(
+      Metrics::kMetricWifiResumeToConnectedMilliseconds,
+      elapsed_milliseconds,
+      Metrics::kMetricWifiResumeToConnectedMillisecondsMin,
+      Metrics::kMetricWifiResumeToConnectedMillisecondsMax,
+      Metrics::kMetricWifiResumeToConnectedMillisecondsNumBuckets);
+}
+
+bool WiFi::GetRoamCandidates(
+    WiFiEndpointConstRefPtr* current_endpoint,
+    vector<WiFiEndpointConstRefPtr>* candidates) {
+  if (!IsConnectedToCurrentService() || pending_service_ ||
+      is_roaming_in_progress_) {
+    return false;
+  }
+  EndpointMap::const_iterator current_it =
+      endpoint_by_rpcid_.find(supplicant_bss_);
+  if (current_it == endpoint_by_rpcid_.end()) {
+    return false;
+  }
+  *current_endpoint = current_it->second;
+  for (const auto& rpcid_endpoint : endpoint_by_rpcid_) {
+    if (rpcid_endpoint.first == supplicant_bss_) {
+      continue;
+    }
+    WiFiServiceRefPtr service =
+        provider_->FindServiceForEndpoint(rpcid_endpoint.second);
+    if (service == current_service_) {
+      candidates->push_back(rpcid_endpoint.second);
+    }
+  }
+  return !candidates->empty();
+}
+
+void WiFi::EvaluateRoamCandidates() {
+  WiFiEndpointConstRefPtr current_endpoint;
+  vector<WiFiEndpointConstRefPtr> candidates;
+  if (!GetRoamCandidates(&current_endpoint, &candidates)) {
+    return;
+  }
+  WiFiEndpointConstRefPtr candidate =
+      roam_scorer_->SelectRoamCandidate(current_endpoint, candidates);
+  if (!candidate) {
+    return;
+  }
+  LOG(INFO) << "WiFi " << link_name() << " roaming from "
+            << current_endpoint->bssid_string() << " to "
+            << candidate->bssid_string();
+  Error unused_error;
+  RequestRoam(candidate->bssid_string(), &unused_error);
+}
+
+void WiFi::ScanForRoamCandidates(
+    const WiFiEndpointConstRefPtr& current_endpoint) {
+  if (!roam_scorer_->IsDegrading(current_endpoint)) {
+    return;
+  }
+  WiFiEndpointConstRefPtr unused_current_endpoint;
+  vector<WiFiEndpointConstRefPtr> candidates;
+  if (!GetRoamCandidates(&unused_current_endpoint, &candidates)) {
+    return;
+  }
+  time_t now;
+  if (!time_->GetSecondsMonotonic(&now) ||
+      (roam_scan_at_ && now - roam_scan_at_ < kMinRoamScanIntervalSeconds)) {
+    return;
+  }
+  roam_scan_at_ = now;
+  FreqSet freqs;
+  for (const auto& candidate : candidates) {
+    freqs.insert(candidate->frequency());
+  }
+  SLOG(this, 2) << __func__ << ": " << current_endpoint->bssid_string()
+                << " is degrading; scanning " << freqs.size()
+                << " channels";
+  TriggerPassiveScan(freqs);
+}
+
 void WiFi::AbortScan() {
   if (scan_session_) {
     scan_session_.reset();
@@ -2005,6 +2340,7 @@ void WiFi::TriggerPassiveScan(const FreqSet& freqs) {
 
 void WiFi::OnConnected() {
   Device::OnConnected();
+  ReportResumeToConnected();
   EnableHighBitrates();
   if (current_service_ &&
       current_service_->IsSecurityMatch(kSecurityWep)) {
@@ -2174,6 +2510,7 @@ void WiFi::PendingTimeoutHandler() {
   // DisconnectWithFailure will leave the pending service's state in failure
   // state. Reset its state back to idle, to allow it to be connectable again.
   pending_service->SetState(Service::kStateIdle);
+  ExpireRestoredEndpointsOfService(pending_service.get());
 }
 
 void WiFi::StartReconnectTimer() {
@@ -2453,6 +2790,7 @@ void WiFi::OnNewWiphy(const Nl80211Message& nl80211_message) {
       }
     }
   }
+  provider_->RegisterScanDevice(this, phy_name_, all_scan_frequencies_);
 }
 
 void WiFi::OnTriggerPassiveScanResponse(const Nl80211Message& netlink_message) {
@@ -2726,7 +3064,7 @@ void WiFi::RequestStationInfo() {
   request_station_info_callback_.Reset(
       Bind(&WiFi::RequestStationInfo, weak_ptr_factory_.GetWeakPtr()));
   dispatcher()->PostDelayedTask(request_station_info_callback_.callback(),
-                                kRequestStationInfoPeriodSeconds * 1000);
+                                station_info_period_seconds_ * 1000);
 }
 
 void WiFi::OnReceivedStationInfo(const Nl80211Message& nl80211_message) {
@@ -2810,6 +3148,8 @@ void WiFi::OnReceivedStationInfo(const Nl80211Message& nl80211_message) {
     }
   }
 
+  UpdateStationInfoPeriod(static_cast<signed char>(signal));
+
   AttributeListConstRefPtr transmit_info;
   if (station_info->ConstGetNestedAttributeList(
       NL80211_STA_INFO_TX_BITRATE, &transmit_info)) {
@@ -2870,10 +3210,72 @@ void WiFi::OnReceivedStationInfo(const Nl80211Message& nl80211_message) {
   }
 }
 
+void WiFi::UpdateStationInfoPeriod(int signal_dbm) {
+  bool has_packet_count =
+      link_statistics_.ContainsUint(kPacketReceiveSuccessesProperty) &&
+      link_statistics_.ContainsUint(kPacketTransmitSuccessesProperty);
+  uint32_t packet_count = 0;
+  if (has_packet_count) {
+    packet_count =
+        link_statistics_.GetUint(kPacketReceiveSuccessesProperty) +
+        link_statistics_.GetUint(kPacketTransmitSuccessesProperty);
+  }
+
+  // Comparing against the strongest recent sample rather than just the
+  // previous one also catches a signal that declines a little at a time.
+  int recent_signal_dbm = signal_dbm;
+  if (!station_info_signals_dbm_.empty()) {
+    recent_signal_dbm = *std::max_element(station_info_signals_dbm_.begin(),
+                                          station_info_signals_dbm_.end());
+  }
+
+  int period_seconds = kRequestStationInfoPeriodSeconds;
+  if (signal_dbm < kStationInfoWeakSignalDbm) {
+    SLOG(this, 2) << __func__ << ": signal is weak at " << signal_dbm
+                  << " dBm";
+    period_seconds = kRequestStationInfoFastPeriodSeconds;
+  } else if (signal_dbm <= recent_signal_dbm - kStationInfoSignalDropDb) {
+    SLOG(this, 2) << __func__ << ": signal dropped from "
+                  << recent_signal_dbm << " to " << signal_dbm << " dBm";
+    period_seconds = kRequestStationInfoFastPeriodSeconds;
+  } else if (has_packet_count && has_station_info_packet_count_ &&
+             packet_count >= station_info_packet_count_ &&
+             packet_count - station_info_packet_count_ >=
+                 kStationInfoActivePacketsPerSecond *
+                     station_info_period_seconds_) {
+    SLOG(this, 2) << __func__ << ": "
+                  << packet_count - station_info_packet_count_
+                  << " packets in the last " << station_info_period_seconds_
+                  << " seconds";
+    period_seconds = kRequestStationInfoFastPeriodSeconds;
+  }
+
+  station_info_signals_dbm_.push_back(signal_dbm);
+  if (station_info_signals_dbm_.size() > kStationInfoSignalWindow) {
+    station_info_signals_dbm_.pop_front();
+  }
+  has_station_info_packet_count_ = has_packet_count;
+  station_info_packet_count_ = packet_count;
+
+  if (period_seconds == station_info_period_seconds_) {
+    return;
+  }
+  SLOG(this, 2) << __func__ << ": requesting station info every "
+                << period_seconds << " seconds";
+  station_info_period_seconds_ = period_seconds;
+  request_station_info_callback_.Reset(
+      Bind(&WiFi::RequestStationInfo, weak_ptr_factory_.GetWeakPtr()));
+  dispatcher()->PostDelayedTask(request_station_info_callback_.callback(),
+                                station_info_period_seconds_ * 1000);
+}
+
 void WiFi::StopRequestingStationInfo() {
   SLOG(this, 2) << "WiFi Device " << link_name() << ": " << __func__;
   request_station_info_callback_.Cancel();
   link_statistics_.Clear();
+  station_info_period_seconds_ = kRequestStationInfoPeriodSeconds;
+  station_info_signals_dbm_.clear();
+  has_station_info_packet_count_ = false;
 }
 
 void WiFi::TDLSDiscoverResponse(const string& peer_address) {
@@ -87,6 +87,7 @@
 
 #include <time.h>
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
@@ -118,6 +119,7 @@ class Metrics;
 class NetlinkManager;
 class NetlinkMessage;
 class Nl80211Message;
+class RoamScorer;
 class ScanSession;
 class SupplicantEAPStateHandler;
 class SupplicantInterfaceProxyInterface;
@@ -200,6 +202,9 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
 
   // Called by WiFiEndpoint.
   virtual void NotifyEndpointChanged(const WiFiEndpointConstRefPtr& endpoint);
+  // Called by WiFiEndpoint when only its signal strength has changed.
+  virtual void NotifyEndpointSignalChanged(
+      const WiFiEndpointConstRefPtr& endpoint);
 
   // Utility, used by WiFiService and WiFiEndpoint.
   // Replace non-ASCII characters with '?'. Return true if one or more
@@ -318,6 +323,13 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   FRIEND_TEST(WiFiMainTest, ProgressiveScanError);  // ScanMethod, ScanState
   FRIEND_TEST(WiFiMainTest, ProgressiveScanFound);  // ScanMethod, ScanState
   FRIEND_TEST(WiFiMainTest, ProgressiveScanNotFound);  // ScanMethod, ScanState
+  FRIEND_TEST(WiFiMainTest, ResumeCacheExpired);  // kMaxResumeCacheAgeSeconds
+  // kMinResumeCacheSignalDbm
+  FRIEND_TEST(WiFiMainTest, ResumeCacheRestoresEndpoints);
+  // kMinResumeCacheSignalDbm
+  FRIEND_TEST(WiFiMainTest, ResumeCacheSkipsWeakOrUnknownEndpoints);
+  // kMinRoamScanIntervalSeconds
+  FRIEND_TEST(WiFiMainTest, ScanForRoamCandidatesWhenDegrading);
   FRIEND_TEST(WiFiMainTest, ScanRejected);  // ScanState
   FRIEND_TEST(WiFiMainTest, ScanResults);             // EndpointMap
   FRIEND_TEST(WiFiMainTest, ScanResultsWithUpdates);  // EndpointMap
@@ -329,6 +341,9 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   FRIEND_TEST(WiFiPropertyTest, BgscanMethodProperty);  // bgscan_method_
   FRIEND_TEST(WiFiTimerTest, FastRescan);  // kFastScanIntervalSeconds
   FRIEND_TEST(WiFiTimerTest, RequestStationInfo);  // kRequestStationInfoPeriod
+  // kRequestStationInfoFastPeriodSeconds
+  FRIEND_TEST(WiFiTimerTest, RequestStationInfoAdaptsPeriod);
+  FRIEND_TEST(WiFiTimerTest, RequestStationInfoTracksSlowDeclineAndWeakSignal);
   // kPostWakeConnectivityReportDelayMilliseconds
   FRIEND_TEST(WiFiTimerTest, ResumeDispatchesConnectivityReportTask);
   // kFastScanIntervalSeconds
@@ -351,6 +366,10 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   static const uint16_t kDefaultRoamThresholdDb;
   static const uint16_t kDefaultScanIntervalSeconds;
   static const time_t kMaxBSSResumeAgeSeconds;
+  static const time_t kMaxResumeCacheAgeSeconds;
+  static const int16_t kMinResumeCacheSignalDbm;
+  // Minimum time between scans for roam candidates while connected.
+  static const time_t kMinRoamScanIntervalSeconds;
   static const char kInterfaceStateUnknown[];
   // Delay between scans when supplicant finds "No suitable network".
   static const time_t kRescanIntervalSeconds;
@@ -360,6 +379,21 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   static const int kPendingTimeoutSeconds;
   static const int kReconnectTimeoutSeconds;
   static const int kRequestStationInfoPeriodSeconds;
+  // Period between station info requests while the link is degrading or
+  // carrying traffic.
+  static const int kRequestStationInfoFastPeriodSeconds;
+  // Drop in signal strength from the strongest of the recent station info
+  // samples that counts as a degrading link.
+  static const int kStationInfoSignalDropDb;
+  // Number of recent station info samples the signal strength is compared
+  // against.
+  static const size_t kStationInfoSignalWindow;
+  // Signal strength below which the link is considered weak, and station
+  // info is requested at the fast period.
+  static const int kStationInfoWeakSignalDbm;
+  // Packet rate between two station info samples above which traffic is
+  // considered to be flowing.
+  static const uint32_t kStationInfoActivePacketsPerSecond;
   static const size_t kMinumumFrequenciesToScan;
   static const float kDefaultFractionPerScan;
   static const size_t kStuckQueueLengthThreshold;
@@ -430,6 +464,40 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   void PropertiesChangedTask(const KeyValueStore& properties);
   void ScanDoneTask();
   void ScanFailedTask();
+
+  // Saves the strong endpoints of auto-connect services we have connected
+  // to before, so that they can be restored after resume.
+  void SaveResumeCache();
+  // Hands the endpoints saved by SaveResumeCache() that supplicant no
+  // longer reports back to |provider_|, so auto-connect can start before
+  // the first scan after resume completes.
+  void RestoreResumeCache();
+  // Returns the frequencies of the endpoints of auto-connect services, which
+  // are where a scan in dark resume is most likely to find a network to
+  // connect to.
+  FreqSet GetDarkResumeScanFrequencies();
+  // Retires the restored endpoint with the BSSID of |endpoint|, which
+  // supplicant has just reported again.
+  void MergeRestoredEndpoint(const WiFiEndpointConstRefPtr& endpoint);
+  // Retires the restored endpoints that supplicant has not reported again,
+  // except those of the current or pending service.
+  void ExpireRestoredEndpoints();
+  // Retires the restored endpoints of |service|, which failed to connect.
+  void ExpireRestoredEndpointsOfService(const WiFiService* service);
+  // Reports the time since resume, if this is the first connection since.
+  void ReportResumeToConnected();
+
+  // If we are settled on |current_service_|, sets |current_endpoint| to
+  // the endpoint we are associated with and |candidates| to the other
+  // endpoints of |current_service_|, and returns true if there are any.
+  bool GetRoamCandidates(WiFiEndpointConstRefPtr* current_endpoint,
+                         std::vector<WiFiEndpointConstRefPtr>* candidates);
+  // Asks supplicant to roam if |roam_scorer_| finds a better endpoint for
+  // |current_service_|.
+  void EvaluateRoamCandidates();
+  // Scans the channels of the other endpoints of |current_service_| if
+  // |roam_scorer_| finds that |current_endpoint| is degrading.
+  void ScanForRoamCandidates(const WiFiEndpointConstRefPtr& current_endpoint);
   // UpdateScanStateAfterScanDone is spawned as a task from ScanDoneTask in
   // order to guarantee that it is run after the start of any connections that
   // result from a scan.  This works because supplicant sends all BSSAdded
@@ -444,6 +512,12 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   // [ScanDone]-->[ScanDoneTask]-->[UpdateScanStateAfterScanDone]
   void UpdateScanStateAfterScanDone();
   void ScanTask();
+  // Starts a scan requested through Scan().  If |scan_partition| is not
+  // empty, a progressive scan covers only those frequencies and does not
+  // fall back to a full scan (see WiFiProvider::JoinScanFanOut()).
+  void StartScan(ScanType scan_type,
+                 const std::string& reason,
+                 const std::set<uint16_t>& scan_partition);
   void StateChanged(const std::string& new_state);
   // Heuristic check if a connection failure was due to bad credentials.
   // Returns true and puts type of failure in |failure| if a credential
@@ -553,6 +627,12 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   void RequestStationInfo();
   void OnReceivedStationInfo(const Nl80211Message& nl80211_message);
   void StopRequestingStationInfo();
+  // Chooses the period of station info requests from the signal strength
+  // |signal_dbm| and the packet counts in |link_statistics_| of the sample
+  // just received.  The signal is compared against the recent samples and
+  // the packet count against the previous sample.  Reschedules the next
+  // request if the period changes.
+  void UpdateStationInfoPeriod(int signal_dbm);
 
   void ConnectToSupplicant();
 
@@ -646,6 +726,15 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   // next scan completes.
   bool need_bss_flush_;
   struct timeval resumed_at_;
+  // Endpoints saved at suspend, keyed by BSSID, and the boottime at which
+  // they were saved.
+  EndpointMap resume_cache_;
+  time_t resume_cache_boottime_;
+  // Endpoints restored from |resume_cache_| that supplicant has not yet
+  // reported again, keyed by BSSID.
+  EndpointMap restored_endpoints_;
+  // Set at resume if we were not connected, until we connect.
+  bool report_resume_to_connected_;
   // Executes when the (foreground) scan timer expires. Calls ScanTimerHandler.
   base::CancelableClosure scan_timer_callback_;
   // Executes when a pending service connect timer expires. Calls
@@ -675,6 +764,10 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   std::unique_ptr<SupplicantEAPStateHandler> eap_state_handler_;
   // Tracks mac80211 state, to diagnose problems such as queue stalls.
   std::unique_ptr<Mac80211Monitor> mac80211_monitor_;
+  // Ranks the endpoints of |current_service_| for roaming.
+  std::unique_ptr<RoamScorer> roam_scorer_;
+  // When we last scanned for roam candidates, or 0 if we never did.
+  time_t roam_scan_at_;
 
   // Properties
   std::string bgscan_method_;
@@ -691,6 +784,9 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   size_t min_frequencies_to_scan_;
   size_t max_frequencies_to_scan_;
   bool scan_all_frequencies_;
+  // Set if |scan_session_| covers only this phy's share of the band (see
+  // WiFiProvider::JoinScanFanOut()).
+  bool partitioned_scan_;
 
   // Holds the list of scan results waiting to be processed and a cancelable
   // closure for processing the pending tasks in PendingScanResultsHandler().
@@ -712,6 +808,16 @@ class WiFi : public Device, public SupplicantEventDelegateInterface {
   // Used to report the current state of our wireless link.
   KeyValueStore link_statistics_;
 
+  // Current period between station info requests.
+  int station_info_period_seconds_;
+  // Signal strengths of the last kStationInfoSignalWindow station info
+  // samples, oldest first.
+  std::deque<int> station_info_signals_dbm_;
+  // Total packet count of the last station info sample, if
+  // |has_station_info_packet_count_|.
+  bool has_station_info_packet_count_;
+  uint32_t station_info_packet_count_;
+
   // Wiphy interface index of this WiFi device.
   uint32_t wiphy_index_;
 
@@ -16,11 +16,17 @@
 
 #include "shill/wifi/wifi_endpoint.h"
 
+#include <string.h>
+
 #include <algorithm>
+#include <deque>
+#include <limits>
 
+#include <base/lazy_instance.h>
 #include <base/stl_util.h>
 #include <base/strings/stringprintf.h>
 #include <base/strings/string_number_conversions.h>
+#include <base/strings/string_piece.h>
 #include <base/strings/string_util.h>
 #if defined(__ANDROID__)
 #include <dbus/service_constants.h>
@@ -50,52 +56,253 @@ static auto kModuleLogScope = ScopeLogger::kWiFi;
 static string ObjectID(WiFiEndpoint* w) { return "(wifi_endpoint)"; }
 }
 
+struct WiFiEndpoint::InternedSSID {
+  vector<uint8_t> ssid;
+  string ssid_string;
+  // Formatted on first use.
+  string ssid_hex;
+  size_t ref_count;
+};
+
+struct WiFiEndpoint::IEParseState {
+  bool found_ht;
+  bool found_vht;
+  bool found_erp;
+  VendorInformation* vendor_information;
+  bool* ieee80211w_required;
+  string* country_code;
+  int* channel_utilization;
+};
+
+// Maps every information element ID to the function that parses it, so
+// that ParseIEs() costs one table lookup and at most one call per element.
+class WiFiEndpoint::IEHandlerTable {
+ public:
+  // |ie| and |end| bound the data of the element, past its header.
+  typedef void (*Handler)(const uint8_t* ie,
+                          const uint8_t* end,
+                          IEParseState* state);
+
+  IEHandlerTable() : handlers_() {
+    handlers_[IEEE_80211::kElemIdBSSLoad] = &HandleBSSLoad;
+    handlers_[IEEE_80211::kElemIdCountry] = &HandleCountry;
+    handlers_[IEEE_80211::kElemIdErp] = &HandleErp;
+    handlers_[IEEE_80211::kElemIdHTCap] = &HandleHT;
+    handlers_[IEEE_80211::kElemIdHTInfo] = &HandleHT;
+    handlers_[IEEE_80211::kElemIdVHTCap] = &HandleVHT;
+    handlers_[IEEE_80211::kElemIdVHTOperation] = &HandleVHT;
+    handlers_[IEEE_80211::kElemIdRSN] = &HandleRSN;
+    handlers_[IEEE_80211::kElemIdVendor] = &HandleVendor;
+  }
+
+  static const IEHandlerTable& GetInstance() { return instance_.Get(); }
+
+  // Returns nullptr for elements that ParseIEs() ignores.
+  Handler Get(uint8_t element_id) const { return handlers_[element_id]; }
+
+ private:
+  static void HandleBSSLoad(const uint8_t* ie,
+                            const uint8_t* end,
+                            IEParseState* state) {
+    // Format of a BSS Load element:
+    //        2                1                     2
+    // +---------------+-------------+--------------------------------+
+    // | Station Count | Channel     | Available Admission Capacity   |
+    // |               | Utilization |                                |
+    // +---------------+-------------+--------------------------------+
+    if (end - ie >= IEEE_80211::kBSSLoadStationCountLen +
+                    IEEE_80211::kBSSLoadChannelUtilizationLen) {
+      *state->channel_utilization = ie[IEEE_80211::kBSSLoadStationCountLen];
+    }
+  }
+
+  static void HandleCountry(const uint8_t* ie,
+                            const uint8_t* end,
+                            IEParseState* state) {
+    // Retrieve 2-character country code from the beginning of the element.
+    if (end - ie >= 2) {
+      state->country_code->assign(reinterpret_cast<const char*>(ie), 2);
+    }
+    // A Country element has always been taken as a sign of 802.11g too.
+    state->found_erp = true;
+  }
+
+  static void HandleErp(const uint8_t* /*ie*/,
+                        const uint8_t* /*end*/,
+                        IEParseState* state) {
+    state->found_erp = true;
+  }
+
+  static void HandleHT(const uint8_t* /*ie*/,
+                       const uint8_t* /*end*/,
+                       IEParseState* state) {
+    state->found_ht = true;
+  }
+
+  static void HandleVHT(const uint8_t* /*ie*/,
+                        const uint8_t* /*end*/,
+                        IEParseState* state) {
+    state->found_vht = true;
+  }
+
+  static void HandleRSN(const uint8_t* ie,
+                        const uint8_t* end,
+                        IEParseState* state) {
+    ParseWPACapabilities(ie, end, state->ieee80211w_required);
+  }
+
+  static void HandleVendor(const uint8_t* ie,
+                           const uint8_t* end,
+                           IEParseState* state) {
+    ParseVendorIE(ie, end, state->vendor_information,
+                  state->ieee80211w_required);
+  }
+
+  static base::LazyInstance<IEHandlerTable> instance_;
+
+  Handler handlers_[256];
+
+  DISALLOW_COPY_AND_ASSIGN(IEHandlerTable);
+};
+
+// static
+base::LazyInstance<WiFiEndpoint::IEHandlerTable>
+    WiFiEndpoint::IEHandlerTable::instance_ = LAZY_INSTANCE_INITIALIZER;
+
+// static
+const size_t WiFiEndpoint::OUISet::kMaxOUIs;
+
+bool WiFiEndpoint::OUISet::insert(uint32_t oui) {
+  uint32_t* position = std::lower_bound(ouis_, ouis_ + size_, oui);
+  if (position != ouis_ + size_ && *position == oui) {
+    return true;
+  }
+  if (size_ == kMaxOUIs) {
+    return false;
+  }
+  std::copy_backward(position, ouis_ + size_, ouis_ + size_ + 1);
+  *position = oui;
+  ++size_;
+  return true;
+}
+
+const uint32_t* WiFiEndpoint::OUISet::find(uint32_t oui) const {
+  const uint32_t* position = std::lower_bound(begin(), end(), oui);
+  return (position != end() && *position == oui) ? position : end();
+}
+
+namespace {
+
+// Interned copies of the network and security mode names of endpoints, so
+// that each endpoint stores a one-byte index rather than its own string.
+// Index 0 is the empty string.
+class ModeNameTable {
+ public:
+  ModeNameTable() : names_(1) {
+    index_by_name_[string()] = 0;
+  }
+
+  uint8_t Intern(const string& name) {
+    const auto it = index_by_name_.find(name);
+    if (it != index_by_name_.end()) {
+      return it->second;
+    }
+    CHECK_LE(names_.size(), std::numeric_limits<uint8_t>::max());
+    uint8_t index = names_.size();
+    names_.push_back(name);
+    index_by_name_[name] = index;
+    return index;
+  }
+
+  const string& Get(uint8_t index) const { return names_[index]; }
+
+ private:
+  // A deque, so that references to the names stay valid as it grows.
+  std::deque<string> names_;
+  map<string, uint8_t> index_by_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModeNameTable);
+};
+
+base::LazyInstance<ModeNameTable> g_mode_names = LAZY_INSTANCE_INITIALIZER;
+
+// The SSIDs shared between endpoints, keyed by the SSID.
+typedef map<vector<uint8_t>, std::unique_ptr<WiFiEndpoint::InternedSSID>>
+    InternedSSIDMap;
+
+base::LazyInstance<InternedSSIDMap> g_ssids = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
 WiFiEndpoint::WiFiEndpoint(ControlInterface* control_interface,
                            const WiFiRefPtr& device,
                            const string& rpc_id,
                            const KeyValueStore& properties)
-    : frequency_(0),
+    : bssid_(0),
+      bssid_length_(0),
+      has_country_code_(false),
+      frequency_(0),
       physical_mode_(Metrics::kWiFiNetworkPhyModeUndef),
       ieee80211w_required_(false),
       control_interface_(control_interface),
       device_(device),
       rpc_id_(rpc_id) {
-  ssid_ = properties.GetUint8s(WPASupplicant::kBSSPropertySSID);
-  bssid_ = properties.GetUint8s(WPASupplicant::kBSSPropertyBSSID);
+  ssid_ = AcquireSSID(properties.GetUint8s(WPASupplicant::kBSSPropertySSID));
+  const vector<uint8_t> bssid =
+      properties.GetUint8s(WPASupplicant::kBSSPropertyBSSID);
+  if (bssid.size() > sizeof(bssid_)) {
+    LOG(ERROR) << "Truncating BSSID of " << bssid.size() << " bytes";
+  }
+  for (uint8_t byte : bssid) {
+    if (bssid_length_ == sizeof(bssid_)) {
+      break;
+    }
+    bssid_ = (bssid_ << 8) | byte;
+    ++bssid_length_;
+  }
   signal_strength_ = properties.GetInt16(WPASupplicant::kBSSPropertySignal);
   if (properties.ContainsUint16(WPASupplicant::kBSSPropertyFrequency)) {
     frequency_ = properties.GetUint16(WPASupplicant::kBSSPropertyFrequency);
   }
 
   Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
-  if (!ParseIEs(properties, &phy_mode, &vendor_information_,
-                &ieee80211w_required_, &country_code_)) {
+  VendorInformation vendor_information;
+  string country_code;
+  int channel_utilization = -1;
+  if (!ParseIEs(properties, &phy_mode, &vendor_information,
+                &ieee80211w_required_, &country_code,
+                &channel_utilization)) {
     phy_mode = DeterminePhyModeFromFrequency(properties, frequency_);
   }
   physical_mode_ = phy_mode;
-
-  network_mode_ = ParseMode(
-      properties.GetString(WPASupplicant::kBSSPropertyMode));
+  if (!vendor_information.wps_manufacturer.empty() ||
+      !vendor_information.wps_model_name.empty() ||
+      !vendor_information.wps_model_number.empty() ||
+      !vendor_information.wps_device_name.empty() ||
+      !vendor_information.oui_set.empty()) {
+    vendor_information_.reset(new VendorInformation(vendor_information));
+  }
+  if (country_code.size() == arraysize(country_code_)) {
+    memcpy(country_code_, country_code.data(), arraysize(country_code_));
+    has_country_code_ = true;
+  }
+  channel_utilization_ = channel_utilization;
+
+  const char* network_mode =
+      ParseMode(properties.GetString(WPASupplicant::kBSSPropertyMode));
+  network_mode_ = g_mode_names.Get().Intern(network_mode ? network_mode : "");
   set_security_mode(ParseSecurity(properties, &security_flags_));
   has_rsn_property_ =
       properties.ContainsKeyValueStore(WPASupplicant::kPropertyRSN);
   has_wpa_property_ =
       properties.ContainsKeyValueStore(WPASupplicant::kPropertyWPA);
 
-  if (network_mode_.empty()) {
-    // XXX log error?
-  }
-
-  ssid_string_ = string(ssid_.begin(), ssid_.end());
-  WiFi::SanitizeSSID(&ssid_string_);
-  ssid_hex_ = base::HexEncode(&(*ssid_.begin()), ssid_.size());
-  bssid_string_ = Device::MakeStringFromHardwareAddress(bssid_);
-  bssid_hex_ = base::HexEncode(&(*bssid_.begin()), bssid_.size());
-
   CheckForTetheringSignature();
 }
 
-WiFiEndpoint::~WiFiEndpoint() {}
+WiFiEndpoint::~WiFiEndpoint() {
+  ReleaseSSID(ssid_);
+}
 
 void WiFiEndpoint::Start() {
   supplicant_bss_proxy_.reset(
@@ -105,32 +312,46 @@ void WiFiEndpoint::Start() {
 void WiFiEndpoint::PropertiesChanged(const KeyValueStore& properties) {
   SLOG(this, 2) << __func__;
   bool should_notify = false;
+  bool signal_changed = false;
   if (properties.ContainsInt16(WPASupplicant::kBSSPropertySignal)) {
-    signal_strength_ = properties.GetInt16(WPASupplicant::kBSSPropertySignal);
-    should_notify = true;
+    int16_t signal_strength =
+        properties.GetInt16(WPASupplicant::kBSSPropertySignal);
+    if (signal_strength != signal_strength_) {
+      signal_strength_ = signal_strength;
+      signal_changed = true;
+    }
   }
 
   if (properties.ContainsString(WPASupplicant::kBSSPropertyMode)) {
     string new_mode =
         ParseMode(properties.GetString(WPASupplicant::kBSSPropertyMode));
-    if (new_mode != network_mode_) {
-      network_mode_ = new_mode;
-      SLOG(this, 2) << "WiFiEndpoint " << bssid_string_ << " mode is now "
-                    << network_mode_;
+    if (new_mode != network_mode()) {
+      network_mode_ = g_mode_names.Get().Intern(new_mode);
+      SLOG(this, 2) << "WiFiEndpoint " << bssid_string() << " mode is now "
+                    << network_mode();
       should_notify = true;
     }
   }
 
-  const char* new_security_mode = ParseSecurity(properties, &security_flags_);
-  if (new_security_mode != security_mode()) {
-    set_security_mode(new_security_mode);
-    SLOG(this, 2) << "WiFiEndpoint " << bssid_string_ << " security is now "
-                  << security_mode();
-    should_notify = true;
+  // Most updates carry only a new signal level, so the security mode is
+  // re-derived only when one of its inputs is present.
+  if (properties.ContainsKeyValueStore(WPASupplicant::kPropertyRSN) ||
+      properties.ContainsKeyValueStore(WPASupplicant::kPropertyWPA) ||
+      properties.ContainsBool(WPASupplicant::kPropertyPrivacy)) {
+    const char* new_security_mode =
+        ParseSecurity(properties, &security_flags_);
+    if (new_security_mode != security_mode()) {
+      set_security_mode(new_security_mode);
+      SLOG(this, 2) << "WiFiEndpoint " << bssid_string() << " security is now "
+                    << security_mode();
+      should_notify = true;
+    }
   }
 
   if (should_notify) {
     device_->NotifyEndpointChanged(this);
+  } else if (signal_changed) {
+    device_->NotifyEndpointSignalChanged(this);
   }
 }
 
@@ -142,30 +363,33 @@ void WiFiEndpoint::UpdateSignalStrength(int16_t strength) {
   SLOG(this, 2) << __func__ << ": signal strength "
                 << signal_strength_ << " -> " << strength;
   signal_strength_ = strength;
-  device_->NotifyEndpointChanged(this);
+  device_->NotifyEndpointSignalChanged(this);
 }
 
 map<string, string> WiFiEndpoint::GetVendorInformation() const {
   map<string, string> vendor_information;
-  if (!vendor_information_.wps_manufacturer.empty()) {
+  if (!vendor_information_) {
+    return vendor_information;
+  }
+  if (!vendor_information_->wps_manufacturer.empty()) {
     vendor_information[kVendorWPSManufacturerProperty] =
-        vendor_information_.wps_manufacturer;
+        vendor_information_->wps_manufacturer;
   }
-  if (!vendor_information_.wps_model_name.empty()) {
+  if (!vendor_information_->wps_model_name.empty()) {
     vendor_information[kVendorWPSModelNameProperty] =
-        vendor_information_.wps_model_name;
+        vendor_information_->wps_model_name;
   }
-  if (!vendor_information_.wps_model_number.empty()) {
+  if (!vendor_information_->wps_model_number.empty()) {
     vendor_information[kVendorWPSModelNumberProperty] =
-        vendor_information_.wps_model_number;
+        vendor_information_->wps_model_number;
   }
-  if (!vendor_information_.wps_device_name.empty()) {
+  if (!vendor_information_->wps_device_name.empty()) {
     vendor_information[kVendorWPSDeviceNameProperty] =
-        vendor_information_.wps_device_name;
+        vendor_information_->wps_device_name;
   }
-  if (!vendor_information_.oui_set.empty()) {
+  if (!vendor_information_->oui_set.empty()) {
     vector<string> oui_vector;
-    for (auto oui : vendor_information_.oui_set) {
+    for (auto oui : vendor_information_->oui_set) {
       oui_vector.push_back(
           StringPrintf("%02x-%02x-%02x",
               oui >> 16, (oui >> 8) & 0xff, oui & 0xff));
@@ -189,27 +413,34 @@ uint32_t WiFiEndpoint::ModeStringToUint(const string& mode_string) {
 }
 
 const vector<uint8_t>& WiFiEndpoint::ssid() const {
-  return ssid_;
+  return ssid_->ssid;
 }
 
 const string& WiFiEndpoint::ssid_string() const {
-  return ssid_string_;
+  return ssid_->ssid_string;
 }
 
 const string& WiFiEndpoint::ssid_hex() const {
-  return ssid_hex_;
+  if (ssid_->ssid_hex.empty() && !ssid_->ssid.empty()) {
+    ssid_->ssid_hex = base::HexEncode(ssid_->ssid.data(), ssid_->ssid.size());
+  }
+  return ssid_->ssid_hex;
 }
 
-const string& WiFiEndpoint::bssid_string() const {
-  return bssid_string_;
+string WiFiEndpoint::bssid_string() const {
+  return Device::MakeStringFromHardwareAddress(GetBSSIDBytes());
 }
 
-const string& WiFiEndpoint::bssid_hex() const {
-  return bssid_hex_;
+string WiFiEndpoint::bssid_hex() const {
+  const vector<uint8_t> bssid = GetBSSIDBytes();
+  return base::HexEncode(bssid.data(), bssid.size());
 }
 
-const string& WiFiEndpoint::country_code() const {
-  return country_code_;
+string WiFiEndpoint::country_code() const {
+  if (!has_country_code_) {
+    return string();
+  }
+  return string(country_code_, arraysize(country_code_));
 }
 
 const WiFiRefPtr& WiFiEndpoint::device() const {
@@ -229,11 +460,11 @@ uint16_t WiFiEndpoint::physical_mode() const {
 }
 
 const string& WiFiEndpoint::network_mode() const {
-  return network_mode_;
+  return g_mode_names.Get().Get(network_mode_);
 }
 
 const string& WiFiEndpoint::security_mode() const {
-  return security_mode_;
+  return g_mode_names.Get().Get(security_mode_);
 }
 
 bool WiFiEndpoint::ieee80211w_required() const {
@@ -252,6 +483,10 @@ bool WiFiEndpoint::has_tethering_signature() const {
   return has_tethering_signature_;
 }
 
+int WiFiEndpoint::channel_utilization() const {
+  return channel_utilization_;
+}
+
 // static
 WiFiEndpoint* WiFiEndpoint::MakeOpenEndpoint(
     ControlInterface* control_interface,
@@ -412,13 +647,15 @@ bool WiFiEndpoint::ParseIEs(
     const KeyValueStore& properties,
     Metrics::WiFiNetworkPhyMode* phy_mode,
     VendorInformation* vendor_information,
-    bool* ieee80211w_required, string* country_code) {
+    bool* ieee80211w_required, string* country_code,
+    int* channel_utilization) {
 
   if (!properties.ContainsUint8s(WPASupplicant::kBSSPropertyIEs)) {
     SLOG(nullptr, 2) << __func__ << ": No IE property in BSS.";
     return false;
   }
-  vector<uint8_t> ies = properties.GetUint8s(WPASupplicant::kBSSPropertyIEs);
+  const vector<uint8_t>& ies =
+      properties.GetUint8s(WPASupplicant::kBSSPropertyIEs);
 
   // Format of an information element:
   //    1       1          1 - 252
@@ -426,50 +663,30 @@ bool WiFiEndpoint::ParseIEs(
   // | Type | Length | Data           |
   // +------+--------+----------------+
   *phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
-  bool found_ht = false;
-  bool found_vht = false;
-  bool found_erp = false;
-  int ie_len = 0;
-  vector<uint8_t>::iterator it;
-  for (it = ies.begin();
-       std::distance(it, ies.end()) > 1;  // Ensure Length field is within PDU.
+  IEParseState state = {false, false, false, vendor_information,
+                        ieee80211w_required, country_code,
+                        channel_utilization};
+  const IEHandlerTable& handlers = IEHandlerTable::GetInstance();
+  const uint8_t* it = ies.data();
+  const uint8_t* const end = it + ies.size();
+  ptrdiff_t ie_len = 0;
+  for (; end - it > 1;  // Ensure Length field is within PDU.
        it += ie_len) {
-    ie_len = 2 + *(it + 1);
-    if (std::distance(it, ies.end()) < ie_len) {
+    ie_len = 2 + it[1];
+    if (end - it < ie_len) {
       LOG(ERROR) << __func__ << ": IE extends past containing PDU.";
       break;
     }
-    switch (*it) {
-      case IEEE_80211::kElemIdCountry:
-        // Retrieve 2-character country code from the beginning of the element.
-        if (ie_len >= 4) {
-          *country_code = string(it + 2, it + 4);
-        }
-      case IEEE_80211::kElemIdErp:
-        found_erp = true;
-        break;
-      case IEEE_80211::kElemIdHTCap:
-      case IEEE_80211::kElemIdHTInfo:
-        found_ht = true;
-        break;
-      case IEEE_80211::kElemIdVHTCap:
-      case IEEE_80211::kElemIdVHTOperation:
-        found_vht = true;
-        break;
-      case IEEE_80211::kElemIdRSN:
-        ParseWPACapabilities(it + 2, it + ie_len, ieee80211w_required);
-        break;
-      case IEEE_80211::kElemIdVendor:
-        ParseVendorIE(it + 2, it + ie_len, vendor_information,
-                      ieee80211w_required);
-        break;
+    IEHandlerTable::Handler handler = handlers.Get(it[0]);
+    if (handler) {
+      handler(it + 2, it + ie_len, &state);
     }
   }
-  if (found_vht) {
+  if (state.found_vht) {
     *phy_mode = Metrics::kWiFiNetworkPhyMode11ac;
-  } else if (found_ht) {
+  } else if (state.found_ht) {
     *phy_mode = Metrics::kWiFiNetworkPhyMode11n;
-  } else if (found_erp) {
+  } else if (state.found_erp) {
     *phy_mode = Metrics::kWiFiNetworkPhyMode11g;
   } else {
     return false;
@@ -479,8 +696,8 @@ bool WiFiEndpoint::ParseIEs(
 
 // static
 void WiFiEndpoint::ParseWPACapabilities(
-    vector<uint8_t>::const_iterator ie,
-    vector<uint8_t>::const_iterator end,
+    const uint8_t* ie,
+    const uint8_t* end,
     bool* ieee80211w_required) {
   // Format of an RSN Information Element:
   //    2             4
@@ -507,7 +724,7 @@ void WiFiEndpoint::ParseWPACapabilities(
   // +-------------------------------+
   // | Group Management Cipher Suite |
   // +-------------------------------+
-  if (std::distance(ie, end) < IEEE_80211::kRSNIECipherCountOffset) {
+  if (end - ie < IEEE_80211::kRSNIECipherCountOffset) {
     return;
   }
   ie += IEEE_80211::kRSNIECipherCountOffset;
@@ -516,26 +733,26 @@ void WiFiEndpoint::ParseWPACapabilities(
   // cipher count followed by n * cipher_selector.
   for (int i = 0; i < IEEE_80211::kRSNIENumCiphers; ++i) {
     // Retrieve a little-endian cipher count.
-    if (std::distance(ie, end) < IEEE_80211::kRSNIECipherCountLen) {
+    if (end - ie < IEEE_80211::kRSNIECipherCountLen) {
       return;
     }
-    uint16_t cipher_count = *ie | (*(ie + 1) << 8);
+    uint16_t cipher_count = ie[0] | (ie[1] << 8);
 
     // Skip over the cipher selectors.
     int skip_length = IEEE_80211::kRSNIECipherCountLen +
       cipher_count * IEEE_80211::kRSNIESelectorLen;
-    if (std::distance(ie, end) < skip_length) {
+    if (end - ie < skip_length) {
       return;
     }
     ie += skip_length;
   }
 
-  if (std::distance(ie, end) < IEEE_80211::kRSNIECapabilitiesLen) {
+  if (end - ie < IEEE_80211::kRSNIECapabilitiesLen) {
     return;
   }
 
   // Retrieve a little-endian capabilities bitfield.
-  uint16_t capabilities = *ie | (*(ie + 1) << 8);
+  uint16_t capabilities = ie[0] | (ie[1] << 8);
 
   if (capabilities & IEEE_80211::kRSNCapabilityFrameProtectionRequired &&
       ieee80211w_required) {
@@ -547,8 +764,8 @@ void WiFiEndpoint::ParseWPACapabilities(
 
 
 // static
-void WiFiEndpoint::ParseVendorIE(vector<uint8_t>::const_iterator ie,
-                                 vector<uint8_t>::const_iterator end,
+void WiFiEndpoint::ParseVendorIE(const uint8_t* ie,
+                                 const uint8_t* end,
                                  VendorInformation* vendor_information,
                                  bool* ieee80211w_required) {
   // Format of an vendor-specific information element (with type
@@ -558,12 +775,12 @@ void WiFiEndpoint::ParseVendorIE(vector<uint8_t>::const_iterator ie,
   // | OUI        | OUI Type | Data           |
   // +------------+----------+----------------+
 
-  if (std::distance(ie, end) < 4) {
+  if (end - ie < 4) {
     LOG(ERROR) << __func__ << ": no room in IE for OUI and type field.";
     return;
   }
-  uint32_t oui = (*ie << 16) | (*(ie + 1) << 8) | *(ie + 2);
-  uint8_t oui_type = *(ie + 3);
+  uint32_t oui = (ie[0] << 16) | (ie[1] << 8) | ie[2];
+  uint8_t oui_type = ie[3];
   ie += 4;
 
   if (oui == IEEE_80211::kOUIVendorMicrosoft &&
@@ -573,30 +790,34 @@ void WiFiEndpoint::ParseVendorIE(vector<uint8_t>::const_iterator ie,
     // +------+--------+----------------+
     // | Type | Length | Data           |
     // +------+--------+----------------+
-    while (std::distance(ie, end) >= 4) {
-      int element_type = (*ie << 8) | *(ie + 1);
-      int element_length = (*(ie + 2) << 8) | *(ie + 3);
+    while (end - ie >= 4) {
+      int element_type = (ie[0] << 8) | ie[1];
+      int element_length = (ie[2] << 8) | ie[3];
       ie += 4;
-      if (std::distance(ie, end) < element_length) {
+      if (end - ie < element_length) {
         LOG(ERROR) << __func__ << ": WPS element extends past containing PDU.";
         break;
       }
-      string s(ie, ie + element_length);
-      if (base::IsStringASCII(s)) {
-        switch (element_type) {
-          case IEEE_80211::kWPSElementManufacturer:
-            vendor_information->wps_manufacturer = s;
-            break;
-          case IEEE_80211::kWPSElementModelName:
-            vendor_information->wps_model_name = s;
-            break;
-          case IEEE_80211::kWPSElementModelNumber:
-            vendor_information->wps_model_number = s;
-            break;
-          case IEEE_80211::kWPSElementDeviceName:
-            vendor_information->wps_device_name = s;
-            break;
-        }
+      // Only copy out the elements we keep.
+      string* field = nullptr;
+      switch (element_type) {
+        case IEEE_80211::kWPSElementManufacturer:
+          field = &vendor_information->wps_manufacturer;
+          break;
+        case IEEE_80211::kWPSElementModelName:
+          field = &vendor_information->wps_model_name;
+          break;
+        case IEEE_80211::kWPSElementModelNumber:
+          field = &vendor_information->wps_model_number;
+          break;
+        case IEEE_80211::kWPSElementDeviceName:
+          field = &vendor_information->wps_device_name;
+          break;
+      }
+      base::StringPiece value(reinterpret_cast<const char*>(ie),
+                              element_length);
+      if (field && base::IsStringASCII(value)) {
+        value.CopyToString(field);
       }
       ie += element_length;
     }
@@ -610,10 +831,62 @@ void WiFiEndpoint::ParseVendorIE(vector<uint8_t>::const_iterator ie,
 }
 
 void WiFiEndpoint::CheckForTetheringSignature() {
+  const vector<uint8_t> bssid = GetBSSIDBytes();
   has_tethering_signature_ =
-      Tethering::IsAndroidBSSID(bssid_) ||
-      (Tethering::IsLocallyAdministeredBSSID(bssid_) &&
-       Tethering::HasIosOui(vendor_information_.oui_set));
+      Tethering::IsAndroidBSSID(bssid) ||
+      (Tethering::IsLocallyAdministeredBSSID(bssid) && vendor_information_ &&
+       Tethering::HasIosOui(vendor_information_->oui_set.begin(),
+                            vendor_information_->oui_set.end()));
+}
+
+vector<uint8_t> WiFiEndpoint::GetBSSIDBytes() const {
+  vector<uint8_t> bssid(bssid_length_);
+  uint64_t packed = bssid_;
+  for (auto it = bssid.rbegin(); it != bssid.rend(); ++it) {
+    *it = packed & 0xff;
+    packed >>= 8;
+  }
+  return bssid;
+}
+
+WiFiEndpoint::VendorInformation* WiFiEndpoint::mutable_vendor_information() {
+  if (!vendor_information_) {
+    vendor_information_.reset(new VendorInformation());
+  }
+  return vendor_information_.get();
+}
+
+void WiFiEndpoint::set_security_mode(const string& mode) {
+  security_mode_ = g_mode_names.Get().Intern(mode);
+}
+
+// static
+WiFiEndpoint::InternedSSID* WiFiEndpoint::AcquireSSID(
+    const vector<uint8_t>& ssid) {
+  std::unique_ptr<InternedSSID>& interned_ssid = g_ssids.Get()[ssid];
+  if (!interned_ssid) {
+    interned_ssid.reset(new InternedSSID());
+    interned_ssid->ssid = ssid;
+    interned_ssid->ssid_string = string(ssid.begin(), ssid.end());
+    WiFi::SanitizeSSID(&interned_ssid->ssid_string);
+    interned_ssid->ref_count = 0;
+  }
+  ++interned_ssid->ref_count;
+  return interned_ssid.get();
+}
+
+// static
+void WiFiEndpoint::ReleaseSSID(InternedSSID* ssid) {
+  DCHECK_GT(ssid->ref_count, 0U);
+  if (--ssid->ref_count == 0) {
+    InternedSSIDMap* ssids = g_ssids.Pointer();
+    ssids->erase(ssids->find(ssid->ssid));
+  }
+}
+
+// static
+size_t WiFiEndpoint::GetInternedSSIDCount() {
+  return g_ssids.Get().size();
 }
 
 }  // namespace shill
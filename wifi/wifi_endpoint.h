@@ -51,13 +51,40 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
     bool wpa_psk;
     bool privacy;
   };
+  // A set of vendor OUIs kept inline in ascending order, so that parsing
+  // the IEs of a BSS does not allocate for it.  A BSS seldom advertises more
+  // than a few vendors; OUIs beyond |kMaxOUIs| are dropped.
+  class OUISet {
+   public:
+    static const size_t kMaxOUIs = 8;
+
+    OUISet() : size_(0) {}
+
+    // Adds |oui|.  Returns false if |oui| is new and the set is full.
+    bool insert(uint32_t oui);
+    // Returns end() if |oui| is not in the set.
+    const uint32_t* find(uint32_t oui) const;
+
+    const uint32_t* begin() const { return ouis_; }
+    const uint32_t* end() const { return ouis_ + size_; }
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+   private:
+    uint32_t ouis_[kMaxOUIs];
+    size_t size_;
+  };
   struct VendorInformation {
     std::string wps_manufacturer;
     std::string wps_model_name;
     std::string wps_model_number;
     std::string wps_device_name;
-    std::set<uint32_t> oui_set;
+    OUISet oui_set;
   };
+  // An SSID and its printable forms, shared by all endpoints that advertise
+  // it (see wifi_endpoint.cc).
+  struct InternedSSID;
+
   WiFiEndpoint(ControlInterface* control_interface,
                const WiFiRefPtr& device,
                const std::string& rpc_id,
@@ -87,9 +114,9 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
   const std::vector<uint8_t>& ssid() const;
   const std::string& ssid_string() const;
   const std::string& ssid_hex() const;
-  const std::string& bssid_string() const;
-  const std::string& bssid_hex() const;
-  const std::string& country_code() const;
+  std::string bssid_string() const;
+  std::string bssid_hex() const;
+  std::string country_code() const;
   const WiFiRefPtr& device() const;
   int16_t signal_strength() const;
   uint16_t frequency() const;
@@ -100,8 +127,12 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
   bool has_rsn_property() const;
   bool has_wpa_property() const;
   bool has_tethering_signature() const;
+  // Returns the channel utilization advertised in the BSS Load element,
+  // scaled to [0, 255], or -1 if the BSS did not advertise one.
+  int channel_utilization() const;
 
  private:
+  friend class RoamScorerTest;  // for MakeOpenEndpoint
   friend class WiFiEndpointTest;
   friend class WiFiObjectTest;  // for MakeOpenEndpoint
   friend class WiFiProviderTest;  // for MakeOpenEndpoint
@@ -112,6 +143,7 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
   FRIEND_TEST(WiFiEndpointTest, ParseKeyManagementMethodsPSK);
   FRIEND_TEST(WiFiEndpointTest, ParseKeyManagementMethodsEAPAndPSK);
   FRIEND_TEST(WiFiEndpointTest, HasTetheringSignature);
+  FRIEND_TEST(WiFiEndpointTest, LargeScanTableSharesStrings);
   FRIEND_TEST(WiFiProviderTest, OnEndpointAddedWithSecurity);
   FRIEND_TEST(WiFiProviderTest, OnEndpointUpdated);
   FRIEND_TEST(WiFiServiceTest, ConnectTaskWPA80211w);
@@ -126,6 +158,15 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
     kKeyManagementPSK
   };
 
+  // Returns the entry for |ssid| in the table of interned SSIDs, adding it
+  // if necessary, and takes a reference to it.
+  static InternedSSID* AcquireSSID(const std::vector<uint8_t>& ssid);
+  // Drops a reference taken by AcquireSSID(), removing |ssid| from the
+  // table once no endpoint uses it.
+  static void ReleaseSSID(InternedSSID* ssid);
+  // Returns the number of distinct SSIDs currently interned.
+  static size_t GetInternedSSIDCount();
+
   // Build a simple WiFiEndpoint, for testing purposes.
   static WiFiEndpoint* MakeEndpoint(ControlInterface* control_interface,
                                     const WiFiRefPtr& wifi,
@@ -166,52 +207,70 @@ class WiFiEndpoint : public base::RefCounted<WiFiEndpoint> {
       const KeyValueStore& properties,
       uint16_t frequency);
   // Parse information elements to determine the physical mode, vendor
-  // information and IEEE 802.11w requirement information associated
-  // with the AP.  Returns true if a physical mode was determined from
-  // the IE elements, false otherwise.
+  // information, IEEE 802.11w requirement and channel utilization
+  // information associated with the AP.  Returns true if a physical mode
+  // was determined from the IE elements, false otherwise.  The elements
+  // are scanned in place in a single pass, dispatched through a table of
+  // handlers indexed by element ID; only the fields recorded in
+  // |vendor_information| and |country_code| are copied out.
   static bool ParseIEs(const KeyValueStore& properties,
                        Metrics::WiFiNetworkPhyMode* phy_mode,
                        VendorInformation* vendor_information,
-                       bool* ieee80211w_required, std::string* country_code);
-  // Parse a WPA information element and set *|ieee80211w_required| to true
-  // if IEEE 802.11w is required by this AP.
-  static void ParseWPACapabilities(std::vector<uint8_t>::const_iterator ie,
-                                   std::vector<uint8_t>::const_iterator end,
+                       bool* ieee80211w_required, std::string* country_code,
+                       int* channel_utilization);
+  // Parse a WPA information element spanning [|ie|, |end|) and set
+  // *|ieee80211w_required| to true if IEEE 802.11w is required by this AP.
+  static void ParseWPACapabilities(const uint8_t* ie,
+                                   const uint8_t* end,
                                    bool* ieee80211w_required);
-  // Parse a single vendor information element.  If this is a WPA vendor
-  // element, call ParseWPACapabilites with |ieee80211w_required|.
-  static void ParseVendorIE(std::vector<uint8_t>::const_iterator ie,
-                            std::vector<uint8_t>::const_iterator end,
+  // Parse a single vendor information element spanning [|ie|, |end|).  If
+  // this is a WPA vendor element, call ParseWPACapabilites with
+  // |ieee80211w_required|.
+  static void ParseVendorIE(const uint8_t* ie,
+                            const uint8_t* end,
                             VendorInformation* vendor_information,
                             bool* ieee80211w_required);
+  // The outputs of ParseIEs(), and the table of functions that fill them in
+  // for each element ID (see wifi_endpoint.cc).
+  struct IEParseState;
+  class IEHandlerTable;
 
   // Assigns a value to |has_tethering_signature_|.
   void CheckForTetheringSignature();
 
+  // Returns the BSSID unpacked into bytes.
+  std::vector<uint8_t> GetBSSIDBytes() const;
+
+  // Returns |vendor_information_|, allocating it if the endpoint has none.
+  VendorInformation* mutable_vendor_information();
+
   // Private setter used in unit tests.
-  void set_security_mode(const std::string& mode) { security_mode_ = mode; }
-
-  // TODO(quiche): make const?
-  std::vector<uint8_t> ssid_;
-  std::vector<uint8_t> bssid_;
-  std::string ssid_string_;
-  std::string ssid_hex_;
-  std::string bssid_string_;
-  std::string bssid_hex_;
-  std::string country_code_;
+  void set_security_mode(const std::string& mode);
+
+  // Endpoints are kept for every BSS in range, so they are stored compactly:
+  // the SSID is shared between endpoints, the BSSID and country code are
+  // packed in place, and the mode and security names are indices into a
+  // table of interned strings.  Other forms are formatted on demand.
+  InternedSSID* ssid_;
+  uint64_t bssid_;
+  uint8_t bssid_length_;
+  char country_code_[2];
+  bool has_country_code_;
   int16_t signal_strength_;
   uint16_t frequency_;
   uint16_t physical_mode_;
   // network_mode_ and security_mode_ are represented as flimflam names
   // (not necessarily the same as wpa_supplicant names)
-  std::string network_mode_;
-  std::string security_mode_;
-  VendorInformation vendor_information_;
+  uint8_t network_mode_;
+  uint8_t security_mode_;
+  int16_t channel_utilization_;
   bool ieee80211w_required_;
   bool has_rsn_property_;
   bool has_wpa_property_;
   bool has_tethering_signature_;
   SecurityFlags security_flags_;
+  // Only allocated if the BSS advertises vendor information.
+  std::unique_ptr<VendorInformation> vendor_information_;
 
   ControlInterface* control_interface_;
   WiFiRefPtr device_;
@@ -16,12 +16,14 @@
 
 #include "shill/wifi/wifi_endpoint.h"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <string>
 #include <vector>
 
 #include <base/stl_util.h>
+#include <base/strings/stringprintf.h>
 #if defined(__ANDROID__)
 #include <dbus/service_constants.h>
 #else
@@ -38,6 +40,7 @@
 #include "shill/tethering.h"
 #include "shill/wifi/mock_wifi.h"
 
+using base::StringPrintf;
 using std::map;
 using std::set;
 using std::string;
@@ -179,15 +182,21 @@ class WiFiEndpointTest : public PropertyStoreTest {
   bool ParseIEs(const KeyValueStore& properties,
                 Metrics::WiFiNetworkPhyMode* phy_mode,
                 WiFiEndpoint::VendorInformation* vendor_information,
-                bool* ieee80211w_required, std::string* country_code) {
+                bool* ieee80211w_required, std::string* country_code,
+                int* channel_utilization = nullptr) {
+    int unused_channel_utilization;
+    if (!channel_utilization) {
+      channel_utilization = &unused_channel_utilization;
+    }
     return WiFiEndpoint::ParseIEs(properties, phy_mode, vendor_information,
-                                  ieee80211w_required, country_code);
+                                  ieee80211w_required, country_code,
+                                  channel_utilization);
   }
 
   void SetVendorInformation(
       const WiFiEndpointRefPtr& endpoint,
       const WiFiEndpoint::VendorInformation& vendor_information) {
-    endpoint->vendor_information_ = vendor_information;
+    *endpoint->mutable_vendor_information() = vendor_information;
   }
 
   WiFiEndpoint* MakeEndpoint(ControlInterface* control_interface,
@@ -299,6 +308,44 @@ TEST_F(WiFiEndpointTest, SSIDWithNull) {
   EXPECT_EQ("?", endpoint->ssid_string());
 }
 
+TEST_F(WiFiEndpointTest, LargeScanTableSharesStrings) {
+  // A dense environment: 5000 BSSes advertising 50 SSIDs between them.
+  const int kNumEndpoints = 5000;
+  const int kNumSSIDs = 50;
+  const size_t initial_ssid_count = WiFiEndpoint::GetInternedSSIDCount();
+  vector<WiFiEndpointRefPtr> endpoints;
+  for (int i = 0; i < kNumEndpoints; ++i) {
+    endpoints.push_back(MakeOpenEndpoint(
+        nullptr, nullptr, StringPrintf("ssid%d", i % kNumSSIDs),
+        StringPrintf("00:00:00:00:%02x:%02x", i >> 8, i & 0xff)));
+  }
+  EXPECT_EQ(initial_ssid_count + kNumSSIDs,
+            WiFiEndpoint::GetInternedSSIDCount());
+
+  // Endpoints share their SSID and mode strings rather than copying them.
+  EXPECT_EQ(&endpoints[0]->ssid_string(),
+            &endpoints[kNumSSIDs]->ssid_string());
+  EXPECT_EQ(&endpoints[0]->ssid(), &endpoints[kNumSSIDs]->ssid());
+  EXPECT_EQ(&endpoints[0]->network_mode(), &endpoints[1]->network_mode());
+  EXPECT_EQ(&endpoints[0]->security_mode(), &endpoints[1]->security_mode());
+  EXPECT_EQ("ssid49", endpoints.back()->ssid_string());
+  EXPECT_EQ("737369643439", endpoints.back()->ssid_hex());
+  EXPECT_EQ("00:00:00:00:13:87", endpoints.back()->bssid_string());
+  EXPECT_EQ("000000001387", endpoints.back()->bssid_hex());
+  EXPECT_TRUE(endpoints.back()->country_code().empty());
+  EXPECT_TRUE(endpoints.back()->GetVendorInformation().empty());
+
+  // What remains per endpoint is a small fixed-size object (the strings
+  // and vendor information used to take over 500 bytes on 64-bit hosts).
+  LOG(INFO) << kNumEndpoints << " endpoints take about "
+            << kNumEndpoints * sizeof(WiFiEndpoint) << " bytes";
+  EXPECT_LE(sizeof(WiFiEndpoint), 192U);
+
+  // Interned SSIDs go away with the last endpoint that uses them.
+  endpoints.clear();
+  EXPECT_EQ(initial_ssid_count, WiFiEndpoint::GetInternedSSIDCount());
+}
+
 TEST_F(WiFiEndpointTest, DeterminePhyModeFromFrequency) {
   {
     KeyValueStore properties;
@@ -685,6 +732,132 @@ TEST_F(WiFiEndpointTest, ParseCountryCode) {
   }
 }
 
+TEST_F(WiFiEndpointTest, ParseChannelUtilization) {
+  {
+    vector<uint8_t> ies;
+    Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+    WiFiEndpoint::VendorInformation vendor_information;
+    int channel_utilization = -1;
+    ParseIEs(MakeBSSPropertiesWithIEs(ies), &phy_mode, &vendor_information,
+             nullptr, nullptr, &channel_utilization);
+    EXPECT_EQ(-1, channel_utilization);
+  }
+  {
+    // Truncated before the channel utilization field.
+    vector<uint8_t> ies;
+    AddIEWithData(IEEE_80211::kElemIdBSSLoad, vector<uint8_t>{3, 0}, &ies);
+    Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+    WiFiEndpoint::VendorInformation vendor_information;
+    int channel_utilization = -1;
+    ParseIEs(MakeBSSPropertiesWithIEs(ies), &phy_mode, &vendor_information,
+             nullptr, nullptr, &channel_utilization);
+    EXPECT_EQ(-1, channel_utilization);
+  }
+  {
+    vector<uint8_t> ies;
+    AddIEWithData(IEEE_80211::kElemIdBSSLoad,
+                  vector<uint8_t>{3, 0, 200, 0, 0}, &ies);
+    Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+    WiFiEndpoint::VendorInformation vendor_information;
+    int channel_utilization = -1;
+    ParseIEs(MakeBSSPropertiesWithIEs(ies), &phy_mode, &vendor_information,
+             nullptr, nullptr, &channel_utilization);
+    EXPECT_EQ(200, channel_utilization);
+  }
+}
+
+TEST_F(WiFiEndpointTest, ParseIEsMalformed) {
+  const uint32_t kVendorOUI = 0x123456;
+  vector<uint8_t> ies;
+  const string kCountryCode("US ");
+  AddIEWithData(IEEE_80211::kElemIdCountry,
+                vector<uint8_t>(kCountryCode.begin(), kCountryCode.end()),
+                &ies);
+  AddIE(IEEE_80211::kElemIdErp, &ies);
+  AddIE(IEEE_80211::kElemIdHTCap, &ies);
+  AddIEWithData(IEEE_80211::kElemIdRSN,
+                MakeRSNProperties(
+                    1, 1, IEEE_80211::kRSNCapabilityFrameProtectionRequired),
+                &ies);
+  const size_t kRSNEnd = ies.size();
+  vector<uint8_t> wps;
+  AddWPSElement(IEEE_80211::kWPSElementManufacturer, "manufacturer", &wps);
+  AddVendorIE(IEEE_80211::kOUIVendorMicrosoft, IEEE_80211::kOUIMicrosoftWPS,
+              wps, &ies);
+  AddVendorIE(IEEE_80211::kOUIVendorMicrosoft, IEEE_80211::kOUIMicrosoftWPA,
+              MakeRSNProperties(1, 1, 0), &ies);
+  AddVendorIE(kVendorOUI, 0, vector<uint8_t>(), &ies);
+
+  // Every truncation and a deterministic set of single-byte corruptions of
+  // the element list must be rejected or parsed without reading past it.
+  for (size_t length = 0; length < ies.size(); ++length) {
+    Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+    WiFiEndpoint::VendorInformation vendor_information;
+    bool ieee80211w_required = false;
+    string country_code;
+    ParseIEs(MakeBSSPropertiesWithIEs(
+                 vector<uint8_t>(ies.begin(), ies.begin() + length)),
+             &phy_mode, &vendor_information, &ieee80211w_required,
+             &country_code);
+    // Only a complete RSN element requires frame protection; the WPA
+    // element that follows it does not.
+    EXPECT_EQ(length >= kRSNEnd, ieee80211w_required) << length;
+    EXPECT_TRUE(country_code.empty() || country_code.size() == 2) << length;
+  }
+  uint32_t seed = 1;
+  for (int i = 0; i < 1000; ++i) {
+    vector<uint8_t> corrupted(ies);
+    seed = seed * 1103515245 + 12345;
+    corrupted[(seed >> 8) % corrupted.size()] = seed >> 24;
+    Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+    WiFiEndpoint::VendorInformation vendor_information;
+    bool ieee80211w_required = false;
+    string country_code;
+    ParseIEs(MakeBSSPropertiesWithIEs(corrupted), &phy_mode,
+             &vendor_information, &ieee80211w_required, &country_code);
+    EXPECT_TRUE(country_code.empty() || country_code.size() == 2) << i;
+    EXPECT_LE(vendor_information.wps_manufacturer.size(), corrupted.size())
+        << i;
+  }
+
+  Metrics::WiFiNetworkPhyMode phy_mode = Metrics::kWiFiNetworkPhyModeUndef;
+  WiFiEndpoint::VendorInformation vendor_information;
+  bool ieee80211w_required = false;
+  string country_code;
+  EXPECT_TRUE(ParseIEs(MakeBSSPropertiesWithIEs(ies), &phy_mode,
+                       &vendor_information, &ieee80211w_required,
+                       &country_code));
+  EXPECT_EQ(Metrics::kWiFiNetworkPhyMode11n, phy_mode);
+  EXPECT_EQ("US", country_code);
+  EXPECT_TRUE(ieee80211w_required);
+  EXPECT_EQ("manufacturer", vendor_information.wps_manufacturer);
+  EXPECT_TRUE(ContainsKey(vendor_information.oui_set, kVendorOUI));
+}
+
+TEST_F(WiFiEndpointTest, OUISet) {
+  WiFiEndpoint::OUISet oui_set;
+  EXPECT_TRUE(oui_set.empty());
+  EXPECT_TRUE(oui_set.insert(0x00aabb));
+  EXPECT_TRUE(oui_set.insert(0x001122));
+  EXPECT_TRUE(oui_set.insert(0x00aabb));
+  EXPECT_EQ(2, oui_set.size());
+  EXPECT_EQ(vector<uint32_t>({0x001122, 0x00aabb}),
+            vector<uint32_t>(oui_set.begin(), oui_set.end()));
+  EXPECT_TRUE(oui_set.find(0x003344) == oui_set.end());
+
+  // Once the set is full, new OUIs are dropped but known ones still fit.
+  for (uint32_t oui = 1; oui_set.size() < WiFiEndpoint::OUISet::kMaxOUIs;
+       ++oui) {
+    EXPECT_TRUE(oui_set.insert(oui));
+  }
+  EXPECT_FALSE(oui_set.insert(0xffffff));
+  EXPECT_TRUE(oui_set.insert(0x001122));
+  EXPECT_EQ(WiFiEndpoint::OUISet::kMaxOUIs, oui_set.size());
+  EXPECT_TRUE(oui_set.find(0xffffff) == oui_set.end());
+  EXPECT_TRUE(ContainsKey(oui_set, 0x00aabb));
+  EXPECT_TRUE(std::is_sorted(oui_set.begin(), oui_set.end()));
+}
+
 TEST_F(WiFiEndpointTest, PropertiesChangedNone) {
   WiFiEndpointRefPtr endpoint =
       MakeOpenEndpoint(nullptr, wifi(), "ssid", "00:00:00:00:00:01");
@@ -707,9 +880,32 @@ TEST_F(WiFiEndpointTest, PropertiesChangedStrength) {
   changed_properties.SetInt16(WPASupplicant::kBSSPropertySignal,
                               signal_strength);
 
-  EXPECT_CALL(*wifi(), NotifyEndpointChanged(_));
+  EXPECT_CALL(*wifi(), NotifyEndpointChanged(_)).Times(0);
+  EXPECT_CALL(*wifi(), NotifyEndpointSignalChanged(_));
   endpoint->PropertiesChanged(changed_properties);
   EXPECT_EQ(signal_strength, endpoint->signal_strength());
+  Mock::VerifyAndClearExpectations(wifi().get());
+
+  // An unchanged signal strength is not reported.
+  EXPECT_CALL(*wifi(), NotifyEndpointChanged(_)).Times(0);
+  EXPECT_CALL(*wifi(), NotifyEndpointSignalChanged(_)).Times(0);
+  endpoint->PropertiesChanged(changed_properties);
+}
+
+TEST_F(WiFiEndpointTest, PropertiesChangedStrengthAndMode) {
+  WiFiEndpointRefPtr endpoint =
+      MakeOpenEndpoint(nullptr, wifi(), "ssid", "00:00:00:00:00:01");
+  KeyValueStore changed_properties;
+  changed_properties.SetInt16(WPASupplicant::kBSSPropertySignal, 10);
+  changed_properties.SetString(WPASupplicant::kBSSPropertyMode,
+                               WPASupplicant::kNetworkModeAdHoc);
+
+  // A full update subsumes the signal-only notification.
+  EXPECT_CALL(*wifi(), NotifyEndpointChanged(_));
+  EXPECT_CALL(*wifi(), NotifyEndpointSignalChanged(_)).Times(0);
+  endpoint->PropertiesChanged(changed_properties);
+  EXPECT_EQ(10, endpoint->signal_strength());
+  EXPECT_EQ(kModeAdhoc, endpoint->network_mode());
 }
 
 TEST_F(WiFiEndpointTest, PropertiesChangedNetworkMode) {
@@ -819,7 +1015,7 @@ TEST_F(WiFiEndpointTest, HasTetheringSignature) {
     WiFiEndpointRefPtr endpoint = MakeEndpoint(
         nullptr, wifi(), "ssid", "02:1a:10:00:00:01", false, false);
     EXPECT_FALSE(endpoint->has_tethering_signature());
-    endpoint->vendor_information_.oui_set.insert(Tethering::kIosOui);
+    endpoint->mutable_vendor_information()->oui_set.insert(Tethering::kIosOui);
     endpoint->CheckForTetheringSignature();
     EXPECT_TRUE(endpoint->has_tethering_signature());
   }
@@ -827,7 +1023,7 @@ TEST_F(WiFiEndpointTest, HasTetheringSignature) {
     WiFiEndpointRefPtr endpoint = MakeEndpoint(
         nullptr, wifi(), "ssid", "04:1a:10:00:00:01", false, false);
     EXPECT_FALSE(endpoint->has_tethering_signature());
-    endpoint->vendor_information_.oui_set.insert(Tethering::kIosOui);
+    endpoint->mutable_vendor_information()->oui_set.insert(Tethering::kIosOui);
     endpoint->CheckForTetheringSignature();
     EXPECT_FALSE(endpoint->has_tethering_signature());
   }
@@ -17,6 +17,7 @@
 #include "shill/wifi/wifi_provider.h"
 
 #include <stdlib.h>
+#include <time.h>
 
 #include <algorithm>
 #include <limits>
@@ -26,6 +27,7 @@
 
 #include <base/bind.h>
 #include <base/format_macros.h>
+#include <base/stl_util.h>
 #include <base/strings/string_number_conversions.h>
 #include <base/strings/string_split.h>
 #include <base/strings/string_util.h>
@@ -83,6 +85,13 @@ const char WiFiProvider::kStorageFrequencies[] = "Frequencies";
 const int WiFiProvider::kMaxStorageFrequencies = 20;
 const time_t WiFiProvider::kWeeksToKeepFrequencyCounts = 3;
 const time_t WiFiProvider::kSecondsPerWeek = 60 * 60 * 24 * 7;
+const int WiFiProvider::kSightingTimeOfDayBuckets = 6;
+const int64_t WiFiProvider::kMaxSightingsPerBucket = 1000;
+const int64_t WiFiProvider::kConnectionSightingWeight = 10;
+
+namespace {
+const time_t kSecondsPerDay = 60 * 60 * 24;
+}  // namespace
 
 WiFiProvider::WiFiProvider(ControlInterface* control_interface,
                            EventDispatcher* dispatcher,
@@ -94,7 +103,9 @@ WiFiProvider::WiFiProvider(ControlInterface* control_interface,
       manager_(manager),
       running_(false),
       total_frequency_connections_(-1L),
+      sighting_count_by_time_of_day_(kSightingTimeOfDayBuckets),
       time_(Time::GetInstance()),
+      scan_fan_out_started_(false),
       disable_vht_(false) {}
 
 WiFiProvider::~WiFiProvider() {}
@@ -285,6 +296,11 @@ void WiFiProvider::OnEndpointAdded(const WiFiEndpointConstRefPtr& endpoint) {
     return;
   }
 
+  RecordSighting(endpoint->frequency());
+  AssignEndpoint(endpoint);
+}
+
+void WiFiProvider::AssignEndpoint(const WiFiEndpointConstRefPtr& endpoint) {
   WiFiServiceRefPtr service = FindService(endpoint->ssid(),
                                           endpoint->network_mode(),
                                           endpoint->security_mode());
@@ -353,9 +369,21 @@ void WiFiProvider::OnEndpointUpdated(const WiFiEndpointConstRefPtr& endpoint) {
 
   // The endpoint no longer matches the associated service.  Remove the
   // endpoint, so current references to the endpoint are reset, then add
-  // it again so it can be associated with a new service.
+  // it again so it can be associated with a new service.  This is the same
+  // sighting as when the endpoint was added, so it is not counted again.
   OnEndpointRemoved(endpoint);
-  OnEndpointAdded(endpoint);
+  AssignEndpoint(endpoint);
+}
+
+void WiFiProvider::OnEndpointSignalChanged(
+    const WiFiEndpointConstRefPtr& endpoint) {
+  if (!running_) {
+    return;
+  }
+
+  WiFiService* service = FindServiceForEndpoint(endpoint).get();
+  CHECK(service);
+  service->NotifyEndpointSignalChanged(endpoint);
 }
 
 bool WiFiProvider::OnServiceUnloaded(const WiFiServiceRefPtr& service) {
@@ -791,14 +819,159 @@ void WiFiProvider::IncrementConnectCount(uint16_t frequency_mhz) {
 }
 
 WiFiProvider::FrequencyCountList WiFiProvider::GetScanFrequencies() const {
-  FrequencyCountList freq_connects_list;
+  ConnectFrequencyMap weight_by_frequency =
+      sighting_count_by_time_of_day_[GetSightingBucket()];
   for (const auto freq_count : connect_count_by_frequency_) {
-    freq_connects_list.push_back(FrequencyCount(freq_count.first,
-                                                freq_count.second));
+    weight_by_frequency[freq_count.first] +=
+        freq_count.second * kConnectionSightingWeight;
+  }
+  FrequencyCountList freq_connects_list;
+  for (const auto freq_weight : weight_by_frequency) {
+    freq_connects_list.push_back(FrequencyCount(freq_weight.first,
+                                                freq_weight.second));
   }
   return freq_connects_list;
 }
 
+void WiFiProvider::RegisterScanDevice(const WiFi* wifi,
+                                      const string& phy_name,
+                                      const set<uint16_t>& frequencies) {
+  for (auto& device : scan_devices_) {
+    if (device.wifi == wifi) {
+      device.phy_name = phy_name;
+      device.frequencies = frequencies;
+      return;
+    }
+  }
+  scan_devices_.push_back(ScanDevice{wifi, phy_name, frequencies});
+}
+
+void WiFiProvider::DeregisterScanDevice(const WiFi* wifi) {
+  for (auto it = scan_devices_.begin(); it != scan_devices_.end(); ++it) {
+    if (it->wifi == wifi) {
+      scan_devices_.erase(it);
+      return;
+    }
+  }
+}
+
+void WiFiProvider::StartScanFanOut() {
+  scan_fan_out_started_ = true;
+  scan_fan_out_members_.clear();
+}
+
+bool WiFiProvider::JoinScanFanOut(const WiFi* wifi,
+                                  const ScanPartitionCallback& callback) {
+  if (!scan_fan_out_started_) {
+    return false;
+  }
+  scan_fan_out_members_.push_back(ScanFanOutMember{wifi, callback});
+  return true;
+}
+
+void WiFiProvider::FinishScanFanOut() {
+  if (!scan_fan_out_started_) {
+    return;
+  }
+  scan_fan_out_started_ = false;
+  vector<ScanFanOutMember> members;
+  members.swap(scan_fan_out_members_);
+  std::map<const WiFi*, set<uint16_t>> partitions =
+      GetScanPartitions(members);
+  for (const auto& member : members) {
+    member.callback.Run(partitions[member.wifi]);
+  }
+}
+
+std::map<const WiFi*, set<uint16_t>> WiFiProvider::GetScanPartitions(
+    const vector<ScanFanOutMember>& members) const {
+  std::map<const WiFi*, set<uint16_t>> partitions;
+  set<const WiFi*> member_devices;
+  for (const auto& member : members) {
+    member_devices.insert(member.wifi);
+  }
+
+  vector<const ScanDevice*> participants;
+  set<string> phys;
+  std::map<uint16_t, size_t> phy_count_by_frequency;
+  for (const auto& device : scan_devices_) {
+    if (!ContainsKey(member_devices, device.wifi) ||
+        device.frequencies.empty() || !phys.insert(device.phy_name).second) {
+      continue;
+    }
+    participants.push_back(&device);
+    for (uint16_t frequency : device.frequencies) {
+      ++phy_count_by_frequency[frequency];
+    }
+  }
+  if (participants.size() < 2) {
+    return partitions;
+  }
+
+  for (const auto* device : participants) {
+    partitions[device->wifi];
+  }
+  // Place the frequencies that the fewest phys can scan first, so that the
+  // frequencies every phy can scan are left to even out the partitions.
+  for (size_t phy_count = 1; phy_count <= participants.size(); ++phy_count) {
+    for (const auto& frequency_phy_count : phy_count_by_frequency) {
+      if (frequency_phy_count.second != phy_count) {
+        continue;
+      }
+      uint16_t frequency = frequency_phy_count.first;
+      set<uint16_t>* partition = nullptr;
+      for (const auto* device : participants) {
+        if (!ContainsKey(device->frequencies, frequency)) {
+          continue;
+        }
+        set<uint16_t>* candidate = &partitions[device->wifi];
+        if (!partition || candidate->size() < partition->size()) {
+          partition = candidate;
+        }
+      }
+      partition->insert(frequency);
+    }
+  }
+  SLOG(this, 2) << "Partitioned " << phy_count_by_frequency.size()
+                << " scan frequencies across " << participants.size()
+                << " phys";
+  return partitions;
+}
+
+size_t WiFiProvider::GetSightingBucket() const {
+  time_t now = time_->GetSecondsSinceEpoch();
+  struct tm local_time;
+  localtime_r(&now, &local_time);
+  time_t seconds_into_day =
+      (local_time.tm_hour * 60 + local_time.tm_min) * 60 + local_time.tm_sec;
+  // A leap second may take |seconds_into_day| to a full day.
+  return std::min<size_t>(
+      seconds_into_day / (kSecondsPerDay / kSightingTimeOfDayBuckets),
+      kSightingTimeOfDayBuckets - 1);
+}
+
+void WiFiProvider::RecordSighting(uint16_t frequency_mhz) {
+  ConnectFrequencyMap& sightings =
+      sighting_count_by_time_of_day_[GetSightingBucket()];
+  ++sightings[frequency_mhz];
+
+  int64_t total_sightings = 0;
+  for (const auto& freq_count : sightings) {
+    total_sightings += freq_count.second;
+  }
+  if (total_sightings < kMaxSightingsPerBucket) {
+    return;
+  }
+  for (auto it = sightings.begin(); it != sightings.end();) {
+    it->second /= 2;
+    if (it->second == 0) {
+      it = sightings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void WiFiProvider::ReportAutoConnectableServices() {
   int num_services = NumAutoConnectableServices();
   // Only report stats when there are wifi services available.
@@ -21,9 +21,11 @@
 
 #include <deque>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <base/callback.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 
 #include "shill/accessor_interface.h"  // for ByteArrays
@@ -41,6 +43,7 @@ class Manager;
 class Metrics;
 class StoreInterface;
 class Time;
+class WiFi;
 class WiFiEndpoint;
 class WiFiService;
 
@@ -60,10 +63,15 @@ class WiFiProvider : public ProviderInterface {
     FrequencyCount(uint16_t freq, size_t conn)
         : frequency(freq), connection_count(conn) {}
     uint16_t frequency;
-    size_t connection_count;  // Number of successful connections at this
-                              // frequency.
+    size_t connection_count;  // Weight of this frequency: successful
+                              // connections, plus recent sightings (see
+                              // GetScanFrequencies()).
   };
   typedef std::deque<FrequencyCount> FrequencyCountList;
+  // Starts a scan that covers |scan_partition|, or everything the device
+  // can scan if it is empty.
+  typedef base::Callback<void(const std::set<uint16_t>& scan_partition)>
+      ScanPartitionCallback;
 
   WiFiProvider(ControlInterface* control_interface,
                EventDispatcher* dispatcher,
@@ -108,6 +116,10 @@ class WiFiProvider : public ProviderInterface {
   // service, otherwise notify the associated service of the update to
   // the endpoint.
   virtual void OnEndpointUpdated(const WiFiEndpointConstRefPtr& endpoint);
+  // Called by WiFi when only the signal strength of |endpoint| has
+  // changed.  The endpoint keeps its service, which is told directly.
+  virtual void OnEndpointSignalChanged(
+      const WiFiEndpointConstRefPtr& endpoint);
 
   // Called by a WiFiService when it is unloaded and no longer visible.
   virtual bool OnServiceUnloaded(const WiFiServiceRefPtr& service);
@@ -125,9 +137,36 @@ class WiFiProvider : public ProviderInterface {
   virtual void IncrementConnectCount(uint16_t frequency_mhz);
 
   // Returns a list of all of the frequencies on which this device has
-  // connected.  This data is accumulated across multiple shill runs.
+  // connected or recently seen endpoints, weighted by how likely a scan
+  // of each frequency is to find a candidate.  Each connection counts as
+  // |kConnectionSightingWeight| sightings; only sightings made at the
+  // current time of day are counted.  The connection data is accumulated
+  // across multiple shill runs.
   virtual FrequencyCountList GetScanFrequencies() const;
 
+  // Called by a WiFi device once it knows which |frequencies| its phy
+  // |phy_name| can scan, and when it stops.  Scans that devices on more
+  // than one phy start together are split between the phys (see
+  // JoinScanFanOut()).
+  virtual void RegisterScanDevice(const WiFi* wifi,
+                                  const std::string& phy_name,
+                                  const std::set<uint16_t>& frequencies);
+  virtual void DeregisterScanDevice(const WiFi* wifi);
+
+  // Called by the Manager around asking every WiFi device to scan.  While a
+  // fan-out is open, an idle device calls JoinScanFanOut() instead of
+  // starting its scan; FinishScanFanOut() then splits the band between the
+  // phys of the devices that joined and runs each device's |callback| with
+  // its share.  The endpoints each device finds all feed the same services,
+  // so the union of the partitions covers every frequency any of them
+  // supports.  A device that scans outside a fan-out scans everything
+  // itself.
+  virtual void StartScanFanOut();
+  // Returns false, without keeping |callback|, if no fan-out is open.
+  virtual bool JoinScanFanOut(const WiFi* wifi,
+                              const ScanPartitionCallback& callback);
+  virtual void FinishScanFanOut();
+
   // Report the number of auto connectable services available to uma
   // metrics.
   void ReportAutoConnectableServices();
@@ -148,6 +187,7 @@ class WiFiProvider : public ProviderInterface {
   FRIEND_TEST(WiFiProviderTest, FrequencyMapBasicAging);
   FRIEND_TEST(WiFiProviderTest, FrequencyMapToStringList);
   FRIEND_TEST(WiFiProviderTest, FrequencyMapToStringListEmpty);
+  FRIEND_TEST(WiFiProviderTest, GetScanFrequenciesWithSightings);
   FRIEND_TEST(WiFiProviderTest, IncrementConnectCount);
   FRIEND_TEST(WiFiProviderTest, IncrementConnectCountCreateNew);
   FRIEND_TEST(WiFiProviderTest, LoadAndFixupServiceEntriesDefaultProfile);
@@ -158,6 +198,17 @@ class WiFiProvider : public ProviderInterface {
 
   typedef std::map<const WiFiEndpoint*, WiFiServiceRefPtr> EndpointServiceMap;
 
+  struct ScanDevice {
+    const WiFi* wifi;
+    std::string phy_name;
+    std::set<uint16_t> frequencies;
+  };
+
+  struct ScanFanOutMember {
+    const WiFi* wifi;
+    ScanPartitionCallback callback;
+  };
+
   static const char kManagerErrorSSIDTooLong[];
   static const char kManagerErrorSSIDTooShort[];
   static const char kManagerErrorSSIDRequired[];
@@ -171,6 +222,9 @@ class WiFiProvider : public ProviderInterface {
   static const char kStorageId[];
   static const time_t kWeeksToKeepFrequencyCounts;
   static const time_t kSecondsPerWeek;
+  static const int kSightingTimeOfDayBuckets;
+  static const int64_t kMaxSightingsPerBucket;
+  static const int64_t kConnectionSightingWeight;
 
   // Add a service to the service_ vector and register it with the Manager.
   WiFiServiceRefPtr AddService(const std::vector<uint8_t>& ssid,
@@ -178,6 +232,10 @@ class WiFiProvider : public ProviderInterface {
                                const std::string& security,
                                bool is_hidden);
 
+  // Adds |endpoint| to the service it matches, creating that service if
+  // there is none.
+  void AssignEndpoint(const WiFiEndpointConstRefPtr& endpoint);
+
   // Find a service given its properties.
   WiFiServiceRefPtr FindService(const std::vector<uint8_t>& ssid,
                                 const std::string& mode,
@@ -194,6 +252,23 @@ class WiFiProvider : public ProviderInterface {
   void ReportRememberedNetworkCount();
   void ReportServiceSourceMetrics();
 
+  // Returns the index into |sighting_count_by_time_of_day_| for the current
+  // local time of day.
+  size_t GetSightingBucket() const;
+  // Counts a sighting of an endpoint on |frequency_mhz|.  Halves all counts
+  // in the current bucket once it holds |kMaxSightingsPerBucket| sightings,
+  // so that old locations fade out.
+  void RecordSighting(uint16_t frequency_mhz);
+
+  // Returns the share of the band of each of |members| that is registered
+  // in |scan_devices_|.  Only the first such device on each phy takes part,
+  // and only if devices on at least two phys do.  Each frequency goes to
+  // the device with the fewest frequencies so far among those that can scan
+  // it (earliest registered on a tie), so that the phys finish a full scan
+  // in about the same time.
+  std::map<const WiFi*, std::set<uint16_t>> GetScanPartitions(
+      const std::vector<ScanFanOutMember>& members) const;
+
   // Retrieve a WiFi service's identifying properties from passed-in |args|.
   // Returns true if |args| are valid and populates |ssid|, |mode|,
   // |security| and |hidden_ssid|, if successful.  Otherwise, this function
@@ -264,8 +339,20 @@ class WiFiProvider : public ProviderInterface {
   // Count of successful wifi connections we've made.
   int64_t total_frequency_connections_;
 
+  // Number of endpoints seen on each frequency, bucketed by the time of day
+  // at which they were seen.  Unlike the connection counts, these are not
+  // persisted.
+  std::vector<ConnectFrequencyMap> sighting_count_by_time_of_day_;
+
   Time* time_;
 
+  // WiFi devices that can share scans, in registration order.
+  std::vector<ScanDevice> scan_devices_;
+  // Set between StartScanFanOut() and FinishScanFanOut(), along with the
+  // devices that have joined the fan-out so far.
+  bool scan_fan_out_started_;
+  std::vector<ScanFanOutMember> scan_fan_out_members_;
+
   // Disable 802.11ac Very High Throughput (VHT) connections.
   bool disable_vht_;
 
@@ -16,11 +16,15 @@
 
 #include "shill/wifi/wifi_provider.h"
 
+#include <stdlib.h>
+#include <time.h>
+
 #include <map>
 #include <set>
 #include <string>
 #include <vector>
 
+#include <base/bind.h>
 #include <base/format_macros.h>
 #include <base/strings/string_number_conversions.h>
 #include <base/strings/string_util.h>
@@ -71,6 +75,16 @@ const char kIllegalDayProfile[] = "IllegalDay";
 const time_t kSecondsPerWeek = 60 * 60 * 24 * 7;
 const time_t kTestDays = 20;
 
+// Returns the time at |hour|:00 local time on January |day|, 2016.
+time_t LocalTime(int day, int hour) {
+  struct tm local_time = {};
+  local_time.tm_year = 2016 - 1900;
+  local_time.tm_mday = day;
+  local_time.tm_hour = hour;
+  local_time.tm_isdst = -1;
+  return mktime(&local_time);
+}
+
 }  // namespace
 
 class WiFiProviderTest : public testing::Test {
@@ -214,6 +228,29 @@ class WiFiProviderTest : public testing::Test {
     return provider_.running_;
   }
 
+  // Runs a scan fan-out that each of |wifis| joins, and returns the share of
+  // the band each of them is asked to scan.
+  map<const WiFi*, set<uint16_t>> RunScanFanOut(
+      const vector<const WiFi*>& wifis) {
+    map<const WiFi*, set<uint16_t>> partitions;
+    provider_.StartScanFanOut();
+    for (const auto* wifi : wifis) {
+      EXPECT_TRUE(provider_.JoinScanFanOut(
+          wifi, base::Bind(&WiFiProviderTest::SaveScanPartition,
+                           &partitions, wifi)));
+    }
+    EXPECT_TRUE(partitions.empty());
+    provider_.FinishScanFanOut();
+    EXPECT_EQ(wifis.size(), partitions.size());
+    return partitions;
+  }
+
+  static void SaveScanPartition(map<const WiFi*, set<uint16_t>>* partitions,
+                                const WiFi* wifi,
+                                const set<uint16_t>& partition) {
+    (*partitions)[wifi] = partition;
+  }
+
   void AddStringParameterToStorage(MockStore* storage,
                                    const string& id,
                                    const string& key,
@@ -1532,6 +1569,36 @@ TEST_F(WiFiProviderTest, OnEndpointUpdatedWhileStopped) {
   provider_.OnEndpointUpdated(endpoint);
 }
 
+TEST_F(WiFiProviderTest, OnEndpointSignalChanged) {
+  provider_.Start();
+
+  const string ssid("an_ssid");
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(ssid, "00:00:00:00:00:00", 0, 0);
+  const vector<uint8_t> ssid_bytes(ssid.begin(), ssid.end());
+  MockWiFiServiceRefPtr open_service = AddMockService(ssid_bytes,
+                                                      kModeManaged,
+                                                      kSecurityNone,
+                                                      false);
+  EXPECT_CALL(*open_service, AddEndpoint(RefPtrMatch(endpoint)));
+  EXPECT_CALL(manager_, UpdateService(RefPtrMatch(open_service)));
+  provider_.OnEndpointAdded(endpoint);
+  Mock::VerifyAndClearExpectations(open_service.get());
+  Mock::VerifyAndClearExpectations(&manager_);
+
+  // A signal change goes straight to the service without re-matching.
+  EXPECT_CALL(*open_service,
+              NotifyEndpointSignalChanged(RefPtrMatch(endpoint)));
+  EXPECT_CALL(*open_service, NotifyEndpointUpdated(_)).Times(0);
+  EXPECT_CALL(manager_, UpdateService(_)).Times(0);
+  provider_.OnEndpointSignalChanged(endpoint);
+}
+
+TEST_F(WiFiProviderTest, OnEndpointSignalChangedWhileStopped) {
+  const string ssid("an_ssid");
+  WiFiEndpointRefPtr endpoint = MakeEndpoint(ssid, "00:00:00:00:00:00", 0, 0);
+  provider_.OnEndpointSignalChanged(endpoint);
+}
+
 TEST_F(WiFiProviderTest, OnServiceUnloaded) {
   // This function should never unregister services itself -- the Manager
   // will automatically deregister the service if OnServiceUnloaded()
@@ -1840,6 +1907,207 @@ TEST_F(WiFiProviderTest, FrequencyMapAgingIllegalDay) {
   Save();
 }
 
+TEST_F(WiFiProviderTest, GetScanFrequenciesWithSightings) {
+  const time_t kMorning = LocalTime(1, 8);
+  const time_t kEvening = LocalTime(1, 20);
+  provider_.connect_count_by_frequency_[2412] = 2;
+
+  // Endpoints seen in the morning count towards morning scans only.
+  EXPECT_CALL(time_, GetSecondsSinceEpoch()).WillRepeatedly(Return(kMorning));
+  provider_.RecordSighting(2412);
+  provider_.RecordSighting(5180);
+  provider_.RecordSighting(5180);
+  WiFiProvider::FrequencyCountList frequencies =
+      provider_.GetScanFrequencies();
+  ASSERT_EQ(2, frequencies.size());
+  EXPECT_EQ(2412, frequencies[0].frequency);
+  EXPECT_EQ(2 * WiFiProvider::kConnectionSightingWeight + 1,
+            frequencies[0].connection_count);
+  EXPECT_EQ(5180, frequencies[1].frequency);
+  EXPECT_EQ(2, frequencies[1].connection_count);
+
+  EXPECT_CALL(time_, GetSecondsSinceEpoch()).WillRepeatedly(Return(kEvening));
+  frequencies = provider_.GetScanFrequencies();
+  ASSERT_EQ(1, frequencies.size());
+  EXPECT_EQ(2412, frequencies[0].frequency);
+  EXPECT_EQ(2 * WiFiProvider::kConnectionSightingWeight,
+            frequencies[0].connection_count);
+
+  // The same time of day on a later day shares the morning sightings.
+  EXPECT_CALL(time_, GetSecondsSinceEpoch())
+      .WillRepeatedly(Return(LocalTime(1 + kTestDays, 8)));
+  frequencies = provider_.GetScanFrequencies();
+  ASSERT_EQ(2, frequencies.size());
+  EXPECT_EQ(2, frequencies[1].connection_count);
+
+  // A full bucket halves its counts, dropping frequencies seen only once.
+  for (int64_t i = 3; i < WiFiProvider::kMaxSightingsPerBucket; ++i) {
+    provider_.RecordSighting(5745);
+  }
+  frequencies = provider_.GetScanFrequencies();
+  ASSERT_EQ(3, frequencies.size());
+  EXPECT_EQ(2412, frequencies[0].frequency);
+  EXPECT_EQ(2 * WiFiProvider::kConnectionSightingWeight,
+            frequencies[0].connection_count);
+  EXPECT_EQ(5180, frequencies[1].frequency);
+  EXPECT_EQ(1, frequencies[1].connection_count);
+  EXPECT_EQ(5745, frequencies[2].frequency);
+  EXPECT_EQ((WiFiProvider::kMaxSightingsPerBucket - 3) / 2,
+            frequencies[2].connection_count);
+}
+
+TEST_F(WiFiProviderTest, SightingsUseLocalTimeOfDay) {
+  const char* saved_tz = getenv("TZ");
+  const string saved_tz_value(saved_tz ? saved_tz : "");
+  // Ten hours ahead of UTC, without daylight saving time.
+  setenv("TZ", "XST-10", 1);
+  tzset();
+  const time_t kHour = 60 * 60;
+
+  // 20:00 UTC is 06:00 local time.
+  EXPECT_CALL(time_, GetSecondsSinceEpoch())
+      .WillRepeatedly(Return(20 * kHour));
+  provider_.RecordSighting(5180);
+  // 19:00 UTC is 05:00 local time, the same time of day.
+  EXPECT_CALL(time_, GetSecondsSinceEpoch())
+      .WillRepeatedly(Return(19 * kHour));
+  EXPECT_EQ(1, provider_.GetScanFrequencies().size());
+  // 23:30 UTC is 09:30 local time, a different time of day.
+  EXPECT_CALL(time_, GetSecondsSinceEpoch())
+      .WillRepeatedly(Return(23 * kHour + 30 * 60));
+  EXPECT_TRUE(provider_.GetScanFrequencies().empty());
+
+  if (saved_tz) {
+    setenv("TZ", saved_tz_value.c_str(), 1);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+TEST_F(WiFiProviderTest, ScanPartitionSinglePhy) {
+  // The provider never dereferences the devices it partitions scans for.
+  const WiFi* wifi0 = reinterpret_cast<const WiFi*>(0x10);
+  const WiFi* wifi1 = reinterpret_cast<const WiFi*>(0x20);
+  const set<uint16_t> frequencies{2412, 2437, 5180};
+
+  provider_.RegisterScanDevice(wifi0, "phy0", frequencies);
+  EXPECT_TRUE(RunScanFanOut({wifi0})[wifi0].empty());
+
+  // A second interface on the same phy shares its radio, so there is still
+  // nothing to split.
+  provider_.RegisterScanDevice(wifi1, "phy0", frequencies);
+  map<const WiFi*, set<uint16_t>> partitions = RunScanFanOut({wifi0, wifi1});
+  EXPECT_TRUE(partitions[wifi0].empty());
+  EXPECT_TRUE(partitions[wifi1].empty());
+}
+
+TEST_F(WiFiProviderTest, ScanPartitionTwoPhys) {
+  const WiFi* wifi0 = reinterpret_cast<const WiFi*>(0x10);
+  const WiFi* wifi1 = reinterpret_cast<const WiFi*>(0x20);
+  const WiFi* unregistered = reinterpret_cast<const WiFi*>(0x30);
+
+  provider_.RegisterScanDevice(wifi0, "phy0",
+                               set<uint16_t>{2412, 2437, 2462, 5180, 5200});
+  provider_.RegisterScanDevice(wifi1, "phy1",
+                               set<uint16_t>{2412, 2437, 2462});
+
+  // Scans started outside a fan-out are not held back.
+  EXPECT_FALSE(provider_.JoinScanFanOut(
+      wifi0, WiFiProvider::ScanPartitionCallback()));
+
+  // Frequencies only one phy supports are placed first; the shared ones
+  // even out the partitions.
+  map<const WiFi*, set<uint16_t>> partitions =
+      RunScanFanOut({wifi0, wifi1, unregistered});
+  EXPECT_EQ((set<uint16_t>{2462, 5180, 5200}), partitions[wifi0]);
+  EXPECT_EQ((set<uint16_t>{2412, 2437}), partitions[wifi1]);
+  EXPECT_TRUE(partitions[unregistered].empty());
+
+  // A device whose peer does not take part in the fan-out scans everything
+  // itself.
+  EXPECT_TRUE(RunScanFanOut({wifi0})[wifi0].empty());
+  EXPECT_TRUE(RunScanFanOut({wifi1, unregistered})[wifi1].empty());
+
+  // Re-registering replaces a device's frequencies.
+  provider_.RegisterScanDevice(wifi1, "phy1",
+                               set<uint16_t>{2412, 2437, 2462, 5180, 5200});
+  partitions = RunScanFanOut({wifi0, wifi1});
+  EXPECT_EQ((set<uint16_t>{2412, 2462, 5200}), partitions[wifi0]);
+  EXPECT_EQ((set<uint16_t>{2437, 5180}), partitions[wifi1]);
+
+  // Once only one phy remains, it scans everything itself.
+  provider_.DeregisterScanDevice(wifi1);
+  partitions = RunScanFanOut({wifi0, wifi1});
+  EXPECT_TRUE(partitions[wifi0].empty());
+  EXPECT_TRUE(partitions[wifi1].empty());
+}
+
+TEST_F(WiFiProviderTest, ScanPartitionThreePhys) {
+  const set<uint16_t> frequencies{2412, 2437, 2462, 5180, 5200, 5220};
+  const vector<const WiFi*> wifis{
+    reinterpret_cast<const WiFi*>(0x10),
+    reinterpret_cast<const WiFi*>(0x20),
+    reinterpret_cast<const WiFi*>(0x30),
+  };
+  for (size_t i = 0; i < wifis.size(); ++i) {
+    provider_.RegisterScanDevice(wifis[i], StringPrintf("phy%" PRIuS, i),
+                                 frequencies);
+  }
+
+  // Each phy scans a third of the band, and together they cover all of it.
+  map<const WiFi*, set<uint16_t>> partitions = RunScanFanOut(wifis);
+  set<uint16_t> covered;
+  for (const auto* wifi : wifis) {
+    EXPECT_EQ(frequencies.size() / wifis.size(), partitions[wifi].size());
+    for (uint16_t frequency : partitions[wifi]) {
+      EXPECT_TRUE(covered.insert(frequency).second);
+    }
+  }
+  EXPECT_EQ(frequencies, covered);
+  EXPECT_EQ((set<uint16_t>{2412, 5180}), partitions[wifis[0]]);
+
+  // When only two of them take part, those two still cover the whole band.
+  partitions = RunScanFanOut({wifis[0], wifis[2]});
+  EXPECT_EQ(frequencies.size() / 2, partitions[wifis[0]].size());
+  EXPECT_EQ(frequencies.size() / 2, partitions[wifis[2]].size());
+  covered = partitions[wifis[0]];
+  covered.insert(partitions[wifis[2]].begin(), partitions[wifis[2]].end());
+  EXPECT_EQ(frequencies, covered);
+}
+
+TEST_F(WiFiProviderTest, OnEndpointAddedRecordsSighting) {
+  provider_.Start();
+  const string ssid("an_ssid");
+  const vector<uint8_t> ssid_bytes(ssid.begin(), ssid.end());
+  MockWiFiServiceRefPtr service =
+      AddMockService(ssid_bytes, kModeManaged, kSecurityNone, false);
+  WiFiEndpointRefPtr endpoint =
+      MakeEndpoint(ssid, "00:00:00:00:00:00", 5180, 0);
+  EXPECT_CALL(*service, AddEndpoint(RefPtrMatch(endpoint)));
+  EXPECT_CALL(manager_, UpdateService(RefPtrMatch(service)));
+  provider_.OnEndpointAdded(endpoint);
+
+  WiFiProvider::FrequencyCountList frequencies =
+      provider_.GetScanFrequencies();
+  ASSERT_EQ(1, frequencies.size());
+  EXPECT_EQ(5180, frequencies[0].frequency);
+  EXPECT_EQ(1, frequencies[0].connection_count);
+
+  // Moving the endpoint to another service is not a new sighting.
+  MockWiFiServiceRefPtr rsn_service =
+      AddMockService(ssid_bytes, kModeManaged, kSecurityRsn, false);
+  EXPECT_CALL(*service, RemoveEndpoint(RefPtrMatch(endpoint)));
+  EXPECT_CALL(*service, HasEndpoints()).WillOnce(Return(true));
+  EXPECT_CALL(*rsn_service, AddEndpoint(RefPtrMatch(endpoint)));
+  EXPECT_CALL(manager_, UpdateService(_)).Times(2);
+  endpoint->set_security_mode(kSecurityRsn);
+  provider_.OnEndpointUpdated(endpoint);
+  frequencies = provider_.GetScanFrequencies();
+  ASSERT_EQ(1, frequencies.size());
+  EXPECT_EQ(1, frequencies[0].connection_count);
+}
+
 TEST_F(WiFiProviderTest, IncrementConnectCount) {
   const time_t kThisWeek = kFirstWeek +
       WiFiProvider::kWeeksToKeepFrequencyCounts - 1;
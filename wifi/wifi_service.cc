@@ -97,6 +97,7 @@ WiFiService::WiFiService(ControlInterface* control_interface,
       raw_signal_strength_(0),
       cipher_8021x_(kCryptoNone),
       suspected_credential_failures_(0),
+      representative_endpoint_(nullptr),
       ssid_(ssid),
       ieee80211w_required_(false),
       expecting_disconnect_(false),
@@ -255,6 +256,27 @@ void WiFiService::NotifyEndpointUpdated(
   UpdateFromEndpoints();
 }
 
+void WiFiService::NotifyEndpointSignalChanged(
+    const WiFiEndpointConstRefPtr& endpoint) {
+  DCHECK(endpoints_.find(endpoint) != endpoints_.end());
+  int16_t signal = endpoint->signal_strength();
+  if (endpoint.get() == representative_endpoint_) {
+    // The current endpoint represents the service regardless of its signal,
+    // and any other representative is still the strongest if it got
+    // stronger.
+    if (current_endpoint_ || signal >= raw_signal_strength_) {
+      raw_signal_strength_ = signal;
+      SetStrength(SignalToStrength(signal));
+      return;
+    }
+  } else if (current_endpoint_ ||
+             (representative_endpoint_ && signal < raw_signal_strength_)) {
+    // This endpoint cannot displace the representative endpoint.
+    return;
+  }
+  UpdateFromEndpoints();
+}
+
 string WiFiService::GetStorageIdentifier() const {
   return storage_identifier_;
 }
@@ -448,7 +470,7 @@ bool WiFiService::Unload() {
 
 void WiFiService::SetState(ConnectState state) {
   Service::SetState(state);
-  NotifyPropertyChanges();
+  NotifyPropertyChange(kVisibleProperty);
 }
 
 bool WiFiService::IsSecurityMatch(const string& security) const {
@@ -797,6 +819,7 @@ void WiFiService::UpdateFromEndpoints() {
     LOG(WARNING) << "Service " << unique_name()
                  << " will disconnect due to no remaining endpoints.";
   }
+  representative_endpoint_ = representative_endpoint;
 
   SetWiFi(wifi);
 
@@ -859,7 +882,7 @@ void WiFiService::UpdateFromEndpoints() {
   adaptor()->EmitUint16sChanged(kWifiFrequencyListProperty, frequency_list_);
   SetStrength(SignalToStrength(signal));
   UpdateSecurity();
-  NotifyPropertyChanges();
+  NotifyPropertyChange(kVisibleProperty);
 }
 
 void WiFiService::UpdateSecurity() {
@@ -78,6 +78,11 @@ class WiFiService : public Service {
   // Called to inform of changes in the properties of an endpoint.
   // (Not necessarily the currently connected endpoint.)
   virtual void NotifyEndpointUpdated(const WiFiEndpointConstRefPtr& endpoint);
+  // Called to inform that only the signal strength of |endpoint| has
+  // changed.  Unless this can change which endpoint represents the
+  // service, only the service strength is updated.
+  virtual void NotifyEndpointSignalChanged(
+      const WiFiEndpointConstRefPtr& endpoint);
 
   // wifi_<MAC>_<BSSID>_<mode_string>_<security_string>
   std::string GetStorageIdentifier() const override;
@@ -376,6 +381,9 @@ class WiFiService : public Service {
   WiFiRefPtr wifi_;
   std::set<WiFiEndpointConstRefPtr> endpoints_;
   WiFiEndpointConstRefPtr current_endpoint_;
+  // The endpoint chosen by the last UpdateFromEndpoints() call.  It is
+  // always either nullptr or a member of |endpoints_|.
+  const WiFiEndpoint* representative_endpoint_;
   const std::vector<uint8_t> ssid_;
   // Track whether IEEE 802.11w (Protected Management Frame) support is
   // mandated by one or more endpoints we have seen that provide this service.
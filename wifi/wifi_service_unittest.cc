@@ -1620,6 +1620,58 @@ TEST_F(WiFiServiceUpdateFromEndpointsTest, EndpointModified) {
   Mock::VerifyAndClearExpectations(&adaptor);
 }
 
+TEST_F(WiFiServiceUpdateFromEndpointsTest, EndpointSignalChanged) {
+  EXPECT_CALL(adaptor, EmitUint16Changed(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitStringChanged(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitUint8Changed(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitBoolChanged(_, _)).Times(AnyNumber());
+  service->AddEndpoint(ok_endpoint);
+  service->AddEndpoint(good_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+
+  // A weaker Endpoint that stays weaker doesn't touch the Service.
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _)).Times(0);
+  EXPECT_CALL(adaptor, EmitUint8Changed(_, _)).Times(0);
+  ok_endpoint->signal_strength_ = (kOkEndpointSignal + kGoodEndpointSignal) / 2;
+  service->NotifyEndpointSignalChanged(ok_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+
+  // A stronger optimal Endpoint updates only the Service strength.
+  EXPECT_CALL(adaptor, EmitUint16Changed(_, _)).Times(0);
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _)).Times(0);
+  EXPECT_CALL(adaptor, EmitStringChanged(_, _)).Times(0);
+  EXPECT_CALL(adaptor, EmitUint8Changed(kSignalStrengthProperty, _));
+  good_endpoint->signal_strength_ = kGoodEndpointSignal + 1;
+  service->NotifyEndpointSignalChanged(good_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+  EXPECT_EQ(WiFiService::SignalToStrength(kGoodEndpointSignal + 1),
+            service->strength());
+
+  // A weaker optimal Endpoint may hand over to another Endpoint.
+  EXPECT_CALL(adaptor, EmitUint16Changed(kWifiFrequency, kOkEndpointFrequency));
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _));
+  EXPECT_CALL(adaptor, EmitStringChanged(kWifiBSsid, kOkEndpointBssId));
+  EXPECT_CALL(adaptor, EmitUint8Changed(kSignalStrengthProperty, _));
+  good_endpoint->signal_strength_ = kOkEndpointSignal;
+  service->NotifyEndpointSignalChanged(good_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+
+  // Once a current Endpoint is set, no other Endpoint can displace it.
+  EXPECT_CALL(adaptor, EmitUint16Changed(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitStringChanged(_, _)).Times(AnyNumber());
+  EXPECT_CALL(adaptor, EmitUint8Changed(_, _)).Times(AnyNumber());
+  service->NotifyCurrentEndpoint(good_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+  EXPECT_CALL(adaptor, EmitUint16sChanged(_, _)).Times(0);
+  EXPECT_CALL(adaptor, EmitUint8Changed(_, _)).Times(0);
+  ok_endpoint->signal_strength_ = kGoodEndpointSignal + 10;
+  service->NotifyEndpointSignalChanged(ok_endpoint);
+  Mock::VerifyAndClearExpectations(&adaptor);
+  EXPECT_EQ(kGoodEndpointBssId, service->bssid());
+}
+
 TEST_F(WiFiServiceUpdateFromEndpointsTest, Ieee80211w) {
   EXPECT_CALL(adaptor, EmitUint16Changed(_, _)).Times(AnyNumber());
   EXPECT_CALL(adaptor, EmitStringChanged(_, _)).Times(AnyNumber());
@@ -2083,7 +2135,8 @@ TEST_F(WiFiServiceTest, GetTethering) {
   // If this endpoint reports the right vendor OUI, we should suspect
   // it to be tethered.  However since this evaluation normally only
   // happens in the endpoint constructor, we must force it to recalculate.
-  endpoint_ios->vendor_information_.oui_set.insert(Tethering::kIosOui);
+  endpoint_ios->mutable_vendor_information()->oui_set.insert(
+      Tethering::kIosOui);
   endpoint_ios->CheckForTetheringSignature();
   EXPECT_EQ(kTetheringSuspectedState, service->GetTethering(nullptr));
 
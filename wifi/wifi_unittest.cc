@@ -79,6 +79,7 @@
 #include "shill/test_event_dispatcher.h"
 #include "shill/testing.h"
 #include "shill/wifi/mock_mac80211_monitor.h"
+#include "shill/wifi/mock_roam_scorer.h"
 #include "shill/wifi/mock_scan_session.h"
 #include "shill/wifi/mock_tdls_manager.h"
 #include "shill/wifi/mock_wake_on_wifi.h"
@@ -120,6 +121,7 @@ using ::testing::ReturnNew;
 using ::testing::ReturnRef;
 using ::testing::SaveArg;
 using ::testing::SetArgumentPointee;
+using ::testing::SizeIs;
 using ::testing::StrEq;
 using ::testing::StrictMock;
 using ::testing::Test;
@@ -588,6 +590,7 @@ class WiFiObjectTest : public ::testing::TestWithParam<string> {
         mac80211_monitor_(new StrictMock<MockMac80211Monitor>(
             dispatcher, kDeviceName, WiFi::kStuckQueueLengthThreshold,
             base::Closure(), &metrics_)),
+        roam_scorer_(new NiceMock<MockRoamScorer>()),
         supplicant_process_proxy_(new NiceMock<MockSupplicantProcessProxy>()),
         supplicant_bss_proxy_(new NiceMock<MockSupplicantBSSProxy>()),
         dhcp_config_(new MockDHCPConfig(&control_interface_, kDeviceName)),
@@ -597,6 +600,7 @@ class WiFiObjectTest : public ::testing::TestWithParam<string> {
             new NiceMock<MockSupplicantInterfaceProxy>()),
         supplicant_network_proxy_(new NiceMock<MockSupplicantNetworkProxy>()) {
     wifi_->mac80211_monitor_.reset(mac80211_monitor_);
+    wifi_->roam_scorer_.reset(roam_scorer_);
     wifi_->supplicant_process_proxy_.reset(supplicant_process_proxy_);
     InstallMockScanSession();
     ON_CALL(*supplicant_process_proxy_, CreateInterface(_, _))
@@ -1026,6 +1030,9 @@ class WiFiObjectTest : public ::testing::TestWithParam<string> {
   void NotifyEndpointChanged(const WiFiEndpointConstRefPtr& endpoint) {
     wifi_->NotifyEndpointChanged(endpoint);
   }
+  void NotifyEndpointSignalChanged(const WiFiEndpointConstRefPtr& endpoint) {
+    wifi_->NotifyEndpointSignalChanged(endpoint);
+  }
   bool RemoveNetwork(const string& network) {
     return wifi_->RemoveNetwork(network);
   }
@@ -1308,6 +1315,10 @@ class WiFiObjectTest : public ::testing::TestWithParam<string> {
     return mac80211_monitor_;
   }
 
+  MockRoamScorer* roam_scorer() {
+    return roam_scorer_;
+  }
+
   void ReportConnectedToServiceAfterWake() {
     wifi_->ReportConnectedToServiceAfterWake();
   }
@@ -1357,6 +1368,7 @@ class WiFiObjectTest : public ::testing::TestWithParam<string> {
   NiceMock<MockWiFiProvider> wifi_provider_;
   int bss_counter_;
   MockMac80211Monitor* mac80211_monitor_;  // Owned by |wifi_|.
+  MockRoamScorer* roam_scorer_;  // Owned by |wifi_|.
 
   // protected fields interspersed between private fields, due to
   // initialization order
@@ -1682,6 +1694,15 @@ TEST_F(WiFiMainTest, NotifyEndpointChanged) {
   NotifyEndpointChanged(endpoint);
 }
 
+TEST_F(WiFiMainTest, NotifyEndpointSignalChanged) {
+  WiFiEndpointRefPtr endpoint =
+      MakeEndpointWithMode("ssid", "00:00:00:00:00:00", kNetworkModeAdHoc);
+  EXPECT_CALL(*wifi_provider(),
+              OnEndpointSignalChanged(EndpointMatch(endpoint)));
+  EXPECT_CALL(*wifi_provider(), OnEndpointUpdated(_)).Times(0);
+  NotifyEndpointSignalChanged(endpoint);
+}
+
 TEST_F(WiFiMainTest, RemoveNetwork) {
   string network = "/test/path";
   StartWiFi();
@@ -1910,6 +1931,22 @@ TEST_F(WiFiMainTest, ResumeDoesNotScanIfConnected) {
   InstallMockScanSession();
   SetCurrentService(MakeMockService(kSecurityNone));
   EXPECT_CALL(*scan_session_, InitiateScan()).Times(0);
+  EXPECT_CALL(*scan_session_, ReportCandidateFound());
+  dispatcher_.DispatchPendingEvents();
+}
+
+TEST_F(WiFiMainTest, ProgressiveScanIgnoresUserConnect) {
+  StartWiFi();
+  dispatcher_.DispatchPendingEvents();
+  ReportScanDone();
+  dispatcher_.DispatchPendingEvents();
+  OnAfterResume();
+  InstallMockScanSession();
+  MockWiFiServiceRefPtr service = MakeMockService(kSecurityNone);
+  EXPECT_CALL(*service, is_in_user_connect()).WillRepeatedly(Return(true));
+  SetPendingService(service);
+  EXPECT_CALL(*scan_session_, InitiateScan()).Times(0);
+  EXPECT_CALL(*scan_session_, ReportCandidateFound()).Times(0);
   dispatcher_.DispatchPendingEvents();
 }
 
@@ -2656,6 +2693,86 @@ TEST_F(WiFiMainTest, ProgressiveScanError) {
   VerifyScanState(WiFi::kScanIdle, WiFi::kScanMethodNone);
 }
 
+// Verifies that a NetlinkMessage is an NL80211_CMD_TRIGGER_SCAN message for
+// exactly the set of |frequencies|.
+MATCHER_P(ScansFrequencies, frequencies, "") {
+  const Nl80211Message* msg = static_cast<const Nl80211Message*>(arg);
+  if (msg->command() != NL80211_CMD_TRIGGER_SCAN) {
+    return false;
+  }
+  AttributeListConstRefPtr frequency_list;
+  if (!msg->const_attributes()->ConstGetNestedAttributeList(
+      NL80211_ATTR_SCAN_FREQUENCIES, &frequency_list)) {
+    return false;
+  }
+  set<uint16_t> scan_frequencies;
+  AttributeIdIterator freq_iter(*frequency_list);
+  for (; !freq_iter.AtEnd(); freq_iter.Advance()) {
+    uint32_t frequency = 0;
+    if (frequency_list->GetU32AttributeValue(freq_iter.GetId(), &frequency)) {
+      scan_frequencies.insert(frequency);
+    }
+  }
+  return scan_frequencies == frequencies;
+}
+
+TEST_F(WiFiMainTest, PartitionedScan) {
+  // Another phy in the same scan fan-out covers the rest of the band, so
+  // this one only scans its share, and does not fall back to a supplicant
+  // scan once done.
+  const set<uint16_t> kPartition{2412, 5180};
+  WiFiProvider::ScanPartitionCallback start_scan;
+  EXPECT_CALL(*wifi_provider(), JoinScanFanOut(wifi().get(), _))
+      .WillOnce(DoAll(SaveArg<1>(&start_scan), Return(true)));
+  EXPECT_CALL(*GetSupplicantInterfaceProxy(), Scan(_)).Times(0);
+  SetScanSize(1, 1);
+  ClearScanSession();  // Clear Mock ScanSession to get an actual ScanSession.
+  StartWiFi();  // Joins the fan-out instead of scanning.
+  VerifyScanState(WiFi::kScanIdle, WiFi::kScanMethodNone);
+  start_scan.Run(kPartition);  // Posts |ProgressiveScanTask|.
+
+  // A progressive scan walks through the partition a batch at a time.
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(
+      ScansFrequencies(set<uint16_t>{2412}), _, _, _));
+  dispatcher_.DispatchPendingEvents();
+  VerifyScanState(WiFi::kScanScanning, WiFi::kScanMethodProgressive);
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(
+      ScansFrequencies(set<uint16_t>{5180}), _, _, _));
+  ReportScanDoneKeepScanSession();
+  dispatcher_.DispatchPendingEvents();
+  ExpectScanStop();
+  ExpectFoundNothing();
+  ReportScanDoneKeepScanSession();
+  dispatcher_.DispatchPendingEvents();
+  VerifyScanState(WiFi::kScanIdle, WiFi::kScanMethodNone);
+  EXPECT_TRUE(IsScanSessionNull());
+
+  // A full scan covers the whole partition at once.
+  EXPECT_CALL(*wifi_provider(), JoinScanFanOut(wifi().get(), _))
+      .WillOnce(DoAll(SaveArg<1>(&start_scan), Return(true)));
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(
+      ScansFrequencies(kPartition), _, _, _));
+  TriggerScan(WiFi::kScanMethodFull);
+  start_scan.Run(kPartition);
+  dispatcher_.DispatchPendingEvents();
+  VerifyScanState(WiFi::kScanScanning, WiFi::kScanMethodProgressive);
+}
+
+TEST_F(WiFiMainTest, UnpartitionedFanOutScan) {
+  // No other phy joined the fan-out, so a progressive scan that runs out of
+  // frequencies still falls back to a full supplicant scan.
+  WiFiProvider::ScanPartitionCallback start_scan;
+  EXPECT_CALL(*wifi_provider(), JoinScanFanOut(wifi().get(), _))
+      .WillOnce(DoAll(SaveArg<1>(&start_scan), Return(true)));
+  StartWiFi();  // Joins the fan-out instead of scanning.
+  start_scan.Run(set<uint16_t>());  // Posts |ProgressiveScanTask|.
+  EXPECT_CALL(*scan_session_, HasMoreFrequencies()).WillOnce(Return(false));
+  EXPECT_CALL(*GetSupplicantInterfaceProxy(), Scan(_));
+  dispatcher_.DispatchPendingEvents();
+  VerifyScanState(WiFi::kScanScanning,
+                  WiFi::kScanMethodProgressiveFinishedToFull);
+}
+
 TEST_F(WiFiMainTest, InitialSupplicantState) {
   EXPECT_EQ(WiFi::kInterfaceStateUnknown, GetSupplicantState());
 }
@@ -3045,6 +3162,328 @@ TEST_F(WiFiMainTest, FlushBSSOnResume) {
   ReportScanDone();
 }
 
+TEST_F(WiFiMainTest, ResumeCacheRestoresEndpoints) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service;
+  const string bss_path(MakeNewEndpointAndService(
+      WiFi::kMinResumeCacheSignalDbm, 2412, kNetworkModeInfrastructure,
+      &endpoint, &service));
+  service->SetAutoConnect(true);
+  service->SetHasEverConnected(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(160), Return(true)));
+  OnBeforeSuspend();
+
+  // Supplicant forgets the endpoint while we are suspended.
+  RemoveBSS(bss_path);
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(endpoint)));
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  OnAfterResume();
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  // A fresh report of the same BSS retires the restored endpoint.
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(endpoint)));
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(EndpointMatch(endpoint)))
+      .WillOnce(Return(nullptr));
+  ReportBSS(bss_path, string(endpoint->ssid().begin(), endpoint->ssid().end()),
+            endpoint->bssid_string(),
+            WiFi::kMinResumeCacheSignalDbm, 2412, kNetworkModeInfrastructure);
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  // Having been merged, the endpoint is not expired after the scan.
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(_)).Times(0);
+  ReportScanDone();
+}
+
+TEST_F(WiFiMainTest, ResumeCacheSkipsWeakOrUnknownEndpoints) {
+  StartWiFi();
+  MockWiFiServiceRefPtr weak_service;
+  const string weak_path(MakeNewEndpointAndService(
+      WiFi::kMinResumeCacheSignalDbm - 1, 2412, kNetworkModeInfrastructure,
+      nullptr, &weak_service));
+  weak_service->SetAutoConnect(true);
+  weak_service->SetHasEverConnected(true);
+  MockWiFiServiceRefPtr new_service;
+  const string new_path(MakeNewEndpointAndService(
+      0, 2412, kNetworkModeInfrastructure, nullptr, &new_service));
+  new_service->SetAutoConnect(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(101), Return(true)));
+  OnBeforeSuspend();
+  RemoveBSS(weak_path);
+  RemoveBSS(new_path);
+
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(_)).Times(0);
+  OnAfterResume();
+}
+
+TEST_F(WiFiMainTest, ResumeCacheExpired) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service;
+  const string bss_path(MakeNewEndpointAndService(
+      0, 2412, kNetworkModeInfrastructure, &endpoint, &service));
+  service->SetAutoConnect(true);
+  service->SetHasEverConnected(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(
+          SetArgumentPointee<0>(101 + WiFi::kMaxResumeCacheAgeSeconds),
+          Return(true)));
+  OnBeforeSuspend();
+  RemoveBSS(bss_path);
+
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(_)).Times(0);
+  OnAfterResume();
+}
+
+TEST_F(WiFiMainTest, ResumeCacheExpiresUnseenEndpoints) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service;
+  const string bss_path(MakeNewEndpointAndService(
+      0, 2412, kNetworkModeInfrastructure, &endpoint, &service));
+  service->SetAutoConnect(true);
+  service->SetHasEverConnected(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(110), Return(true)));
+  OnBeforeSuspend();
+  RemoveBSS(bss_path);
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(endpoint)));
+  OnAfterResume();
+
+  // The first scan after resume did not find the endpoint again.
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(EndpointMatch(endpoint)))
+      .WillOnce(Return(nullptr));
+  ReportScanDone();
+}
+
+TEST_F(WiFiMainTest, ResumeCacheExpiresEndpointsAfterPendingFailure) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service;
+  const string bss_path(MakeNewEndpointAndService(
+      0, 2412, kNetworkModeInfrastructure, &endpoint, &service));
+  service->SetAutoConnect(true);
+  service->SetHasEverConnected(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(110), Return(true)));
+  OnBeforeSuspend();
+  RemoveBSS(bss_path);
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(endpoint)));
+  OnAfterResume();
+
+  // The endpoint is kept while auto-connect is trying its service.
+  SetPendingService(service);
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(_)).Times(0);
+  ReportScanDone();
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  // Once the attempt fails, the endpoint is retired.
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(EndpointMatch(endpoint)))
+      .WillOnce(Return(nullptr));
+  ReportCurrentBSSChanged(WPASupplicant::kCurrentBSSNull);
+  EXPECT_EQ(nullptr, GetPendingService().get());
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(_)).Times(0);
+  ReportScanDone();
+}
+
+TEST_F(WiFiMainTest, ResumeCacheExpiresEndpointsOnLaterScan) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service;
+  const string bss_path(MakeNewEndpointAndService(
+      0, 2412, kNetworkModeInfrastructure, &endpoint, &service));
+  service->SetAutoConnect(true);
+  service->SetHasEverConnected(true);
+
+  EXPECT_CALL(time_, GetSecondsBoottime(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(100), Return(true)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(110), Return(true)));
+  OnBeforeSuspend();
+  RemoveBSS(bss_path);
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointAdded(EndpointMatch(endpoint)));
+  OnAfterResume();
+  SetPendingService(service);
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(_)).Times(0);
+  ReportScanDone();
+  Mock::VerifyAndClearExpectations(wifi_provider());
+
+  // The service is no longer pending, so the next scan retires the endpoint
+  // even though the flush after resume has already happened.
+  SetPendingService(nullptr);
+  EXPECT_CALL(*wifi_provider(), FindServiceForEndpoint(EndpointMatch(endpoint)))
+      .WillRepeatedly(Return(service));
+  EXPECT_CALL(*wifi_provider(), OnEndpointRemoved(EndpointMatch(endpoint)))
+      .WillOnce(Return(nullptr));
+  ReportScanDone();
+}
+
+TEST_F(WiFiMainTest, ReportResumeToConnected) {
+  StartWiFi();
+  const struct timeval resume_time = {1, 0};
+  const struct timeval connected_time = {3, 500000};
+  EXPECT_CALL(time_, GetTimeMonotonic(_))
+      .WillOnce(DoAll(SetArgumentPointee<0>(resume_time), Return(0)))
+      .WillOnce(DoAll(SetArgumentPointee<0>(connected_time), Return(0)));
+  OnAfterResume();
+
+  EXPECT_CALL(*metrics(),
+              SendToUMA(Metrics::kMetricWifiResumeToConnectedMilliseconds,
+                        2500, _, _, _));
+  wifi()->OnConnected();
+  Mock::VerifyAndClearExpectations(metrics());
+
+  // Only the first connection after resume is reported.
+  EXPECT_CALL(*metrics(),
+              SendToUMA(Metrics::kMetricWifiResumeToConnectedMilliseconds,
+                        _, _, _, _)).Times(0);
+  wifi()->OnConnected();
+}
+
+TEST_F(WiFiMainTest, EvaluateRoamCandidatesOnScanDone) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService("", &endpoint, nullptr);
+  EXPECT_CALL(*service, IsConnected()).WillRepeatedly(Return(true));
+  WiFiEndpointRefPtr candidate;
+  AddEndpointToService(service, -50, 5180, kNetworkModeInfrastructure,
+                       &candidate);
+
+  // No better candidate.
+  EXPECT_CALL(*roam_scorer(), SelectRoamCandidate(_, SizeIs(1)))
+      .WillOnce(Return(nullptr));
+  EXPECT_CALL(*GetSupplicantInterfaceProxy(), Roam(_)).Times(0);
+  ReportScanDone();
+  Mock::VerifyAndClearExpectations(roam_scorer());
+  Mock::VerifyAndClearExpectations(GetSupplicantInterfaceProxy());
+
+  EXPECT_CALL(*roam_scorer(), SelectRoamCandidate(_, SizeIs(1)))
+      .WillOnce(Return(candidate));
+  EXPECT_CALL(*GetSupplicantInterfaceProxy(), Roam(candidate->bssid_string()))
+      .WillOnce(Return(true));
+  ReportScanDone();
+  Mock::VerifyAndClearExpectations(roam_scorer());
+  Mock::VerifyAndClearExpectations(GetSupplicantInterfaceProxy());
+
+  // Leave connection attempts in progress alone.
+  SetPendingService(MakeMockService(kSecurityNone));
+  EXPECT_CALL(*roam_scorer(), SelectRoamCandidate(_, _)).Times(0);
+  ReportScanDone();
+}
+
+TEST_F(WiFiMainTest, ScanDoneRecordsSteadySignals) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService("", &endpoint, nullptr);
+  WiFiEndpointRefPtr candidate;
+  AddEndpointToService(service, -50, 5180, kNetworkModeInfrastructure,
+                       &candidate);
+
+  // Seeing the same signal again is not reported by the endpoints, so each
+  // scan records a fresh sample for both of them.
+  EXPECT_CALL(*roam_scorer(), RecordSignal(_)).Times(2);
+  ReportScanDone();
+  Mock::VerifyAndClearExpectations(roam_scorer());
+}
+
+TEST_F(WiFiMainTest, ScanForRoamCandidatesWhenDegrading) {
+  StartWiFi();
+  WiFiEndpointRefPtr endpoint;
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService("", &endpoint, nullptr);
+  EXPECT_CALL(*service, IsConnected()).WillRepeatedly(Return(true));
+  EXPECT_CALL(time_, GetSecondsMonotonic(_))
+      .WillRepeatedly(DoAll(SetArgumentPointee<0>(100), Return(true)));
+
+  // A single-endpoint service has nowhere to roam.
+  EXPECT_CALL(*roam_scorer(), IsDegrading(_)).WillRepeatedly(Return(true));
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(0);
+  wifi()->NotifyEndpointSignalChanged(endpoint);
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+
+  AddEndpointToService(service, -50, 5180, kNetworkModeInfrastructure,
+                       nullptr);
+  EXPECT_CALL(netlink_manager_,
+              SendNl80211Message(IsNl80211Command(kNl80211FamilyId,
+                                                  TriggerScanMessage::kCommand),
+                                 _, _, _));
+  wifi()->NotifyEndpointSignalChanged(endpoint);
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+
+  // Scans are rate limited.
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(0);
+  wifi()->NotifyEndpointSignalChanged(endpoint);
+  Mock::VerifyAndClearExpectations(&netlink_manager_);
+
+  // A healthy link is not scanned for.
+  EXPECT_CALL(time_, GetSecondsMonotonic(_))
+      .WillRepeatedly(DoAll(SetArgumentPointee<0>(
+          100 + WiFi::kMinRoamScanIntervalSeconds), Return(true)));
+  EXPECT_CALL(*roam_scorer(), IsDegrading(_)).WillRepeatedly(Return(false));
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(_, _, _, _)).Times(0);
+  wifi()->NotifyEndpointSignalChanged(endpoint);
+}
+
+TEST_F(WiFiMainTest, RoamScorerRecordsFailuresAndRoams) {
+  StartWiFi();
+  string kPath("/fake/path");
+  WiFiEndpointRefPtr endpoint;
+  EXPECT_CALL(*roam_scorer(), RecordRoam(string(), _));
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService(kPath, &endpoint, nullptr);
+  Mock::VerifyAndClearExpectations(roam_scorer());
+
+  WiFiEndpointRefPtr endpoint2;
+  const string bss_path2(AddEndpointToService(
+      service, -50, 5180, kNetworkModeInfrastructure, &endpoint2));
+  EXPECT_CALL(*roam_scorer(),
+              RecordRoam(endpoint->bssid_string(), endpoint2->bssid_string()));
+  ReportCurrentBSSChanged(bss_path2);
+  Mock::VerifyAndClearExpectations(roam_scorer());
+
+  // Supplicant falls off the BSS without being asked to.
+  unique_ptr<MockSupplicantNetworkProxy> network_proxy(
+      new MockSupplicantNetworkProxy());
+  EXPECT_CALL(*control_interface(),
+              CreateSupplicantNetworkProxy(kPath))
+      .WillOnce(ReturnAndReleasePointee(&network_proxy));
+  EXPECT_CALL(*network_proxy, SetEnabled(false)).WillOnce(Return(true));
+  EXPECT_CALL(*roam_scorer(), RecordFailure(endpoint2->bssid_string()));
+  ReportCurrentBSSChanged(WPASupplicant::kCurrentBSSNull);
+}
+
 TEST_F(WiFiMainTest, CallWakeOnWiFi_OnScanDone) {
   StartWiFi();
 
@@ -3437,10 +3876,34 @@ class WiFiTimerTest : public WiFiObjectTest {
 
  protected:
   void ExpectInitialScanSequence();
+  void ReportStationInfo(int8_t signal, uint32_t packets);
 
   StrictMock<MockEventDispatcher> mock_dispatcher_;
 };
 
+void WiFiTimerTest::ReportStationInfo(int8_t signal, uint32_t packets) {
+  NewStationMessage new_station;
+  WiFiEndpointRefPtr endpoint = GetEndpointMap().begin()->second;
+  new_station.attributes()->CreateRawAttribute(NL80211_ATTR_MAC, "BSSID");
+  new_station.attributes()->SetRawAttributeValue(
+      NL80211_ATTR_MAC, ByteString::CreateFromHexString(endpoint->bssid_hex()));
+  new_station.attributes()->CreateNestedAttribute(
+      NL80211_ATTR_STA_INFO, "Station Info");
+  AttributeListRefPtr station_info;
+  new_station.attributes()->GetNestedAttributeList(
+      NL80211_ATTR_STA_INFO, &station_info);
+  station_info->CreateU8Attribute(NL80211_STA_INFO_SIGNAL, "Signal");
+  station_info->SetU8AttributeValue(NL80211_STA_INFO_SIGNAL, signal);
+  station_info->CreateU32Attribute(NL80211_STA_INFO_RX_PACKETS,
+                                   "ReceivedSuccesses");
+  station_info->SetU32AttributeValue(NL80211_STA_INFO_RX_PACKETS, packets);
+  station_info->CreateU32Attribute(NL80211_STA_INFO_TX_PACKETS,
+                                   "TransmitSuccesses");
+  station_info->SetU32AttributeValue(NL80211_STA_INFO_TX_PACKETS, 0);
+  new_station.attributes()->SetNestedAttributeHasAValue(NL80211_ATTR_STA_INFO);
+  ReportReceivedStationInfo(new_station);
+}
+
 void WiFiTimerTest::ExpectInitialScanSequence() {
   // Choose a number of iterations some multiple higher than the fast scan
   // count.
@@ -3636,7 +4099,8 @@ TEST_F(WiFiTimerTest, RequestStationInfo) {
   new_station.attributes()->SetNestedAttributeHasAValue(NL80211_ATTR_STA_INFO);
 
   EXPECT_NE(kSignalValue, endpoint->signal_strength());
-  EXPECT_CALL(*wifi_provider(), OnEndpointUpdated(EndpointMatch(endpoint)));
+  EXPECT_CALL(*wifi_provider(),
+              OnEndpointSignalChanged(EndpointMatch(endpoint)));
   EXPECT_CALL(*metrics(), NotifyWifiTxBitrate(kBitrate/10));
   AttributeListConstRefPtr station_info_prime;
   ReportReceivedStationInfo(new_station);
@@ -3715,6 +4179,93 @@ TEST_F(WiFiTimerTest, RequestStationInfo) {
             link_statistics.LookupString(kTransmitBitrateProperty, ""));
 }
 
+TEST_F(WiFiTimerTest, RequestStationInfoAdaptsPeriod) {
+  EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(AnyNumber());
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(AnyNumber());
+  StartWiFi();
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService("", nullptr, nullptr);
+  EXPECT_CALL(*service, IsConnected()).WillRepeatedly(Return(true));
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // The first sample has nothing to be compared against.
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(0);
+  ReportStationInfo(-50, 1000);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Poll faster while the signal is dropping.
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoFastPeriodSeconds * 1000));
+  ReportStationInfo(-50 - WiFi::kStationInfoSignalDropDb, 1000);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Keep polling faster while the stronger sample is still recent.
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(0);
+  for (size_t i = 1; i < WiFi::kStationInfoSignalWindow; ++i) {
+    ReportStationInfo(-50 - WiFi::kStationInfoSignalDropDb, 1000);
+  }
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Return to the normal period once the link is stable and idle.
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoPeriodSeconds * 1000));
+  ReportStationInfo(-50 - WiFi::kStationInfoSignalDropDb, 1001);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Poll faster while traffic is flowing.
+  const uint32_t kActivePackets = WiFi::kStationInfoActivePacketsPerSecond *
+                                  WiFi::kRequestStationInfoPeriodSeconds;
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoFastPeriodSeconds * 1000));
+  ReportStationInfo(-50 - WiFi::kStationInfoSignalDropDb,
+                    1001 + kActivePackets);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // The next request uses the fast period.
+  EXPECT_CALL(netlink_manager_, SendNl80211Message(
+      IsNl80211Command(kNl80211FamilyId, NL80211_CMD_GET_STATION), _, _, _));
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoFastPeriodSeconds * 1000));
+  RequestStationInfo();
+}
+
+TEST_F(WiFiTimerTest, RequestStationInfoTracksSlowDeclineAndWeakSignal) {
+  EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(AnyNumber());
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(AnyNumber());
+  StartWiFi();
+  MockWiFiServiceRefPtr service =
+      SetupConnectedService("", nullptr, nullptr);
+  EXPECT_CALL(*service, IsConnected()).WillRepeatedly(Return(true));
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // A signal declining by less than kStationInfoSignalDropDb per sample
+  // switches to the fast period once the total drop is large enough.
+  const int kStepDb = 2;
+  ASSERT_LT(kStepDb, WiFi::kStationInfoSignalDropDb);
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(0);
+  ReportStationInfo(-50, 1000);
+  ReportStationInfo(-50 - kStepDb, 1000);
+  ReportStationInfo(-50 - 2 * kStepDb, 1000);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoFastPeriodSeconds * 1000));
+  ReportStationInfo(-50 - 3 * kStepDb, 1000);
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // A weak signal keeps the fast period even once it stops changing.
+  const int kWeakSignalDbm = WiFi::kStationInfoWeakSignalDbm - 5;
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(0);
+  for (size_t i = 0; i <= WiFi::kStationInfoSignalWindow; ++i) {
+    ReportStationInfo(kWeakSignalDbm, 1000);
+  }
+  Mock::VerifyAndClearExpectations(&mock_dispatcher_);
+
+  // Recovering from a weak signal returns to the normal period.
+  EXPECT_CALL(mock_dispatcher_, PostDelayedTask(
+      _, WiFi::kRequestStationInfoPeriodSeconds * 1000));
+  ReportStationInfo(WiFi::kStationInfoWeakSignalDbm + 5, 1000);
+}
+
 TEST_F(WiFiTimerTest, ResumeDispatchesConnectivityReportTask) {
   EXPECT_CALL(mock_dispatcher_, PostTask(_)).Times(AnyNumber());
   EXPECT_CALL(mock_dispatcher_, PostDelayedTask(_, _)).Times(AnyNumber());
@@ -4356,6 +4907,10 @@ TEST_F(WiFiMainTest, OnNewWiphy) {
   EXPECT_CALL(*mac80211_monitor(), Start(_));
   EXPECT_CALL(*wake_on_wifi_, ParseWakeOnWiFiCapabilities(_));
   EXPECT_CALL(*wake_on_wifi_, OnWiphyIndexReceived(kNewWiphyNlMsg_WiphyIndex));
+  EXPECT_CALL(*wifi_provider(),
+              RegisterScanDevice(wifi().get(), _,
+                                 SizeIs(arraysize(
+                                     kNewWiphyNlMsg_UniqueFrequencies))));
   GetAllScanFrequencies()->clear();
   OnNewWiphy(new_wiphy_message);
   EXPECT_EQ(arraysize(kNewWiphyNlMsg_UniqueFrequencies),
@@ -4414,18 +4969,39 @@ TEST_F(WiFiMainTest, OnBeforeSuspend_CallsWakeOnWiFi) {
   SetWiFiEnabled(true);
   EXPECT_CALL(
       *wake_on_wifi_,
-      OnBeforeSuspend(IsConnectedToCurrentService(), _, _, _, _, _, _));
+      OnBeforeSuspend(IsConnectedToCurrentService(), _, _, _, _, _, _, _));
   EXPECT_CALL(*this, SuspendCallback(_)).Times(0);
   OnBeforeSuspend();
 
   SetWiFiEnabled(false);
-  EXPECT_CALL(*wake_on_wifi_,
-              OnBeforeSuspend(IsConnectedToCurrentService(), _, _, _, _, _, _))
+  EXPECT_CALL(
+      *wake_on_wifi_,
+      OnBeforeSuspend(IsConnectedToCurrentService(), _, _, _, _, _, _, _))
       .Times(0);
   EXPECT_CALL(*this, SuspendCallback(ErrorTypeIs(Error::kSuccess)));
   OnBeforeSuspend();
 }
 
+TEST_F(WiFiMainTest, OnBeforeSuspend_PassesDarkResumeScanFrequencies) {
+  StartWiFi();
+  MockWiFiServiceRefPtr auto_connect_service;
+  MakeNewEndpointAndService(0, 2412, kNetworkModeInfrastructure, nullptr,
+                            &auto_connect_service);
+  auto_connect_service->SetAutoConnect(true);
+  MockWiFiServiceRefPtr other_service;
+  MakeNewEndpointAndService(0, 5180, kNetworkModeInfrastructure, nullptr,
+                            &other_service);
+  other_service->SetAutoConnect(false);
+
+  // Only the frequencies of auto-connect services are worth scanning in dark
+  // resume.
+  WiFi::FreqSet expected_freqs;
+  expected_freqs.insert(2412);
+  EXPECT_CALL(*wake_on_wifi_,
+              OnBeforeSuspend(_, _, expected_freqs, _, _, _, _, _));
+  OnBeforeSuspend();
+}
+
 TEST_F(WiFiMainTest, OnDarkResume_CallsWakeOnWiFi) {
   SetWiFiEnabled(true);
   EXPECT_CALL(*wake_on_wifi_,
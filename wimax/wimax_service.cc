@@ -101,7 +101,7 @@ void WiMaxService::Stop() {
     SetDevice(nullptr);
   }
   UpdateConnectable();
-  NotifyPropertyChanges();
+  NotifyPropertyChange(kVisibleProperty);
 }
 
 bool WiMaxService::Start(WiMaxNetworkProxyInterface* proxy) {
@@ -139,7 +139,7 @@ bool WiMaxService::Start(WiMaxNetworkProxyInterface* proxy) {
       Bind(&WiMaxService::OnSignalStrengthChanged, Unretained(this)));
   proxy_.reset(local_proxy.release());
   UpdateConnectable();
-  NotifyPropertyChanges();
+  NotifyPropertyChange(kVisibleProperty);
   LOG(INFO) << "WiMAX service started: " << GetStorageIdentifier();
   return true;
 }